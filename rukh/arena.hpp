@@ -0,0 +1,143 @@
+//
+// file : arena.hpp
+// in : file:///home/tim/projects/rukh/rukh/arena.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:08:11 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace rukh
+{
+  /// \brief A chunked bump allocator
+  /// Allocations are never freed individually: the whole arena is reset at once (and the chunks are kept for reuse).
+  /// \warning The arena does not call destructors
+  class arena
+  {
+    public:
+      static constexpr size_t k_default_chunk_size = 64 * 1024;
+
+    public:
+      explicit arena(size_t _chunk_size = k_default_chunk_size) : chunk_size(_chunk_size) {}
+      arena(arena&&) = default;
+      arena& operator = (arena&&) = default;
+
+      /// \brief Return the size of the chunks allocated by the arena
+      size_t get_chunk_size() const { return chunk_size; }
+
+      /// \brief Allocate memory (never returns nullptr)
+      void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+      {
+        for (;;)
+        {
+          if (current < chunks.size())
+          {
+            chunk& c = chunks[current];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(c.data.get());
+            const uintptr_t ptr = (base + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+            if (ptr + size <= base + c.size)
+            {
+              offset = ptr + size - base;
+              used += size;
+              return reinterpret_cast<void*>(ptr);
+            }
+            // try the next chunk (from a previous reset)
+            ++current;
+            offset = 0;
+            continue;
+          }
+
+          // allocate a new chunk, big enough for the allocation
+          const size_t size_with_alignment = size + alignment;
+          const size_t new_size = size_with_alignment > chunk_size ? size_with_alignment : chunk_size;
+          chunks.push_back({std::make_unique<uint8_t[]>(new_size), new_size});
+          current = chunks.size() - 1;
+          offset = 0;
+        }
+      }
+
+      /// \brief Allocate and construct an object
+      template<typename Type, typename... Args>
+      Type* create(Args&&... args)
+      {
+        return new (allocate(sizeof(Type), alignof(Type))) Type(std::forward<Args>(args)...);
+      }
+
+      /// \brief Allocate an (uninitialized) array of trivial objects
+      template<typename Type>
+      Type* allocate_array(size_t count)
+      {
+        return reinterpret_cast<Type*>(allocate(sizeof(Type) * count, alignof(Type)));
+      }
+
+      /// \brief Make all the memory available again (without freeing the chunks)
+      void reset()
+      {
+        current = 0;
+        offset = 0;
+        used = 0;
+      }
+
+      /// \brief Free every chunk
+      void release()
+      {
+        chunks.clear();
+        reset();
+      }
+
+      /// \brief Return the number of bytes allocated since the last reset (without the alignment padding)
+      size_t get_used_size() const { return used; }
+
+      /// \brief Return the number of bytes reserved by the arena
+      size_t get_reserved_size() const
+      {
+        size_t ret = 0;
+        for (const chunk& c : chunks)
+          ret += c.size;
+        return ret;
+      }
+
+    private:
+      struct chunk
+      {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+      };
+
+    private:
+      size_t chunk_size;
+      std::vector<chunk> chunks;
+      size_t current = 0; // chunk currently used
+      size_t offset = 0; // offset in the current chunk
+      size_t used = 0;
+  };
+} // namespace rukh
@@ -0,0 +1,317 @@
+//
+// file : cast_matrix.hpp
+// in : file:///home/tim/projects/rukh/rukh/cast_matrix.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:05:10 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "type.hpp"
+#include "type_set.hpp"
+
+namespace rukh
+{
+  class type_db;
+
+  /// \brief Costs of casts, as used for overload resolution (lower is better)
+  namespace cast_cost
+  {
+    constexpr uint16_t exact = 0;
+    constexpr uint16_t meta = 1; // the argument is accepted by a meta-type parameter
+    constexpr uint16_t lossless_hop = 2; // per implicit lossless cast in the chain
+    constexpr uint16_t lossy_hop = 4; // per implicit lossy cast in the chain
+    constexpr uint16_t explicit_hop = 16; // per explicit cast in the chain
+
+    constexpr uint16_t none = 0xFFFF; // no cast possible
+  } // namespace cast_cost
+
+  /// \brief Information about the best chain of casts from a type to another
+  struct cast_info
+  {
+    /// \brief implicit: there is a chain of implicit casts, lossless: there is a chain of lossless casts
+    /// constant / generates_ir: for the cheapest chain
+    type::cast_type flags = type::cast_type::none;
+    uint16_t cost = cast_cost::none; // cost of the cheapest chain (0 for the identity)
+
+    bool is_possible() const { return cost != cast_cost::none; }
+    bool is_implicit() const { return (flags & type::cast_type::implicit) != type::cast_type::none; }
+    bool is_lossless() const { return (flags & type::cast_type::lossless) != type::cast_type::none; }
+
+    /// \brief The identity cast
+    static constexpr cast_info identity()
+    {
+      return {type::cast_type::implicit | type::cast_type::lossless | type::cast_type::constant, cast_cost::exact};
+    }
+  };
+
+  /// \brief Result of an overload resolution
+  struct overload_match
+  {
+    static constexpr size_t npos = ~size_t(0);
+
+    size_t index = npos; // index of the best candidate, npos if no candidate matches
+    uint32_t cost = ~0u; // total cost of the implicit casts of the best candidate
+    bool ambiguous = false; // more than one candidate have the best cost
+
+    bool found() const { return index != npos; }
+  };
+
+  /// \brief Find the candidate parameter list that is the cheapest to call with the given arguments
+  /// \param cost must return the cost (cast_cost) of passing an argument to a parameter (cast_cost::none if not possible)
+  template<typename CostFnc>
+  overload_match find_best_overload(const std::vector<type::ref>& args, const std::vector<std::vector<type::ref>>& candidates, CostFnc&& cost)
+  {
+    overload_match ret;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+      const std::vector<type::ref>& params = candidates[i];
+      if (params.size() != args.size())
+        continue;
+
+      uint32_t total = 0;
+      bool possible = true;
+      for (size_t j = 0; possible && j < args.size(); ++j)
+      {
+        const uint16_t c = cost(args[j], params[j]);
+        possible = c != cast_cost::none;
+        total += c;
+      }
+      if (!possible)
+        continue;
+
+      if (total < ret.cost)
+        ret = {i, total, false};
+      else if (total == ret.cost)
+        ret.ambiguous = true;
+    }
+    return ret;
+  }
+
+  /// \brief Transitive closure of the cast_into fields of the concrete types of a type_db, as a dense matrix
+  ///
+  /// Only concrete types that are the source or the target of a cast are in the matrix (they are given a
+  /// dense cast index), other types can only be casted into themselves.
+  /// The matrix is updated incrementally: only the rows of new types, and of types that can reach a type that gained
+  /// new casts, are recomputed.
+  /// \note The functions of cast_into are only called once per cast, when the cast is added to the matrix
+  class cast_matrix
+  {
+    public:
+      static constexpr uint32_t k_no_index = ~0u;
+
+    public:
+      /// \brief Process the definitions that have been added to the DB since the last update
+      /// \note Implemented in type_db.hpp
+      void update(const type_db& db);
+
+      /// \brief Return the cast index of a definition (or k_no_index)
+      uint32_t get_cast_index(uint32_t definition_index) const
+      {
+        return definition_index < cast_indices.size() ? cast_indices[definition_index] : k_no_index;
+      }
+
+      /// \brief Return the definition index of a cast index
+      uint32_t get_definition_index(uint32_t cast_index) const { return cast_types[cast_index]; }
+
+      /// \brief Return the cast info between two cast indices
+      cast_info get(uint32_t from, uint32_t to) const
+      {
+        const cell& c = cells[size_t(from) * stride + to];
+        return {static_cast<type::cast_type>(c.flags), c.cost};
+      }
+
+      /// \brief Number of types in the matrix
+      uint32_t size() const { return static_cast<uint32_t>(cast_types.size()); }
+
+    private:
+      struct cell
+      {
+        uint16_t flags = 0;
+        uint16_t cost = cast_cost::none;
+      };
+
+      struct edge
+      {
+        uint32_t target; // cast index
+        type::cast_type flags;
+      };
+
+      struct pending_edge
+      {
+        uint32_t source; // cast index
+        type::ref target;
+        type::cast_type flags;
+      };
+
+      uint32_t ensure_index(uint32_t definition_index)
+      {
+        if (cast_indices.size() <= definition_index)
+          cast_indices.resize(definition_index + 1, k_no_index);
+        if (cast_indices[definition_index] == k_no_index)
+        {
+          cast_indices[definition_index] = size();
+          cast_types.push_back(definition_index);
+          edges.emplace_back();
+          reach.emplace_back();
+        }
+        return cast_indices[definition_index];
+      }
+
+      /// \brief Make room for the new types (keeping the existing rows)
+      void grow(uint32_t count)
+      {
+        if (count <= stride)
+          return;
+        const uint32_t new_stride = count > stride * 2 ? count : stride * 2;
+        std::vector<cell> new_cells(size_t(new_stride) * new_stride);
+        for (uint32_t i = 0; i < stride; ++i)
+        {
+          for (uint32_t j = 0; j < stride; ++j)
+            new_cells[size_t(i) * new_stride + j] = cells[size_t(i) * stride + j];
+        }
+        cells = std::move(new_cells);
+        stride = new_stride;
+      }
+
+      /// \brief Compute the row of a type (every cast chains starting from that type)
+      void compute_row(uint32_t from)
+      {
+        using ct = type::cast_type;
+        constexpr ct k_and_flags = ct::implicit | ct::lossless | ct::constant;
+        const uint32_t count = size();
+
+        // flags of a chain extended by a cast:
+        const auto extend = [](ct chain, ct cast)
+        {
+          return (chain & cast & k_and_flags) | ((chain | cast) & ct::generates_ir);
+        };
+
+        // cheapest chain (dijkstra), only following implicit casts or following all of them:
+        const auto cheapest = [&](bool implicit_only, std::vector<uint32_t>& dist, std::vector<ct>& chain)
+        {
+          dist.assign(count, ~0u);
+          chain.assign(count, ct::none);
+          using entry = std::pair<uint32_t, uint32_t>; // (cost, index)
+          std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+          dist[from] = 0;
+          chain[from] = k_and_flags;
+          queue.push({0, from});
+          while (!queue.empty())
+          {
+            const auto [d, u] = queue.top();
+            queue.pop();
+            if (d != dist[u])
+              continue;
+            for (const edge& e : edges[u])
+            {
+              const bool implicit = (e.flags & ct::implicit) != ct::none;
+              if (implicit_only && !implicit)
+                continue;
+              const bool lossless = (e.flags & ct::lossless) != ct::none;
+              const uint32_t w = !implicit ? cast_cost::explicit_hop : (lossless ? cast_cost::lossless_hop : cast_cost::lossy_hop);
+              if (d + w < dist[e.target])
+              {
+                dist[e.target] = d + w;
+                chain[e.target] = extend(chain[u], e.flags);
+                queue.push({d + w, e.target});
+              }
+            }
+          }
+        };
+
+        std::vector<uint32_t> implicit_dist;
+        std::vector<ct> implicit_chain;
+        std::vector<uint32_t> any_dist;
+        std::vector<ct> any_chain;
+        cheapest(true, implicit_dist, implicit_chain);
+        cheapest(false, any_dist, any_chain);
+
+        // lossless chains (bfs):
+        std::vector<bool> lossless(count, false);
+        std::vector<uint32_t> stack = {from};
+        lossless[from] = true;
+        while (!stack.empty())
+        {
+          const uint32_t u = stack.back();
+          stack.pop_back();
+          for (const edge& e : edges[u])
+          {
+            if ((e.flags & ct::lossless) != ct::none && !lossless[e.target])
+            {
+              lossless[e.target] = true;
+              stack.push_back(e.target);
+            }
+          }
+        }
+
+        type_set& row_reach = reach[from];
+        row_reach = type_set(count);
+        for (uint32_t to = 0; to < count; ++to)
+        {
+          cell& c = cells[size_t(from) * stride + to];
+          c = {};
+          ct flags = ct::none;
+          uint32_t cost = cast_cost::none;
+          if (implicit_dist[to] != ~0u)
+          {
+            flags = implicit_chain[to];
+            cost = implicit_dist[to];
+          }
+          else if (any_dist[to] != ~0u)
+          {
+            flags = any_chain[to] & ~ct::implicit;
+            cost = any_dist[to];
+          }
+          else
+          {
+            continue;
+          }
+          flags = (flags & ~ct::lossless) | (lossless[to] ? ct::lossless : ct::none);
+
+          row_reach.set(to);
+          c.flags = static_cast<uint16_t>(flags);
+          c.cost = static_cast<uint16_t>(cost < cast_cost::none ? cost : cast_cost::none - 1);
+        }
+      }
+
+    private:
+      uint32_t processed = 0; // number of definitions that have been processed
+
+      std::vector<uint32_t> cast_indices; // definition index -> cast index
+      std::vector<uint32_t> cast_types; // cast index -> definition index
+      std::vector<std::vector<edge>> edges; // [cast index] direct casts
+      std::vector<pending_edge> pending; // casts to types that are not (yet) defined
+      std::vector<type_set> reach; // [cast index] set of types that can be reached from a type
+
+      std::vector<cell> cells;
+      uint32_t stride = 0;
+  };
+} // namespace rukh
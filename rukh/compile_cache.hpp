@@ -0,0 +1,600 @@
+//
+// file : compile_cache.hpp
+// in : file:///home/tim/projects/rukh/rukh/compile_cache.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:50:47 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "generator.hpp"
+#include "hash_table.hpp"
+#include "node.hpp"
+#include "span.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  /// \brief A content-addressed cache of the results of the nodes (resolution and generated IR)
+  ///
+  /// Entries are keyed by the structural hash of a node (see hash_node): a Merkle hash of the node (its name, params,
+  /// internal state and input types) and of the structural hashes of the nodes connected to its inputs. Two nodes with
+  /// the same structural hash are the roots of identical subgraphs, so they have the same results:
+  ///  - the resolution: the types of the outputs and the constants set by const_generate()
+  ///  - the generated IR: the operations emitted by generate(), with their operands recorded relative to the node
+  ///    (inputs of the node, previous operations of the node or constants), so that they can be emitted again
+  ///    in any generator (see recorder / replay)
+  ///
+  /// The resolver and the pass_runner use the cache (see resolver::set_cache and pass_runner::generate) to skip the
+  /// nodes they find in it. Caching is opt-in: only the nodes that are cacheable (see base_node::is_cacheable) are
+  /// looked up and stored. Only successful resolutions are stored (so that errors are always reported), and the
+  /// logs of the nodes found in the cache are not replayed.
+  ///
+  /// Entries are kept in memory and, when the cache has a directory, written to it (one file per entry, named after
+  /// the key), so that other processes using the same directory find them.
+  ///
+  /// \note The cache is thread-safe. Entries are immutable: storing an entry with the same key replaces it,
+  ///       the previous one stays valid for as long as it is referenced.
+  class compile_cache
+  {
+    public:
+      static constexpr uint32_t k_magic = 'R' | ('K' << 8) | ('C' << 16) | ('E' << 24);
+      static constexpr uint32_t k_version = 1;
+
+      /// \brief References to values, in the recorded IR: 2 bits of kind, 30 bits of index
+      enum class ref_kind : uint32_t
+      {
+        input = 0, // the value of an input pin of the node
+        local = 1, // the value defined by a previous operation of the node
+        constant = 2, // a constant of the entry
+        none = 3,
+      };
+      static constexpr uint32_t k_no_ref = ~0u;
+
+      static constexpr uint32_t make_ref(ref_kind k, uint32_t index) { return (static_cast<uint32_t>(k) << 30) | (index & 0x3FFFFFFF); }
+      static constexpr ref_kind get_ref_kind(uint32_t ref) { return static_cast<ref_kind>(ref >> 30); }
+      static constexpr uint32_t get_ref_index(uint32_t ref) { return ref & 0x3FFFFFFF; }
+
+      struct constant
+      {
+        type::ref value_type;
+        uint32_t offset; // in entry::data
+        uint32_t size;
+      };
+
+      struct operation
+      {
+        opcode op;
+        uint8_t reserved;
+        uint16_t operand_count;
+        uint32_t first_operand; // in entry::operands
+        uint32_t immediate;
+        uint32_t reserved2;
+        type::ref result_type;
+      };
+
+      struct entry
+      {
+        // resolution:
+        bool has_resolution = false;
+        std::vector<type::ref> output_types; // [output count]
+        std::vector<uint32_t> output_constants; // [output count] index in constants, or k_no_ref
+
+        // generated IR:
+        bool has_ir = false;
+        std::vector<operation> operations;
+        std::vector<uint32_t> operands; // refs
+        std::vector<uint32_t> output_refs; // [output count] value of the outputs after generate()
+
+        // constants of both parts:
+        std::vector<constant> constants;
+        std::vector<uint8_t> data;
+
+        /// \brief Add a constant and return its index
+        uint32_t add_constant(type::ref t, span<const uint8_t> bytes)
+        {
+          constants.push_back({t, static_cast<uint32_t>(data.size()), static_cast<uint32_t>(bytes.size())});
+          data.insert(data.end(), bytes.begin(), bytes.end());
+          return static_cast<uint32_t>(constants.size() - 1);
+        }
+
+        span<const uint8_t> get_data(const constant& c) const { return {data.data() + c.offset, c.size}; }
+      };
+
+      struct stats
+      {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t disk_hits = 0; // (included in hits)
+        uint32_t stores = 0;
+      };
+
+      class recorder;
+
+    public:
+      /// \param _directory where the entries are written / read (entries are only kept in memory if empty)
+      /// \param _salt mixed in the structural hashes (see hash_node): a version of the nodes, to be changed when they
+      ///        give other results for the same structural hash, so that the entries of the previous versions (in the
+      ///        directory) are not used anymore
+      explicit compile_cache(std::string _directory = {}, uint64_t _salt = 0) : directory(std::move(_directory)), salt(_salt) {}
+
+      /// \brief Return the entry stored under a key (the memory first, then the directory), or nullptr
+      std::shared_ptr<const entry> find(hash_t key);
+
+      /// \brief Store (or replace) an entry
+      void store(hash_t key, entry&& e);
+
+      /// \brief Remove every entry from the memory (the directory is left as is)
+      void clear()
+      {
+        std::lock_guard<std::mutex> _l(lock);
+        indices.clear();
+        entries.clear();
+      }
+
+      size_t size() const
+      {
+        std::lock_guard<std::mutex> _l(lock);
+        return entries.size();
+      }
+
+      stats get_stats() const
+      {
+        std::lock_guard<std::mutex> _l(lock);
+        return result;
+      }
+
+      const std::string& get_directory() const { return directory; }
+
+      uint64_t get_salt() const { return salt; }
+
+    public: // helpers
+      /// \brief Compute the structural hash of a node
+      /// \param inputs_hash a combination of the structural hashes of the nodes connected to the inputs
+      ///        (with the pins they are connected by, see resolver)
+      /// \param salt the salt of the cache the hash is used with (see get_salt)
+      /// \note The input types of the node must have been set
+      static hash_t hash_node(const base_node& node, const value_table& values, uint64_t inputs_hash, uint64_t salt);
+
+      /// \brief Make the resolution part of an entry from a resolved node
+      /// \return false if the node cannot be cached (an output is set to a non-constant value)
+      static bool make_resolution(const base_node& node, const value_table& values, entry& e);
+
+      /// \brief Set the output types and constants of a node from an entry
+      /// \return false if the entry does not match the node
+      static bool apply_resolution(const entry& e, base_node& node, value_table& values);
+
+      /// \brief Emit the recorded IR of an entry, with the values of the inputs of the node, and set the outputs
+      /// \return false if the entry does not match the node (nothing is emitted then)
+      static bool replay(const entry& e, base_node& node, value_table& values, generator& gen);
+
+    private:
+      std::string get_path(hash_t key) const
+      {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.rkc", static_cast<unsigned long long>(key));
+        return directory + "/" + name;
+      }
+
+      static std::vector<uint8_t> serialize(const entry& e);
+      static bool deserialize(span<const uint8_t> bytes, entry& e);
+
+      bool write_entry(hash_t key, const entry& e) const;
+      bool read_entry(hash_t key, entry& e) const;
+
+    private:
+      const std::string directory;
+      const uint64_t salt;
+
+      mutable std::mutex lock;
+      hash_table<uint32_t> indices; // key -> index in entries
+      std::vector<std::shared_ptr<const entry>> entries;
+      stats result;
+  };
+
+  /// \brief A generator that forwards the operations to another generator and records them in an entry
+  /// (the recording is dropped if the node uses a value that is not one of its inputs, nor a constant)
+  class compile_cache::recorder : public generator
+  {
+    public:
+      recorder(generator& _target, const value_table& _values, span<const pin_impl> _inputs, entry& _e)
+        : target(_target), values(_values), inputs(_inputs), e(_e)
+      {
+        e.has_ir = false;
+        e.operations.clear();
+        e.operands.clear();
+        e.output_refs.clear();
+      }
+
+      using generator::emit;
+      value emit(opcode op, type::ref result_type, span<const value> operands, uint32_t immediate = 0) override
+      {
+        const value ret = target.emit(op, result_type, operands, immediate);
+        if (!recording)
+          return ret;
+
+        const uint32_t first_operand = static_cast<uint32_t>(e.operands.size());
+        for (const value it : operands)
+        {
+          const uint32_t ref = get_ref(it);
+          if (ref == k_no_ref)
+          {
+            recording = false;
+            return ret;
+          }
+          e.operands.push_back(ref);
+        }
+        e.operations.push_back({op, 0, static_cast<uint16_t>(operands.size()), first_operand, immediate, 0, result_type});
+        locals.push_back(ret);
+        return ret;
+      }
+
+      /// \brief Record the values of the outputs of the node (after generate())
+      /// \return whether or not the IR has been recorded
+      bool finish(span<const pin_impl> outputs)
+      {
+        if (!recording)
+          return false;
+        for (const pin_impl& it : outputs)
+        {
+          const uint32_t ref = it.get_value().is_valid() ? get_ref(it.get_value()) : k_no_ref;
+          if (it.get_value().is_valid() && ref == k_no_ref)
+            return false;
+          e.output_refs.push_back(ref);
+        }
+        e.has_ir = true;
+        return true;
+      }
+
+    private:
+      uint32_t get_ref(value v)
+      {
+        if (!v.is_valid())
+          return k_no_ref;
+        for (uint32_t i = 0; i < inputs.size(); ++i)
+        {
+          if (inputs[i].get_value() == v)
+            return make_ref(ref_kind::input, i);
+        }
+        for (uint32_t i = static_cast<uint32_t>(locals.size()); i > 0; --i)
+        {
+          if (locals[i - 1] == v)
+            return make_ref(ref_kind::local, i - 1);
+        }
+        if (values.is_constant(v))
+          return make_ref(ref_kind::constant, e.add_constant(values.get_type(v), values.get_data(v)));
+        return k_no_ref;
+      }
+
+    private:
+      generator& target;
+      const value_table& values;
+      span<const pin_impl> inputs;
+      entry& e;
+      std::vector<value> locals; // [operation index] value returned by the target
+      bool recording = true;
+  };
+
+
+  // // // // //
+  // // // // //
+  // // // // //
+
+
+  inline std::shared_ptr<const compile_cache::entry> compile_cache::find(hash_t key)
+  {
+    {
+      std::lock_guard<std::mutex> _l(lock);
+      if (const uint32_t* index = indices.find(key); index != nullptr)
+      {
+        ++result.hits;
+        return entries[*index];
+      }
+    }
+
+    entry e;
+    if (directory.empty() || !read_entry(key, e))
+    {
+      std::lock_guard<std::mutex> _l(lock);
+      ++result.misses;
+      return {};
+    }
+
+    std::shared_ptr<const entry> ret = std::make_shared<const entry>(std::move(e));
+    std::lock_guard<std::mutex> _l(lock);
+    ++result.hits;
+    ++result.disk_hits;
+    const auto [index, inserted] = indices.insert(key, static_cast<uint32_t>(entries.size()));
+    if (!inserted) // (found by another thread in the mean time)
+      return entries[*index];
+    entries.push_back(ret);
+    return ret;
+  }
+
+  inline void compile_cache::store(hash_t key, entry&& e)
+  {
+    std::shared_ptr<const entry> ptr = std::make_shared<const entry>(std::move(e));
+    if (!directory.empty())
+      write_entry(key, *ptr);
+
+    std::lock_guard<std::mutex> _l(lock);
+    ++result.stores;
+    const auto [index, inserted] = indices.insert(key, static_cast<uint32_t>(entries.size()));
+    if (inserted)
+      entries.push_back(std::move(ptr));
+    else
+      entries[*index] = std::move(ptr);
+  }
+
+  inline hash_t compile_cache::hash_node(const base_node& node, const value_table& values, uint64_t inputs_hash, uint64_t salt)
+  {
+    uint64_t h = hash_bytes(k_hash_seed, &salt, sizeof(salt));
+    const hash_t name = node.get_name_hash();
+    const uint64_t state = node.get_state_hash();
+    h = hash_bytes(h, &name, sizeof(name));
+    h = hash_bytes(h, &state, sizeof(state));
+    for (const param_impl& it : node.get_param_impls())
+    {
+      const hash_t t = it.get_type();
+      h = hash_bytes(h, &t, sizeof(t));
+      if (values.is_constant(it.get_value()))
+      {
+        const span<const uint8_t> data = values.get_data(it.get_value());
+        h = hash_bytes(h, data.data(), data.size());
+      }
+    }
+    // the input types are given by the nodes connected to the inputs, but may also have been set by the graph:
+    for (const pin_impl& it : node.get_input_impls())
+    {
+      const hash_t t = it.get_type();
+      h = hash_bytes(h, &t, sizeof(t));
+    }
+    h = hash_bytes(h, &inputs_hash, sizeof(inputs_hash));
+    return h == 0 ? static_cast<hash_t>(1) : static_cast<hash_t>(h);
+  }
+
+  inline bool compile_cache::make_resolution(const base_node& node, const value_table& values, entry& e)
+  {
+    const span<const pin_impl> outputs = node.get_output_impls();
+    e.output_types.clear();
+    e.output_constants.clear();
+    for (const pin_impl& it : outputs)
+    {
+      e.output_types.push_back(it.get_type());
+      if (!it.get_value().is_valid())
+      {
+        e.output_constants.push_back(k_no_ref);
+        continue;
+      }
+      if (!values.is_constant(it.get_value()))
+        return false;
+      e.output_constants.push_back(e.add_constant(values.get_type(it.get_value()), values.get_data(it.get_value())));
+    }
+    e.has_resolution = true;
+    return true;
+  }
+
+  inline bool compile_cache::apply_resolution(const entry& e, base_node& node, value_table& values)
+  {
+    const span<pin_impl> outputs = node.get_output_impls();
+    if (!e.has_resolution || e.output_types.size() != outputs.size())
+      return false;
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+      outputs[i].set_type(e.output_types[i]);
+      if (e.output_constants[i] == k_no_ref)
+        continue;
+      const constant& c = e.constants[e.output_constants[i]];
+      outputs[i].set_value(values.add_constant(c.value_type, e.get_data(c).data(), c.size));
+    }
+    return true;
+  }
+
+  inline bool compile_cache::replay(const entry& e, base_node& node, value_table& values, generator& gen)
+  {
+    const span<pin_impl> inputs = node.get_input_impls();
+    const span<pin_impl> outputs = node.get_output_impls();
+    if (!e.has_ir || e.output_refs.size() != outputs.size())
+      return false;
+
+    std::vector<value> locals;
+    std::vector<value> operands;
+    locals.reserve(e.operations.size());
+    const auto get_value = [&](uint32_t ref) -> value
+    {
+      const uint32_t index = get_ref_index(ref);
+      switch (get_ref_kind(ref))
+      {
+        case ref_kind::input: return index < inputs.size() ? inputs[index].get_value() : value();
+        case ref_kind::local: return index < locals.size() ? locals[index] : value();
+        case ref_kind::constant:
+        {
+          const constant& c = e.constants[index];
+          return values.add_constant(c.value_type, e.get_data(c).data(), c.size);
+        }
+        case ref_kind::none: return {};
+      }
+      return {};
+    };
+
+    for (const operation& it : e.operations)
+    {
+      operands.clear();
+      for (uint32_t i = 0; i < it.operand_count; ++i)
+        operands.push_back(get_value(e.operands[it.first_operand + i]));
+      locals.push_back(gen.emit(it.op, it.result_type, operands, it.immediate));
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+      outputs[i].set_value(get_value(e.output_refs[i]));
+    return true;
+  }
+
+  inline std::vector<uint8_t> compile_cache::serialize(const entry& e)
+  {
+    const uint32_t header[] =
+    {
+      k_magic, k_version,
+      (e.has_resolution ? 1u : 0u) | (e.has_ir ? 2u : 0u),
+      static_cast<uint32_t>(e.output_types.size()),
+      static_cast<uint32_t>(e.operations.size()),
+      static_cast<uint32_t>(e.operands.size()),
+      static_cast<uint32_t>(e.output_refs.size()),
+      static_cast<uint32_t>(e.constants.size()),
+      static_cast<uint32_t>(e.data.size()),
+      0,
+    };
+    std::vector<uint8_t> ret;
+    const auto write = [&ret](const void* data, size_t size)
+    {
+      ret.insert(ret.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    };
+    write(header, sizeof(header));
+    write(e.output_types.data(), e.output_types.size() * sizeof(type::ref));
+    write(e.output_constants.data(), e.output_constants.size() * sizeof(uint32_t));
+    write(e.operations.data(), e.operations.size() * sizeof(operation));
+    write(e.operands.data(), e.operands.size() * sizeof(uint32_t));
+    write(e.output_refs.data(), e.output_refs.size() * sizeof(uint32_t));
+    write(e.constants.data(), e.constants.size() * sizeof(constant));
+    write(e.data.data(), e.data.size());
+    return ret;
+  }
+
+  inline bool compile_cache::deserialize(span<const uint8_t> bytes, entry& e)
+  {
+    uint32_t header[10];
+    if (bytes.size() < sizeof(header))
+      return false;
+    memcpy(header, bytes.data(), sizeof(header));
+    if (header[0] != k_magic || header[1] != k_version)
+      return false;
+
+    size_t offset = sizeof(header);
+    const auto read = [&](auto& vector, uint32_t count)
+    {
+      using elem = typename std::remove_reference_t<decltype(vector)>::value_type;
+      if ((bytes.size() - offset) / sizeof(elem) < count)
+        return false;
+      vector.resize(count);
+      if (count > 0)
+        memcpy(vector.data(), bytes.data() + offset, count * sizeof(elem));
+      offset += count * sizeof(elem);
+      return true;
+    };
+    e.has_resolution = (header[2] & 1) != 0;
+    e.has_ir = (header[2] & 2) != 0;
+    if (!read(e.output_types, header[3]) || !read(e.output_constants, header[3]) || !read(e.operations, header[4])
+        || !read(e.operands, header[5]) || !read(e.output_refs, header[6]) || !read(e.constants, header[7])
+        || !read(e.data, header[8]))
+    {
+      return false;
+    }
+
+    // check every reference, so that a corrupted file cannot make replay() read out of bounds:
+    for (const constant& c : e.constants)
+    {
+      if (c.offset > e.data.size() || c.size > e.data.size() - c.offset)
+        return false;
+    }
+    for (const uint32_t it : e.output_constants)
+    {
+      if (it != k_no_ref && it >= e.constants.size())
+        return false;
+    }
+    const auto is_valid_ref = [&e](uint32_t ref, size_t local_count)
+    {
+      switch (get_ref_kind(ref))
+      {
+        case ref_kind::local: return get_ref_index(ref) < local_count;
+        case ref_kind::constant: return get_ref_index(ref) < e.constants.size();
+        case ref_kind::none: return ref == k_no_ref;
+        default: return true;
+      }
+    };
+    for (size_t i = 0; i < e.operations.size(); ++i)
+    {
+      const operation& op = e.operations[i];
+      if (op.first_operand > e.operands.size() || op.operand_count > e.operands.size() - op.first_operand)
+        return false;
+      for (uint32_t j = 0; j < op.operand_count; ++j)
+      {
+        if (!is_valid_ref(e.operands[op.first_operand + j], i))
+          return false;
+      }
+    }
+    for (const uint32_t it : e.output_refs)
+    {
+      if (!is_valid_ref(it, e.operations.size()))
+        return false;
+    }
+    return true;
+  }
+
+  inline bool compile_cache::write_entry(hash_t key, const entry& e) const
+  {
+    const std::vector<uint8_t> bytes = serialize(e);
+    // write to a temporary file, then rename it: other processes never see a partially written entry
+    // (the name of the temporary file is unique to the write: the same key can be stored by several threads at once)
+    static std::atomic<uint64_t> write_count = {0};
+    const std::string path = get_path(key);
+    const std::string tmp_path = path + "." + std::to_string(getpid()) + "." + std::to_string(write_count.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == nullptr)
+      return false;
+    const bool written = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    if (fclose(f) != 0 || !written || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+      remove(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  inline bool compile_cache::read_entry(hash_t key, entry& e) const
+  {
+    FILE* f = fopen(get_path(key).c_str(), "rb");
+    if (f == nullptr)
+      return false;
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), f)) > 0)
+      bytes.insert(bytes.end(), buffer, buffer + count);
+    fclose(f);
+    return deserialize(bytes, e);
+  }
+} // namespace rukh
@@ -0,0 +1,333 @@
+//
+// file : concurrent_type_db.hpp
+// in : file:///home/tim/projects/rukh/rukh/concurrent_type_db.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:06:36 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "type_db.hpp"
+#include "frozen_type_db.hpp"
+
+namespace rukh
+{
+  /// \brief A type DB that can be shared between threads: many threads compiling graphs while new (plugin) types are registered
+  ///
+  /// Writers add definitions to an internal type_db (under a mutex), and publish() them: the type_db is frozen and
+  /// the resulting frozen_type_db atomically replaces the current snapshot (RCU-style).
+  /// Each reader thread registers once (register_reader, which may lock and allocate), and then acquires the current
+  /// snapshot through its reader handle. reader::acquire() is wait-free: it announces the current epoch in the slot of
+  /// the reader, loads the current snapshot once and increments its reference count, without any retry, lock or allocation.
+  /// A snapshot is immutable, and stays alive (as well as every frozen_type obtained from it) until its handle is released,
+  /// even if newer snapshots have been published in the meantime.
+  ///
+  /// Snapshots that are no longer current are reclaimed by the writer (in publish() or collect()) after their grace period
+  /// (every reader that was acquiring a snapshot when it was replaced is done) and once no handle holds them.
+  /// The writer never waits for the readers: snapshots still in their grace period are kept for a later collect().
+  /// \note The callable fields of the definitions (members_getter, cast_into, ...) are called concurrently by the readers
+  class concurrent_type_db
+  {
+    private:
+      struct node
+      {
+        node(frozen_type_db&& _db, uint64_t _version) : db(std::move(_db)), version(_version) {}
+
+        const frozen_type_db db;
+        const uint64_t version;
+        std::atomic<uint32_t> refcount = {1}; // the reference of being the current snapshot
+        uint64_t retired_epoch = 0; // the epoch at which the snapshot stopped being the current one (writer only)
+      };
+
+      static constexpr uint64_t k_idle = ~uint64_t(0);
+
+      struct alignas(64) reader_slot
+      {
+        std::atomic<uint64_t> epoch = {k_idle}; // the epoch announced by the reader while in acquire(), k_idle otherwise
+        std::atomic<bool> registered = {false};
+      };
+
+    public:
+      /// \brief A reference to a published snapshot. The snapshot (and its types) are valid until the handle is released.
+      class snapshot
+      {
+        public:
+          snapshot() = default;
+          snapshot(snapshot&& o) noexcept : n(o.n) { o.n = nullptr; }
+          snapshot& operator = (snapshot&& o) noexcept
+          {
+            if (this != &o)
+            {
+              release();
+              n = o.n;
+              o.n = nullptr;
+            }
+            return *this;
+          }
+          snapshot(const snapshot&) = delete;
+          snapshot& operator = (const snapshot&) = delete;
+          ~snapshot() { release(); }
+
+          /// \brief Return the frozen DB of the snapshot
+          const frozen_type_db& get_db() const { return n->db; }
+          const frozen_type_db* operator -> () const { return &n->db; }
+          const frozen_type_db& operator * () const { return n->db; }
+
+          /// \brief Return the version of the snapshot (incremented by every publish())
+          uint64_t get_version() const { return n->version; }
+
+          /// \brief Return whether or not the handle holds a snapshot
+          explicit operator bool() const { return n != nullptr; }
+
+          /// \brief Release the snapshot. The handle must not be used after that.
+          void release()
+          {
+            if (n != nullptr)
+              n->refcount.fetch_sub(1, std::memory_order_acq_rel);
+            n = nullptr;
+          }
+
+        private:
+          explicit snapshot(node* _n) : n(_n) {}
+
+        private:
+          node* n = nullptr;
+
+          friend class concurrent_type_db;
+      };
+
+      /// \brief A registered reader (see register_reader). A reader must only be used by one thread at a time.
+      /// \note Readers must be destructed before the DB (snapshots acquired through them may outlive them)
+      class reader
+      {
+        public:
+          reader() = default;
+          reader(reader&& o) noexcept : tdb(o.tdb), slot(o.slot) { o.slot = nullptr; }
+          reader& operator = (reader&& o) noexcept
+          {
+            if (this != &o)
+            {
+              unregister();
+              tdb = o.tdb;
+              slot = o.slot;
+              o.slot = nullptr;
+            }
+            return *this;
+          }
+          reader(const reader&) = delete;
+          reader& operator = (const reader&) = delete;
+          ~reader() { unregister(); }
+
+          /// \brief Acquire the current snapshot (wait-free)
+          snapshot acquire() const
+          {
+            // NOTE: the epoch has to be announced before loading the current snapshot (see collect_locked)
+            slot->epoch.store(tdb->epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            node* const n = tdb->current.load(std::memory_order_seq_cst);
+            n->refcount.fetch_add(1, std::memory_order_acq_rel);
+            slot->epoch.store(k_idle, std::memory_order_release);
+            return snapshot(n);
+          }
+
+          /// \brief Return whether or not the handle is registered to a DB
+          explicit operator bool() const { return slot != nullptr; }
+
+        private:
+          reader(const concurrent_type_db& _tdb, reader_slot& _slot) : tdb(&_tdb), slot(&_slot) {}
+
+          void unregister()
+          {
+            if (slot != nullptr)
+              slot->registered.store(false, std::memory_order_release);
+            slot = nullptr;
+          }
+
+        private:
+          const concurrent_type_db* tdb = nullptr;
+          reader_slot* slot = nullptr;
+
+          friend class concurrent_type_db;
+      };
+
+    public:
+      /// \brief Create the DB, with an initial (empty) snapshot
+      concurrent_type_db()
+      {
+        published_epoch = db.get_epoch();
+        current.store(new node(db.freeze(), 0), std::memory_order_release);
+      }
+
+      /// \warning Every snapshot must have been released and every reader destructed before destructing the DB
+      ~concurrent_type_db()
+      {
+        delete current.load(std::memory_order_acquire);
+        for (node* n : retired)
+          delete n;
+        for (reader_slot* slot : slots)
+          delete slot;
+      }
+
+      concurrent_type_db(const concurrent_type_db&) = delete;
+      concurrent_type_db& operator = (const concurrent_type_db&) = delete;
+
+      /// \brief Add a new definition. It will be visible to the readers after the next call to publish()
+      /// \return whether or not the type has been added or not (see type_db::add_definition)
+      bool add_definition(type::definition&& def)
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        return db.add_definition(std::move(def));
+      }
+
+      /// \brief Add a new definition. It will be visible to the readers after the next call to publish()
+      /// \return whether or not the type has been added or not (see type_db::add_definition)
+      bool add_definition(const type::definition& def)
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        return db.add_definition(def);
+      }
+
+      /// \brief Freeze the definitions and make them the current snapshot
+      /// Snapshots acquired before the call stay valid (and unchanged) until they are released.
+      /// \note Does nothing if no definition has been added since the last call
+      /// \note The new snapshot is a full rebuild of the image (linear in the number of types, see type_db::freeze):
+      ///       only the cast closure is updated incrementally. Batch the definitions and publish them at once.
+      void publish()
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        if (db.get_epoch() != published_epoch)
+        {
+          published_epoch = db.get_epoch();
+          node* const n = new node(db.freeze(), ++version);
+          // NOTE: before the exchange, so that get_version() is never older than an acquired snapshot
+          current_version.store(version, std::memory_order_release);
+          node* const old = current.exchange(n, std::memory_order_seq_cst);
+          // readers that announce this epoch (or a later one) load the new snapshot:
+          old->retired_epoch = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+          old->refcount.fetch_sub(1, std::memory_order_acq_rel);
+          retired.push_back(old);
+        }
+        collect_locked();
+      }
+
+      /// \brief Register a reader thread (may lock and allocate: to be done once per thread, not on the read path)
+      /// The slots of destructed readers are reused: the number of slots is bounded by the number of concurrent readers.
+      reader register_reader() const
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        for (reader_slot* slot : slots)
+        {
+          if (!slot->registered.load(std::memory_order_acquire))
+          {
+            slot->registered.store(true, std::memory_order_relaxed);
+            return reader(*this, *slot);
+          }
+        }
+        reader_slot* const slot = new reader_slot;
+        slot->registered.store(true, std::memory_order_relaxed);
+        slots.push_back(slot);
+        return reader(*this, *slot);
+      }
+
+      /// \brief Return the version of the current snapshot (wait-free)
+      uint64_t get_version() const
+      {
+        return current_version.load(std::memory_order_acquire);
+      }
+
+      /// \brief Reclaim the snapshots that are no longer used (never waits for the readers)
+      void collect()
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        collect_locked();
+      }
+
+      /// \brief Return the number of old snapshots that are still held by readers (or not yet reclaimed)
+      size_t get_retired_count() const
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        return retired.size();
+      }
+
+      /// \brief Call a function with the (non-frozen) type_db, under the writer lock
+      /// \note Definitions added that way are only visible to readers after the next call to publish()
+      template<typename Fnc>
+      auto with_type_db(Fnc&& fnc)
+      {
+        std::lock_guard<std::mutex> _l(write_lock);
+        return fnc(db);
+      }
+
+    private:
+      /// \brief Return the oldest epoch announced by a reader currently in acquire() (k_idle if none)
+      uint64_t get_oldest_reader_epoch() const
+      {
+        uint64_t oldest = k_idle;
+        for (const reader_slot* slot : slots)
+          oldest = std::min(oldest, slot->epoch.load(std::memory_order_seq_cst));
+        return oldest;
+      }
+
+      void collect_locked()
+      {
+        if (retired.empty())
+          return;
+
+        // A reader that announced an epoch older than the one at which a snapshot has been replaced may have loaded it
+        // (and not yet incremented its refcount): the grace period of the snapshot is not over.
+        // A reader that announced it (or a newer one) loads a newer snapshot, as current is replaced before the epoch changes.
+        // NOTE: the slots have to be checked before the refcount (a reader increments the refcount before leaving acquire())
+        const uint64_t oldest_epoch = get_oldest_reader_epoch();
+        for (size_t i = 0; i < retired.size();)
+        {
+          node* const n = retired[i];
+          if (n->retired_epoch > oldest_epoch || n->refcount.load(std::memory_order_seq_cst) != 0)
+          {
+            ++i;
+            continue;
+          }
+          delete n;
+          retired[i] = retired.back();
+          retired.pop_back();
+        }
+      }
+
+    private:
+      mutable std::mutex write_lock;
+      type_db db;
+      uint64_t published_epoch = 0;
+      uint64_t version = 0;
+      std::vector<node*> retired;
+      mutable std::vector<reader_slot*> slots; // see register_reader (writer lock)
+
+      std::atomic<node*> current = {nullptr};
+      std::atomic<uint64_t> epoch = {1};
+      std::atomic<uint64_t> current_version = {0};
+  };
+} // namespace rukh
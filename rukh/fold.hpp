@@ -0,0 +1,628 @@
+//
+// file : fold.hpp
+// in : file:///home/tim/projects/rukh/rukh/fold.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:25:43 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "swizzle.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+  #define RUKH_FOLD_X86 1
+  #include <immintrin.h>
+#else
+  #define RUKH_FOLD_X86 0
+#endif
+
+// The kernels must give the same results on every path: products must not be fused with the additions (FMA).
+// (GCC contracts across statements by default, clang only inside an expression)
+#if defined(__GNUC__) && !defined(__clang__)
+  #define RUKH_FOLD_EXACT __attribute__((optimize("fp-contract=off")))
+#else
+  #define RUKH_FOLD_EXACT
+#endif
+
+namespace rukh
+{
+  /// \brief Constant-folding kernels for float vectors and matrices
+  ///
+  /// Kernels work on arrays of floats (the components of constants, see value_table::get_components), and
+  /// there is a SSE2, an AVX2 and a scalar implementation of each one. The best one supported by the CPU
+  /// is selected at runtime (see get_isa / set_isa).
+  /// Every implementation gives bit-exact results: the operations are done in the same order, products are never
+  /// fused with additions, and min / max / comparisons follow the SSE semantics (for NaNs and signed zeros).
+  /// The only exception is the sign / payload of NaNs (the compiler is free to swap the operands of an addition).
+  /// The value_table functions replace every NaN they produce by a single quiet NaN, so folded constants
+  /// (and their hashes) do not depend on the implementation.
+  ///
+  /// Matrices are column-major n * n matrices (as in GLSL). Booleans (results of comparisons) are uint32_t 0 / 1.
+  ///
+  /// The functions taking a value_table can be called from base_node::const_generate. They return an invalid value
+  /// if an operand is not a constant (a runtime value or an invalid handle) or if the sizes of the operands do not match.
+  namespace fold
+  {
+    enum class isa : uint8_t
+    {
+      scalar,
+      sse2,
+      avx2,
+    };
+
+    enum class binary_op : uint8_t
+    {
+      add,
+      sub,
+      mul,
+      div,
+      min, // a < b ? a : b
+      max, // a > b ? a : b
+    };
+
+    enum class compare_op : uint8_t
+    {
+      lt,
+      le,
+      gt,
+      ge,
+      eq,
+      ne, // true if one of the operands is NaN
+    };
+
+    /// \brief The kernels of one implementation
+    struct kernel_table
+    {
+      /// r[i] = a[i] op b[i]
+      void (*binary)(binary_op op, const float* a, const float* b, float* r, size_t count);
+      /// r[i] = a[i] op b
+      void (*binary_broadcast)(binary_op op, const float* a, float b, float* r, size_t count);
+      /// r[i] = a[i] op b[i] ? 1 : 0
+      void (*compare)(compare_op op, const float* a, const float* b, uint32_t* r, size_t count);
+      /// r[v] = dot(a[v * dim ...], b[v * dim ...]) for \p count vectors of \p dim components
+      void (*dot)(const float* a, const float* b, size_t dim, float* r, size_t count);
+      /// r = a * b (n * n matrices)
+      void (*mat_mul)(const float* a, const float* b, float* r, size_t n);
+      /// r = m * v (n * n matrix, n components vector)
+      void (*mat_vec)(const float* m, const float* v, float* r, size_t n);
+    };
+
+    namespace internal
+    {
+      RUKH_FOLD_EXACT inline float apply(binary_op op, float a, float b)
+      {
+        switch (op)
+        {
+          case binary_op::add: return a + b;
+          case binary_op::sub: return a - b;
+          case binary_op::mul: return a * b;
+          case binary_op::div: return a / b;
+          case binary_op::min: return a < b ? a : b;
+          case binary_op::max: return a > b ? a : b;
+        }
+        return 0;
+      }
+
+      inline uint32_t apply(compare_op op, float a, float b)
+      {
+        switch (op)
+        {
+          case compare_op::lt: return a < b;
+          case compare_op::le: return a <= b;
+          case compare_op::gt: return a > b;
+          case compare_op::ge: return a >= b;
+          case compare_op::eq: return a == b;
+          case compare_op::ne: return !(a == b);
+        }
+        return 0;
+      }
+
+      // // // // // scalar // // // // //
+
+      RUKH_FOLD_EXACT inline void binary_scalar(binary_op op, const float* a, const float* b, float* r, size_t count)
+      {
+        for (size_t i = 0; i < count; ++i)
+          r[i] = apply(op, a[i], b[i]);
+      }
+
+      RUKH_FOLD_EXACT inline void binary_broadcast_scalar(binary_op op, const float* a, float b, float* r, size_t count)
+      {
+        for (size_t i = 0; i < count; ++i)
+          r[i] = apply(op, a[i], b);
+      }
+
+      inline void compare_scalar(compare_op op, const float* a, const float* b, uint32_t* r, size_t count)
+      {
+        for (size_t i = 0; i < count; ++i)
+          r[i] = apply(op, a[i], b[i]);
+      }
+
+      RUKH_FOLD_EXACT inline void dot_scalar(const float* a, const float* b, size_t dim, float* r, size_t count)
+      {
+        for (size_t v = 0; v < count; ++v, a += dim, b += dim)
+        {
+          float acc = a[0] * b[0];
+          for (size_t c = 1; c < dim; ++c)
+          {
+            const float p = a[c] * b[c];
+            acc = acc + p;
+          }
+          r[v] = acc;
+        }
+      }
+
+      RUKH_FOLD_EXACT inline void mat_vec_scalar(const float* m, const float* v, float* r, size_t n)
+      {
+        for (size_t i = 0; i < n; ++i)
+        {
+          float acc = m[i] * v[0];
+          for (size_t k = 1; k < n; ++k)
+          {
+            const float p = m[k * n + i] * v[k];
+            acc = acc + p;
+          }
+          r[i] = acc;
+        }
+      }
+
+      RUKH_FOLD_EXACT inline void mat_mul_scalar(const float* a, const float* b, float* r, size_t n)
+      {
+        for (size_t j = 0; j < n; ++j)
+          mat_vec_scalar(a, b + j * n, r + j * n, n);
+      }
+
+      inline constexpr kernel_table scalar_kernels =
+      {
+        binary_scalar, binary_broadcast_scalar, compare_scalar, dot_scalar, mat_mul_scalar, mat_vec_scalar,
+      };
+
+#if RUKH_FOLD_X86
+      // // // // // sse2 // // // // //
+
+      RUKH_FOLD_EXACT inline __m128 apply_sse2(binary_op op, __m128 a, __m128 b)
+      {
+        switch (op)
+        {
+          case binary_op::add: return _mm_add_ps(a, b);
+          case binary_op::sub: return _mm_sub_ps(a, b);
+          case binary_op::mul: return _mm_mul_ps(a, b);
+          case binary_op::div: return _mm_div_ps(a, b);
+          case binary_op::min: return _mm_min_ps(a, b);
+          case binary_op::max: return _mm_max_ps(a, b);
+        }
+        return a;
+      }
+
+      inline __m128 apply_sse2(compare_op op, __m128 a, __m128 b)
+      {
+        switch (op)
+        {
+          case compare_op::lt: return _mm_cmplt_ps(a, b);
+          case compare_op::le: return _mm_cmple_ps(a, b);
+          case compare_op::gt: return _mm_cmplt_ps(b, a);
+          case compare_op::ge: return _mm_cmple_ps(b, a);
+          case compare_op::eq: return _mm_cmpeq_ps(a, b);
+          case compare_op::ne: return _mm_cmpneq_ps(a, b);
+        }
+        return a;
+      }
+
+      RUKH_FOLD_EXACT inline void binary_sse2(binary_op op, const float* a, const float* b, float* r, size_t count)
+      {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+          _mm_storeu_ps(r + i, apply_sse2(op, _mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        binary_scalar(op, a + i, b + i, r + i, count - i);
+      }
+
+      RUKH_FOLD_EXACT inline void binary_broadcast_sse2(binary_op op, const float* a, float b, float* r, size_t count)
+      {
+        const __m128 vb = _mm_set1_ps(b);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+          _mm_storeu_ps(r + i, apply_sse2(op, _mm_loadu_ps(a + i), vb));
+        binary_broadcast_scalar(op, a + i, b, r + i, count - i);
+      }
+
+      inline void compare_sse2(compare_op op, const float* a, const float* b, uint32_t* r, size_t count)
+      {
+        const __m128i one = _mm_set1_epi32(1);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+          const __m128 mask = apply_sse2(op, _mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(r + i), _mm_and_si128(_mm_castps_si128(mask), one));
+        }
+        compare_scalar(op, a + i, b + i, r + i, count - i);
+      }
+
+      RUKH_FOLD_EXACT inline void dot_sse2(const float* a, const float* b, size_t dim, float* r, size_t count)
+      {
+        if (dim != 4)
+          return dot_scalar(a, b, dim, r, count);
+        // the products are computed in parallel, the sum is done in the same order as the scalar version
+        alignas(16) float p[4];
+        for (size_t v = 0; v < count; ++v, a += 4, b += 4)
+        {
+          _mm_store_ps(p, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+          float acc = p[0] + p[1];
+          acc = acc + p[2];
+          r[v] = acc + p[3];
+        }
+      }
+
+      RUKH_FOLD_EXACT inline void mat_vec_sse2(const float* m, const float* v, float* r, size_t n)
+      {
+        if (n != 4)
+          return mat_vec_scalar(m, v, r, n);
+        __m128 acc = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0]));
+        for (size_t k = 1; k < 4; ++k)
+          acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(m + k * 4), _mm_set1_ps(v[k])));
+        _mm_storeu_ps(r, acc);
+      }
+
+      RUKH_FOLD_EXACT inline void mat_mul_sse2(const float* a, const float* b, float* r, size_t n)
+      {
+        for (size_t j = 0; j < n; ++j)
+          mat_vec_sse2(a, b + j * n, r + j * n, n);
+      }
+
+      inline constexpr kernel_table sse2_kernels =
+      {
+        binary_sse2, binary_broadcast_sse2, compare_sse2, dot_sse2, mat_mul_sse2, mat_vec_sse2,
+      };
+
+      // // // // // avx2 // // // // //
+
+      #define RUKH_FOLD_AVX2 __attribute__((target("avx2"))) RUKH_FOLD_EXACT
+
+      RUKH_FOLD_AVX2 inline __m256 apply_avx2(binary_op op, __m256 a, __m256 b)
+      {
+        switch (op)
+        {
+          case binary_op::add: return _mm256_add_ps(a, b);
+          case binary_op::sub: return _mm256_sub_ps(a, b);
+          case binary_op::mul: return _mm256_mul_ps(a, b);
+          case binary_op::div: return _mm256_div_ps(a, b);
+          case binary_op::min: return _mm256_min_ps(a, b);
+          case binary_op::max: return _mm256_max_ps(a, b);
+        }
+        return a;
+      }
+
+      RUKH_FOLD_AVX2 inline __m256 apply_avx2(compare_op op, __m256 a, __m256 b)
+      {
+        switch (op)
+        {
+          case compare_op::lt: return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+          case compare_op::le: return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+          case compare_op::gt: return _mm256_cmp_ps(b, a, _CMP_LT_OQ);
+          case compare_op::ge: return _mm256_cmp_ps(b, a, _CMP_LE_OQ);
+          case compare_op::eq: return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+          case compare_op::ne: return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);
+        }
+        return a;
+      }
+
+      RUKH_FOLD_AVX2 inline void binary_avx2(binary_op op, const float* a, const float* b, float* r, size_t count)
+      {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+          _mm256_storeu_ps(r + i, apply_avx2(op, _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        binary_sse2(op, a + i, b + i, r + i, count - i);
+      }
+
+      RUKH_FOLD_AVX2 inline void binary_broadcast_avx2(binary_op op, const float* a, float b, float* r, size_t count)
+      {
+        const __m256 vb = _mm256_set1_ps(b);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+          _mm256_storeu_ps(r + i, apply_avx2(op, _mm256_loadu_ps(a + i), vb));
+        binary_broadcast_sse2(op, a + i, b, r + i, count - i);
+      }
+
+      RUKH_FOLD_AVX2 inline void compare_avx2(compare_op op, const float* a, const float* b, uint32_t* r, size_t count)
+      {
+        const __m256i one = _mm256_set1_epi32(1);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+          const __m256 mask = apply_avx2(op, _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_and_si256(_mm256_castps_si256(mask), one));
+        }
+        compare_sse2(op, a + i, b + i, r + i, count - i);
+      }
+
+      RUKH_FOLD_AVX2 inline void dot_avx2(const float* a, const float* b, size_t dim, float* r, size_t count)
+      {
+        if (dim != 4)
+          return dot_scalar(a, b, dim, r, count);
+        // two vectors at a time (the sum is done in the same order as the scalar version)
+        alignas(32) float p[8];
+        size_t v = 0;
+        for (; v + 2 <= count; v += 2, a += 8, b += 8)
+        {
+          _mm256_store_ps(p, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+          for (size_t h = 0; h < 2; ++h)
+          {
+            float acc = p[h * 4 + 0] + p[h * 4 + 1];
+            acc = acc + p[h * 4 + 2];
+            r[v + h] = acc + p[h * 4 + 3];
+          }
+        }
+        dot_sse2(a, b, dim, r + v, count - v);
+      }
+
+      RUKH_FOLD_AVX2 inline void mat_mul_avx2(const float* a, const float* b, float* r, size_t n)
+      {
+        if (n != 4)
+          return mat_mul_scalar(a, b, r, n);
+        // two columns of the result at a time
+        for (size_t j = 0; j < 4; j += 2)
+        {
+          const float* bj = b + j * 4;
+          __m256 acc = _mm256_mul_ps(_mm256_broadcast_ps(reinterpret_cast<const __m128*>(a)), _mm256_setr_m128(_mm_set1_ps(bj[0]), _mm_set1_ps(bj[4])));
+          for (size_t k = 1; k < 4; ++k)
+          {
+            const __m256 col = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + k * 4));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(col, _mm256_setr_m128(_mm_set1_ps(bj[k]), _mm_set1_ps(bj[4 + k]))));
+          }
+          _mm256_storeu_ps(r + j * 4, acc);
+        }
+      }
+
+      inline constexpr kernel_table avx2_kernels =
+      {
+        binary_avx2, binary_broadcast_avx2, compare_avx2, dot_avx2, mat_mul_avx2, mat_vec_sse2,
+      };
+
+      #undef RUKH_FOLD_AVX2
+#endif
+
+      inline isa detect_isa()
+      {
+#if RUKH_FOLD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+          return isa::avx2;
+        return isa::sse2;
+#else
+        return isa::scalar;
+#endif
+      }
+
+      inline isa clamp_isa(isa i)
+      {
+        static const isa supported = detect_isa();
+        return i > supported ? supported : i;
+      }
+
+      inline std::atomic<isa> current_isa = {clamp_isa(isa::avx2)};
+    } // namespace internal
+
+    /// \brief Return the implementation currently used
+    inline isa get_isa() { return internal::current_isa.load(std::memory_order_relaxed); }
+
+    /// \brief Return the best implementation supported by the CPU
+    inline isa get_supported_isa() { return internal::clamp_isa(isa::avx2); }
+
+    /// \brief Change the implementation used (for instance to compare them)
+    /// \note Implementations not supported by the CPU are replaced by the best supported one
+    inline void set_isa(isa i) { internal::current_isa.store(internal::clamp_isa(i), std::memory_order_relaxed); }
+
+    /// \brief Return the kernels of an implementation
+    inline const kernel_table& get_kernels(isa i)
+    {
+      switch (internal::clamp_isa(i))
+      {
+#if RUKH_FOLD_X86
+        case isa::avx2: return internal::avx2_kernels;
+        case isa::sse2: return internal::sse2_kernels;
+#endif
+        default: return internal::scalar_kernels;
+      }
+    }
+
+    /// \brief Return the kernels of the implementation currently used
+    inline const kernel_table& get_kernels() { return get_kernels(get_isa()); }
+
+    // // // // // kernels that are the same for every implementation (no arithmetic) // // // // //
+
+    /// \brief r = cross(a, b) for \p count 3 components vectors
+    RUKH_FOLD_EXACT inline void cross(const float* a, const float* b, float* r, size_t count)
+    {
+      for (size_t v = 0; v < count; ++v, a += 3, b += 3, r += 3)
+      {
+        const float x = a[1] * b[2];
+        const float y = a[2] * b[0];
+        const float z = a[0] * b[1];
+        const float nx = a[2] * b[1];
+        const float ny = a[0] * b[2];
+        const float nz = a[1] * b[0];
+        r[0] = x - nx;
+        r[1] = y - ny;
+        r[2] = z - nz;
+      }
+    }
+
+    /// \brief r = swizzle of a (r has e.length components)
+    inline void apply_swizzle(const swizzle::entry& e, const float* a, float* r)
+    {
+      for (unsigned i = 0; i < e.length; ++i)
+        r[i] = a[e.get_component(i)];
+    }
+
+    /// \brief r = transpose(m) (n * n matrices, r must not be m)
+    inline void transpose(const float* m, float* r, size_t n)
+    {
+      for (size_t j = 0; j < n; ++j)
+      {
+        for (size_t i = 0; i < n; ++i)
+          r[i * n + j] = m[j * n + i];
+      }
+    }
+
+    // // // // // folding of constant values // // // // //
+
+    /// \brief Replace every NaN by the same quiet NaN
+    inline void canonicalize_nans(float* r, size_t count)
+    {
+      constexpr uint32_t k_quiet_nan = 0x7FC00000u;
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (r[i] != r[i])
+          memcpy(r + i, &k_quiet_nan, sizeof(float));
+      }
+    }
+
+    /// \brief Fold a component-wise operation. \p b can also be a single-component constant (it is then broadcasted)
+    inline value binary(value_table& values, binary_op op, value a, value b, type::ref result_type)
+    {
+      if (!values.is_constant(a) || !values.is_constant(b))
+        return {};
+      const size_t count = values.get_size(a) / sizeof(float);
+      const size_t b_count = values.get_size(b) / sizeof(float);
+      if (count == 0 || (b_count != count && b_count != 1))
+        return {};
+
+      const value r = values.add_constant(result_type, count * sizeof(float));
+      const float* const pa = values.get_components<float>(a).data();
+      const float* const pb = values.get_components<float>(b).data();
+      float* const pr = values.get_components<float>(r).data();
+      if (b_count == count)
+        get_kernels().binary(op, pa, pb, pr, count);
+      else
+        get_kernels().binary_broadcast(op, pa, *pb, pr, count);
+      canonicalize_nans(pr, count);
+      return r;
+    }
+
+    /// \brief Fold a component-wise comparison (the result is a vector of uint32_t 0 / 1)
+    inline value compare(value_table& values, compare_op op, value a, value b, type::ref result_type)
+    {
+      if (!values.is_constant(a) || !values.is_constant(b))
+        return {};
+      const size_t count = values.get_size(a) / sizeof(float);
+      if (count == 0 || values.get_size(b) != values.get_size(a))
+        return {};
+
+      const value r = values.add_constant(result_type, count * sizeof(uint32_t));
+      get_kernels().compare(op, values.get_components<float>(a).data(), values.get_components<float>(b).data(),
+                            values.get_components<uint32_t>(r).data(), count);
+      return r;
+    }
+
+    /// \brief Fold dot(a, b)
+    inline value dot(value_table& values, value a, value b, type::ref result_type)
+    {
+      if (!values.is_constant(a) || !values.is_constant(b))
+        return {};
+      const size_t dim = values.get_size(a) / sizeof(float);
+      if (dim == 0 || values.get_size(b) != values.get_size(a))
+        return {};
+
+      const value r = values.add_constant(result_type, sizeof(float));
+      get_kernels().dot(values.get_components<float>(a).data(), values.get_components<float>(b).data(), dim,
+                        values.get_components<float>(r).data(), 1);
+      canonicalize_nans(values.get_components<float>(r).data(), 1);
+      return r;
+    }
+
+    /// \brief Fold cross(a, b) (3 components vectors)
+    inline value cross(value_table& values, value a, value b, type::ref result_type)
+    {
+      if (!values.is_constant(a) || !values.is_constant(b))
+        return {};
+      if (values.get_size(a) != 3 * sizeof(float) || values.get_size(b) != 3 * sizeof(float))
+        return {};
+
+      const value r = values.add_constant(result_type, 3 * sizeof(float));
+      cross(values.get_components<float>(a).data(), values.get_components<float>(b).data(),
+            values.get_components<float>(r).data(), 1);
+      canonicalize_nans(values.get_components<float>(r).data(), 3);
+      return r;
+    }
+
+    /// \brief Fold a swizzle
+    inline value apply_swizzle(value_table& values, const swizzle::entry& e, value a, type::ref result_type)
+    {
+      if (!values.is_constant(a) || values.get_size(a) < e.required_dim * sizeof(float))
+        return {};
+
+      const value r = values.add_constant(result_type, e.length * sizeof(float));
+      apply_swizzle(e, values.get_components<float>(a).data(), values.get_components<float>(r).data());
+      return r;
+    }
+
+    /// \brief Fold a * b (n * n matrices)
+    inline value mat_mul(value_table& values, value a, value b, size_t n, type::ref result_type)
+    {
+      if (!values.is_constant(a) || !values.is_constant(b))
+        return {};
+      const size_t size = n * n * sizeof(float);
+      if (n == 0 || values.get_size(a) != size || values.get_size(b) != size)
+        return {};
+
+      const value r = values.add_constant(result_type, size);
+      get_kernels().mat_mul(values.get_components<float>(a).data(), values.get_components<float>(b).data(),
+                            values.get_components<float>(r).data(), n);
+      canonicalize_nans(values.get_components<float>(r).data(), n * n);
+      return r;
+    }
+
+    /// \brief Fold m * v (n * n matrix, n components vector)
+    inline value mat_vec(value_table& values, value m, value v, size_t n, type::ref result_type)
+    {
+      if (!values.is_constant(m) || !values.is_constant(v))
+        return {};
+      if (n == 0 || values.get_size(m) != n * n * sizeof(float) || values.get_size(v) != n * sizeof(float))
+        return {};
+
+      const value r = values.add_constant(result_type, n * sizeof(float));
+      get_kernels().mat_vec(values.get_components<float>(m).data(), values.get_components<float>(v).data(),
+                            values.get_components<float>(r).data(), n);
+      canonicalize_nans(values.get_components<float>(r).data(), n);
+      return r;
+    }
+
+    /// \brief Fold transpose(m) (n * n matrix)
+    inline value transpose(value_table& values, value m, size_t n, type::ref result_type)
+    {
+      if (!values.is_constant(m) || n == 0 || values.get_size(m) != n * n * sizeof(float))
+        return {};
+
+      const value r = values.add_constant(result_type, n * n * sizeof(float));
+      transpose(values.get_components<float>(m).data(), values.get_components<float>(r).data(), n);
+      return r;
+    }
+  } // namespace fold
+} // namespace rukh
@@ -0,0 +1,1011 @@
+//
+// file : frozen_type_db.hpp
+// in : file:///home/tim/projects/rukh/rukh/frozen_type_db.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 22:54:35 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "type.hpp"
+#include "type_db.hpp"
+#include "type_hooks.hpp"
+
+namespace rukh
+{
+  class frozen_type_db;
+
+  /// \brief A type of a frozen_type_db.
+  /// Same API as type, but works on the compact (struct-of-arrays) representation of the frozen DB,
+  /// and is only an index (plus the DB reference).
+  /// The member, cast and resolution queries are the ones of type (see type_queries.hpp).
+  class frozen_type
+  {
+    public:
+      /// \brief Return the type::ref associated with the type
+      type::ref get_ref() const;
+
+      /// \brief Return the (interned) debug name of the type
+      std::string_view get_debug_name() const;
+
+      /// \brief Return the callable fields of the type
+      const type_hooks& get_hooks() const;
+
+      /// \brief Return whether or not a type can be implicitly casted into another (see type::can_implicit_cast)
+      bool can_implicit_cast(const frozen_type& other) const;
+
+      /// \brief Return whether or not a type can be casted into another without precision loss (see type::can_lossless_cast)
+      bool can_lossless_cast(const frozen_type& other) const;
+
+      /// \brief Check that the members are all of known types (see type::is_valid)
+      bool is_valid() const;
+
+      /// \brief Whether or not a type is a primitive number (see type::is_primitive)
+      bool is_primitive() const;
+
+      /// \brief Whether or not a type is a concrete type ('explicit' type).
+      bool is_concrete() const;
+
+      /// \brief Whether or not a type is a concrete type and each one of its members is also a fully concrete type
+      bool is_fully_concrete() const;
+
+      /// \brief Return the size (in bytes) of the type (including its members). (see type::size)
+      size_t size() const;
+
+      /// \brief Return whether or not the type has the specified member
+      /// \tparam String must be a string as provided by rk_str("my-member")
+      template<typename String>
+      bool has_member() const { return has_member(String::hash); }
+
+      /// \brief Return whether or not the type has the specified member
+      /// \warning must not be used for string literals. Only for runtime-strings.
+      bool has_member(const std::string_view& sv) const { return has_member(hash_string(sv)); }
+
+      /// \brief Return whether or not the type has the specified member (see type::has_member)
+      bool has_member(const interned_string& name) const { return has_member(name.hash); }
+
+      /// \brief Return whether or not the type has the specified member (see type::has_member)
+      bool has_member(hash_t name) const;
+
+      /// \brief Return the swizzle for a member name hash, or nullptr if it is not a valid swizzle for the type
+      const swizzle::entry* get_swizzle(hash_t name) const;
+
+      /// \brief Return whether or not a given type is a valid resolution for the current type (see type::is_valid_resolution)
+      /// \note The result is cached by the frozen_type_db (see frozen_type_db::get_resolution_cache_stats)
+      bool is_valid_resolution(const frozen_type& t) const;
+
+      /// \brief Return whether or not a concrete type is accepted by the current type (see type::accepts)
+      bool accepts(const frozen_type& t) const;
+
+      /// \brief Return the member type (or the special none type if none found)
+      /// \tparam String must be a string as provided by rk_str("my-member")
+      template<typename String>
+      frozen_type get_member_type() const { return get_member_type(String::hash); }
+
+      /// \brief Return the member type (or the special none type if none found)
+      /// \warning must not be used for string literals. Only for runtime-strings.
+      frozen_type get_member_type(const std::string_view& sv) const { return get_member_type(hash_string(sv)); }
+
+      /// \brief Return the member type (or the special none type if none found) (see type::get_member_type)
+      frozen_type get_member_type(const interned_string& name) const { return get_member_type(name.hash); }
+
+      /// \brief Return the member type (or the special none type if none found) (see type::get_member_type)
+      frozen_type get_member_type(hash_t name) const;
+
+      const frozen_type_db& tdb;
+      const uint32_t index;
+
+    private:
+      friend struct definition_accessor<frozen_type>;
+
+      /// \brief Return the index of the member in the frozen DB member arrays, or ~0u
+      uint32_t find_member(hash_t name) const;
+  };
+
+  /// \brief An immutable, compact, snapshot of a type_db (see type_db::freeze)
+  ///
+  /// Every data field of the definitions lives in a single contiguous image, with a struct-of-arrays layout:
+  /// each type is a dense index, members and subtypes are contiguous arrays (with per-type ranges),
+  /// debug names are interned in a single character blob and derived properties (size, validity, accepted types)
+  /// are precomputed. Looking-up a type is a probe in a flat hash table that is also stored in the image.
+  ///
+  /// The image does not contain any pointer, and can be saved to a file (save_image) and then directly mmap-ed
+  /// by other processes (load_image), without any deserialization.
+  /// Callable fields (members_getter, is_dim_valid_for, ...) cannot be stored in the image: they are copied from
+  /// the definitions when freezing a type_db, and rebound by name through a hook_registry when loading an image.
+  class frozen_type_db
+  {
+    public:
+      /// \brief Index of the special "none" type
+      static constexpr uint32_t k_none = 0;
+      /// \brief Returned by get_concrete_index for non-concrete types
+      static constexpr uint32_t k_not_concrete = type_db::k_not_concrete;
+
+    public:
+      frozen_type_db(frozen_type_db&&) = default;
+      frozen_type_db& operator = (frozen_type_db&&) = default;
+      frozen_type_db(const frozen_type_db&) = delete;
+      frozen_type_db& operator = (const frozen_type_db&) = delete;
+
+      /// \brief Map a type image (as written by save_image) and rebind its hooks
+      /// The image is used in place: only the header and the bounds of the sections are checked (constant-time),
+      /// and only the types that have callable fields have to be rebound (linear in the number of hooked types).
+      /// The queries use the stored indices and ranges without any check: images that do not come from save_image
+      /// (untrusted files) must be loaded with \p validate_entries, which also checks every entry (linear in the image size).
+      /// \return nothing if the file cannot be mapped, is not a valid type image (or of a different version),
+      ///         or if hooks are missing from the registry
+      /// \note The registry must outlive the returned DB
+      static std::optional<frozen_type_db> load_image(const std::string& path, const hook_registry& hooks, bool validate_entries = false);
+
+      /// \brief Write the image to a file, so that it can be loaded with load_image
+      bool save_image(const std::string& path) const;
+
+      /// \brief Return the type for a given type::ref or a spacial none type
+      frozen_type get_type(type::ref id) const { return {*this, index_of(id)}; }
+
+      /// \brief Return the special "none" type
+      frozen_type get_none() const { return {*this, k_none}; }
+
+      /// \brief Return the type at a given dense index
+      frozen_type get_type_at(uint32_t index) const { return {*this, index < header->type_count ? index : k_none}; }
+
+      /// \brief Return the dense index of a type (k_none if not in the DB)
+      uint32_t index_of(type::ref id) const
+      {
+        if (id == type::ref::zero)
+          return k_none;
+        const uint64_t mask = header->table_size - 1;
+        for (uint64_t i = slot_for(id);; i = (i + 1) & mask)
+        {
+          if (table[i].key == id)
+            return table[i].index;
+          if (table[i].key == type::ref::zero)
+            return k_none;
+        }
+      }
+
+      /// \brief Return the number of types in the snapshot (including the none type)
+      size_t size() const { return header->type_count; }
+
+      /// \brief Return the number of concrete types in the snapshot
+      size_t get_concrete_count() const { return header->concrete_count; }
+
+      /// \brief Return the dense concrete-type index (same as type_db::get_concrete_index)
+      uint32_t get_concrete_index(type::ref id) const { return concrete_indices[index_of(id)]; }
+
+      /// \brief Return the best chain of casts from a type to another (see type_db::get_cast)
+      cast_info get_cast(uint32_t from, uint32_t to) const
+      {
+        if (from == to)
+          return cast_info::identity();
+        const uint32_t from_index = cast_indices[from];
+        const uint32_t to_index = cast_indices[to];
+        if (from_index == ~0u || to_index == ~0u)
+          return {};
+        const uint32_t c = cast_cells[uint64_t(from_index) * header->cast_count + to_index];
+        return {static_cast<type::cast_type>(c >> 16), static_cast<uint16_t>(c & 0xFFFF)};
+      }
+
+      /// \brief Return the cheapest candidate parameter list for the given argument types (see type_db::find_best_overload)
+      overload_match find_best_overload(const std::vector<type::ref>& args, const std::vector<std::vector<type::ref>>& candidates) const
+      {
+        return rukh::find_best_overload(args, candidates, [this](type::ref arg, type::ref param) -> uint16_t
+        {
+          if (arg == param)
+            return cast_cost::exact;
+          const uint32_t param_index = index_of(param);
+          if (param_index == k_none)
+            return cast_cost::none;
+          const uint32_t arg_index = index_of(arg);
+          if (concrete_indices[param_index] == k_not_concrete)
+          {
+            const uint32_t concrete_index = concrete_indices[arg_index];
+            return concrete_index != k_not_concrete && accepts(param_index, concrete_index) ? cast_cost::meta : cast_cost::none;
+          }
+          const cast_info info = get_cast(arg_index, param_index);
+          return info.is_implicit() ? info.cost : cast_cost::none;
+        });
+      }
+
+      /// \brief Return the size of the image (in bytes)
+      size_t get_image_size() const { return header->image_size; }
+
+      /// \brief Return the counters of the resolution cache (see frozen_type::is_valid_resolution)
+      type_db::resolution_cache_stats get_resolution_cache_stats() const { return {memo->hits.load(), memo->misses.load()}; }
+
+      /// \brief Reset the counters of the resolution cache
+      void reset_resolution_cache_stats() const
+      {
+        memo->hits = 0;
+        memo->misses = 0;
+      }
+
+    private:
+      /// \brief Flags of a type (precomputed properties + presence of callable fields)
+      enum flag : uint32_t
+      {
+        concrete = 1 << 0,
+        valid = 1 << 1,
+        fully_concrete = 1 << 2,
+        can_default_construct = 1 << 3,
+        has_dim_getter = 1 << 4,
+        has_members_getter = 1 << 5,
+        has_subtypes_getter = 1 << 6,
+        has_casts = 1 << 7,
+        has_construct_from = 1 << 8,
+        has_destruct = 1 << 9,
+      };
+
+      static constexpr uint32_t k_magic = 'R' | ('K' << 8) | ('T' << 16) | ('I' << 24);
+      static constexpr uint32_t k_version = 3;
+
+      /// \brief Position of an array in the image
+      struct section
+      {
+        uint64_t offset;
+        uint64_t count;
+      };
+
+      /// \brief Index table entry
+      struct table_entry
+      {
+        type::ref key;
+        uint64_t index;
+      };
+
+      /// \brief What's at the start of the image
+      struct image_header
+      {
+        uint32_t magic; // also checks the endianness
+        uint32_t version;
+        uint64_t image_size;
+        uint32_t type_count;
+        uint32_t concrete_count;
+        uint64_t table_size; // power of 2
+        uint64_t hooked_count; // number of types with callable fields
+        uint64_t cast_count; // number of types in the cast matrix
+
+        // [type_count]
+        section refs;
+        section sizes;
+        section dims;
+        section flags;
+        section concrete_indices;
+        section accepted_offsets; // offset in accepted_words or ~0u
+        section name_offsets;
+        section name_lengths;
+        section hook_slots; // index in hook_names or ~0u
+        section swizzle_offsets; // offset in swizzle_types or ~0u
+        section cast_indices; // index in the cast matrix or ~0u
+        // [type_count + 1] (ranges)
+        section member_offsets;
+        section subtype_offsets;
+        // [concrete_count]
+        section concrete_types;
+        // [total member count]
+        section member_names;
+        section member_types;
+        // [total subtype count]
+        section subtypes;
+        // [meta type count * words_per_set]
+        section accepted_words;
+        // [hooked_count]
+        section hook_names;
+        // [swizzled type count * 4]
+        section swizzle_types;
+        // [cast_count * cast_count] (flags << 16 | cost, see cast_matrix)
+        section cast_cells;
+        // [table_size]
+        section table;
+        // [total name length]
+        section names;
+      };
+
+    private:
+      frozen_type_db() = default;
+      explicit frozen_type_db(const type_db& db);
+
+      /// \brief Check the header and that every sections is in the image
+      static bool is_valid_image(const void* image, size_t size);
+      /// \brief Check that every stored index and range is in bounds (the image must pass is_valid_image)
+      static bool has_valid_entries(const void* image);
+
+      uint64_t slot_for(type::ref id) const
+      {
+        const uint64_t h = static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull;
+        return h >> table_shift;
+      }
+
+      template<typename T>
+      static T* write_ptr(uint8_t* image, const section& s)
+      {
+        return reinterpret_cast<T*>(image + s.offset);
+      }
+
+      template<typename T>
+      const T* get(const section& s) const
+      {
+        return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(header) + s.offset);
+      }
+
+      /// \brief Set the pointers to the different arrays of the image
+      void bind_image(const void* image);
+
+      bool accepts(uint32_t index, uint32_t concrete_index) const
+      {
+        if (accepted_offsets[index] == ~0u)
+          return concrete_indices[index] == concrete_index;
+        return (accepted_words[accepted_offsets[index] + concrete_index / 64] >> (concrete_index % 64)) & 1;
+      }
+
+      /// \brief Results of frozen_type::is_valid_resolution (the image is immutable, so they stay valid)
+      /// (behind a pointer, so that the DB can be moved)
+      struct resolution_memo
+      {
+        std::shared_mutex lock;
+        hash_table<bool, type_ref_pair> results;
+        std::atomic<uint64_t> hits = {0};
+        std::atomic<uint64_t> misses = {0};
+      };
+
+    private:
+      std::vector<uint64_t> storage; // the image (when owned)
+      mapped_file mapping; // the image (when loaded)
+
+      std::deque<type_hooks> owned_hooks; // when frozen from a type_db
+      std::vector<const type_hooks*> bound_hooks; // [hooked_count]
+
+      std::unique_ptr<resolution_memo> memo = std::make_unique<resolution_memo>();
+
+      // pointers to the different arrays of the image:
+      const image_header* header = nullptr;
+      unsigned table_shift = 64;
+      const type::ref* refs = nullptr;
+      const uint64_t* sizes = nullptr;
+      const uint32_t* dims = nullptr;
+      const uint32_t* flags = nullptr;
+      const uint32_t* concrete_indices = nullptr;
+      const uint32_t* accepted_offsets = nullptr;
+      const uint32_t* name_offsets = nullptr;
+      const uint32_t* name_lengths = nullptr;
+      const uint32_t* member_offsets = nullptr;
+      const uint32_t* subtype_offsets = nullptr;
+      const uint32_t* concrete_types = nullptr;
+      const hash_t* member_names = nullptr;
+      const uint32_t* member_types = nullptr;
+      const type::ref* subtypes = nullptr;
+      const uint64_t* accepted_words = nullptr;
+      const table_entry* table = nullptr;
+      const char* names = nullptr;
+      const uint32_t* hook_slots = nullptr;
+      const hash_t* hook_names = nullptr;
+      const uint32_t* swizzle_offsets = nullptr;
+      const uint32_t* swizzle_types = nullptr;
+      const uint32_t* cast_indices = nullptr;
+      const uint32_t* cast_cells = nullptr;
+
+      friend class type_db;
+      friend class frozen_type;
+      friend struct definition_accessor<frozen_type>;
+  };
+
+
+  // // // // //
+  // // // // //
+  // // // // //
+
+
+  inline frozen_type_db::frozen_type_db(const type_db& db)
+  {
+    const uint32_t type_count = static_cast<uint32_t>(db.definitions.size());
+    const uint32_t concrete_count = static_cast<uint32_t>(db.concrete_types.size());
+    const uint32_t set_words = static_cast<uint32_t>((concrete_count + 63) / 64);
+
+    // count everything:
+    uint64_t member_count = 0;
+    uint64_t subtype_count = 0;
+    uint64_t meta_count = 0;
+    uint64_t hooked_count = 0;
+    uint64_t swizzled_count = 0;
+    for (const auto& def : db.definitions)
+    {
+      swizzled_count += def.swizzle_types != decltype(def.swizzle_types){} ? 1 : 0;
+      member_count += def.members.size();
+      subtype_count += def.subtypes.size();
+      meta_count += def.concrete ? 0 : 1;
+      hooked_count += type_hooks::has_hooks(def) ? 1 : 0;
+    }
+    const cast_matrix& casts = db.casts; // see type_db::update_caches
+    const uint64_t cast_count = casts.size();
+
+    uint64_t table_size = 16;
+    while (type_count * 2 > table_size)
+      table_size *= 2;
+
+    // intern the names:
+    std::vector<char> name_blob;
+    std::vector<uint32_t> name_offs(type_count);
+    {
+      hash_table<uint32_t> interned;
+      for (uint32_t i = 0; i < type_count; ++i)
+      {
+        const std::string& name = db.definitions[i].debug_name;
+        const hash_t h = hash_string(name);
+        const uint32_t* off = interned.find(h);
+        if (off != nullptr && *off + name.size() <= name_blob.size() && name.compare(0, name.size(), name_blob.data() + *off, name.size()) == 0)
+        {
+          name_offs[i] = *off;
+          continue;
+        }
+        name_offs[i] = static_cast<uint32_t>(name_blob.size());
+        interned.insert(h, name_offs[i]);
+        name_blob.insert(name_blob.end(), name.begin(), name.end());
+      }
+    }
+
+    // layout:
+    image_header hdr = {};
+    uint64_t offset = (sizeof(image_header) + 7) & ~uint64_t(7);
+    const auto alloc = [&offset](section& s, uint64_t count, uint64_t elem_size)
+    {
+      s = {offset, count};
+      offset = (offset + count * elem_size + 7) & ~uint64_t(7);
+    };
+    alloc(hdr.refs, type_count, sizeof(type::ref));
+    alloc(hdr.sizes, type_count, sizeof(uint64_t));
+    alloc(hdr.dims, type_count, sizeof(uint32_t));
+    alloc(hdr.flags, type_count, sizeof(uint32_t));
+    alloc(hdr.concrete_indices, type_count, sizeof(uint32_t));
+    alloc(hdr.accepted_offsets, type_count, sizeof(uint32_t));
+    alloc(hdr.name_offsets, type_count, sizeof(uint32_t));
+    alloc(hdr.name_lengths, type_count, sizeof(uint32_t));
+    alloc(hdr.hook_slots, type_count, sizeof(uint32_t));
+    alloc(hdr.swizzle_offsets, type_count, sizeof(uint32_t));
+    alloc(hdr.cast_indices, type_count, sizeof(uint32_t));
+    alloc(hdr.member_offsets, type_count + 1, sizeof(uint32_t));
+    alloc(hdr.subtype_offsets, type_count + 1, sizeof(uint32_t));
+    alloc(hdr.concrete_types, concrete_count, sizeof(uint32_t));
+    alloc(hdr.member_names, member_count, sizeof(hash_t));
+    alloc(hdr.member_types, member_count, sizeof(uint32_t));
+    alloc(hdr.subtypes, subtype_count, sizeof(type::ref));
+    alloc(hdr.accepted_words, meta_count * set_words, sizeof(uint64_t));
+    alloc(hdr.hook_names, hooked_count, sizeof(hash_t));
+    alloc(hdr.swizzle_types, swizzled_count * 4, sizeof(uint32_t));
+    alloc(hdr.cast_cells, cast_count * cast_count, sizeof(uint32_t));
+    alloc(hdr.table, table_size, sizeof(table_entry));
+    alloc(hdr.names, name_blob.size(), sizeof(char));
+    hdr.magic = k_magic;
+    hdr.version = k_version;
+    hdr.image_size = offset;
+    hdr.hooked_count = hooked_count;
+    hdr.cast_count = cast_count;
+    hdr.type_count = type_count;
+    hdr.concrete_count = concrete_count;
+    hdr.table_size = table_size;
+
+    storage.resize(offset / sizeof(uint64_t), 0);
+    uint8_t* const image = reinterpret_cast<uint8_t*>(storage.data());
+    memcpy(image, &hdr, sizeof(hdr));
+
+    type::ref* const w_refs = write_ptr<type::ref>(image, hdr.refs);
+    uint64_t* const w_sizes = write_ptr<uint64_t>(image, hdr.sizes);
+    uint32_t* const w_dims = write_ptr<uint32_t>(image, hdr.dims);
+    uint32_t* const w_flags = write_ptr<uint32_t>(image, hdr.flags);
+    uint32_t* const w_concrete_indices = write_ptr<uint32_t>(image, hdr.concrete_indices);
+    uint32_t* const w_accepted_offsets = write_ptr<uint32_t>(image, hdr.accepted_offsets);
+    uint32_t* const w_name_offsets = write_ptr<uint32_t>(image, hdr.name_offsets);
+    uint32_t* const w_name_lengths = write_ptr<uint32_t>(image, hdr.name_lengths);
+    uint32_t* const w_hook_slots = write_ptr<uint32_t>(image, hdr.hook_slots);
+    uint32_t* const w_swizzle_offsets = write_ptr<uint32_t>(image, hdr.swizzle_offsets);
+    uint32_t* const w_cast_indices = write_ptr<uint32_t>(image, hdr.cast_indices);
+    uint32_t* const w_member_offsets = write_ptr<uint32_t>(image, hdr.member_offsets);
+    uint32_t* const w_subtype_offsets = write_ptr<uint32_t>(image, hdr.subtype_offsets);
+    uint32_t* const w_concrete_types = write_ptr<uint32_t>(image, hdr.concrete_types);
+    hash_t* const w_member_names = write_ptr<hash_t>(image, hdr.member_names);
+    uint32_t* const w_member_types = write_ptr<uint32_t>(image, hdr.member_types);
+    type::ref* const w_subtypes = write_ptr<type::ref>(image, hdr.subtypes);
+    uint64_t* const w_accepted_words = write_ptr<uint64_t>(image, hdr.accepted_words);
+    hash_t* const w_hook_names = write_ptr<hash_t>(image, hdr.hook_names);
+    uint32_t* const w_swizzle_types = write_ptr<uint32_t>(image, hdr.swizzle_types);
+    uint32_t* const w_cast_cells = write_ptr<uint32_t>(image, hdr.cast_cells);
+    table_entry* const w_table = write_ptr<table_entry>(image, hdr.table);
+    char* const w_names = write_ptr<char>(image, hdr.names);
+
+    // fill the image:
+    uint32_t member_it = 0;
+    uint32_t subtype_it = 0;
+    uint32_t accepted_it = 0;
+    uint32_t swizzle_it = 0;
+    for (uint32_t i = 0; i < type_count; ++i)
+    {
+      const type::definition& def = db.definitions[i];
+      const type_db::properties& props = db.cache[i].props;
+
+      w_refs[i] = def.type_id;
+      w_sizes[i] = props.size;
+      w_dims[i] = static_cast<uint32_t>(def.dim);
+      w_flags[i] = (def.concrete ? concrete : flag(0))
+                   | (props.valid ? valid : flag(0))
+                   | (props.fully_concrete ? fully_concrete : flag(0))
+                   | (def.can_default_construct ? can_default_construct : flag(0))
+                   | (def.is_dim_valid_for ? has_dim_getter : flag(0))
+                   | (def.members_getter ? has_members_getter : flag(0))
+                   | (def.subtypes_getter ? has_subtypes_getter : flag(0))
+                   | (!def.cast_into.empty() ? has_casts : flag(0))
+                   | (def.construct_from ? has_construct_from : flag(0))
+                   | (def.destruct ? has_destruct : flag(0));
+      w_concrete_indices[i] = db.concrete_indices[i];
+      w_cast_indices[i] = casts.get_cast_index(i);
+      w_name_offsets[i] = name_offs[i];
+      w_name_lengths[i] = static_cast<uint32_t>(def.debug_name.size());
+
+      w_swizzle_offsets[i] = ~0u;
+      if (def.swizzle_types != decltype(def.swizzle_types){})
+      {
+        w_swizzle_offsets[i] = swizzle_it;
+        for (const type::ref id : def.swizzle_types)
+          w_swizzle_types[swizzle_it++] = id != type::ref::zero ? db.index_of(id) : ~0u;
+      }
+
+      w_hook_slots[i] = ~0u;
+      if (type_hooks::has_hooks(def))
+      {
+        w_hook_slots[i] = static_cast<uint32_t>(owned_hooks.size());
+        w_hook_names[owned_hooks.size()] = type_hooks::name_of(def);
+        owned_hooks.push_back(type_hooks::from(def));
+      }
+
+      // members are sorted by name hash (std::map), subtypes by ref (std::set)
+      w_member_offsets[i] = member_it;
+      for (auto&& it : def.members)
+      {
+        w_member_names[member_it] = it.first;
+        w_member_types[member_it] = db.index_of(it.second);
+        ++member_it;
+      }
+      w_subtype_offsets[i] = subtype_it;
+      for (const type::ref id : def.subtypes)
+        w_subtypes[subtype_it++] = id;
+
+      w_accepted_offsets[i] = ~0u;
+      if (!def.concrete)
+      {
+        w_accepted_offsets[i] = accepted_it;
+        db.type_sets[i].set.for_each([&](uint32_t concrete_index)
+        {
+          w_accepted_words[accepted_it + concrete_index / 64] |= uint64_t(1) << (concrete_index % 64);
+        });
+        accepted_it += set_words;
+      }
+    }
+    w_member_offsets[type_count] = member_it;
+    w_subtype_offsets[type_count] = subtype_it;
+
+    for (uint32_t i = 0; i < concrete_count; ++i)
+      w_concrete_types[i] = db.concrete_types[i];
+    for (uint32_t from = 0; from < cast_count; ++from)
+    {
+      for (uint32_t to = 0; to < cast_count; ++to)
+      {
+        const cast_info info = casts.get(from, to);
+        w_cast_cells[from * cast_count + to] = (static_cast<uint32_t>(info.flags) << 16) | info.cost;
+      }
+    }
+    if (!name_blob.empty())
+      memcpy(w_names, name_blob.data(), name_blob.size());
+
+    bind_image(image);
+    for (const auto& hooks : owned_hooks)
+      bound_hooks.push_back(&hooks);
+
+    // index table: (the none type is not in it, as the "none" name is an alias and zero is the empty marker)
+    const uint64_t mask = table_size - 1;
+    const auto insert = [&](type::ref key, uint32_t index)
+    {
+      uint64_t slot = slot_for(key);
+      while (w_table[slot].key != type::ref::zero)
+        slot = (slot + 1) & mask;
+      w_table[slot] = {key, index};
+    };
+    insert(rukh_str_hash("none"), k_none);
+    for (uint32_t i = 1; i < type_count; ++i)
+      insert(db.definitions[i].type_id, i);
+  }
+
+  inline void frozen_type_db::bind_image(const void* image)
+  {
+    header = reinterpret_cast<const image_header*>(image);
+    table_shift = 64;
+    for (uint64_t c = header->table_size; c > 1; c >>= 1)
+      --table_shift;
+
+    refs = get<type::ref>(header->refs);
+    sizes = get<uint64_t>(header->sizes);
+    dims = get<uint32_t>(header->dims);
+    flags = get<uint32_t>(header->flags);
+    concrete_indices = get<uint32_t>(header->concrete_indices);
+    accepted_offsets = get<uint32_t>(header->accepted_offsets);
+    name_offsets = get<uint32_t>(header->name_offsets);
+    name_lengths = get<uint32_t>(header->name_lengths);
+    member_offsets = get<uint32_t>(header->member_offsets);
+    subtype_offsets = get<uint32_t>(header->subtype_offsets);
+    concrete_types = get<uint32_t>(header->concrete_types);
+    member_names = get<hash_t>(header->member_names);
+    member_types = get<uint32_t>(header->member_types);
+    subtypes = get<type::ref>(header->subtypes);
+    accepted_words = get<uint64_t>(header->accepted_words);
+    table = get<table_entry>(header->table);
+    names = get<char>(header->names);
+    hook_slots = get<uint32_t>(header->hook_slots);
+    hook_names = get<hash_t>(header->hook_names);
+    swizzle_offsets = get<uint32_t>(header->swizzle_offsets);
+    swizzle_types = get<uint32_t>(header->swizzle_types);
+    cast_indices = get<uint32_t>(header->cast_indices);
+    cast_cells = get<uint32_t>(header->cast_cells);
+  }
+
+  inline bool frozen_type_db::is_valid_image(const void* image, size_t size)
+  {
+    if (size < sizeof(image_header) || (reinterpret_cast<uintptr_t>(image) % alignof(image_header)) != 0)
+      return false;
+    const image_header& hdr = *reinterpret_cast<const image_header*>(image);
+    if (hdr.magic != k_magic || hdr.version != k_version || hdr.image_size > size)
+      return false;
+    // the table must have at least one empty slot (see index_of)
+    if (hdr.type_count == 0 || hdr.table_size == 0 || (hdr.table_size & (hdr.table_size - 1)) != 0 || hdr.table_size <= hdr.type_count)
+      return false;
+
+    // sections:
+    const auto in_image_any = [&hdr](const section& s, uint64_t elem_size)
+    {
+      return s.offset % 8 == 0 && s.offset <= hdr.image_size && s.count <= (hdr.image_size - s.offset) / elem_size;
+    };
+    const auto in_image = [&in_image_any](const section& s, uint64_t count, uint64_t elem_size)
+    {
+      return s.count == count && in_image_any(s, elem_size);
+    };
+    const uint64_t tc = hdr.type_count;
+    const bool sections_valid = in_image(hdr.refs, tc, sizeof(type::ref)) && in_image(hdr.sizes, tc, sizeof(uint64_t))
+           && in_image(hdr.dims, tc, sizeof(uint32_t)) && in_image(hdr.flags, tc, sizeof(uint32_t))
+           && in_image(hdr.concrete_indices, tc, sizeof(uint32_t)) && in_image(hdr.accepted_offsets, tc, sizeof(uint32_t))
+           && in_image(hdr.name_offsets, tc, sizeof(uint32_t)) && in_image(hdr.name_lengths, tc, sizeof(uint32_t))
+           && in_image(hdr.hook_slots, tc, sizeof(uint32_t)) && in_image(hdr.swizzle_offsets, tc, sizeof(uint32_t))
+           && in_image(hdr.member_offsets, tc + 1, sizeof(uint32_t)) && in_image(hdr.subtype_offsets, tc + 1, sizeof(uint32_t))
+           && hdr.concrete_count <= tc && in_image(hdr.concrete_types, hdr.concrete_count, sizeof(uint32_t))
+           && in_image_any(hdr.member_names, sizeof(hash_t)) && in_image(hdr.member_types, hdr.member_names.count, sizeof(uint32_t))
+           && in_image_any(hdr.subtypes, sizeof(type::ref)) && in_image_any(hdr.accepted_words, sizeof(uint64_t))
+           && in_image(hdr.hook_names, hdr.hooked_count, sizeof(hash_t)) && in_image_any(hdr.swizzle_types, sizeof(uint32_t))
+           && in_image(hdr.cast_indices, tc, sizeof(uint32_t))
+           && hdr.cast_count <= tc && in_image(hdr.cast_cells, hdr.cast_count * hdr.cast_count, sizeof(uint32_t))
+           && in_image(hdr.table, hdr.table_size, sizeof(table_entry)) && in_image_any(hdr.names, sizeof(char));
+    if (!sections_valid)
+      return false;
+
+    // offsets of the member/subtype ranges: (read by size checks in the queries)
+    const uint8_t* const base = reinterpret_cast<const uint8_t*>(image);
+    const uint32_t* const member_offsets = reinterpret_cast<const uint32_t*>(base + hdr.member_offsets.offset);
+    const uint32_t* const subtype_offsets = reinterpret_cast<const uint32_t*>(base + hdr.subtype_offsets.offset);
+    return member_offsets[0] == 0 && member_offsets[tc] == hdr.member_names.count
+        && subtype_offsets[0] == 0 && subtype_offsets[tc] == hdr.subtypes.count;
+  }
+
+  inline bool frozen_type_db::has_valid_entries(const void* image)
+  {
+    // stored values: (every index and range is used without check by the queries)
+    const image_header& hdr = *reinterpret_cast<const image_header*>(image);
+    const uint64_t tc = hdr.type_count;
+    const uint8_t* const base = reinterpret_cast<const uint8_t*>(image);
+    const auto array = [base](const section& s) { return reinterpret_cast<const uint32_t*>(base + s.offset); };
+    const uint32_t* const flags = array(hdr.flags);
+    const uint32_t* const concrete_indices = array(hdr.concrete_indices);
+    const uint32_t* const accepted_offsets = array(hdr.accepted_offsets);
+    const uint32_t* const name_offsets = array(hdr.name_offsets);
+    const uint32_t* const name_lengths = array(hdr.name_lengths);
+    const uint32_t* const hook_slots = array(hdr.hook_slots);
+    const uint32_t* const swizzle_offsets = array(hdr.swizzle_offsets);
+    const uint32_t* const cast_indices = array(hdr.cast_indices);
+    const uint32_t* const member_offsets = array(hdr.member_offsets);
+    const uint32_t* const subtype_offsets = array(hdr.subtype_offsets);
+    const uint32_t* const concrete_types = array(hdr.concrete_types);
+    const uint32_t* const member_types = array(hdr.member_types);
+    const uint32_t* const swizzle_types = array(hdr.swizzle_types);
+
+    const uint64_t set_words = (uint64_t(hdr.concrete_count) + 63) / 64;
+    const uint32_t hook_flags = has_dim_getter | has_members_getter | has_subtypes_getter | has_casts | has_construct_from | has_destruct;
+    for (uint64_t i = 0; i < tc; ++i)
+    {
+      if (member_offsets[i] > member_offsets[i + 1] || subtype_offsets[i] > subtype_offsets[i + 1])
+        return false;
+      if (concrete_indices[i] != k_not_concrete && concrete_indices[i] >= hdr.concrete_count)
+        return false;
+      if (accepted_offsets[i] != ~0u && uint64_t(accepted_offsets[i]) + set_words > hdr.accepted_words.count)
+        return false;
+      if (uint64_t(name_offsets[i]) + name_lengths[i] > hdr.names.count)
+        return false;
+      if (hook_slots[i] != ~0u ? hook_slots[i] >= hdr.hooked_count : (flags[i] & hook_flags) != 0)
+        return false;
+      if (swizzle_offsets[i] != ~0u && uint64_t(swizzle_offsets[i]) + 4 > hdr.swizzle_types.count)
+        return false;
+      if (cast_indices[i] != ~0u && cast_indices[i] >= hdr.cast_count)
+        return false;
+    }
+    for (uint64_t i = 0; i < hdr.concrete_count; ++i)
+    {
+      if (concrete_types[i] >= tc)
+        return false;
+    }
+    for (uint64_t i = 0; i < hdr.member_types.count; ++i)
+    {
+      if (member_types[i] >= tc)
+        return false;
+    }
+    for (uint64_t i = 0; i < hdr.swizzle_types.count; ++i)
+    {
+      if (swizzle_types[i] != ~0u && swizzle_types[i] >= tc)
+        return false;
+    }
+
+    const table_entry* const table = reinterpret_cast<const table_entry*>(base + hdr.table.offset);
+    bool has_empty_slot = false;
+    for (uint64_t i = 0; i < hdr.table_size; ++i)
+    {
+      if (table[i].key == type::ref::zero)
+        has_empty_slot = true;
+      else if (table[i].index >= tc)
+        return false;
+    }
+    return has_empty_slot;
+  }
+
+  inline std::optional<frozen_type_db> frozen_type_db::load_image(const std::string& path, const hook_registry& hooks, bool validate_entries)
+  {
+    frozen_type_db ret;
+    if (!ret.mapping.map(path))
+      return {};
+    if (!is_valid_image(ret.mapping.data, ret.mapping.size))
+      return {};
+    if (validate_entries && !has_valid_entries(ret.mapping.data))
+      return {};
+
+    ret.bind_image(ret.mapping.data);
+    ret.bound_hooks.reserve(ret.header->hooked_count);
+    for (uint64_t i = 0; i < ret.header->hooked_count; ++i)
+    {
+      const type_hooks* th = hooks.find(ret.hook_names[i]);
+      if (th == nullptr)
+        return {};
+      ret.bound_hooks.push_back(th);
+    }
+    return {std::move(ret)};
+  }
+
+  inline bool frozen_type_db::save_image(const std::string& path) const
+  {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+      return false;
+    const bool success = fwrite(header, 1, header->image_size, f) == header->image_size;
+    return (fclose(f) == 0) && success;
+  }
+
+  inline frozen_type_db type_db::freeze() const
+  {
+    std::lock_guard<std::shared_mutex> _l(sync.cache_lock);
+    update_caches();
+    return frozen_type_db(*this);
+  }
+
+
+  // // // // //
+  // // // // //
+  // // // // //
+
+
+  inline type::ref frozen_type::get_ref() const
+  {
+    return tdb.refs[index];
+  }
+
+  inline std::string_view frozen_type::get_debug_name() const
+  {
+    return {tdb.names + tdb.name_offsets[index], tdb.name_lengths[index]};
+  }
+
+  inline const type_hooks& frozen_type::get_hooks() const
+  {
+    static const type_hooks empty;
+    const uint32_t slot = tdb.hook_slots[index];
+    return slot != ~0u ? *tdb.bound_hooks[slot] : empty;
+  }
+
+  /// \brief Read the arrays of the image (see definition_accessor)
+  template<>
+  struct definition_accessor<frozen_type>
+  {
+    static bool has_dim_getter(const frozen_type& t) { return t.tdb.flags[t.index] & frozen_type_db::has_dim_getter; }
+    static bool is_dim_valid_for(const frozen_type& t, size_t dim) { return t.get_hooks().is_dim_valid_for(dim); }
+    static size_t get_dim(const frozen_type& t) { return t.tdb.dims[t.index]; }
+
+    static size_t get_member_count(const frozen_type& t) { return t.tdb.member_offsets[t.index + 1] - t.tdb.member_offsets[t.index]; }
+
+    static std::optional<type::ref> find_member(const frozen_type& t, hash_t name)
+    {
+      if (const uint32_t member = t.find_member(name); member != ~0u)
+        return t.tdb.refs[t.tdb.member_types[member]];
+      return {};
+    }
+
+    static type::ref get_dynamic_member(const frozen_type& t, hash_t name)
+    {
+      if (t.tdb.flags[t.index] & frozen_type_db::has_members_getter)
+        return t.get_hooks().members_getter(name);
+      return type::ref::zero;
+    }
+
+    template<typename Fnc>
+    static bool all_members(const frozen_type& t, Fnc&& fnc)
+    {
+      for (uint32_t i = t.tdb.member_offsets[t.index]; i < t.tdb.member_offsets[t.index + 1]; ++i)
+      {
+        if (!fnc(t.tdb.member_names[i], t.tdb.refs[t.tdb.member_types[i]]))
+          return false;
+      }
+      return true;
+    }
+
+    static type::ref get_swizzle_type(const frozen_type& t, size_t length)
+    {
+      const uint32_t offset = t.tdb.swizzle_offsets[t.index];
+      if (offset == ~0u)
+        return type::ref::zero;
+      const uint32_t swizzle_type = t.tdb.swizzle_types[offset + length - 1];
+      return swizzle_type != ~0u ? t.tdb.refs[swizzle_type] : type::ref::zero;
+    }
+
+    static bool has_subtype(const frozen_type& t, type::ref subtype)
+    {
+      const type::ref* const begin = t.tdb.subtypes + t.tdb.subtype_offsets[t.index];
+      const type::ref* const end = t.tdb.subtypes + t.tdb.subtype_offsets[t.index + 1];
+      return std::binary_search(begin, end, subtype)
+             || ((t.tdb.flags[t.index] & frozen_type_db::has_subtypes_getter) && t.get_hooks().subtypes_getter(subtype));
+    }
+
+    template<typename Fnc>
+    static bool all_subtypes(const frozen_type& t, Fnc&& fnc)
+    {
+      for (uint32_t i = t.tdb.subtype_offsets[t.index]; i < t.tdb.subtype_offsets[t.index + 1]; ++i)
+      {
+        if (!fnc(t.tdb.subtypes[i]))
+          return false;
+      }
+      return true;
+    }
+
+    static cast_info get_cast(const frozen_type& from, const frozen_type& to) { return from.tdb.get_cast(from.index, to.index); }
+  };
+
+  inline bool frozen_type::can_implicit_cast(const frozen_type& other) const
+  {
+    return type_queries::can_implicit_cast(*this, other);
+  }
+
+  inline bool frozen_type::can_lossless_cast(const frozen_type& other) const
+  {
+    return type_queries::can_lossless_cast(*this, other);
+  }
+
+  inline bool frozen_type::is_valid() const
+  {
+    return tdb.flags[index] & frozen_type_db::valid;
+  }
+
+  inline bool frozen_type::is_primitive() const
+  {
+    return tdb.member_offsets[index] == tdb.member_offsets[index + 1] && is_fully_concrete();
+  }
+
+  inline bool frozen_type::is_concrete() const
+  {
+    return tdb.flags[index] & frozen_type_db::concrete;
+  }
+
+  inline bool frozen_type::is_fully_concrete() const
+  {
+    return tdb.flags[index] & frozen_type_db::fully_concrete;
+  }
+
+  inline size_t frozen_type::size() const
+  {
+    return tdb.sizes[index];
+  }
+
+  inline uint32_t frozen_type::find_member(hash_t name) const
+  {
+    const hash_t* const begin = tdb.member_names + tdb.member_offsets[index];
+    const hash_t* const end = tdb.member_names + tdb.member_offsets[index + 1];
+    const hash_t* const it = std::lower_bound(begin, end, name);
+    if (it != end && *it == name)
+      return static_cast<uint32_t>(it - tdb.member_names);
+    return ~0u;
+  }
+
+  inline const swizzle::entry* frozen_type::get_swizzle(hash_t name) const
+  {
+    return type_queries::get_swizzle(*this, name);
+  }
+
+  inline bool frozen_type::has_member(hash_t name) const
+  {
+    return type_queries::has_member(*this, name);
+  }
+
+  inline frozen_type frozen_type::get_member_type(hash_t name) const
+  {
+    return type_queries::get_member_type(*this, name);
+  }
+
+  inline bool frozen_type::accepts(const frozen_type& t) const
+  {
+    const uint32_t concrete_index = tdb.concrete_indices[t.index];
+    return concrete_index != frozen_type_db::k_not_concrete && tdb.accepts(index, concrete_index);
+  }
+
+  inline bool frozen_type::is_valid_resolution(const frozen_type& t) const
+  {
+    // Test for self
+    if (&t.tdb == &tdb && t.index == index)
+      return true;
+
+    frozen_type_db::resolution_memo& memo = *tdb.memo;
+    const type_ref_pair key = {get_ref(), t.get_ref()};
+    {
+      std::shared_lock<std::shared_mutex> _l(memo.lock);
+      if (const bool* it = memo.results.find(key); it != nullptr)
+      {
+        memo.hits.fetch_add(1, std::memory_order_relaxed);
+        return *it;
+      }
+    }
+    memo.misses.fetch_add(1, std::memory_order_relaxed);
+
+    const bool result = type_queries::compute_resolution(*this, t);
+    std::lock_guard<std::shared_mutex> _l(memo.lock);
+    memo.results.insert(key, result);
+    return result;
+  }
+} // namespace rukh
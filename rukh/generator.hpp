@@ -0,0 +1,120 @@
+//
+// file : generator.hpp
+// in : file:///home/tim/projects/rukh/rukh/generator.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:41:21 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+#include "span.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  class base_node;
+
+  /// \brief The operations nodes can emit when generating code
+  enum class opcode : uint8_t
+  {
+    constant, // no operand, immediate: index of the constant in the value table
+    input, // no operand, immediate: index of the input of the function
+    output, // operands: {value}, immediate: index of the output of the function. Produces no value.
+
+    add, sub, mul, div, rem, neg,
+    min, max, abs,
+    lt, le, gt, ge, eq, ne,
+    logical_and, logical_or, logical_not,
+    select, // operands: {condition, if true, if false}
+
+    dot, cross,
+    mat_mul, // operands: {a, b} (matrix * matrix, matrix * vector or vector * matrix, depending on the types)
+    transpose,
+
+    construct, // operands: the components (or members), in order
+    extract, // operands: {value}, immediate: index of the component / member
+    swizzle, // operands: {vector}, immediate: 2 bits per component, component count in the top 4 bits (see swizzle_immediate)
+    convert, // operands: {value}, converted to the result type
+
+    intrinsic, // operands: the arguments, immediate: the intrinsic (defined by the frontend)
+  };
+
+  /// \brief Return whether or not an operation only depends on its operands (and has no side effect)
+  /// Two pure operations with the same operands, type and immediate define the same value.
+  /// Intrinsics are defined by the frontend, and so are considered as not pure.
+  constexpr bool is_pure(opcode op)
+  {
+    return op != opcode::output && op != opcode::intrinsic;
+  }
+
+  /// \brief Return the immediate of a swizzle operation
+  /// \param components the index of the source component of each component of the result (at most 4)
+  constexpr uint32_t swizzle_immediate(span<const uint8_t> components)
+  {
+    uint32_t ret = static_cast<uint32_t>(components.size()) << 28;
+    for (size_t i = 0; i < components.size(); ++i)
+      ret |= static_cast<uint32_t>(components[i] & 3) << (i * 2);
+    return ret;
+  }
+
+  /// \brief Interface of the code generators (the backends), given to base_node::generate()
+  ///
+  /// Generators produce SSA code: every operation that produces something defines a new value (see rukh::value)
+  /// that is used as an operand of the following operations. Nodes set the values they emit on their output pins,
+  /// the values of the inputs are those of the output pins they are connected to (which may be constants, see
+  /// base_node::const_generate: generators must accept constants of the value table as operands).
+  ///
+  /// rukh::ir::builder is the default generator (RUKH-IR), rukh::range_pruner can be put in front of a generator
+  /// to skip the operations that the ranges of their operands make redundant (see range_analysis).
+  class generator
+  {
+    public:
+      virtual ~generator() = default;
+
+      /// \brief Emit an operation
+      /// \param result_type the type of the result (type::ref::zero for operations that produce nothing)
+      /// \param immediate an operation-specific constant (see opcode)
+      /// \return the value defined by the operation (an invalid value if the operation produces nothing or failed)
+      virtual value emit(opcode op, type::ref result_type, span<const value> operands, uint32_t immediate = 0) = 0;
+
+      /// \brief Emit an operation (g.emit(opcode::add, t, {a, b}))
+      value emit(opcode op, type::ref result_type, std::initializer_list<value> operands, uint32_t immediate = 0)
+      {
+        return emit(op, result_type, span<const value>(operands.begin(), operands.size()), immediate);
+      }
+
+      /// \brief Called by pass_runner::generate before a node is generated, once the values of its inputs are set
+      /// (nodes of a batch are all begun before the batch is generated). The default implementation does nothing.
+      /// \param node the index of the node in its graph
+      virtual void begin_node(uint32_t /*node*/, const base_node& /*n*/) {}
+
+      /// \brief Called by pass_runner::generate after a node has been generated (its outputs have their values)
+      virtual void end_node(uint32_t /*node*/, const base_node& /*n*/) {}
+  };
+} // namespace rukh
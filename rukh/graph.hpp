@@ -0,0 +1,548 @@
+//
+// file : graph.hpp
+// in : file:///home/tim/projects/rukh/rukh/graph.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:08:11 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "node.hpp"
+#include "node_kind.hpp"
+#include "span.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  /// \brief Handle to a node of a graph
+  struct node_handle
+  {
+    uint32_t index = ~0u;
+
+    bool is_valid() const { return index != ~0u; }
+
+    bool operator == (const node_handle& o) const { return index == o.index; }
+    bool operator != (const node_handle& o) const { return index != o.index; }
+  };
+
+  /// \brief Handle to a connection of a graph
+  /// \warning Edge handles are invalidated by disconnect()
+  struct edge_handle
+  {
+    uint32_t index = ~0u;
+
+    bool is_valid() const { return index != ~0u; }
+
+    bool operator == (const edge_handle& o) const { return index == o.index; }
+    bool operator != (const edge_handle& o) const { return index != o.index; }
+  };
+
+  /// \brief A graph of nodes: owns the nodes and the connections between their pins
+  ///
+  /// Nodes are allocated in an arena and referenced by 32-bit handles. Connections are stored in a struct-of-arrays
+  /// edge table (one array per field), so whole-graph passes are linear scans over contiguous memory.
+  /// Destroying (or clearing) a graph runs the node destructors in a single pass, then resets the arena.
+  ///
+  /// The graph records which nodes have to be resolved / generated again (dirty nodes): new nodes, nodes whose inputs
+  /// have been connected or disconnected and nodes whose params have been edited (see edit_param / mark_dirty).
+  /// It also records the edits of its topology (see get_topology_edits), so that the resolver can patch its order
+  /// instead of computing it again. The resolver uses that to only re-run the nodes affected by an edit (see resolver::update)
+  ///
+  /// The connections ending at a node are indexed by input pin, the connections starting from a node are linked in
+  /// a list: both are updated in constant time by connect() / disconnect().
+  ///
+  /// Every node also records its kind (its concrete type, see node_kind), so that passes can process all the nodes
+  /// of the same type with a single call (see pass_runner).
+  ///
+  /// Some nodes can be flagged as output nodes (the results of the graph, see set_output_node). When there are some,
+  /// only the nodes that (directly or not) are connected to an output node are processed by the resolver.
+  class graph
+  {
+    public:
+      /// \brief The connections of the graph, as parallel arrays (index = edge_handle::index)
+      /// A connection goes from an output pin of the source node to an input pin of the destination node.
+      struct edge_table
+      {
+        std::vector<uint32_t> src_node;
+        std::vector<uint32_t> src_pin; // index in get_output_pins()
+        std::vector<uint32_t> dst_node;
+        std::vector<uint32_t> dst_pin; // index in get_input_pins()
+        std::vector<type::ref> types; // resolved type of the connection (type::ref::zero if not yet resolved)
+
+        size_t size() const { return src_node.size(); }
+      };
+
+      /// \brief An edit of the topology of the graph (see get_topology_edits)
+      struct topology_edit
+      {
+        enum class kind_t : uint8_t
+        {
+          add_node, // node: the new node
+          connect, // node: the source of the connection, dst: its destination
+          disconnect, // node: the source of the connection, dst: its destination
+          set_output_node, // node: the node flagged (or unflagged) as an output node
+        };
+
+        kind_t kind;
+        uint32_t node;
+        uint32_t dst = ~0u;
+      };
+
+    public:
+      explicit graph(size_t arena_chunk_size = arena::k_default_chunk_size) : allocator(arena_chunk_size) {}
+      ~graph() { clear(); }
+
+      graph(graph&&) = default;
+      graph& operator = (graph&& o)
+      {
+        if (this != &o)
+        {
+          clear();
+          allocator = std::move(o.allocator);
+          nodes = std::move(o.nodes);
+          edges = std::move(o.edges);
+          kinds = std::move(o.kinds);
+          node_kinds = std::move(o.node_kinds);
+          values = std::move(o.values);
+          dirty = std::move(o.dirty);
+          dirty_list = std::move(o.dirty_list);
+          output_nodes = std::move(o.output_nodes);
+          input_offsets = std::move(o.input_offsets);
+          input_edges = std::move(o.input_edges);
+          first_output_edges = std::move(o.first_output_edges);
+          next_output_edges = std::move(o.next_output_edges);
+          prev_output_edges = std::move(o.prev_output_edges);
+          topology_version = o.topology_version + 1;
+          drop_topology_edits();
+          o.nodes.clear();
+          o.node_kinds.clear();
+        }
+        return *this;
+      }
+      graph(const graph&) = delete;
+      graph& operator = (const graph&) = delete;
+
+      /// \brief Create a node in the graph
+      /// \tparam Node must inherit from base_node (most probably via rukh::node<...>)
+      template<typename Node, typename... Args>
+      node_handle add_node(Args&&... args)
+      {
+        static_assert(std::is_base_of_v<base_node, Node>, "rukh::graph::add_node: Node must inherit from rukh::base_node");
+        base_node* n = allocator.create<Node>(std::forward<Args>(args)...);
+        return add(n, get_kind_index<Node>());
+      }
+
+      /// \brief Create a copy of a node of another graph: a node of the same type, with the same params and state
+      /// (the connections are not copied)
+      /// \return an invalid handle if the type of the node is not copy-constructible (see node_kind::clone)
+      node_handle add_copy(const graph& src, node_handle n)
+      {
+        const node_kind& kind = src.get_node_kind(n);
+        if (kind.clone == nullptr)
+          return {};
+        return add(kind.clone(src.get_node(n), allocator), get_kind_index(kind));
+      }
+
+      /// \brief Reserve memory for \p node_count nodes and \p edge_count connections
+      void reserve(size_t node_count, size_t edge_count)
+      {
+        nodes.reserve(node_count);
+        node_kinds.reserve(node_count);
+        input_offsets.reserve(node_count);
+        first_output_edges.reserve(node_count);
+        dirty.reserve(node_count);
+        dirty_list.reserve(node_count);
+        edges.src_node.reserve(edge_count);
+        edges.src_pin.reserve(edge_count);
+        edges.dst_node.reserve(edge_count);
+        edges.dst_pin.reserve(edge_count);
+        edges.types.reserve(edge_count);
+        next_output_edges.reserve(edge_count);
+        prev_output_edges.reserve(edge_count);
+      }
+
+      /// \brief Return a node of the graph
+      base_node& get_node(node_handle h) { return *nodes[h.index]; }
+      const base_node& get_node(node_handle h) const { return *nodes[h.index]; }
+
+      /// \brief Return the number of nodes in the graph
+      size_t get_node_count() const { return nodes.size(); }
+
+      /// \brief Return the table holding the values (constants) set by the nodes
+      value_table& get_values() { return values; }
+      const value_table& get_values() const { return values; }
+
+      /// \brief Return the index of the kind of a node (in get_node_kinds())
+      uint32_t get_node_kind_index(node_handle h) const { return node_kinds[h.index]; }
+
+      /// \brief Return the kind of a node
+      const node_kind& get_node_kind(node_handle h) const { return kinds[node_kinds[h.index]]; }
+
+      /// \brief Return the kinds of the nodes that have been added to the graph
+      span<const node_kind> get_node_kinds() const { return kinds; }
+
+      /// \brief Connect an output pin of a node to an input pin of another node
+      /// An output pin can be connected to any number of input pins, but an input pin can only have one connection.
+      /// \return an invalid handle if one of the nodes / pins does not exist, or if the input pin is already connected
+      ///         (the existing connection has to be removed first, see find_input_edge and disconnect)
+      edge_handle connect(node_handle src, uint32_t src_pin, node_handle dst, uint32_t dst_pin, type::ref t = type::ref::zero)
+      {
+        if (src.index >= nodes.size() || dst.index >= nodes.size())
+          return {};
+        if (src_pin >= nodes[src.index]->get_output_pins().size() || dst_pin >= nodes[dst.index]->get_input_pins().size())
+          return {};
+        uint32_t& input_edge = input_edges[input_offsets[dst.index] + dst_pin];
+        if (input_edge != ~0u)
+          return {};
+
+        const uint32_t e = static_cast<uint32_t>(edges.size());
+        input_edge = e;
+        edges.src_node.push_back(src.index);
+        edges.src_pin.push_back(src_pin);
+        edges.dst_node.push_back(dst.index);
+        edges.dst_pin.push_back(dst_pin);
+        edges.types.push_back(t);
+
+        // (at the head of the list of the source)
+        uint32_t& first = first_output_edges[src.index];
+        next_output_edges.push_back(first);
+        prev_output_edges.push_back(~0u);
+        if (first != ~0u)
+          prev_output_edges[first] = e;
+        first = e;
+
+        record_topology_edit({topology_edit::kind_t::connect, src.index, dst.index});
+        mark_dirty(dst);
+        return {e};
+      }
+
+      /// \brief Remove a connection
+      /// \warning The last connection takes the place of the removed one (its handle becomes \p e)
+      bool disconnect(edge_handle e)
+      {
+        if (e.index >= edges.size())
+          return false;
+        record_topology_edit({topology_edit::kind_t::disconnect, edges.src_node[e.index], edges.dst_node[e.index]});
+        mark_dirty({edges.dst_node[e.index]});
+        input_edges[input_offsets[edges.dst_node[e.index]] + edges.dst_pin[e.index]] = ~0u;
+        unlink_output_edge(e.index);
+        const uint32_t last = static_cast<uint32_t>(edges.size() - 1);
+        if (e.index != last)
+        {
+          input_edges[input_offsets[edges.dst_node[last]] + edges.dst_pin[last]] = e.index;
+          // the last connection takes the place of the removed one in the list of its source:
+          const uint32_t next = next_output_edges[last];
+          const uint32_t prev = prev_output_edges[last];
+          next_output_edges[e.index] = next;
+          prev_output_edges[e.index] = prev;
+          if (next != ~0u)
+            prev_output_edges[next] = e.index;
+          if (prev != ~0u)
+            next_output_edges[prev] = e.index;
+          else
+            first_output_edges[edges.src_node[last]] = e.index;
+        }
+        const auto swap_remove = [i = e.index](auto& v)
+        {
+          v[i] = v.back();
+          v.pop_back();
+        };
+        swap_remove(edges.src_node);
+        swap_remove(edges.src_pin);
+        swap_remove(edges.dst_node);
+        swap_remove(edges.dst_pin);
+        swap_remove(edges.types);
+        swap_remove(next_output_edges);
+        swap_remove(prev_output_edges);
+        return true;
+      }
+
+      /// \brief Return the connections of the graph
+      const edge_table& get_edges() const { return edges; }
+
+      /// \brief Return the number of connections in the graph
+      size_t get_edge_count() const { return edges.size(); }
+
+      /// \brief Set the resolved type of a connection
+      void set_edge_type(edge_handle e, type::ref t) { edges.types[e.index] = t; }
+
+      /// \brief Call fnc(node_handle, base_node&) for every node of the graph (in creation order)
+      template<typename Fnc>
+      void for_each_node(Fnc&& fnc)
+      {
+        for (uint32_t i = 0; i < nodes.size(); ++i)
+          fnc(node_handle{i}, *nodes[i]);
+      }
+
+      /// \brief Call fnc(node_handle, const base_node&) for every node of the graph (in creation order)
+      template<typename Fnc>
+      void for_each_node(Fnc&& fnc) const
+      {
+        for (uint32_t i = 0; i < nodes.size(); ++i)
+          fnc(node_handle{i}, static_cast<const base_node&>(*nodes[i]));
+      }
+
+      /// \brief Call fnc(edge_handle) for every connection that ends at a given node (in the order of its input pins)
+      template<typename Fnc>
+      void for_each_input_edge(node_handle n, Fnc&& fnc) const
+      {
+        const uint32_t end = n.index + 1 < nodes.size() ? input_offsets[n.index + 1] : static_cast<uint32_t>(input_edges.size());
+        for (uint32_t i = input_offsets[n.index]; i < end; ++i)
+        {
+          if (input_edges[i] != ~0u)
+            fnc(edge_handle{input_edges[i]});
+        }
+      }
+
+      /// \brief Call fnc(edge_handle) for every connection that starts at a given node (the last connected first)
+      template<typename Fnc>
+      void for_each_output_edge(node_handle n, Fnc&& fnc) const
+      {
+        for (uint32_t e = first_output_edges[n.index]; e != ~0u; e = next_output_edges[e])
+          fnc(edge_handle{e});
+      }
+
+      /// \brief Return the connection that ends at a given input pin (or an invalid handle)
+      edge_handle find_input_edge(node_handle n, uint32_t pin) const
+      {
+        if (n.index >= nodes.size() || pin >= nodes[n.index]->get_input_pins().size())
+          return {};
+        return {input_edges[input_offsets[n.index] + pin]};
+      }
+
+      /// \brief Remove every node and connection
+      /// Destructors are run in a single pass, then the arena is reset (its memory is kept for the next nodes)
+      void clear()
+      {
+        for (base_node* n : nodes)
+          n->~base_node();
+        nodes.clear();
+        node_kinds.clear();
+        edges = {};
+        input_offsets.clear();
+        input_edges.clear();
+        first_output_edges.clear();
+        next_output_edges.clear();
+        prev_output_edges.clear();
+        dirty.clear();
+        dirty_list.clear();
+        output_nodes.clear();
+        ++topology_version;
+        drop_topology_edits();
+        values.reset();
+        allocator.reset();
+      }
+
+    public: // output nodes
+      /// \brief Flag (or unflag) a node as an output of the graph
+      /// If the graph has output nodes, the nodes that do not contribute to any of them are dead: they are
+      /// neither resolved nor generated (see resolver). If it has none, every node is live.
+      /// \note Does nothing if the node does not exist
+      void set_output_node(node_handle n, bool is_output = true)
+      {
+        assert(n.index < nodes.size());
+        if (n.index >= nodes.size())
+          return;
+        const auto it = std::find(output_nodes.begin(), output_nodes.end(), n.index);
+        if ((it != output_nodes.end()) == is_output)
+          return;
+        if (is_output)
+          output_nodes.push_back(n.index);
+        else
+          output_nodes.erase(it);
+        record_topology_edit({topology_edit::kind_t::set_output_node, n.index});
+      }
+
+      /// \brief Return whether or not a node is flagged as an output of the graph
+      bool is_output_node(node_handle n) const
+      {
+        return std::find(output_nodes.begin(), output_nodes.end(), n.index) != output_nodes.end();
+      }
+
+      /// \brief Return the output nodes (in the order they have been flagged)
+      span<const uint32_t> get_output_nodes() const { return output_nodes; }
+
+    public: // dirty tracking
+      /// \brief Access a param of a node in order to change it. Marks the node as dirty.
+      /// \warning The node and the param must exist
+      param_impl& edit_param(node_handle n, uint32_t param)
+      {
+        assert(n.index < nodes.size() && param < nodes[n.index]->get_params().size());
+        mark_dirty(n);
+        return nodes[n.index]->get_param_impls()[param];
+      }
+
+      /// \brief Flag a node as needing to be resolved / generated again (for instance after a change in its internal state)
+      void mark_dirty(node_handle n)
+      {
+        if (dirty[n.index] != 0)
+          return;
+        dirty[n.index] = 1;
+        dirty_list.push_back(n.index);
+      }
+
+      /// \brief Return whether or not a node is dirty
+      bool is_dirty(node_handle n) const { return dirty[n.index] != 0; }
+
+      /// \brief Return the dirty nodes (in the order they have been flagged)
+      span<const uint32_t> get_dirty_nodes() const { return dirty_list; }
+
+      /// \brief Clear the dirty flags (done by the resolver)
+      void clear_dirty()
+      {
+        for (const uint32_t n : dirty_list)
+          dirty[n] = 0;
+        dirty_list.clear();
+      }
+
+      /// \brief Return a number that changes every time a node or a connection is added or removed
+      uint64_t get_topology_version() const { return topology_version; }
+
+      /// \brief Return whether or not every topology edit since a given topology version is in get_topology_edits()
+      /// The edits are dropped (and no longer recorded until clear_topology_edits) once there are as many of them as
+      /// nodes and connections in the graph: computing the topology again is then as fast as replaying them.
+      bool has_topology_edits_since(uint64_t version) const { return topology_edits_version == version; }
+
+      /// \brief Return the edits of the topology (in the order they have been made), see has_topology_edits_since
+      span<const topology_edit> get_topology_edits() const { return topology_edits; }
+
+      /// \brief Clear the topology edits, and record the next ones (done by the resolver)
+      void clear_topology_edits()
+      {
+        topology_edits.clear();
+        topology_edits_version = topology_version;
+      }
+
+    private:
+      node_handle add(base_node* n, uint32_t kind)
+      {
+        nodes.push_back(n);
+        node_kinds.push_back(kind);
+        input_offsets.push_back(static_cast<uint32_t>(input_edges.size()));
+        input_edges.resize(input_edges.size() + n->get_input_pins().size(), ~0u);
+        first_output_edges.push_back(~0u);
+        dirty.push_back(0);
+        record_topology_edit({topology_edit::kind_t::add_node, static_cast<uint32_t>(nodes.size() - 1)});
+        mark_dirty({static_cast<uint32_t>(nodes.size() - 1)});
+        return {static_cast<uint32_t>(nodes.size() - 1)};
+      }
+
+      void record_topology_edit(const topology_edit& edit)
+      {
+        ++topology_version;
+        if (topology_edits_version == k_no_topology_edits)
+          return;
+        if (topology_edits.size() >= nodes.size() + edges.size())
+        {
+          drop_topology_edits();
+          return;
+        }
+        topology_edits.push_back(edit);
+      }
+
+      void drop_topology_edits()
+      {
+        topology_edits.clear();
+        topology_edits_version = k_no_topology_edits;
+      }
+
+      /// \brief Remove a connection from the list of its source
+      void unlink_output_edge(uint32_t e)
+      {
+        const uint32_t next = next_output_edges[e];
+        const uint32_t prev = prev_output_edges[e];
+        if (next != ~0u)
+          prev_output_edges[next] = prev;
+        if (prev != ~0u)
+          next_output_edges[prev] = next;
+        else
+          first_output_edges[edges.src_node[e]] = next;
+      }
+
+      /// \brief Return the index of a kind in kinds (~0u if it is not there)
+      uint32_t find_kind_index(const void* id) const
+      {
+        // there are few different node types in a graph: a linear search is fine
+        for (uint32_t i = 0; i < kinds.size(); ++i)
+        {
+          if (kinds[i].id.id == id)
+            return i;
+        }
+        return ~0u;
+      }
+
+      template<typename Node>
+      uint32_t get_kind_index()
+      {
+        const uint32_t ret = find_kind_index(type_identity<Node>::id.id);
+        if (ret != ~0u)
+          return ret;
+        kinds.push_back(node_kind::make<Node>());
+        return static_cast<uint32_t>(kinds.size() - 1);
+      }
+
+      uint32_t get_kind_index(const node_kind& kind)
+      {
+        const uint32_t ret = find_kind_index(kind.id.id);
+        if (ret != ~0u)
+          return ret;
+        kinds.push_back(kind);
+        return static_cast<uint32_t>(kinds.size() - 1);
+      }
+
+    private:
+      arena allocator;
+      std::vector<base_node*> nodes;
+      edge_table edges;
+      std::vector<uint32_t> input_offsets; // [node count] index of the first input pin of the node in input_edges
+      std::vector<uint32_t> input_edges; // [input pin count] the connection ending at each input pin (~0u if none)
+      std::vector<uint32_t> first_output_edges; // [node count] the last connection starting from the node (~0u if none)
+      std::vector<uint32_t> next_output_edges; // [edge count] next connection in the list of the source (~0u if none)
+      std::vector<uint32_t> prev_output_edges; // [edge count] previous connection in the list of the source (~0u if none)
+
+      std::vector<node_kind> kinds; // kinds are kept by clear()
+      std::vector<uint32_t> node_kinds; // [node count] index in kinds
+
+      value_table values;
+
+      std::vector<uint8_t> dirty; // [node count]
+      std::vector<uint32_t> dirty_list;
+      std::vector<uint32_t> output_nodes;
+      uint64_t topology_version = 0;
+
+      static constexpr uint64_t k_no_topology_edits = ~uint64_t(0);
+      std::vector<topology_edit> topology_edits; // since topology_edits_version
+      uint64_t topology_edits_version = 0; // k_no_topology_edits if they have been dropped
+  };
+} // namespace rukh
@@ -0,0 +1,533 @@
+//
+// file : graph_image.hpp
+// in : file:///home/tim/projects/rukh/rukh/graph_image.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:30:14 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "graph.hpp"
+#include "hash_table.hpp"
+#include "mapped_file.hpp"
+#include "node_registry.hpp"
+#include "reporter.hpp"
+#include "span.hpp"
+#include "string_pool.hpp"
+
+namespace rukh
+{
+  /// \brief A binary dump of a graph (its nodes, their params and the connections)
+  ///
+  /// The image is made of fixed-size records (one array per record type) and a string table, and does not contain
+  /// any pointer: it can be saved to a file (save_image) and then directly mmap-ed (load_image).
+  /// Reading the records does not require any parsing or allocation.
+  ///
+  /// Node kinds are identified by the hash of their name (as with rk_str, see node_registry) and pins by the
+  /// offset of their name in the string table (the pin index is also stored, and used when the name still matches,
+  /// so that images stay loadable when pins are added to a node).
+  ///
+  /// Node records are in topological order (when the graph has no cycle, see is_topological) and edge records are
+  /// sorted by destination node, so that an image can be loaded and resolved chunk by chunk (see stream_loader).
+  class graph_image
+  {
+    public:
+      struct node_record
+      {
+        hash_t kind; // hash of the name of the node
+        uint32_t name; // offset in the string table
+        uint32_t first_param; // index in the param records
+        uint32_t param_count;
+        uint32_t flags; // see node_flags
+      };
+
+      enum node_flags : uint32_t
+      {
+        k_output_node = 1 << 0, // see graph::set_output_node
+      };
+
+      struct param_record
+      {
+        uint32_t pin; // index in get_params()
+        uint32_t name; // offset in the string table
+        type::ref param_type;
+      };
+
+      struct edge_record
+      {
+        uint32_t src_node; // index in the node records
+        uint32_t src_pin; // index in get_output_pins()
+        uint32_t src_pin_name; // offset in the string table
+        uint32_t dst_node;
+        uint32_t dst_pin; // index in get_input_pins()
+        uint32_t dst_pin_name;
+        type::ref edge_type;
+      };
+
+      static constexpr uint32_t k_magic = 'R' | ('K' << 8) | ('G' << 16) | ('I' << 24);
+      static constexpr uint32_t k_version = 2;
+
+      enum flags : uint32_t
+      {
+        k_topological = 1 << 0, // every edge goes from a node to a node that is after it
+      };
+
+    public:
+      graph_image(graph_image&&) = default;
+      graph_image& operator = (graph_image&&) = default;
+
+      /// \brief Dump a graph
+      static graph_image from_graph(const graph& g);
+
+      /// \brief Map an image file (as written by save_image)
+      /// \param prefetch start reading the whole file in the background (for a full instantiate()). Streamed loads,
+      ///        that read the image once and release it as they go (see stream_loader), should not prefetch it.
+      /// \return nothing if the file cannot be mapped or is not a valid graph image (or of a different version)
+      static std::optional<graph_image> load_image(const std::string& path, bool prefetch = true);
+
+      /// \brief Use an image that is already in memory (the memory must outlive the returned image)
+      /// \return nothing if the memory does not contain a valid graph image (or is not aligned on 8 bytes)
+      static std::optional<graph_image> from_memory(const void* data, size_t size);
+
+      /// \brief Write the image to a file, so that it can be loaded with load_image
+      bool save_image(const std::string& path) const;
+
+      /// \brief Return the image data
+      const void* get_data() const { return header; }
+
+      /// \brief Return the size of the image (in bytes)
+      size_t get_image_size() const { return header->image_size; }
+
+      /// \brief Return whether or not the node records are in topological order (false if the graph had a cycle)
+      bool is_topological() const { return (header->flags & k_topological) != 0; }
+
+      span<const node_record> get_nodes() const { return {get<node_record>(header->nodes), header->nodes.count}; }
+      span<const param_record> get_params() const { return {get<param_record>(header->params), header->params.count}; }
+      span<const edge_record> get_edges() const { return {get<edge_record>(header->edges), header->edges.count}; }
+
+      /// \brief Return a string of the string table (an empty string if the offset is not valid)
+      std::string_view get_string(uint32_t offset) const
+      {
+        const string_entry* e = get_string_entry(offset);
+        return e != nullptr ? std::string_view(reinterpret_cast<const char*>(e + 1), e->length) : std::string_view();
+      }
+
+      /// \brief Return the hash of a string of the string table (hash_t::zero if the offset is not valid)
+      hash_t get_string_hash(uint32_t offset) const
+      {
+        const string_entry* e = get_string_entry(offset);
+        return e != nullptr ? e->hash : hash_t::zero;
+      }
+
+      /// \brief Add the nodes and connections of the image to a graph
+      /// Nothing is added if a node kind is not in the registry.
+      /// Params and connections to pins that do not exist (anymore) are reported and skipped.
+      /// \return true if everything has been added
+      bool instantiate(graph& g, const node_registry& registry, reporter& r) const;
+
+    private:
+      /// \brief Position of an array in the image
+      struct section
+      {
+        uint64_t offset;
+        uint64_t count;
+      };
+
+      /// \brief What's at the start of the image
+      struct image_header
+      {
+        uint32_t magic; // also checks the endianness
+        uint32_t version;
+        uint64_t image_size;
+        uint32_t flags;
+        uint32_t reserved;
+
+        section nodes;
+        section params;
+        section edges;
+        section strings; // in bytes
+      };
+
+      /// \brief An entry of the string table (followed by the characters, padded to 8 bytes)
+      struct string_entry
+      {
+        hash_t hash;
+        uint32_t length;
+        uint32_t reserved;
+      };
+
+    private:
+      graph_image() = default;
+
+      /// \brief Check that every section is in the image
+      static bool is_valid_image(const void* image, size_t size);
+
+      template<typename T>
+      const T* get(const section& s) const
+      {
+        return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(header) + s.offset);
+      }
+
+      const string_entry* get_string_entry(uint32_t offset) const
+      {
+        const uint64_t size = header->strings.count;
+        if (offset % 8 != 0 || uint64_t(offset) + sizeof(string_entry) > size)
+          return nullptr;
+        const string_entry* e = reinterpret_cast<const string_entry*>(get<uint8_t>(header->strings) + offset);
+        return uint64_t(offset) + sizeof(string_entry) + e->length <= size ? e : nullptr;
+      }
+
+      /// \brief Create a node from its record and set its params
+      /// \return the created node (its params that do not exist anymore are reported and skipped: \p success is then false)
+      node_handle add_node(graph& g, node_registry::create_fnc create, const node_record& rec, reporter& r, bool& success) const;
+
+      /// \brief Add the connection of an edge record (the nodes of the image start at \p base in the graph)
+      /// \return the created connection (or an invalid handle if the edge is not valid, which is reported)
+      edge_handle connect(graph& g, uint32_t base, const edge_record& rec, type::ref t, reporter& r) const;
+
+      /// \brief Let the OS reclaim the (whole) pages of [begin, end) when the image is mapped (they are read again if needed)
+      /// \return where the next range to release should begin, so that the partial pages are released too (see mapped_file::release)
+      const void* release(const void* begin, const void* end) const
+      {
+        const uint8_t* const data = reinterpret_cast<const uint8_t*>(header);
+        return data + mapping.release(reinterpret_cast<const uint8_t*>(begin) - data, reinterpret_cast<const uint8_t*>(end) - reinterpret_cast<const uint8_t*>(begin));
+      }
+
+      /// \brief Return the index of the pin named \p name (\p hint is checked first), or ~0u
+      static uint32_t find_pin(span<const pin_rt> pins, uint32_t hint, hash_t name)
+      {
+        if (hint < pins.size() && pins[hint].name_hash == name)
+          return hint;
+        for (uint32_t i = 0; i < pins.size(); ++i)
+        {
+          if (pins[i].name_hash == name)
+            return i;
+        }
+        return ~0u;
+      }
+
+    private:
+      std::vector<uint64_t> storage; // the image (when owned)
+      mapped_file mapping; // the image (when loaded)
+      const image_header* header = nullptr;
+
+      friend class stream_loader;
+  };
+
+
+  // // // // //
+  // // // // //
+  // // // // //
+
+
+  inline graph_image graph_image::from_graph(const graph& g)
+  {
+    const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+    const graph::edge_table& edges = g.get_edges();
+    const uint32_t edge_count = static_cast<uint32_t>(edges.size());
+
+    // put the nodes in topological order (Kahn) and sort the edges by destination.
+    // nodes[i] is the node stored at index i in the image, indices[n] the index of the node n in the image
+    std::vector<uint32_t> offsets(node_count + 1, 0);
+    std::vector<uint32_t> out_edges(edge_count);
+    for (uint32_t e = 0; e < edge_count; ++e)
+      ++offsets[edges.src_node[e] + 1];
+    for (uint32_t n = 0; n < node_count; ++n)
+      offsets[n + 1] += offsets[n];
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (uint32_t e = 0; e < edge_count; ++e)
+        out_edges[fill[edges.src_node[e]]++] = e;
+    }
+    std::vector<uint32_t> count(node_count, 0);
+    for (uint32_t e = 0; e < edge_count; ++e)
+      ++count[edges.dst_node[e]];
+    std::vector<uint32_t> nodes;
+    nodes.reserve(node_count);
+    for (uint32_t n = 0; n < node_count; ++n)
+    {
+      if (count[n] == 0)
+        nodes.push_back(n);
+    }
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+      for (uint32_t j = offsets[nodes[i]]; j < offsets[nodes[i] + 1]; ++j)
+      {
+        if (--count[edges.dst_node[out_edges[j]]] == 0)
+          nodes.push_back(edges.dst_node[out_edges[j]]);
+      }
+    }
+    const bool topological = nodes.size() == node_count;
+    if (!topological)
+    {
+      // keep the order of the graph
+      nodes.resize(node_count);
+      for (uint32_t n = 0; n < node_count; ++n)
+        nodes[n] = n;
+    }
+    std::vector<uint32_t>& indices = count;
+    for (uint32_t i = 0; i < node_count; ++i)
+      indices[nodes[i]] = i;
+
+    // edges sorted by destination (stable counting sort):
+    std::vector<uint32_t> sorted_edges(edge_count);
+    offsets.assign(node_count + 1, 0);
+    for (uint32_t e = 0; e < edge_count; ++e)
+      ++offsets[indices[edges.dst_node[e]] + 1];
+    for (uint32_t n = 0; n < node_count; ++n)
+      offsets[n + 1] += offsets[n];
+    for (uint32_t e = 0; e < edge_count; ++e)
+      sorted_edges[offsets[indices[edges.dst_node[e]]]++] = e;
+
+    // string table:
+    std::vector<uint8_t> strings;
+    hash_table<uint32_t> string_offsets;
+    const auto intern = [&](hash_t hash, std::string_view str) -> uint32_t
+    {
+      if (const uint32_t* offset = string_offsets.find(hash); offset != nullptr)
+        return *offset;
+      const uint32_t offset = static_cast<uint32_t>(strings.size());
+      const string_entry e = {hash, static_cast<uint32_t>(str.size()), 0};
+      strings.resize(offset + ((sizeof(string_entry) + str.size() + 7) & ~size_t(7)), 0);
+      memcpy(strings.data() + offset, &e, sizeof(e));
+      memcpy(strings.data() + offset + sizeof(e), str.data(), str.size());
+      string_offsets.insert(hash, offset);
+      return offset;
+    };
+
+    std::vector<uint8_t> is_output(node_count, 0);
+    for (const uint32_t n : g.get_output_nodes())
+      is_output[n] = 1;
+
+    std::vector<node_record> node_records;
+    std::vector<param_record> param_records;
+    node_records.reserve(node_count);
+    for (const uint32_t n : nodes)
+    {
+      const base_node& node = g.get_node({n});
+      const std::string_view name = node.get_name();
+      const hash_t kind = node.get_name_hash();
+      node_record& rec = node_records.emplace_back();
+      rec = {kind, intern(kind, name), static_cast<uint32_t>(param_records.size()), 0, is_output[n] != 0 ? uint32_t(k_output_node) : 0u};
+
+      const span<const pin_rt> params = node.get_params();
+      const span<const param_impl> impls = node.get_param_impls();
+      for (uint32_t i = 0; i < params.size(); ++i)
+      {
+        if (impls[i].get_type() == type::ref::zero)
+          continue;
+        param_records.push_back({i, intern(params[i].name_hash, params[i].name), impls[i].get_type()});
+        ++rec.param_count;
+      }
+    }
+
+    std::vector<edge_record> edge_records(edge_count);
+    for (uint32_t i = 0; i < edge_count; ++i)
+    {
+      const uint32_t e = sorted_edges[i];
+      const pin_rt& src = g.get_node({edges.src_node[e]}).get_output_pins()[edges.src_pin[e]];
+      const pin_rt& dst = g.get_node({edges.dst_node[e]}).get_input_pins()[edges.dst_pin[e]];
+      edge_records[i] =
+      {
+        indices[edges.src_node[e]], edges.src_pin[e], intern(src.name_hash, src.name),
+        indices[edges.dst_node[e]], edges.dst_pin[e], intern(dst.name_hash, dst.name),
+        edges.types[e],
+      };
+    }
+
+    // layout:
+    image_header hdr = {};
+    hdr.magic = k_magic;
+    hdr.version = k_version;
+    hdr.flags = topological ? uint32_t(k_topological) : 0u;
+    uint64_t at = (sizeof(image_header) + 7) & ~uint64_t(7);
+    const auto place = [&at](section& s, uint64_t count, uint64_t elem_size)
+    {
+      s = {at, count};
+      at = (at + count * elem_size + 7) & ~uint64_t(7);
+    };
+    place(hdr.nodes, node_records.size(), sizeof(node_record));
+    place(hdr.params, param_records.size(), sizeof(param_record));
+    place(hdr.edges, edge_records.size(), sizeof(edge_record));
+    place(hdr.strings, strings.size(), 1);
+    hdr.image_size = at;
+
+    graph_image ret;
+    ret.storage.resize(at / 8, 0);
+    uint8_t* const image = reinterpret_cast<uint8_t*>(ret.storage.data());
+    memcpy(image, &hdr, sizeof(hdr));
+    const auto write = [image](const section& s, const void* src, size_t size)
+    {
+      if (size > 0)
+        memcpy(image + s.offset, src, size);
+    };
+    write(hdr.nodes, node_records.data(), node_records.size() * sizeof(node_record));
+    write(hdr.params, param_records.data(), param_records.size() * sizeof(param_record));
+    write(hdr.edges, edge_records.data(), edge_records.size() * sizeof(edge_record));
+    write(hdr.strings, strings.data(), strings.size());
+    ret.header = reinterpret_cast<const image_header*>(image);
+    return ret;
+  }
+
+  inline bool graph_image::is_valid_image(const void* image, size_t size)
+  {
+    if (size < sizeof(image_header) || (reinterpret_cast<uintptr_t>(image) % alignof(image_header)) != 0)
+      return false;
+    const image_header& hdr = *reinterpret_cast<const image_header*>(image);
+    if (hdr.magic != k_magic || hdr.version != k_version || hdr.image_size > size)
+      return false;
+
+    const auto in_image = [&hdr](const section& s, uint64_t elem_size)
+    {
+      return s.offset % 8 == 0 && s.offset <= hdr.image_size && s.count <= (hdr.image_size - s.offset) / elem_size;
+    };
+    return in_image(hdr.nodes, sizeof(node_record)) && in_image(hdr.params, sizeof(param_record))
+           && in_image(hdr.edges, sizeof(edge_record)) && in_image(hdr.strings, 1);
+  }
+
+  inline std::optional<graph_image> graph_image::load_image(const std::string& path, bool prefetch)
+  {
+    graph_image ret;
+    if (!ret.mapping.map(path))
+      return {};
+    if (!is_valid_image(ret.mapping.data, ret.mapping.size))
+      return {};
+    ret.mapping.advise_sequential();
+    if (prefetch)
+      ret.mapping.advise_will_need();
+    ret.header = reinterpret_cast<const image_header*>(ret.mapping.data);
+    return {std::move(ret)};
+  }
+
+  inline std::optional<graph_image> graph_image::from_memory(const void* data, size_t size)
+  {
+    if (!is_valid_image(data, size))
+      return {};
+    graph_image ret;
+    ret.header = reinterpret_cast<const image_header*>(data);
+    return {std::move(ret)};
+  }
+
+  inline bool graph_image::save_image(const std::string& path) const
+  {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+      return false;
+    const bool success = fwrite(header, 1, header->image_size, f) == header->image_size;
+    return (fclose(f) == 0) && success;
+  }
+
+  inline node_handle graph_image::add_node(graph& g, node_registry::create_fnc create, const node_record& rec, reporter& r, bool& success) const
+  {
+    const span<const param_record> params = get_params();
+    const node_handle h = create(g);
+    base_node& node = g.get_node(h);
+    if ((rec.flags & k_output_node) != 0)
+      g.set_output_node(h);
+    if (rec.first_param > params.size() || rec.param_count > params.size() - rec.first_param)
+    {
+      r.log(reporter::severity_t::error, "graph_image: invalid params for a node of kind '{}'", node.get_name());
+      success = false;
+      return h;
+    }
+    for (const param_record& p : params.subspan(rec.first_param, rec.param_count))
+    {
+      const uint32_t pin = find_pin(node.get_params(), p.pin, get_string_hash(p.name));
+      if (pin == ~0u)
+      {
+        r.log(reporter::severity_t::error, "graph_image: node '{}' has no param named '{}'", node.get_name(), get_string(p.name));
+        success = false;
+        continue;
+      }
+      g.edit_param(h, pin).set_type(p.param_type);
+    }
+    return h;
+  }
+
+  inline edge_handle graph_image::connect(graph& g, uint32_t base, const edge_record& rec, type::ref t, reporter& r) const
+  {
+    const size_t node_count = get_nodes().size();
+    if (rec.src_node >= node_count || rec.dst_node >= node_count || base + rec.src_node >= g.get_node_count() || base + rec.dst_node >= g.get_node_count())
+    {
+      r.log(reporter::severity_t::error, "graph_image: invalid connection");
+      return {};
+    }
+    const node_handle src = {base + rec.src_node};
+    const node_handle dst = {base + rec.dst_node};
+    const uint32_t src_pin = find_pin(g.get_node(src).get_output_pins(), rec.src_pin, get_string_hash(rec.src_pin_name));
+    const uint32_t dst_pin = find_pin(g.get_node(dst).get_input_pins(), rec.dst_pin, get_string_hash(rec.dst_pin_name));
+    if (src_pin == ~0u || dst_pin == ~0u)
+    {
+      r.log(reporter::severity_t::error, "graph_image: cannot connect '{}'.'{}' to '{}'.'{}': pin not found",
+            g.get_node(src).get_name(), get_string(rec.src_pin_name), g.get_node(dst).get_name(), get_string(rec.dst_pin_name));
+      return {};
+    }
+    const edge_handle e = g.connect(src, src_pin, dst, dst_pin, t);
+    if (!e.is_valid())
+    {
+      r.log(reporter::severity_t::error, "graph_image: cannot connect '{}'.'{}' to '{}'.'{}': the input pin is already connected",
+            g.get_node(src).get_name(), get_string(rec.src_pin_name), g.get_node(dst).get_name(), get_string(rec.dst_pin_name));
+    }
+    return e;
+  }
+
+  inline bool graph_image::instantiate(graph& g, const node_registry& registry, reporter& r) const
+  {
+    const span<const node_record> nodes = get_nodes();
+    const span<const edge_record> edges = get_edges();
+
+    // check that every node can be created before modifying the graph:
+    bool success = true;
+    for (const node_record& it : nodes)
+    {
+      if (registry.find(it.kind) == nullptr)
+      {
+        r.log(reporter::severity_t::error, "graph_image: unknown node kind: '{}'", get_string(it.name));
+        success = false;
+      }
+    }
+    if (!success)
+      return false;
+
+    const uint32_t base = static_cast<uint32_t>(g.get_node_count());
+    g.reserve(base + nodes.size(), g.get_edge_count() + edges.size());
+    for (const node_record& it : nodes)
+      add_node(g, registry.find(it.kind), it, r, success);
+    for (const edge_record& it : edges)
+    {
+      if (!connect(g, base, it, it.edge_type, r).is_valid())
+        success = false;
+    }
+    return success;
+  }
+} // namespace rukh
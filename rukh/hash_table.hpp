@@ -0,0 +1,213 @@
+//
+// file : hash_table.hpp
+// in : file:///home/tim/projects/rukh/rukh/hash_table.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 22:49:36 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "string.hpp"
+
+namespace rukh
+{
+  /// \brief Describe how a key is hashed / compared in a hash_table
+  /// Keys are expected to already be hashes (or made of hashes), so no real hashing is done.
+  /// Specialize this for other key types.
+  template<typename Key>
+  struct hash_table_key
+  {
+    static constexpr uint64_t hash(Key k) { return static_cast<uint64_t>(k); }
+  };
+
+  /// \brief Flat, open-addressing (linear probing) hash table
+  /// As keys are already hashes, their bits are directly used (after a fibonacci scramble, so that
+  /// the top bits are well distributed) to find the slot. Lookups are then (most of the time) a single cache miss.
+  ///
+  /// \note The default constructed key (hash_t::zero for hash_t) is reserved as the empty marker
+  ///       and cannot be inserted
+  /// \note Value should be small and trivially copiable (like an index).
+  ///       Pointers to values are invalidated by insertions.
+  template<typename Value, typename Key = hash_t>
+  class hash_table
+  {
+    public:
+      hash_table() = default;
+
+      /// \brief Return a pointer to the value associated with the key, or nullptr if not found
+      Value* find(Key k)
+      {
+        return const_cast<Value*>(static_cast<const hash_table*>(this)->find(k));
+      }
+
+      /// \brief Return a pointer to the value associated with the key, or nullptr if not found
+      const Value* find(Key k) const
+      {
+        if (count == 0 || k == Key{})
+          return nullptr;
+        const size_t mask = slots.size() - 1;
+        for (size_t i = slot_for(k);; i = (i + 1) & mask)
+        {
+          const slot& s = slots[i];
+          if (s.key == k)
+            return &s.value;
+          if (s.key == Key{})
+            return nullptr;
+        }
+      }
+
+      /// \brief Insert a new entry. Does nothing if the key is already in the table
+      /// \return the value in the table and whether or not the insertion took place
+      std::pair<Value*, bool> insert(Key k, Value v)
+      {
+        if (k == Key{})
+          return {nullptr, false};
+        if ((count + 1) * 4 > slots.size() * 3)
+          rehash(slots.empty() ? k_min_capacity : slots.size() * 2);
+
+        const size_t mask = slots.size() - 1;
+        for (size_t i = slot_for(k);; i = (i + 1) & mask)
+        {
+          slot& s = slots[i];
+          if (s.key == k)
+            return {&s.value, false};
+          if (s.key == Key{})
+          {
+            s.key = k;
+            s.value = std::move(v);
+            ++count;
+            return {&s.value, true};
+          }
+        }
+      }
+
+      /// \brief Remove an entry
+      /// \return whether or not the key was in the table
+      /// \note Pointers to values are invalidated
+      bool erase(Key k)
+      {
+        if (count == 0 || k == Key{})
+          return false;
+        const size_t mask = slots.size() - 1;
+        size_t i = slot_for(k);
+        for (; slots[i].key != k; i = (i + 1) & mask)
+        {
+          if (slots[i].key == Key{})
+            return false;
+        }
+
+        // backward-shift deletion (no tombstones): move back the next entries of the cluster
+        // that would not be reachable from their slot anymore
+        for (size_t j = (i + 1) & mask; slots[j].key != Key{}; j = (j + 1) & mask)
+        {
+          const size_t home = slot_for(slots[j].key);
+          if (((j - home) & mask) >= ((j - i) & mask))
+          {
+            slots[i] = std::move(slots[j]);
+            i = j;
+          }
+        }
+        slots[i] = slot{};
+        --count;
+        return true;
+      }
+
+      /// \brief Make room for at least \p entry_count entries without rehashing
+      void reserve(size_t entry_count)
+      {
+        size_t capacity = k_min_capacity;
+        while (entry_count * 4 > capacity * 3)
+          capacity *= 2;
+        if (capacity > slots.size())
+          rehash(capacity);
+      }
+
+      /// \brief Remove every entries (keeps the memory)
+      void clear()
+      {
+        for (auto& s : slots)
+          s = slot{};
+        count = 0;
+      }
+
+      size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+
+      /// \brief Return the number of slots (the table is rehashed when it is more than 3/4 full)
+      size_t capacity() const { return slots.size(); }
+
+      /// \brief Call \p fnc(key, value) for every entry (in no particular order)
+      template<typename Fnc>
+      void for_each(Fnc&& fnc) const
+      {
+        for (const auto& s : slots)
+        {
+          if (s.key != Key{})
+            fnc(s.key, s.value);
+        }
+      }
+
+    private:
+      static constexpr size_t k_min_capacity = 16;
+
+      struct slot
+      {
+        Key key = {};
+        Value value = {};
+      };
+
+      size_t slot_for(Key k) const
+      {
+        // fibonacci hashing: the multiply spreads all the bits of the key in the top bits
+        return static_cast<size_t>((hash_table_key<Key>::hash(k) * 0x9E3779B97F4A7C15ull) >> shift);
+      }
+
+      void rehash(size_t capacity)
+      {
+        std::vector<slot> old = std::move(slots);
+        slots.clear();
+        slots.resize(capacity);
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+          --shift;
+        count = 0;
+        for (auto& s : old)
+        {
+          if (s.key != Key{})
+            insert(s.key, std::move(s.value));
+        }
+      }
+
+    private:
+      std::vector<slot> slots;
+      size_t count = 0;
+      unsigned shift = 64;
+  };
+} // namespace rukh
@@ -0,0 +1,442 @@
+//
+// file : ir.hpp
+// in : file:///home/tim/projects/rukh/rukh/ir.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:41:21 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "arena.hpp"
+#include "generator.hpp"
+#include "hash_table.hpp"
+#include "span.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  /// \brief RUKH-IR, the default IR (see ir::builder)
+  namespace ir
+  {
+    /// \brief The id of an instruction in a function (and of the value it defines)
+    using id = uint32_t;
+    static constexpr id k_invalid_id = ~0u;
+
+    /// \brief An instruction (fixed-size)
+    /// The operands are the ids of the instructions that define them, stored in function::get_operands()
+    struct instruction
+    {
+      opcode op;
+      uint8_t reserved;
+      uint16_t operand_count;
+      uint32_t type; // index in function::get_types()
+      uint32_t first_operand; // index in function::get_operands()
+      uint32_t immediate; // see opcode
+    };
+    static_assert(sizeof(instruction) == 16);
+
+    namespace internal
+    {
+      /// \brief A growable array of trivial objects, allocated in an arena
+      /// When it grows, the previous array is left in the arena (it is reclaimed when the arena is reset).
+      template<typename Type>
+      struct arena_array
+      {
+        Type* data = nullptr;
+        uint32_t size = 0;
+        uint32_t capacity = 0;
+
+        void reserve(arena& a, uint32_t count)
+        {
+          if (count <= capacity)
+            return;
+          Type* const new_data = a.allocate_array<Type>(count);
+          if (size > 0)
+            memcpy(new_data, data, size * sizeof(Type));
+          data = new_data;
+          capacity = count;
+        }
+
+        /// \brief Add \p count (uninitialized) elements and return them
+        Type* push(arena& a, uint32_t count)
+        {
+          if (size + count > capacity)
+            reserve(a, std::max<uint32_t>({capacity * 2, size + count, 64}));
+          Type* const ret = data + size;
+          size += count;
+          return ret;
+        }
+
+        void clear() { *this = {}; }
+      };
+    } // namespace internal
+
+    /// \brief A function in SSA form: a list of instructions, each defining (at most) one value
+    ///
+    /// Instructions and operands are stored in flat arrays allocated in an arena owned by the function, so emitting
+    /// an instruction does not allocate (only the arrays grow, by doubling). reset() keeps the memory of the arena:
+    /// a function that is reset and filled again (for instance for the next permutation of a shader) does not allocate
+    /// at all once it has grown to the size of the biggest function.
+    ///
+    /// Use lists (the instructions using a value) are built on demand (see build_use_lists) in flat arrays.
+    class function
+    {
+      public:
+        explicit function(size_t arena_chunk_size = arena::k_default_chunk_size) : allocator(arena_chunk_size) { reset(); }
+        function(function&&) = default;
+        function& operator = (function&&) = default;
+
+        /// \brief Add an instruction
+        /// \return the id of the instruction (k_invalid_id if an operand is not the id of a previous instruction)
+        id add(opcode op, type::ref t, span<const id> operands, uint32_t immediate = 0)
+        {
+          const id ret = instructions.size;
+          if (operands.size() > 0xFFFF)
+            return k_invalid_id;
+          for (const id it : operands)
+          {
+            if (it >= ret)
+              return k_invalid_id;
+          }
+
+          instruction& ins = *instructions.push(allocator, 1);
+          ins = {op, 0, static_cast<uint16_t>(operands.size()), get_type_index(t), this->operands.size, immediate};
+          if (!operands.empty())
+            memcpy(this->operands.push(allocator, static_cast<uint32_t>(operands.size())), operands.data(), operands.size() * sizeof(id));
+          has_uses = false;
+          return ret;
+        }
+
+        /// \brief Reserve memory for \p instruction_count instructions using a total of \p operand_count operands
+        void reserve(uint32_t instruction_count, uint32_t operand_count)
+        {
+          instructions.reserve(allocator, instruction_count);
+          operands.reserve(allocator, operand_count);
+        }
+
+        size_t get_instruction_count() const { return instructions.size; }
+        span<const instruction> get_instructions() const { return {instructions.data, instructions.size}; }
+        const instruction& get_instruction(id i) const { return instructions.data[i]; }
+
+        /// \brief Return the operands of an instruction
+        span<const id> get_operands(id i) const
+        {
+          const instruction& ins = instructions.data[i];
+          return {operands.data + ins.first_operand, ins.operand_count};
+        }
+
+        /// \brief Return the type of the value defined by an instruction
+        type::ref get_type(id i) const { return types[instructions.data[i].type]; }
+
+        /// \brief Return the types used by the function (instruction::type indexes this)
+        span<const type::ref> get_types() const { return types; }
+
+        /// \brief Build the use lists (invalidated when an instruction is added)
+        void build_use_lists();
+
+        /// \brief Return whether or not the use lists are up to date
+        bool has_use_lists() const { return has_uses; }
+
+        /// \brief Return the instructions using the value defined by an instruction (in order)
+        /// \note The use lists must have been built (see build_use_lists)
+        span<const id> get_uses(id i) const
+        {
+          return {uses.data + use_offsets.data[i], use_offsets.data[i + 1] - use_offsets.data[i]};
+        }
+
+        /// \brief Remove every instruction (the memory is kept)
+        void reset()
+        {
+          allocator.reset();
+          instructions.clear();
+          operands.clear();
+          use_offsets.clear();
+          uses.clear();
+          has_uses = false;
+          types.clear();
+          type_indices.clear();
+          types.push_back(type::ref::zero);
+        }
+
+        /// \brief Make the function a copy of \p o (the memory of the function is reused)
+        void assign(const function& o)
+        {
+          reset();
+          if (o.instructions.size > 0)
+            memcpy(instructions.push(allocator, o.instructions.size), o.instructions.data, o.instructions.size * sizeof(instruction));
+          if (o.operands.size > 0)
+            memcpy(operands.push(allocator, o.operands.size), o.operands.data, o.operands.size * sizeof(id));
+          types = o.types;
+          type_indices = o.type_indices;
+        }
+
+        /// \brief Return the memory used by the function (in bytes)
+        size_t get_used_size() const { return allocator.get_used_size(); }
+
+      private:
+        uint32_t get_type_index(type::ref t)
+        {
+          if (t == type::ref::zero)
+            return 0;
+          const auto [index, inserted] = type_indices.insert(t, static_cast<uint32_t>(types.size()));
+          if (inserted)
+            types.push_back(t);
+          return *index;
+        }
+
+      private:
+        arena allocator;
+        internal::arena_array<instruction> instructions;
+        internal::arena_array<id> operands;
+        internal::arena_array<uint32_t> use_offsets; // [instruction count + 1]
+        internal::arena_array<id> uses;
+        bool has_uses = false;
+
+        std::vector<type::ref> types; // [0] is type::ref::zero
+        hash_table<uint32_t> type_indices;
+    };
+
+    /// \brief The RUKH-IR generator: emits the operations in a function
+    ///
+    /// Values defined by the emitted operations are added to the value table (as non-constant values) and mapped to
+    /// the ids of their instructions. Constants of the value table are emitted (once) when they are first used.
+    ///
+    /// Pure operations (see is_pure) are hash-consed: the builder keeps a table of the emitted operations, keyed by
+    /// the hash of (opcode, result type, immediate, operand ids), and emitting an operation that is already
+    /// in the function returns the value it defines instead of adding an instruction (value numbering).
+    /// As operands are ids, a duplicated expression is found whole: once its leaves are numbered, so is every
+    /// operation above them. The leaves that are constants are numbered by content (type and data), as the same
+    /// constant is often added more than once to the value table (by const_generate, or by compile_cache::replay).
+    class builder : public generator
+    {
+      public:
+        struct stats
+        {
+          uint32_t emitted = 0; // instructions added to the function (constants included)
+          uint32_t deduplicated = 0; // operations that were already in the function
+        };
+
+      public:
+        builder(function& _fnc, value_table& _values) : fnc(_fnc), values(_values) {}
+
+        using generator::emit;
+        value emit(opcode op, type::ref result_type, span<const value> operands, uint32_t immediate = 0) override
+        {
+          scratch.clear();
+          for (const value it : operands)
+          {
+            const id i = get_or_add_id(it);
+            if (i == k_invalid_id)
+              return {};
+            scratch.push_back(i);
+          }
+
+          const bool numbered = deduplicate && is_pure(op) && result_type != type::ref::zero;
+          const hash_t key = numbered ? hash_operation(op, result_type, immediate) : hash_t::zero;
+          if (key != hash_t::zero)
+          {
+            if (const uint32_t* existing = numbering.find(key); existing != nullptr && is_same(ids[*existing], op, result_type, immediate))
+            {
+              ++result.deduplicated;
+              return value(*existing);
+            }
+          }
+
+          const id i = fnc.add(op, result_type, scratch, immediate);
+          if (i == k_invalid_id)
+            return {};
+          ++result.emitted;
+          if (result_type == type::ref::zero)
+            return {};
+          const value ret = values.add(result_type);
+          set_id(ret, i);
+          // (on a hash collision, the first operation stays in the table)
+          if (key != hash_t::zero)
+            numbering.insert(key, ret.get_index());
+          return ret;
+        }
+
+        /// \brief Enable or disable the deduplication of pure operations (enabled by default)
+        void set_deduplication(bool enabled) { deduplicate = enabled; }
+
+        /// \brief Return the counters since the last reset
+        const stats& get_stats() const { return result; }
+
+        /// \brief Return the id of the instruction defining a value (k_invalid_id if the value is not in the function)
+        id get_id(value v) const
+        {
+          return v.is_valid() && v.get_index() < ids.size() ? ids[v.get_index()] : k_invalid_id;
+        }
+
+        /// \brief Forget the values mapped to the instructions (to be called when the function is reset)
+        void reset()
+        {
+          ids.clear();
+          numbering.clear();
+          result = {};
+        }
+
+        /// \brief Continue from the state of \p o: its function has been copied in this one (see function::assign)
+        /// and the value table of this builder shares the values of the one of \p o (see value_table::share)
+        void assign(const builder& o)
+        {
+          ids = o.ids;
+          numbering = o.numbering;
+          result = o.result;
+        }
+
+        function& get_function() { return fnc; }
+
+      private:
+        id get_or_add_id(value v)
+        {
+          const id ret = get_id(v);
+          if (ret != k_invalid_id || !values.is_constant(v))
+            return ret;
+
+          // constants are numbered by content: the same constant added twice to the value table is emitted once
+          const hash_t key = deduplicate ? hash_constant(v) : hash_t::zero;
+          if (key != hash_t::zero)
+          {
+            if (const uint32_t* existing = numbering.find(key); existing != nullptr && is_same_constant(value(*existing), v))
+            {
+              ++result.deduplicated;
+              set_id(v, ids[*existing]);
+              return ids[*existing];
+            }
+          }
+
+          const id c = fnc.add(opcode::constant, values.get_type(v), {}, v.get_index());
+          if (c == k_invalid_id)
+            return c;
+          ++result.emitted;
+          set_id(v, c);
+          if (key != hash_t::zero)
+            numbering.insert(key, v.get_index());
+          return c;
+        }
+
+        /// \brief Hash an operation (the operands are in scratch)
+        hash_t hash_operation(opcode op, type::ref t, uint32_t immediate) const
+        {
+          uint64_t h = hash_bytes(k_hash_seed, &op, sizeof(op));
+          h = hash_bytes(h, &t, sizeof(t));
+          h = hash_bytes(h, &immediate, sizeof(immediate));
+          h = hash_bytes(h, scratch.data(), scratch.size() * sizeof(id));
+          return static_cast<hash_t>(h);
+        }
+
+        /// \brief Hash a constant: its type and its data
+        hash_t hash_constant(value v) const
+        {
+          const value_table& table = values;
+          const opcode op = opcode::constant;
+          const type::ref t = table.get_type(v);
+          const span<const uint8_t> data = table.get_data(v);
+          uint64_t h = hash_bytes(k_hash_seed, &op, sizeof(op));
+          h = hash_bytes(h, &t, sizeof(t));
+          h = hash_bytes(h, data.data(), data.size());
+          return static_cast<hash_t>(h);
+        }
+
+        /// \brief Return whether or not two constants have the same type and data
+        bool is_same_constant(value a, value b) const
+        {
+          const value_table& table = values;
+          if (!table.is_constant(a) || get_id(a) == k_invalid_id || table.get_type(a) != table.get_type(b))
+            return false;
+          const span<const uint8_t> data_a = table.get_data(a);
+          const span<const uint8_t> data_b = table.get_data(b);
+          return data_a.size() == data_b.size() && std::equal(data_a.begin(), data_a.end(), data_b.begin());
+        }
+
+        /// \brief Return whether or not an instruction is the operation described by the parameters (and scratch)
+        bool is_same(id i, opcode op, type::ref t, uint32_t immediate) const
+        {
+          if (i == k_invalid_id)
+            return false;
+          const instruction& ins = fnc.get_instruction(i);
+          if (ins.op != op || ins.immediate != immediate || fnc.get_type(i) != t || ins.operand_count != scratch.size())
+            return false;
+          const span<const id> ops = fnc.get_operands(i);
+          return std::equal(ops.begin(), ops.end(), scratch.begin());
+        }
+
+        void set_id(value v, id i)
+        {
+          if (v.get_index() >= ids.size())
+            ids.resize(std::max<size_t>(v.get_index() + 1, ids.size() * 2), k_invalid_id);
+          ids[v.get_index()] = i;
+        }
+
+      private:
+        function& fnc;
+        value_table& values;
+        std::vector<id> ids; // [value index] id of the instruction defining the value
+        std::vector<id> scratch; // operands of the current instruction
+
+        bool deduplicate = true;
+        hash_table<uint32_t> numbering; // hash of an operation (or of a constant) -> index of the value it defines
+        stats result;
+    };
+
+
+    // // // // //
+    // // // // //
+    // // // // //
+
+
+    inline void function::build_use_lists()
+    {
+      const uint32_t count = instructions.size;
+      use_offsets.clear();
+      uses.clear();
+      uint32_t* const offsets = use_offsets.push(allocator, count + 1);
+      id* const items = uses.push(allocator, operands.size);
+      memset(offsets, 0, (count + 1) * sizeof(uint32_t));
+
+      // count, prefix sum, then fill (offsets[i] is used as the cursor of i, and is then the start of i + 1):
+      for (uint32_t o = 0; o < operands.size; ++o)
+        ++offsets[operands.data[o] + 1];
+      for (uint32_t i = 0; i < count; ++i)
+        offsets[i + 1] += offsets[i];
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        for (const id it : get_operands(i))
+          items[offsets[it]++] = i;
+      }
+      for (uint32_t i = count; i > 0; --i)
+        offsets[i] = offsets[i - 1];
+      offsets[0] = 0;
+      has_uses = true;
+    }
+  } // namespace ir
+} // namespace rukh
@@ -0,0 +1,126 @@
+//
+// file : mapped_file.hpp
+// in : file:///home/tim/projects/rukh/rukh/mapped_file.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:30:14 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rukh
+{
+  /// \brief A read-only mapping of a file
+  class mapped_file
+  {
+    public:
+      mapped_file() = default;
+      mapped_file(mapped_file&& o) noexcept : data(o.data), size(o.size) { o.data = nullptr; o.size = 0; }
+      mapped_file& operator = (mapped_file&& o) noexcept
+      {
+        if (this != &o)
+        {
+          unmap();
+          data = o.data;
+          size = o.size;
+          o.data = nullptr;
+          o.size = 0;
+        }
+        return *this;
+      }
+      ~mapped_file() { unmap(); }
+
+      bool map(const std::string& path)
+      {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+          return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+          close(fd);
+          return false;
+        }
+        void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED)
+          return false;
+        data = ptr;
+        size = static_cast<size_t>(st.st_size);
+        return true;
+      }
+
+      /// \brief Tell the OS that the mapping will be read sequentially (read-ahead, pages behind can be dropped early)
+      void advise_sequential() const
+      {
+        if (data != nullptr)
+          madvise(data, size, MADV_SEQUENTIAL);
+      }
+
+      /// \brief Tell the OS that the whole mapping will be read soon (it starts reading it in the background)
+      void advise_will_need() const
+      {
+        if (data != nullptr)
+          madvise(data, size, MADV_WILLNEED);
+      }
+
+      /// \brief Let the OS reclaim the pages that are fully within [offset, offset + length)
+      /// The mapping stays valid: the pages are read again from the file if they are accessed later.
+      /// \return the end of the released pages (\p offset if none has been released). Releasing a range that
+      ///         continues from there releases the last, partial, page of this range once it is fully covered.
+      size_t release(size_t offset, size_t length) const
+      {
+        if (data == nullptr || offset >= size)
+          return offset;
+        const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t end = (offset + length < size ? offset + length : size) / page_size * page_size;
+        const size_t begin = (offset + page_size - 1) / page_size * page_size;
+        if (begin >= end)
+          return offset;
+        madvise(static_cast<uint8_t*>(data) + begin, end - begin, MADV_DONTNEED);
+        return end;
+      }
+
+      void unmap()
+      {
+        if (data != nullptr)
+          munmap(data, size);
+        data = nullptr;
+        size = 0;
+      }
+
+    public:
+      void* data = nullptr;
+      size_t size = 0;
+  };
+} // namespace rukh
@@ -29,16 +29,20 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string_view>
-#include <vector>
 #include <tools/ct_list.hpp>
+#include "generator.hpp"
 #include "reporter.hpp"
 #include "pin.hpp"
+#include "range.hpp"
+#include "span.hpp"
+#include "string_pool.hpp"
 
 namespace rukh
 {
-  class pin_impl;
-  class param_impl;
+  class graph;
 
   /// \brief A base AST node
   class base_node
@@ -47,20 +51,67 @@ namespace rukh
       base_node() noexcept = default;
       virtual ~base_node() noexcept = default;
 
+      // nodes are owned (and destructed) by a graph
+      friend class graph;
+
     public:
       /// \brief Return the name of the node
       virtual std::string_view get_name() const = 0;
       virtual std::string_view get_description() const = 0;
 
+      /// \brief Return the hash of the name of the node (the hash of rk_str(name))
+      virtual hash_t get_name_hash() const { return hash_string(get_name()); }
+
     public: // node infos
+      // NOTE: the returned spans are non-owning (for static nodes, they point to static arrays)
+      //       and are valid for as long as the node is
+
       /// \brief Return the list of input pins
-      virtual std::vector<pin_rt> get_input_pins() const = 0;
+      virtual span<const pin_rt> get_input_pins() const = 0;
 
       /// \brief Return the list of output pins
-      virtual std::vector<pin_rt> get_output_pins() const = 0;
+      virtual span<const pin_rt> get_output_pins() const = 0;
 
       /// \brief Return the list of params
-      virtual std::vector<pin_rt> get_params() const = 0;
+      virtual span<const pin_rt> get_params() const = 0;
+
+      /// \brief Return the state of the input pins (same indices as get_input_pins())
+      virtual span<pin_impl> get_input_impls() = 0;
+      virtual span<const pin_impl> get_input_impls() const = 0;
+
+      /// \brief Return the state of the output pins (same indices as get_output_pins())
+      virtual span<pin_impl> get_output_impls() = 0;
+      virtual span<const pin_impl> get_output_impls() const = 0;
+
+      /// \brief Return the state of the params (same indices as get_params())
+      virtual span<param_impl> get_param_impls() = 0;
+      virtual span<const param_impl> get_param_impls() const = 0;
+
+      /// \brief Return a hash of what the nodes connected to the outputs depend on (the output types and constant values)
+      /// It is used to stop re-resolving / regenerating nodes when an edit does not change the outputs of a node.
+      /// The default implementation only hashes the output types (the resolver adds the data of the constants
+      /// set on the output pins), nodes with some other state should override it.
+      /// \note Called after resolve_output_types() and const_generate()
+      virtual uint64_t get_output_state_hash() const
+      {
+        uint64_t h = k_hash_seed;
+        for (const pin_impl& it : get_output_impls())
+        {
+          const hash_t t = it.get_type();
+          h = hash_bytes(h, &t, sizeof(t));
+        }
+        return h;
+      }
+
+      /// \brief Return a hash of the internal state of the node: what changes its outputs but is not in its params
+      /// nor in its inputs (see compile_cache). The default implementation returns 0, for nodes without such a state.
+      virtual uint64_t get_state_hash() const { return 0; }
+
+      /// \brief Return whether or not the results of the node can be taken from a compile_cache
+      /// A node found in the cache is neither resolved, validated nor generated: only nodes whose results only depend
+      /// on their name, params, input types and get_state_hash() can return true. The default implementation
+      /// returns false, so that nodes with a state they do not hash are always resolved.
+      virtual bool is_cacheable() const { return false; }
 
     public: // generate
       /// \brief Called so that the node implementation will define the output types from the input types
@@ -74,10 +125,23 @@ namespace rukh
       virtual bool is_constant() const = 0;
 
       /// \brief Called independently of is_constant. The purpose of this function is to set output constants.
-      virtual void const_generate(reporter& r) = 0;
+      /// Constants are created in \p values and set as the value of the output pins (see pin_impl::set_value)
+      virtual void const_generate(reporter& r, value_table& values) = 0;
+
+      /// \brief Compute the range of the outputs from the range of the inputs (optional, see range_analysis)
+      /// \p outputs are unknown when called. Nodes that know nothing more about their outputs can leave them as is
+      /// (or return false), the default implementation does that.
+      /// \note Called after const_generate(), the ranges of constant outputs can be made with value_range::from_constant
+      /// \return false if the outputs are unknown
+      virtual bool propagate_ranges(span<const value_range> /*inputs*/, span<value_range> /*outputs*/, const value_table& /*values*/) const
+      {
+        return false;
+      }
 
       /// \brief Generate IR for the current node. Will not be called if is_constant() returns true
-      virtual bool generate(reporter& r/*, generator& g*/) const = 0;
+      /// The values of the inputs are set (see pin_impl::get_value), the node emits its operations in \p g and sets
+      /// the values they define on its output pins.
+      virtual bool generate(reporter& r, generator& g) = 0;
   };
 
   /// \brief A statically defined AST node. Will perform most actions automatically.
@@ -92,36 +156,126 @@ namespace rukh
     typename OutputPins, // outputs < pin<...>, ...>
     typename Params // params < pins<...>, ...>
   >
-  class node : base_node
+  class node : public base_node
   {
     protected:
       node() noexcept = default;
       virtual ~node() noexcept = default;
 
+    protected: // node infos helpers (usable by Child, for instance in batch functions)
+      template<typename... Pins>
+      struct pins_to_array
+      {
+        static constexpr std::array<pin_rt, sizeof...(Pins)> array = {{{Pins::type_id, Pins::name::array, Pins::name::hash}..., }};
+
+        static constexpr size_t npos = ~size_t(0);
+
+        /// \brief Return the index of the pin named \p name (or npos)
+        static constexpr size_t index_of(hash_t name)
+        {
+          for (size_t i = 0; i < array.size(); ++i)
+          {
+            if (array[i].name_hash == name)
+              return i;
+          }
+          return npos;
+        }
+      };
+
+      using input_list = typename neam::ct::list::extract<InputPins>::template as<pins_to_array>;
+      using output_list = typename neam::ct::list::extract<OutputPins>::template as<pins_to_array>;
+      using param_list = typename neam::ct::list::extract<Params>::template as<pins_to_array>;
+
+      /// \brief Return the index of a pin in \p List (input_list, output_list or param_list), resolved at compile-time
+      template<typename List, typename PinName>
+      static constexpr size_t pin_index()
+      {
+        constexpr size_t index = List::index_of(PinName::hash);
+        static_assert(index != List::npos, "rukh::node: there is no pin with that name");
+        return index;
+      }
+
     protected: // utilities
       /// \brief Access an input pin. Will generate a compilation error if the pin is not defined
+      /// \note The index of the pin is resolved at compile-time
       template<typename PinName>
-      const pin_impl& input();
+      const pin_impl& input() const { return input_impls[pin_index<input_list, PinName>()]; }
 
       /// \brief Access an output pin. Will generate a compilation error if the pin is not defined
+      /// \note The index of the pin is resolved at compile-time
       template<typename PinName>
-      pin_impl& output();
+      pin_impl& output() { return output_impls[pin_index<output_list, PinName>()]; }
 
       /// \brief Access a parameter. Will generate a compilation error if the parameter is not defined
+      /// \note The index of the parameter is resolved at compile-time
       template<typename ParamName>
-      const param_impl& param();
+      const param_impl& param() const { return param_impls[pin_index<param_list, ParamName>()]; }
+
+    public:
+      /// \brief Hash of the name of the node (identifies the node type, see node_registry)
+      static constexpr hash_t name_hash = Name::hash;
 
     public: // implems of base_node
       std::string_view get_name() const final { return Name::array; };
       std::string_view get_description() const final { return Child::description; };
-
-    private: // node infos helpers
-      template<typename... Pins> struct pins_to_array { static constexpr pin_rt array[sizeof...(Pins)] = {{Pins::type_id, Pins::name::array}..., }; };
+      hash_t get_name_hash() const final { return Name::hash; }
 
     public: // implems of base_node / node infos
-      std::vector<pin_rt> get_input_pins() const final {return neam::ct::list::extract<InputPins>::template as<pins_to_array>::array;}
-      std::vector<pin_rt> get_output_pins() const final {return neam::ct::list::extract<OutputPins>::template as<pins_to_array>::array;}
-      std::vector<pin_rt> get_params() const final {return neam::ct::list::extract<Params>::template as<pins_to_array>::array;}
-      
+      span<const pin_rt> get_input_pins() const final { return input_list::array; }
+      span<const pin_rt> get_output_pins() const final { return output_list::array; }
+      span<const pin_rt> get_params() const final { return param_list::array; }
+
+      span<pin_impl> get_input_impls() final { return input_impls; }
+      span<const pin_impl> get_input_impls() const final { return input_impls; }
+      span<pin_impl> get_output_impls() final { return output_impls; }
+      span<const pin_impl> get_output_impls() const final { return output_impls; }
+      span<param_impl> get_param_impls() final { return param_impls; }
+      span<const param_impl> get_param_impls() const final { return param_impls; }
+
+    public: // batched dispatch
+      // Passes (see pass_runner) call these with every node of the same type at once. The default implementations
+      // loop over the per-node functions of Child (calls are qualified, so they are not virtual calls).
+      // Child can define functions with the same signatures to process the whole batch itself.
+      // Each node logs in its own reporter (reporters[i] for nodes[i], several nodes can share one).
+
+      /// \brief Call resolve_output_types() on a batch of nodes
+      static void resolve_batch(span<Child* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->Child::resolve_output_types(*reporters[i]);
+      }
+
+      /// \brief Call validate() on a batch of nodes
+      static void validate_batch(span<Child* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->Child::validate(*reporters[i]);
+      }
+
+      /// \brief Call is_constant() on a batch of nodes
+      static void is_constant_batch(span<Child* const> nodes, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->Child::is_constant();
+      }
+
+      /// \brief Call const_generate() on a batch of nodes
+      static void const_generate_batch(span<Child* const> nodes, span<reporter* const> reporters, value_table& values)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          nodes[i]->Child::const_generate(*reporters[i], values);
+      }
+
+      /// \brief Call generate() on a batch of nodes
+      static void generate_batch(span<Child* const> nodes, reporter& r, generator& g, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->Child::generate(r, g);
+      }
+
+    private:
+      std::array<pin_impl, input_list::array.size()> input_impls;
+      std::array<pin_impl, output_list::array.size()> output_impls;
+      std::array<param_impl, param_list::array.size()> param_impls;
   };
 } // namespace rukh
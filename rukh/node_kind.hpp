@@ -0,0 +1,169 @@
+//
+// file : node_kind.hpp
+// in : file:///home/tim/projects/rukh/rukh/node_kind.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:19:21 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "arena.hpp"
+#include "generator.hpp"
+#include "node.hpp"
+#include "reporter.hpp"
+#include "span.hpp"
+#include "type_identity.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  /// \brief The batch entry points of a concrete node type
+  ///
+  /// Every function processes a batch of nodes of the same concrete type (the type the node_kind has been made for).
+  /// For nodes inheriting from rukh::node<...>, they forward to the static Child::*_batch() functions
+  /// (see node<>::resolve_batch), so there is one indirect call per batch instead of one virtual call per node.
+  /// Other nodes fall back to calling the virtual functions of base_node on each node.
+  ///
+  /// The \p results and \p reporters spans have the same size as the \p nodes span: each node logs in its own reporter
+  /// (so that a caller can keep the logs of each node together, see resolver).
+  ///
+  /// clone creates a copy of a node (with its params and its state) in an arena. It is nullptr for the node types that
+  /// are not copy-constructible.
+  struct node_kind
+  {
+    using results_batch_fnc = void (*)(span<base_node* const> nodes, span<reporter* const> reporters, span<uint8_t> results);
+
+    type_id id;
+
+    results_batch_fnc resolve_batch; // results: resolve_output_types()
+    results_batch_fnc validate_batch; // results: validate()
+    void (*is_constant_batch)(span<base_node* const> nodes, span<uint8_t> results);
+    void (*const_generate_batch)(span<base_node* const> nodes, span<reporter* const> reporters, value_table& values);
+    void (*generate_batch)(span<base_node* const> nodes, reporter& r, generator& g, span<uint8_t> results); // results: generate()
+    base_node* (*clone)(const base_node& node, arena& allocator);
+
+    /// \brief Create the node_kind of \p Node
+    template<typename Node>
+    static node_kind make();
+  };
+
+  namespace internal
+  {
+    template<typename Node, typename = void>
+    struct has_batch_functions : std::false_type {};
+
+    template<typename Node>
+    struct has_batch_functions<Node, std::void_t<decltype(Node::resolve_batch(std::declval<span<Node* const>>(),
+                                                                              std::declval<span<reporter* const>>(),
+                                                                              std::declval<span<uint8_t>>()))>>
+      : std::true_type {};
+
+    /// \brief Call fnc(span<Node* const>) with the nodes converted to their concrete type
+    /// The converted pointers are written in a per-thread scratch buffer, so that batch calls do not allocate once it has
+    /// grown to the size of the biggest batch. (The buffer is taken during the call, so nested calls get their own one)
+    template<typename Node, typename Fnc>
+    void call_typed(span<base_node* const> nodes, Fnc&& fnc)
+    {
+      static thread_local std::vector<Node*> scratch;
+      std::vector<Node*> typed = std::move(scratch);
+      typed.clear();
+      for (base_node* n : nodes)
+        typed.push_back(static_cast<Node*>(n));
+      fnc(span<Node* const>(typed));
+      scratch = std::move(typed);
+    }
+  } // namespace internal
+
+  template<typename Node>
+  node_kind node_kind::make()
+  {
+    node_kind ret;
+    ret.id = type_identity<Node>::id;
+    ret.clone = nullptr;
+    if constexpr (std::is_copy_constructible_v<Node>)
+    {
+      ret.clone = [](const base_node& node, arena& allocator) -> base_node*
+      {
+        return allocator.create<Node>(static_cast<const Node&>(node));
+      };
+    }
+    if constexpr (internal::has_batch_functions<Node>::value)
+    {
+      ret.resolve_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        internal::call_typed<Node>(nodes, [&](span<Node* const> t) { Node::resolve_batch(t, reporters, results); });
+      };
+      ret.validate_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        internal::call_typed<Node>(nodes, [&](span<Node* const> t) { Node::validate_batch(t, reporters, results); });
+      };
+      ret.is_constant_batch = [](span<base_node* const> nodes, span<uint8_t> results)
+      {
+        internal::call_typed<Node>(nodes, [&](span<Node* const> t) { Node::is_constant_batch(t, results); });
+      };
+      ret.const_generate_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, value_table& values)
+      {
+        internal::call_typed<Node>(nodes, [&](span<Node* const> t) { Node::const_generate_batch(t, reporters, values); });
+      };
+      ret.generate_batch = [](span<base_node* const> nodes, reporter& r, generator& g, span<uint8_t> results)
+      {
+        internal::call_typed<Node>(nodes, [&](span<Node* const> t) { Node::generate_batch(t, r, g, results); });
+      };
+    }
+    else
+    {
+      ret.resolve_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->resolve_output_types(*reporters[i]);
+      };
+      ret.validate_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->validate(*reporters[i]);
+      };
+      ret.is_constant_batch = [](span<base_node* const> nodes, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->is_constant();
+      };
+      ret.const_generate_batch = [](span<base_node* const> nodes, span<reporter* const> reporters, value_table& values)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          nodes[i]->const_generate(*reporters[i], values);
+      };
+      ret.generate_batch = [](span<base_node* const> nodes, reporter& r, generator& g, span<uint8_t> results)
+      {
+        for (size_t i = 0; i < nodes.size(); ++i)
+          results[i] = nodes[i]->generate(r, g);
+      };
+    }
+    return ret;
+  }
+} // namespace rukh
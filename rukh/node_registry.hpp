@@ -0,0 +1,80 @@
+//
+// file : node_registry.hpp
+// in : file:///home/tim/projects/rukh/rukh/node_registry.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:30:14 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "graph.hpp"
+#include "hash_table.hpp"
+
+namespace rukh
+{
+  /// \brief Creates nodes from the hash of their name (for instance to load a graph_image)
+  class node_registry
+  {
+    public:
+      using create_fnc = node_handle (*)(graph& g);
+
+    public:
+      /// \brief Register a node type (inheriting from rukh::node<...>) under the hash of its name
+      /// \return false if the name is already registered
+      template<typename Node>
+      bool add()
+      {
+        return add(Node::name_hash, [](graph& g) { return g.add_node<Node>(); });
+      }
+
+      /// \brief Register a function creating a node under a name
+      /// \return false if the name is already registered
+      bool add(hash_t name, create_fnc fnc)
+      {
+        if (name == hash_t::zero || fnc == nullptr || indices.find(name) != nullptr)
+          return false;
+        indices.insert(name, static_cast<uint32_t>(factories.size()));
+        factories.push_back(fnc);
+        return true;
+      }
+
+      /// \brief Return the function creating the nodes of a given name, or nullptr
+      create_fnc find(hash_t name) const
+      {
+        if (const uint32_t* index = indices.find(name); index != nullptr)
+          return factories[*index];
+        return nullptr;
+      }
+
+      size_t size() const { return factories.size(); }
+
+    private:
+      std::vector<create_fnc> factories;
+      hash_table<uint32_t> indices;
+  };
+} // namespace rukh
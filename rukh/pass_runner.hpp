@@ -0,0 +1,297 @@
+//
+// file : pass_runner.hpp
+// in : file:///home/tim/projects/rukh/rukh/pass_runner.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:19:21 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "compile_cache.hpp"
+#include "generator.hpp"
+#include "graph.hpp"
+#include "node_kind.hpp"
+#include "reporter.hpp"
+#include "span.hpp"
+
+namespace rukh
+{
+  /// \brief Run passes over the nodes of a graph, one call per node type instead of one virtual call per node
+  ///
+  /// The nodes are split in levels (the level of a node is one more than the highest level of the nodes connected
+  /// to its inputs), then each level is split in batches of nodes of the same kind (see node_kind).
+  /// Nodes of a level do not depend on each other, so batches are processed in (level, kind) order
+  /// and the order of the nodes that is used is still a topological order.
+  /// Inside a batch, nodes keep the order they have in the order given to build().
+  class pass_runner
+  {
+    public:
+      /// \brief A group of nodes of the same level and the same kind
+      struct batch
+      {
+        uint32_t level;
+        uint32_t kind; // index in graph::get_node_kinds()
+        uint32_t offset; // in get_nodes()
+        uint32_t count;
+      };
+
+    public:
+      explicit pass_runner(graph& _g) : g(_g) {}
+
+      /// \brief Split the nodes in batches
+      /// \param order the nodes to process, in a topological order (like resolver::get_order(), or a part of it)
+      void build(span<const uint32_t> order)
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const graph::edge_table& edges = g.get_edges();
+        const uint32_t edge_count = static_cast<uint32_t>(edges.size());
+        constexpr uint32_t k_not_processed = ~0u;
+
+        std::vector<uint32_t> positions(node_count, k_not_processed);
+        for (uint32_t i = 0; i < order.size(); ++i)
+          positions[order[i]] = i;
+
+        // sort the edges by the position of their source (counting sort), so that the level of the source of
+        // an edge is known when the edge is processed:
+        std::vector<uint32_t> offsets(order.size() + 1, 0);
+        for (uint32_t e = 0; e < edge_count; ++e)
+        {
+          if (positions[edges.src_node[e]] != k_not_processed && positions[edges.dst_node[e]] != k_not_processed)
+            ++offsets[positions[edges.src_node[e]] + 1];
+        }
+        for (size_t i = 0; i < order.size(); ++i)
+          offsets[i + 1] += offsets[i];
+        std::vector<uint32_t> sorted_edges(offsets.back());
+        for (uint32_t e = 0; e < edge_count; ++e)
+        {
+          if (positions[edges.src_node[e]] != k_not_processed && positions[edges.dst_node[e]] != k_not_processed)
+            sorted_edges[offsets[positions[edges.src_node[e]]]++] = e;
+        }
+
+        levels.assign(node_count, 0);
+        for (const uint32_t e : sorted_edges)
+          levels[edges.dst_node[e]] = std::max(levels[edges.dst_node[e]], levels[edges.src_node[e]] + 1);
+
+        // connections ending at each node (see set_input_values()):
+        in_offsets.assign(node_count + 1, 0);
+        for (const uint32_t e : sorted_edges)
+          ++in_offsets[edges.dst_node[e] + 1];
+        for (uint32_t n = 0; n < node_count; ++n)
+          in_offsets[n + 1] += in_offsets[n];
+        in_edges.resize(sorted_edges.size());
+        {
+          std::vector<uint32_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+          for (const uint32_t e : sorted_edges)
+            in_edges[fill[edges.dst_node[e]]++] = e;
+        }
+
+        nodes.assign(order.begin(), order.end());
+        std::sort(nodes.begin(), nodes.end(), [&](uint32_t a, uint32_t b)
+        {
+          if (levels[a] != levels[b])
+            return levels[a] < levels[b];
+          const uint32_t kind_a = g.get_node_kind_index({a});
+          const uint32_t kind_b = g.get_node_kind_index({b});
+          if (kind_a != kind_b)
+            return kind_a < kind_b;
+          return positions[a] < positions[b];
+        });
+
+        node_ptrs.resize(nodes.size());
+        batches.clear();
+        for (uint32_t i = 0; i < nodes.size(); ++i)
+        {
+          const uint32_t n = nodes[i];
+          node_ptrs[i] = &g.get_node({n});
+          const uint32_t kind = g.get_node_kind_index({n});
+          if (batches.empty() || batches.back().level != levels[n] || batches.back().kind != kind)
+            batches.push_back({levels[n], kind, i, 0});
+          ++batches.back().count;
+        }
+      }
+
+      /// \brief Return the batches (in the order they must be processed)
+      span<const batch> get_batches() const { return batches; }
+
+      /// \brief Return the nodes, in batch order (which is a topological order)
+      span<const uint32_t> get_nodes() const { return nodes; }
+
+      /// \brief Return the nodes of a batch
+      span<const uint32_t> get_batch_nodes(const batch& b) const { return span<const uint32_t>(nodes).subspan(b.offset, b.count); }
+
+      /// \brief Return the nodes of a batch
+      span<base_node* const> get_batch_node_ptrs(const batch& b) const
+      {
+        return span<base_node* const>(node_ptrs).subspan(b.offset, b.count);
+      }
+
+      /// \brief Return the level of a node (only valid for the nodes given to build())
+      uint32_t get_level(node_handle n) const { return levels[n.index]; }
+
+      /// \brief Call fnc(const node_kind&, span<base_node* const> nodes, span<const uint32_t> node_indices) for every batch
+      template<typename Fnc>
+      void for_each_batch(Fnc&& fnc) const
+      {
+        const span<const node_kind> kinds = g.get_node_kinds();
+        for (const batch& b : batches)
+          fnc(kinds[b.kind], get_batch_node_ptrs(b), get_batch_nodes(b));
+      }
+
+    public: // passes
+      /// \brief Call is_constant() on every node
+      /// \param results [node count] written for the nodes given to build()
+      void is_constant(span<uint8_t> results) const
+      {
+        std::vector<uint8_t> batch_results;
+        for_each_batch([&](const node_kind& kind, span<base_node* const> batch_nodes, span<const uint32_t> indices)
+        {
+          batch_results.assign(batch_nodes.size(), 0);
+          kind.is_constant_batch(batch_nodes, batch_results);
+          for (size_t i = 0; i < indices.size(); ++i)
+            results[indices[i]] = batch_results[i];
+        });
+      }
+
+      /// \brief Call const_generate() on every node
+      void const_generate(reporter& r, value_table& values) const
+      {
+        std::vector<reporter*> reporters;
+        for_each_batch([&](const node_kind& kind, span<base_node* const> batch_nodes, span<const uint32_t>)
+        {
+          reporters.assign(batch_nodes.size(), &r);
+          kind.const_generate_batch(batch_nodes, reporters, values);
+        });
+      }
+
+      /// \brief Call generate() on every node that is not constant
+      /// Before a batch is generated, the inputs of its nodes are given the values of the outputs they are connected to
+      /// (the values emitted by the previous batches, or the constants set by const_generate()).
+      /// The generator is told when each node begins and ends (see generator::begin_node), so a range_pruner
+      /// can be given here to skip the operations made redundant by the ranges of a range_analysis.
+      /// \note Every batch is generated, even after a resolver::update() that re-ran only a few nodes
+      ///       (resolver::generate only generates the nodes it re-ran, and replays the IR of the others)
+      /// \return true if every call to generate() succeeded
+      bool generate(reporter& r, generator& gen) const
+      {
+        return generate(r, gen, nullptr, {});
+      }
+
+      /// \brief Call generate() on every node that is not constant, using (and filling) a cache of the generated IR
+      /// Cacheable nodes (see base_node::is_cacheable) whose structural hash is in the cache with some IR get their
+      /// operations emitted again from the cache (see compile_cache::replay). The other cacheable nodes are generated
+      /// one at a time, so that their operations can be recorded, and are added to the cache.
+      /// \param hashes the structural hashes of the nodes (see resolver::get_structural_hashes), computed by a resolver
+      ///        using the same cache (so that they include its salt)
+      /// \return true if every call to generate() succeeded
+      bool generate(reporter& r, generator& gen, compile_cache& cache, span<const hash_t> hashes) const
+      {
+        return generate(r, gen, &cache, hashes);
+      }
+
+    private:
+      bool generate(reporter& r, generator& gen, compile_cache* cache, span<const hash_t> hashes) const
+      {
+        bool success = true;
+        std::vector<uint8_t> batch_results;
+        std::vector<base_node*> to_generate;
+        std::vector<uint32_t> to_generate_indices;
+        for_each_batch([&](const node_kind& kind, span<base_node* const> batch_nodes, span<const uint32_t> indices)
+        {
+          batch_results.assign(batch_nodes.size(), 0);
+          kind.is_constant_batch(batch_nodes, batch_results);
+          to_generate.clear();
+          to_generate_indices.clear();
+          for (size_t i = 0; i < batch_nodes.size(); ++i)
+          {
+            if (batch_results[i] != 0)
+              continue;
+            set_input_values(indices[i]);
+            gen.begin_node(indices[i], *batch_nodes[i]);
+            if (cache == nullptr || hashes[indices[i]] == hash_t::zero || !batch_nodes[i]->is_cacheable())
+            {
+              to_generate.push_back(batch_nodes[i]);
+              to_generate_indices.push_back(indices[i]);
+              continue;
+            }
+            success = generate_cached(r, gen, *cache, hashes[indices[i]], kind, batch_nodes[i]) && success;
+            gen.end_node(indices[i], *batch_nodes[i]);
+          }
+          if (to_generate.empty())
+            return;
+
+          batch_results.assign(to_generate.size(), 0);
+          kind.generate_batch(to_generate, r, gen, batch_results);
+          for (size_t i = 0; i < to_generate.size(); ++i)
+          {
+            success = success && batch_results[i] != 0;
+            gen.end_node(to_generate_indices[i], *to_generate[i]);
+          }
+        });
+        return success;
+      }
+
+      /// \brief Emit the IR of a node from the cache, or generate (and record) it
+      bool generate_cached(reporter& r, generator& gen, compile_cache& cache, hash_t hash, const node_kind& kind, base_node* node) const
+      {
+        const std::shared_ptr<const compile_cache::entry> e = cache.find(hash);
+        if (e != nullptr && compile_cache::replay(*e, *node, g.get_values(), gen))
+          return true;
+
+        compile_cache::entry recorded = e != nullptr ? *e : compile_cache::entry{};
+        compile_cache::recorder rec(gen, g.get_values(), static_cast<const base_node*>(node)->get_input_impls(), recorded);
+        uint8_t result = 0;
+        kind.generate_batch({&node, 1}, r, rec, {&result, 1});
+        if (result != 0 && rec.finish(static_cast<const base_node*>(node)->get_output_impls()))
+          cache.store(hash, std::move(recorded));
+        return result != 0;
+      }
+
+      /// \brief Set the values of the inputs of a node from the outputs they are connected to
+      void set_input_values(uint32_t n) const
+      {
+        const graph::edge_table& edges = g.get_edges();
+        span<pin_impl> inputs = g.get_node({n}).get_input_impls();
+        for (uint32_t j = in_offsets[n]; j < in_offsets[n + 1]; ++j)
+        {
+          const uint32_t e = in_edges[j];
+          inputs[edges.dst_pin[e]].set_value(g.get_node({edges.src_node[e]}).get_output_impls()[edges.src_pin[e]].get_value());
+        }
+      }
+
+    private:
+      graph& g;
+
+      std::vector<uint32_t> levels; // [node count]
+      std::vector<uint32_t> in_offsets; // [node count + 1] CSR of the connections ending at each node
+      std::vector<uint32_t> in_edges;
+      std::vector<uint32_t> nodes; // in batch order
+      std::vector<base_node*> node_ptrs; // [nodes.size()]
+      std::vector<batch> batches;
+  };
+} // namespace rukh
@@ -0,0 +1,393 @@
+//
+// file : permutation_compiler.hpp
+// in : file:///home/tim/projects/rukh/rukh/permutation_compiler.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:59:32 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "graph.hpp"
+#include "ir.hpp"
+#include "pass_runner.hpp"
+#include "reporter.hpp"
+#include "resolver.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+
+namespace rukh
+{
+  /// \brief Compile the permutations of a graph (the same graph with different params), sharing the work that does
+  /// not depend on the params that change
+  ///
+  /// A permutation is a list of params to set (see param_assignment). The nodes whose params are set by a permutation
+  /// and the nodes connected (directly or not) to their outputs are the cone of the batch: the only nodes whose outputs
+  /// can differ from one permutation to another. The other nodes (the shared nodes) are processed once:
+  ///  - the graph is resolved (see resolver) with its own params,
+  ///  - the shared nodes are generated in a function that every permutation starts from.
+  /// Then, for each permutation, the nodes of the cone are copied (see graph::add_copy), the params of the permutation
+  /// are set on the copies, and the copies are resolved then generated (in topological order) after a copy of the shared
+  /// function. Shared nodes do not depend on the cone, so the instructions of the function stay in topological order.
+  /// The value table of a permutation shares the values of the graph (see value_table::share) and its builder starts
+  /// from the state of the shared one, so the operations of the cone are hash-consed with the shared ones.
+  ///
+  /// With a thread_pool, the permutations are compiled in parallel (one task per permutation). Each task logs into
+  /// its own (buffering) reporter, and the logs are replayed in the order of the permutations.
+  ///
+  /// \note The nodes of the cone must be copy-constructible (see node_kind::clone).
+  /// \note The params of the graph are not modified. The graph must resolve with them: they act as the default values
+  ///       of the params set by the permutations (only the resolution of the shared nodes is used).
+  class permutation_compiler
+  {
+    public:
+      /// \brief A param set by a permutation
+      struct param_assignment
+      {
+        node_handle node;
+        uint32_t param; // index in get_params()
+        type::ref param_type;
+      };
+
+      using permutation = std::vector<param_assignment>;
+
+      struct stats
+      {
+        uint32_t shared_nodes = 0; // nodes resolved and generated once
+        uint32_t cone_nodes = 0; // nodes resolved and generated for each permutation
+        uint32_t shared_instructions = 0; // instructions of the shared function
+        uint32_t compiled = 0; // permutations that have been compiled
+        uint32_t failed = 0; // permutations that have not been compiled
+      };
+
+    public:
+      explicit permutation_compiler(graph& _g) : g(_g), base(_g), runner(_g), shared_builder(shared_function, _g.get_values()) {}
+
+      /// \brief Compile every permutation
+      /// \param pool if nullptr, the permutations are compiled serially by the calling thread
+      /// \return true if every permutation has been compiled
+      bool compile(span<const permutation> permutations, reporter& r, thread_pool* pool = nullptr)
+      {
+        result = {};
+        permutation_count = permutations.size();
+        while (variants.size() < permutation_count)
+          variants.push_back(std::make_unique<variant>());
+        for (size_t i = 0; i < permutation_count; ++i)
+          variants[i]->success = false;
+
+        if (!compile_shared(permutations, r, pool))
+        {
+          result.failed = static_cast<uint32_t>(permutation_count);
+          return false;
+        }
+
+        if (pool == nullptr)
+        {
+          for (size_t i = 0; i < permutation_count; ++i)
+            compile_permutation(*variants[i], permutations[i], r);
+        }
+        else
+        {
+          logs.clear();
+          logs.resize(permutation_count);
+          for (size_t i = 0; i < permutation_count; ++i)
+          {
+            pool->push([this, i, &permutations]
+            {
+              reporter local;
+              local.set_buffering(true);
+              compile_permutation(*variants[i], permutations[i], local);
+              logs[i] = local.take_buffer();
+            });
+          }
+          pool->wait();
+          for (std::vector<reporter::ser_log>& it : logs)
+            r.replay(std::move(it));
+          logs.clear();
+        }
+
+        for (size_t i = 0; i < permutation_count; ++i)
+          ++(variants[i]->success ? result.compiled : result.failed);
+        return result.failed == 0;
+      }
+
+      /// \brief Return the number of permutations of the last compilation
+      size_t get_permutation_count() const { return permutation_count; }
+
+      /// \brief Return whether or not a permutation has been compiled
+      bool is_compiled(size_t permutation) const { return variants[permutation]->success; }
+
+      /// \brief Return the function of a permutation (the shared instructions, then the ones of the cone)
+      const ir::function& get_function(size_t permutation) const { return variants[permutation]->function; }
+
+      /// \brief Return the values of a permutation (the immediate of the constant instructions of its function indexes this)
+      /// \note The table shares the constants of the value table of the graph, which is reset by the next compilation
+      const value_table& get_values(size_t permutation) const { return variants[permutation]->copies.get_values(); }
+
+      /// \brief Return a node as it has been compiled for a permutation (its copy for the nodes of the cone)
+      const base_node& get_node(size_t permutation, node_handle n) const { return get_node(*variants[permutation], n.index); }
+
+      /// \brief Return whether or not a node is processed for each permutation
+      bool is_in_cone(node_handle n) const { return n.index < cone_index.size() && cone_index[n.index] != k_not_in_cone; }
+
+      /// \brief Return the nodes processed for each permutation, in topological order
+      span<const uint32_t> get_cone() const { return cone; }
+
+      /// \brief Return the resolver of the graph (the resolution of the shared nodes)
+      const resolver& get_resolver() const { return base; }
+
+      /// \brief Return the counters of the last compilation
+      const stats& get_stats() const { return result; }
+
+    private:
+      static constexpr uint32_t k_not_in_cone = ~0u;
+
+      /// \brief The state of a permutation
+      struct variant
+      {
+        graph copies; // the copies of the nodes of the cone (copies[k] is the copy of cone[k])
+        ir::function function;
+        ir::builder builder{function, copies.get_values()};
+        std::vector<resolver::node_state> states; // [cone size]
+        bool success = false;
+      };
+
+      /// \brief Resolve the graph, find the cone and generate the shared nodes
+      bool compile_shared(span<const permutation> permutations, reporter& r, thread_pool* pool)
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        bool valid = true;
+        for (const permutation& p : permutations)
+        {
+          for (const param_assignment& a : p)
+          {
+            if (a.node.index < node_count && a.param < g.get_node(a.node).get_params().size())
+              continue;
+            r.log(reporter::severity_t::error, "permutation_compiler: invalid param assignment (node {}, param {})", a.node.index, a.param);
+            valid = false;
+          }
+        }
+        if (!valid)
+          return false;
+
+        // the result is not checked: only the shared nodes must be resolved
+        base.resolve(r, pool);
+        build_inputs();
+
+        std::vector<uint8_t> in_cone(node_count, 0);
+        for (const permutation& p : permutations)
+        {
+          for (const param_assignment& a : p)
+            in_cone[a.node.index] = 1;
+        }
+
+        // the order only has live nodes (in topological order): the cone is what is after an assigned node
+        const graph::edge_table& edges = g.get_edges();
+        cone.clear();
+        cone_index.assign(node_count, k_not_in_cone);
+        shared.clear();
+        bool success = base.get_stats().in_cycle == 0;
+        for (const uint32_t n : base.get_order())
+        {
+          for (uint32_t j = in_offsets[n]; j < in_offsets[n + 1] && in_cone[n] == 0; ++j)
+            in_cone[n] = in_cone[edges.src_node[in_edges[j]]];
+          if (in_cone[n] != 0)
+          {
+            cone_index[n] = static_cast<uint32_t>(cone.size());
+            cone.push_back(n);
+            continue;
+          }
+          shared.push_back(n);
+          success = success && base.get_state({n}) == resolver::node_state::resolved;
+        }
+        if (!success)
+        {
+          r.log(reporter::severity_t::error, "permutation_compiler: the nodes shared by the permutations cannot be resolved");
+          return false;
+        }
+
+        runner.build(shared);
+        shared_function.reset();
+        shared_builder.reset();
+        if (!runner.generate(r, shared_builder))
+          return false;
+
+        result.shared_nodes = static_cast<uint32_t>(shared.size());
+        result.cone_nodes = static_cast<uint32_t>(cone.size());
+        result.shared_instructions = static_cast<uint32_t>(shared_function.get_instruction_count());
+        return true;
+      }
+
+      /// \brief Copy, resolve and generate the cone for a permutation
+      /// \note Only reads the graph: called in parallel for different permutations
+      void compile_permutation(variant& v, const permutation& p, reporter& r) const
+      {
+        const graph& src = g;
+        v.success = false;
+        v.copies.clear();
+        v.copies.get_values().share(src.get_values());
+        for (const uint32_t n : cone)
+        {
+          if (!v.copies.add_copy(src, {n}).is_valid())
+          {
+            r.log(reporter::severity_t::error, "permutation_compiler: node '{}' cannot be copied", src.get_node({n}).get_name());
+            return;
+          }
+        }
+        for (const param_assignment& a : p)
+        {
+          // (assigned nodes that are dead are not in the cone)
+          if (cone_index[a.node.index] != k_not_in_cone)
+            v.copies.get_node({cone_index[a.node.index]}).get_param_impls()[a.param].set_type(a.param_type);
+        }
+
+        v.states.assign(cone.size(), resolver::node_state::pending);
+        bool success = true;
+        for (uint32_t k = 0; k < cone.size(); ++k)
+          success = resolve_copy(v, k, r) && success;
+        if (!success)
+          return;
+
+        v.function.assign(shared_function);
+        v.builder.assign(shared_builder);
+        for (uint32_t k = 0; k < cone.size(); ++k)
+        {
+          base_node& node = v.copies.get_node({k});
+          if (node.is_constant())
+            continue;
+          set_input_values(v, k);
+          success = node.generate(r, v.builder) && success;
+        }
+        v.success = success;
+      }
+
+      /// \brief Resolve the copy of a node of the cone (the same steps as resolver::resolve_node)
+      /// \return false if the node has not been resolved
+      bool resolve_copy(variant& v, uint32_t k, reporter& r) const
+      {
+        const graph::edge_table& edges = g.get_edges();
+        const value_table& values = v.copies.get_values();
+        base_node& node = v.copies.get_node({k});
+        span<pin_impl> inputs = node.get_input_impls();
+        for (pin_impl& it : inputs)
+        {
+          it.set_type(type::ref::zero);
+          it.set_value({});
+        }
+        for (pin_impl& it : node.get_output_impls())
+          it.set_value({});
+
+        const uint32_t n = cone[k];
+        for (uint32_t j = in_offsets[n]; j < in_offsets[n + 1]; ++j)
+        {
+          const uint32_t e = in_edges[j];
+          const uint32_t src = edges.src_node[e];
+          if (cone_index[src] != k_not_in_cone && v.states[cone_index[src]] != resolver::node_state::resolved)
+          {
+            v.states[k] = resolver::node_state::skipped;
+            return false;
+          }
+          // the non-constant outputs of the shared nodes already have the values they have been generated with,
+          // which are only given to the inputs when generating:
+          const pin_impl& output = get_node(v, src).get_output_impls()[edges.src_pin[e]];
+          const value val = output.get_value();
+          inputs[edges.dst_pin[e]].set_type(output.get_type());
+          inputs[edges.dst_pin[e]].set_value(values.is_constant(val) ? val : value{});
+        }
+
+        if (!node.resolve_output_types(r) || !node.validate(r))
+        {
+          v.states[k] = resolver::node_state::failed;
+          return false;
+        }
+        node.const_generate(r, v.copies.get_values());
+        v.states[k] = resolver::node_state::resolved;
+        return true;
+      }
+
+      /// \brief Set the values of the inputs of the copy of a node from the outputs they are connected to
+      void set_input_values(variant& v, uint32_t k) const
+      {
+        const graph::edge_table& edges = g.get_edges();
+        span<pin_impl> inputs = v.copies.get_node({k}).get_input_impls();
+        const uint32_t n = cone[k];
+        for (uint32_t j = in_offsets[n]; j < in_offsets[n + 1]; ++j)
+        {
+          const uint32_t e = in_edges[j];
+          inputs[edges.dst_pin[e]].set_value(get_node(v, edges.src_node[e]).get_output_impls()[edges.src_pin[e]].get_value());
+        }
+      }
+
+      /// \brief Return a node of the graph, or its copy if it is part of the cone
+      const base_node& get_node(const variant& v, uint32_t n) const
+      {
+        if (cone_index[n] != k_not_in_cone)
+          return v.copies.get_node({cone_index[n]});
+        return static_cast<const graph&>(g).get_node({n});
+      }
+
+      /// \brief Build the CSR of the connections ending at each node
+      void build_inputs()
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const graph::edge_table& edges = g.get_edges();
+        const uint32_t edge_count = static_cast<uint32_t>(edges.size());
+        in_offsets.assign(node_count + 1, 0);
+        for (uint32_t e = 0; e < edge_count; ++e)
+          ++in_offsets[edges.dst_node[e] + 1];
+        for (uint32_t n = 0; n < node_count; ++n)
+          in_offsets[n + 1] += in_offsets[n];
+        in_edges.resize(edge_count);
+        std::vector<uint32_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+        for (uint32_t e = 0; e < edge_count; ++e)
+          in_edges[fill[edges.dst_node[e]]++] = e;
+      }
+
+    private:
+      graph& g;
+      resolver base;
+      pass_runner runner; // the shared nodes
+
+      std::vector<uint32_t> in_offsets; // [node count + 1]
+      std::vector<uint32_t> in_edges;
+
+      std::vector<uint32_t> shared; // in batch order
+      std::vector<uint32_t> cone; // in topological order
+      std::vector<uint32_t> cone_index; // [node count] index in cone (k_not_in_cone for the shared and the dead nodes)
+
+      ir::function shared_function;
+      ir::builder shared_builder;
+
+      std::vector<std::unique_ptr<variant>> variants; // kept from one compilation to the next (to reuse their memory)
+      size_t permutation_count = 0;
+      std::vector<std::vector<reporter::ser_log>> logs; // buffered logs of each permutation
+
+      stats result;
+  };
+} // namespace rukh
@@ -31,7 +31,9 @@
 
 #include <cstddef>
 #include <tools/ct_list.hpp>
-#include "string.h"
+#include "string.hpp"
+#include "string_pool.hpp"
+#include "value.hpp"
 
 namespace rukh
 {
@@ -76,10 +78,18 @@ namespace rukh
   };
 
   /// \brief Runtime def of a pin
+  /// \note name must outlive the pin_rt: it is either a static string (rk_str) or a string interned in a string_pool
   struct pin_rt
   {
     hash_t type_id;
     std::string_view name;
+    hash_t name_hash; // precomputed hash of the name
+
+    /// \brief Make a pin_rt from a name interned in a string_pool
+    static pin_rt from_interned(hash_t type_id, const interned_string& name, const string_pool& pool)
+    {
+      return {type_id, pool.get(name), name.hash};
+    }
   };
 
   /// \brief List of input pins
@@ -100,8 +110,26 @@ namespace rukh
   class pin_impl
   {
     public:
-      
+      /// \brief Return the resolved type of the pin (hash_t::zero if not yet resolved)
+      hash_t get_type() const { return resolved_type; }
+
+      /// \brief Set the resolved type of the pin
+      void set_type(hash_t type_id) { resolved_type = type_id; }
+
+      /// \brief Return the value of the pin (set by const_generate() for outputs, an invalid value if there is none)
+      /// For inputs, this is the value of the output pin the input is connected to.
+      value get_value() const { return current_value; }
+
+      /// \brief Set the value of the pin
+      void set_value(value v) { current_value = v; }
+
     private:
-      
+      hash_t resolved_type = hash_t::zero;
+      value current_value;
+  };
+
+  /// \brief Implementation of a parameter
+  class param_impl : public pin_impl
+  {
   };
 } // namespace rukh
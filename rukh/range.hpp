@@ -0,0 +1,221 @@
+//
+// file : range.hpp
+// in : file:///home/tim/projects/rukh/rukh/range.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:27:24 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "span.hpp"
+
+namespace rukh
+{
+  /// \brief A closed interval of floats
+  /// The full interval ([-inf, +inf]) is the only one that can also contain NaN: operations whose result can be NaN
+  /// return the full interval. Arithmetic bounds are rounded outward, so the result always contains the exact result.
+  struct interval
+  {
+    float min = -std::numeric_limits<float>::infinity();
+    float max = std::numeric_limits<float>::infinity();
+
+    /// \brief Return the interval that contains every value
+    static constexpr interval full() { return {}; }
+
+    /// \brief Return the interval that only contains \p v (the full interval for NaN)
+    static interval point(float v) { return std::isnan(v) ? full() : interval{v, v}; }
+
+    /// \brief Return [lo, hi] (the full interval if a bound is NaN or if lo > hi)
+    static interval make(float lo, float hi) { return (std::isnan(lo) || std::isnan(hi) || lo > hi) ? full() : interval{lo, hi}; }
+
+    bool is_full() const { return min == -std::numeric_limits<float>::infinity() && max == std::numeric_limits<float>::infinity(); }
+    bool is_point() const { return min == max; }
+
+    /// \brief Return whether or not every value of the interval is in \p o
+    bool is_within(const interval& o) const { return !is_full() && o.min <= min && max <= o.max; }
+
+    bool contains(float v) const { return is_full() || (min <= v && v <= max); }
+
+    /// \brief Return the smallest interval containing both intervals
+    interval join(const interval& o) const { return {std::fmin(min, o.min), std::fmax(max, o.max)}; }
+
+    /// \brief Return the intersection of both intervals (the full interval if they do not intersect)
+    interval intersect(const interval& o) const { return make(std::fmax(min, o.min), std::fmin(max, o.max)); }
+
+    /// \brief Make an interval from computed bounds, rounding them outward
+    static interval rounded(float lo, float hi)
+    {
+      if (std::isnan(lo) || std::isnan(hi))
+        return full();
+      return {std::nextafter(lo, -std::numeric_limits<float>::infinity()), std::nextafter(hi, std::numeric_limits<float>::infinity())};
+    }
+  };
+
+  inline interval operator + (const interval& a, const interval& b)
+  {
+    if (a.is_full() || b.is_full())
+      return interval::full();
+    return interval::rounded(a.min + b.min, a.max + b.max);
+  }
+
+  inline interval operator - (const interval& a)
+  {
+    return {-a.max, -a.min};
+  }
+
+  inline interval operator - (const interval& a, const interval& b)
+  {
+    return a + (-b);
+  }
+
+  inline interval operator * (const interval& a, const interval& b)
+  {
+    if (a.is_full() || b.is_full())
+      return interval::full();
+    const float p[4] = {a.min * b.min, a.min * b.max, a.max * b.min, a.max * b.max};
+    float lo = p[0];
+    float hi = p[0];
+    for (const float it : p)
+    {
+      if (std::isnan(it))
+        return interval::full();
+      lo = it < lo ? it : lo;
+      hi = it > hi ? it : hi;
+    }
+    return interval::rounded(lo, hi);
+  }
+
+  inline interval operator / (const interval& a, const interval& b)
+  {
+    if (b.contains(0.f))
+      return interval::full();
+    return a * interval::rounded(1.f / b.max, 1.f / b.min);
+  }
+
+  /// \brief min(a, b) for every pair of values of \p a and \p b
+  inline interval min(const interval& a, const interval& b)
+  {
+    if (a.is_full() || b.is_full())
+      return interval::full();
+    return {std::fmin(a.min, b.min), std::fmin(a.max, b.max)};
+  }
+
+  /// \brief max(a, b) for every pair of values of \p a and \p b
+  inline interval max(const interval& a, const interval& b)
+  {
+    if (a.is_full() || b.is_full())
+      return interval::full();
+    return {std::fmax(a.min, b.min), std::fmax(a.max, b.max)};
+  }
+
+  /// \brief clamp(v, lo, hi) (a clamp also gets rid of NaNs, so the result is never full when lo and hi are not)
+  inline interval clamp(const interval& v, const interval& lo, const interval& hi)
+  {
+    if (lo.is_full() || hi.is_full())
+      return interval::full();
+    if (v.is_full())
+      return {lo.min, hi.max};
+    return {std::fmin(std::fmax(v.min, lo.min), hi.min), std::fmin(std::fmax(v.max, lo.max), hi.max)};
+  }
+
+  /// \brief The range of the components of a value (up to k_max_components, bigger values are not tracked)
+  struct value_range
+  {
+    static constexpr size_t k_max_components = 4;
+
+    std::array<interval, k_max_components> components = {};
+    uint8_t count = 0; // 0 if the range is unknown
+
+    /// \brief Return the range of a value nothing is known about
+    static value_range unknown() { return {}; }
+
+    /// \brief Return the range of a value whose \p component_count components are in \p i
+    static value_range uniform(interval i, size_t component_count)
+    {
+      value_range ret;
+      if (component_count > k_max_components)
+        return ret;
+      ret.count = static_cast<uint8_t>(component_count);
+      for (size_t c = 0; c < component_count; ++c)
+        ret.components[c] = i;
+      return ret;
+    }
+
+    /// \brief Return the range of a constant vector (unknown if it has more than k_max_components components)
+    static value_range from_constant(span<const float> data)
+    {
+      value_range ret;
+      if (data.size() > k_max_components)
+        return ret;
+      ret.count = static_cast<uint8_t>(data.size());
+      for (size_t c = 0; c < data.size(); ++c)
+        ret.components[c] = interval::point(data[c]);
+      return ret;
+    }
+
+    bool is_unknown() const
+    {
+      for (size_t c = 0; c < count; ++c)
+      {
+        if (!components[c].is_full())
+          return false;
+      }
+      return true;
+    }
+
+    /// \brief Return the range of a component (the full interval if the component is not tracked)
+    interval get(size_t component) const { return component < count ? components[component] : interval::full(); }
+
+    /// \brief Return the interval that contains every component
+    interval hull() const
+    {
+      if (count == 0)
+        return interval::full();
+      interval ret = components[0];
+      for (size_t c = 1; c < count; ++c)
+        ret = ret.join(components[c]);
+      return ret;
+    }
+
+    /// \brief Return whether or not every component is in \p i (a clamp to \p i is then redundant)
+    bool is_within(const interval& i) const { return count > 0 && hull().is_within(i); }
+
+    /// \brief Return the range of a value that is either in this range or in \p o (a select between both)
+    value_range join(const value_range& o) const
+    {
+      if (count != o.count)
+        return unknown();
+      value_range ret = *this;
+      for (size_t c = 0; c < count; ++c)
+        ret.components[c] = components[c].join(o.components[c]);
+      return ret;
+    }
+  };
+} // namespace rukh
@@ -0,0 +1,314 @@
+//
+// file : range_analysis.hpp
+// in : file:///home/tim/projects/rukh/rukh/range_analysis.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:27:24 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "generator.hpp"
+#include "graph.hpp"
+#include "range.hpp"
+#include "resolver.hpp"
+#include "span.hpp"
+#include "value.hpp"
+
+namespace rukh
+{
+  /// \brief Compute the range of the values of every output pin of a resolved graph (interval propagation)
+  ///
+  /// Nodes are visited in topological order: the range of an input is the range of the output it is connected to
+  /// (unconnected inputs are unknown) and base_node::propagate_ranges() computes the range of the outputs.
+  /// Outputs that are still unknown after that (nodes that do not implement it) but are constants of a float type
+  /// (see set_float_types) get the range of their data. Nodes that have not been resolved have unknown outputs,
+  /// so the ranges are always conservative: a value is always in its range.
+  ///
+  /// Generation can then skip redundant operations, like a clamp / saturate whose input is already in range,
+  /// or a select whose condition is always true / false: see range_pruner.
+  class range_analysis
+  {
+    public:
+      explicit range_analysis(const graph& _g) : g(_g) {}
+
+      /// \brief Set the types whose constants are vectors of floats (the types the ranges are about)
+      /// Only the constants of those types get their range from their data (see get_constant_range).
+      void set_float_types(std::vector<type::ref> types)
+      {
+        float_types = std::move(types);
+        std::sort(float_types.begin(), float_types.end());
+      }
+
+      /// \brief Return whether or not \p t is one of the float types (see set_float_types)
+      bool is_float_type(type::ref t) const
+      {
+        return std::binary_search(float_types.begin(), float_types.end(), t);
+      }
+
+      /// \brief Compute the ranges, using the result of the last resolution of the graph
+      void run(const resolver& res)
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const graph::edge_table& edges = g.get_edges();
+        const uint32_t edge_count = static_cast<uint32_t>(edges.size());
+
+        const auto make_offsets = [&](std::vector<uint32_t>& offsets, auto&& get_pins)
+        {
+          offsets.assign(node_count + 1, 0);
+          for (uint32_t n = 0; n < node_count; ++n)
+            offsets[n + 1] = offsets[n] + static_cast<uint32_t>(get_pins(g.get_node({n})).size());
+        };
+        make_offsets(input_offsets, [](const base_node& n) { return n.get_input_pins(); });
+        make_offsets(output_offsets, [](const base_node& n) { return n.get_output_pins(); });
+        input_ranges.assign(input_offsets.back(), value_range::unknown());
+        output_ranges.assign(output_offsets.back(), value_range::unknown());
+
+        // connections ending at each node (CSR):
+        std::vector<uint32_t> in_offsets(node_count + 1, 0);
+        for (uint32_t e = 0; e < edge_count; ++e)
+          ++in_offsets[edges.dst_node[e] + 1];
+        for (uint32_t n = 0; n < node_count; ++n)
+          in_offsets[n + 1] += in_offsets[n];
+        std::vector<uint32_t> in_edges(edge_count);
+        {
+          std::vector<uint32_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+          for (uint32_t e = 0; e < edge_count; ++e)
+            in_edges[fill[edges.dst_node[e]]++] = e;
+        }
+
+        known_count = 0;
+        for (const uint32_t n : res.get_order())
+        {
+          if (res.get_state({n}) != resolver::node_state::resolved)
+            continue;
+
+          const span<value_range> inputs = span<value_range>(input_ranges).subspan(input_offsets[n], input_offsets[n + 1] - input_offsets[n]);
+          const span<value_range> outputs = span<value_range>(output_ranges).subspan(output_offsets[n], output_offsets[n + 1] - output_offsets[n]);
+          for (uint32_t j = in_offsets[n]; j < in_offsets[n + 1]; ++j)
+          {
+            const uint32_t e = in_edges[j];
+            inputs[edges.dst_pin[e]] = output_ranges[output_offsets[edges.src_node[e]] + edges.src_pin[e]];
+          }
+
+          const base_node& node = g.get_node({n});
+          if (!node.propagate_ranges(span<const value_range>(inputs.data(), inputs.size()), outputs, g.get_values()))
+          {
+            for (value_range& it : outputs)
+              it = value_range::unknown();
+          }
+          const span<const pin_impl> output_pins = node.get_output_impls();
+          for (uint32_t i = 0; i < outputs.size(); ++i)
+          {
+            if (outputs[i].is_unknown())
+              outputs[i] = get_constant_range(output_pins[i].get_value());
+            known_count += outputs[i].is_unknown() ? 0 : 1;
+          }
+        }
+      }
+
+      /// \brief Return the range of a constant of a float type (unknown for other values, see set_float_types)
+      value_range get_constant_range(value v) const
+      {
+        const value_table& values = g.get_values();
+        if (!values.is_constant(v) || !is_float_type(values.get_type(v)))
+          return value_range::unknown();
+        return value_range::from_constant(values.get_components<float>(v));
+      }
+
+      /// \brief Return the range of an output pin
+      const value_range& get_output_range(node_handle n, uint32_t pin) const { return output_ranges[output_offsets[n.index] + pin]; }
+
+      /// \brief Return the range of an input pin
+      const value_range& get_input_range(node_handle n, uint32_t pin) const { return input_ranges[input_offsets[n.index] + pin]; }
+
+      /// \brief Return the number of output pins whose range is known (not unknown)
+      uint32_t get_known_count() const { return known_count; }
+
+      const graph& get_graph() const { return g; }
+
+    private:
+      const graph& g;
+      std::vector<type::ref> float_types; // sorted
+
+      std::vector<uint32_t> input_offsets; // [node count + 1] index of the first input of each node in input_ranges
+      std::vector<uint32_t> output_offsets; // [node count + 1] index of the first output of each node in output_ranges
+      std::vector<value_range> input_ranges;
+      std::vector<value_range> output_ranges;
+      uint32_t known_count = 0;
+  };
+
+  /// \brief A generator that skips the operations the ranges of their operands make redundant, and forwards the others
+  ///
+  /// Given to pass_runner::generate, it takes the ranges of the inputs of the nodes from a range_analysis (and
+  /// those of their outputs once they are generated) and tracks the ranges of the values the nodes emit. Then:
+  ///  - a min / max that always returns the same operand is replaced by that operand (so a clamp / saturate
+  ///    of a value that is already in range emits nothing). The sign of a zero result may differ.
+  ///  - a select whose condition is always true / false is replaced by the selected operand.
+  /// An operand only replaces an operation that has the same type.
+  ///
+  /// \note The wrapped generator must add its values to the value table of the graph (like ir::builder does),
+  ///       and a pruner must only be used for a single generation.
+  class range_pruner : public generator
+  {
+    public:
+      range_pruner(generator& _gen, const range_analysis& _ranges) : gen(_gen), ranges(_ranges) {}
+
+      using generator::emit;
+      value emit(opcode op, type::ref result_type, span<const value> operands, uint32_t immediate = 0) override
+      {
+        const value_table& values = ranges.get_graph().get_values();
+        const auto replace_by = [&](value v)
+        {
+          ++pruned;
+          return v;
+        };
+
+        if ((op == opcode::min || op == opcode::max) && operands.size() == 2)
+        {
+          const value_range a = get_range(operands[0]);
+          const value_range b = get_range(operands[1]);
+          const interval ha = a.hull();
+          const interval hb = b.hull();
+          if (!ha.is_full() && !hb.is_full())
+          {
+            // (max: the operand that is always the greatest, min: the one that is always the smallest)
+            const bool first = op == opcode::max ? ha.min >= hb.max : ha.max <= hb.min;
+            const bool second = op == opcode::max ? hb.min >= ha.max : hb.max <= ha.min;
+            if (first && values.get_type(operands[0]) == result_type)
+              return replace_by(operands[0]);
+            if (second && values.get_type(operands[1]) == result_type)
+              return replace_by(operands[1]);
+          }
+
+          const value ret = gen.emit(op, result_type, operands, immediate);
+          if (a.count == b.count)
+          {
+            value_range r = a;
+            for (size_t c = 0; c < r.count; ++c)
+              r.components[c] = op == opcode::max ? max(a.components[c], b.components[c]) : min(a.components[c], b.components[c]);
+            refine(ret, r);
+          }
+          return ret;
+        }
+
+        if (op == opcode::select && operands.size() == 3)
+        {
+          const int condition = get_condition(operands[0]);
+          if (condition > 0 && values.get_type(operands[1]) == result_type)
+            return replace_by(operands[1]);
+          if (condition == 0 && values.get_type(operands[2]) == result_type)
+            return replace_by(operands[2]);
+
+          const value ret = gen.emit(op, result_type, operands, immediate);
+          refine(ret, get_range(operands[1]).join(get_range(operands[2])));
+          return ret;
+        }
+
+        return gen.emit(op, result_type, operands, immediate);
+      }
+
+      void begin_node(uint32_t node, const base_node& n) override
+      {
+        const span<const pin_impl> inputs = n.get_input_impls();
+        for (uint32_t i = 0; i < inputs.size(); ++i)
+          refine(inputs[i].get_value(), ranges.get_input_range({node}, i));
+        gen.begin_node(node, n);
+      }
+
+      void end_node(uint32_t node, const base_node& n) override
+      {
+        const span<const pin_impl> outputs = n.get_output_impls();
+        for (uint32_t i = 0; i < outputs.size(); ++i)
+          refine(outputs[i].get_value(), ranges.get_output_range({node}, i));
+        gen.end_node(node, n);
+      }
+
+      /// \brief Return the range of a value (unknown if nothing is known about it)
+      value_range get_range(value v) const
+      {
+        if (v.is_valid() && v.get_index() < value_ranges.size() && !value_ranges[v.get_index()].is_unknown())
+          return value_ranges[v.get_index()];
+        return ranges.get_constant_range(v);
+      }
+
+      /// \brief Return the number of operations that have been skipped
+      uint32_t get_pruned_count() const { return pruned; }
+
+    private:
+      /// \brief Return 1 if a condition is always true, 0 if it is always false, -1 if it is not known
+      /// Constant conditions of the float types, like the non-constant ones, are known from their range (so -0.f is false).
+      /// The constants of the other types are booleans or unsigned integers (uint32_t components, see fold).
+      int get_condition(value v) const
+      {
+        if (!v.is_valid())
+          return -1;
+        const value_table& values = ranges.get_graph().get_values();
+        if (values.is_constant(v) && !ranges.is_float_type(values.get_type(v)))
+        {
+          const span<const uint32_t> data = values.get_components<uint32_t>(v);
+          if (data.empty())
+            return -1;
+          const size_t true_count = static_cast<size_t>(std::count_if(data.begin(), data.end(), [](uint32_t it) { return it != 0; }));
+          return true_count == data.size() ? 1 : (true_count == 0 ? 0 : -1);
+        }
+        const interval h = get_range(v).hull();
+        if (h.is_full())
+          return -1;
+        if (!h.contains(0.f))
+          return 1;
+        return h.min == 0.f && h.max == 0.f ? 0 : -1;
+      }
+
+      /// \brief Intersect the range of a value with \p r (both contain the value)
+      void refine(value v, const value_range& r)
+      {
+        if (!v.is_valid() || r.is_unknown())
+          return;
+        if (v.get_index() >= value_ranges.size())
+          value_ranges.resize(v.get_index() + 1);
+        value_range& it = value_ranges[v.get_index()];
+        if (it.is_unknown())
+        {
+          it = r;
+          return;
+        }
+        if (it.count != r.count)
+          return;
+        for (size_t c = 0; c < it.count; ++c)
+          it.components[c] = it.components[c].intersect(r.components[c]);
+      }
+
+    private:
+      generator& gen;
+      const range_analysis& ranges;
+
+      std::vector<value_range> value_ranges; // [value index], grown as values are emitted
+      uint32_t pruned = 0;
+  };
+} // namespace rukh
@@ -29,8 +29,13 @@
 
 #pragma once
 
+#include <array>
+#include <cstdio>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace rukh
 {
@@ -62,12 +67,45 @@ namespace rukh
       {
         severity_t severity;
         std::string message; // unformatted string
+        std::vector<std::string> values; // the values, converted to strings
 
-        // TODO
+        /// \brief Return the formatted message ({} is replaced by the next value, {n} by the nth value)
+        std::string format() const
+        {
+          std::string ret;
+          ret.reserve(message.size());
+          size_t next = 0;
+          for (size_t i = 0; i < message.size(); ++i)
+          {
+            const size_t end = message[i] == '{' ? message.find('}', i) : std::string::npos;
+            if (end == std::string::npos)
+            {
+              ret.push_back(message[i]);
+              continue;
+            }
+            // only a bare {} consumes a value
+            size_t index = end == i + 1 ? next++ : 0;
+            bool valid = true;
+            if (end > i + 1)
+            {
+              for (size_t j = i + 1; j < end && valid; ++j)
+              {
+                valid = message[j] >= '0' && message[j] <= '9';
+                index = index * 10 + static_cast<size_t>(message[j] - '0');
+              }
+            }
+            if (valid && index < values.size())
+              ret += values[index];
+            else
+              ret.append(message, i, end - i + 1);
+            i = end;
+          }
+          return ret;
+        }
       };
 
 
-      using handler_t = void(*)(/* TODO */);
+      using handler_t = void(*)(const ser_log& entry);
       class handler_id
       {
         public:
@@ -104,13 +142,100 @@ namespace rukh
       /// \brief Add a new handler. It will be called for every log events
       /// \note To remove the handler before the destruction of the reporter instance,
       ///       give the returned value to remove_handler.
-      handler_id add_handler(handler_t handler);
-      void remove_handler(const handler_id& id);
+      handler_id add_handler(handler_t handler)
+      {
+        handlers.push_back({++last_handler_id, handler});
+        return {*this, last_handler_id};
+      }
+
+      void remove_handler(const handler_id& id)
+      {
+        for (size_t i = 0; i < handlers.size(); ++i)
+        {
+          if (handlers[i].first == id.id)
+          {
+            handlers.erase(handlers.begin() + i);
+            return;
+          }
+        }
+      }
 
       /// \brief Log a message.
       /// Messages should have {}-style string formatting (with positional parameters using {n})
       /// \note The string is not formatted right away but values are copied and are sent to handlers in a specific format
       template<typename... Types>
-      reporter& log(severity_t s, const std::string_view& msg, Types &&... values);
+      reporter& log(severity_t s, const std::string_view& msg, Types &&... values)
+      {
+        return log(ser_log{s, std::string(msg), {to_log_string(values)...}});
+      }
+
+      /// \brief Log an already built entry
+      reporter& log(ser_log&& entry)
+      {
+        ++counts[static_cast<size_t>(entry.severity)];
+        if (buffering)
+        {
+          buffer.push_back(std::move(entry));
+          return *this;
+        }
+        for (auto& it : handlers)
+          it.second(entry);
+        return *this;
+      }
+
+      /// \brief Return the number of messages of a given severity that have been logged
+      size_t get_count(severity_t s) const { return counts[static_cast<size_t>(s)]; }
+
+      /// \brief Return whether or not an error (or a critical error) has been logged
+      bool has_errors() const { return get_count(severity_t::error) + get_count(severity_t::critical) > 0; }
+
+    public: // buffering
+      // When buffering, log entries are stored instead of being sent to the handlers.
+      // This allows tasks that run concurrently to each log into their own reporter, and the logs to be replayed
+      // afterward in a deterministic order (see replay)
+
+      /// \brief Start / stop storing the log entries instead of sending them to the handlers
+      void set_buffering(bool enable) { buffering = enable; }
+
+      /// \brief Return (and clear) the stored log entries
+      std::vector<ser_log> take_buffer() { return std::move(buffer); }
+
+      /// \brief Log the entries (most probably from another, buffering, reporter)
+      void replay(std::vector<ser_log>&& entries)
+      {
+        for (ser_log& it : entries)
+          log(std::move(it));
+      }
+
+    private:
+      template<typename Type>
+      static std::string to_log_string(const Type& v)
+      {
+        if constexpr (std::is_convertible_v<const Type&, std::string_view>)
+          return std::string(std::string_view(v));
+        else if constexpr (std::is_same_v<Type, bool>)
+          return v ? "true" : "false";
+        else if constexpr (std::is_arithmetic_v<Type>)
+          return std::to_string(v);
+        else if constexpr (std::is_enum_v<Type>)
+          return std::to_string(static_cast<std::underlying_type_t<Type>>(v));
+        else if constexpr (std::is_pointer_v<Type>)
+        {
+          char buffer[32];
+          snprintf(buffer, sizeof(buffer), "%p", static_cast<const void*>(v));
+          return buffer;
+        }
+        else
+          return v.to_string(); // fallback: the type must have a to_string() method
+      }
+
+    private:
+      std::vector<std::pair<unsigned, handler_t>> handlers;
+      unsigned last_handler_id = 0;
+
+      std::array<size_t, 5> counts = {};
+
+      bool buffering = false;
+      std::vector<ser_log> buffer;
   };
 } // namespace rukh
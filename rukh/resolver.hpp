@@ -0,0 +1,1014 @@
+//
+// file : resolver.hpp
+// in : file:///home/tim/projects/rukh/rukh/resolver.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:11:39 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "compile_cache.hpp"
+#include "graph.hpp"
+#include "pass_runner.hpp"
+#include "reporter.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+
+namespace rukh
+{
+  /// \brief Drive the type resolution of a graph: call resolve_output_types(), validate() then const_generate() on every node,
+  /// once the nodes connected to its inputs have been resolved, and propagate the resolved types along the connections.
+  ///
+  /// Nodes are topologically sorted, and every node keeps a count of the connections whose source has not been resolved yet.
+  /// Without a thread_pool, nodes are resolved by batches of nodes of the same level and type (see pass_runner),
+  /// with one call per batch and per step to the node_kind functions (resolve_output_types() of every node of the
+  /// batch, then validate(), ...). Each node of the batch logs in its own (buffering) reporter, and the logs are
+  /// replayed node by node at the end of the batch.
+  /// With a thread_pool, a node is pushed as a task as soon as its count reaches 0, so the independent nodes
+  /// (the wide levels of the graph) are resolved in parallel.
+  /// The nodes can query their type_db from the workers, as long as no definition is added to it during the resolution
+  /// (see the thread-safety notes of type_db).
+  ///
+  /// Each task logs into its own (buffering) reporter; the logs are replayed in topological order at the end,
+  /// so the reported messages do not depend on the scheduling (nor on the number of threads), and are the same
+  /// as the ones of a resolution without a thread_pool.
+  /// Nodes with an input connected to a node that failed are skipped (and do not report anything).
+  /// The constants created by const_generate() go in the value table of the graph (graph::get_values()),
+  /// which is reset by resolve(). update() adds to it, and compacts it once it has doubled since the last resolve() /
+  /// compaction: the values that are not referenced by a pin anymore (the previous constants of re-run nodes) are
+  /// released and the others are renumbered (see value_table::compact, stats::released_values).
+  /// So nodes must only keep the handles of their values in their pins, and what has been generated from the table
+  /// (IR, builders) has to be generated again after an update() that released values.
+  /// As the table is not thread-safe, calls to const_generate() are serialized.
+  ///
+  /// After a first resolution, update() only re-runs the nodes affected by the edits made to the graph since then
+  /// (see graph::get_dirty_nodes): the dirty nodes, then (in topological order) the nodes connected to the outputs of
+  /// any re-run node whose state or output state hash (base_node::get_output_state_hash) has changed.
+  /// The topological order is patched with the topology edits of the graph (see graph::get_topology_edits): a new
+  /// connection that goes against the order only moves the nodes between its ends that are connected to them
+  /// (Pearce-Kelly), and the liveness is only propagated from the nodes whose connections changed. The order and the
+  /// liveness are only computed again when that cannot be done (a cycle, the first / last output node, too many edits).
+  /// The compaction of the value table scans every pin, but is amortized over the values created by the updates.
+  ///
+  /// generate() emits the IR of the live nodes in a generator, and records the operations of each node (relative to
+  /// its inputs, see compile_cache::recorder): the next calls only generate the nodes that have been re-run since then,
+  /// and emit the recorded operations of the others again (see get_generation_stats).
+  ///
+  /// When the graph has output nodes (see graph::set_output_node), the nodes that are not connected (directly or
+  /// through other nodes) to an output node are dead: they are flagged as such when the adjacency is built, are not
+  /// part of the order (so are skipped by every pass using it) and are never resolved. The number of dead nodes is
+  /// reported (with the debug severity).
+  ///
+  /// Every resolved node gets a structural hash (see compile_cache::hash_node), computed from the node and the
+  /// structural hashes of the nodes connected to its inputs. With a compile_cache (see set_cache), cacheable nodes
+  /// (see base_node::is_cacheable) whose structural hash is in the cache get their outputs from it instead of being
+  /// resolved, and the cacheable nodes that have been resolved are added to it. The structural hashes then include the
+  /// salt of the cache (see compile_cache::get_salt).
+  class resolver
+  {
+    public:
+      /// \brief State of a node after a resolution
+      enum class node_state : uint8_t
+      {
+        pending, // not resolved (part of a cycle)
+        resolved,
+        failed, // resolve_output_types() or validate() returned false
+        skipped, // an input is connected to a node that has not been resolved
+        dead, // the node does not contribute to any output node of the graph
+      };
+
+      struct stats
+      {
+        uint32_t resolved = 0;
+        uint32_t failed = 0;
+        uint32_t skipped = 0;
+        uint32_t in_cycle = 0; // nodes that are part of (or depend on) a cycle
+        uint32_t dead = 0; // nodes that do not contribute to any output node
+        uint32_t released_values = 0; // values removed from the value table of the graph by the last update()
+        bool rebuilt_topology = false; // the order has been computed again instead of being patched
+      };
+
+      struct generation_stats
+      {
+        uint32_t generated = 0; // nodes whose generate() has been called
+        uint32_t replayed = 0; // nodes whose recorded operations have been emitted again
+      };
+
+    public:
+      explicit resolver(graph& _g) : g(_g), runner(_g) {}
+
+      /// \brief Resolve every node of the graph
+      /// \param pool if nullptr, nodes are resolved serially (in topological order) by the calling thread
+      /// \return true if every node has been resolved
+      bool resolve(reporter& r, thread_pool* pool = nullptr)
+      {
+        build();
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        states.assign(node_count, node_state::pending);
+        for (uint32_t n = 0; n < node_count; ++n)
+        {
+          if (live[n] == 0)
+            states[n] = node_state::dead;
+        }
+        g.get_values().reset();
+        output_hashes.assign(node_count, 0);
+        structural_hashes.assign(node_count, hash_t::zero);
+        segment_states.assign(node_count, k_not_generated);
+        updated.assign(order.begin(), order.end());
+
+        if (pool == nullptr)
+        {
+          for (const pass_runner::batch& b : runner.get_batches())
+            resolve_batch(b, r);
+        }
+        else
+        {
+          logs.clear();
+          logs.resize(node_count);
+          remaining = std::make_unique<std::atomic<uint32_t>[]>(node_count);
+          for (uint32_t n = 0; n < node_count; ++n)
+            remaining[n].store(get_input_edge_count(n), std::memory_order_relaxed);
+
+          for (uint32_t n = 0; n < node_count; ++n)
+          {
+            if (live[n] != 0 && get_input_edge_count(n) == 0) // (the tasks already pushed decrement the counters)
+              push_node(*pool, n);
+          }
+          pool->wait();
+
+          for (const uint32_t n : order)
+            r.replay(std::move(logs[n]));
+          logs.clear();
+        }
+
+        result = {};
+        result.rebuilt_topology = true;
+        for (const node_state s : states)
+          count_state(s, 1);
+        g.clear_dirty();
+        report_dead(r);
+        compacted_value_count = g.get_values().get_count();
+        return finish(r);
+      }
+
+      /// \brief Only re-resolve the nodes affected by the edits made to the graph since the last resolution
+      /// If the graph has never been resolved, this is the same as resolve()
+      /// \return true if every node of the graph is resolved
+      bool update(reporter& r)
+      {
+        if (states.empty() && g.get_node_count() > 0)
+          return resolve(r);
+
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const uint32_t previous_count = static_cast<uint32_t>(states.size());
+        const bool topology_changed = built_version != g.get_topology_version();
+        result.rebuilt_topology = topology_changed && !patch_topology();
+        if (result.rebuilt_topology)
+          build();
+        states.resize(node_count, node_state::pending);
+        output_hashes.resize(node_count, 0);
+        structural_hashes.resize(node_count, hash_t::zero);
+        segment_states.resize(node_count, k_not_generated);
+        if (result.rebuilt_topology)
+        {
+          liveness_changes.clear();
+          for (uint32_t n = 0; n < node_count; ++n)
+          {
+            if (live[n] == 0)
+              set_state(n, node_state::dead);
+            else if (positions[n] == k_no_position) // now part of a cycle
+              set_state(n, node_state::pending);
+            else if (states[n] == node_state::dead)
+              liveness_changes.push_back(n);
+          }
+        }
+        else if (topology_changed)
+        {
+          for (uint32_t n = previous_count; n < node_count; ++n)
+          {
+            if (live[n] == 0)
+              set_state(n, node_state::dead);
+          }
+          for (const uint32_t n : liveness_changes)
+          {
+            if (live[n] == 0)
+              set_state(n, node_state::dead);
+          }
+        }
+
+        // re-run the dirty nodes, then their outputs (in topological order) until nothing changes
+        // (a node whose inputs are unchanged but whose structural hash changed only has its hash recomputed)
+        using item = std::pair<uint32_t, uint32_t>; // (position, node)
+        std::priority_queue<item, std::vector<item>, std::greater<item>> queue;
+        queued.resize(node_count, k_not_queued);
+        const auto enqueue = [&](uint32_t n, uint8_t mode)
+        {
+          if (queued[n] >= mode || positions[n] == k_no_position || live[n] == 0)
+            return;
+          if (queued[n] == k_not_queued)
+            queue.push({positions[n], n});
+          queued[n] = mode;
+        };
+        for (const uint32_t n : g.get_dirty_nodes())
+          enqueue(n, k_queued_resolve);
+        g.clear_dirty();
+        if (topology_changed)
+        {
+          // nodes that were dead and are now live:
+          for (const uint32_t n : liveness_changes)
+          {
+            if (states[n] == node_state::dead && live[n] != 0)
+            {
+              set_state(n, node_state::pending);
+              enqueue(n, k_queued_resolve);
+            }
+          }
+          report_dead(r);
+        }
+
+        const graph::edge_table& edges = g.get_edges();
+        updated.clear();
+        while (!queue.empty())
+        {
+          const uint32_t n = queue.top().second;
+          queue.pop();
+          const uint8_t mode = queued[n];
+          queued[n] = k_not_queued;
+
+          const hash_t previous_structural_hash = structural_hashes[n];
+          if (mode == k_queued_rehash)
+          {
+            if (states[n] != node_state::resolved)
+              continue;
+            set_structural_hash(n);
+            if (structural_hashes[n] == previous_structural_hash)
+              continue;
+            compile_cache::entry e;
+            if (make_cache_entry(n, e))
+              cache->store(structural_hashes[n], std::move(e));
+            g.for_each_output_edge({n}, [&](edge_handle e) { enqueue(edges.dst_node[e.index], k_queued_rehash); });
+            continue;
+          }
+
+          updated.push_back(n);
+          segment_states[n] = k_not_generated;
+          const node_state previous_state = states[n];
+          const uint64_t previous_hash = output_hashes[n];
+          states[n] = node_state::pending;
+          resolve_node(n, r);
+          count_state(previous_state, -1);
+          count_state(states[n], 1);
+
+          // early cutoff: the nodes depending on this one will not see any difference
+          // (but their structural hashes are computed from the one of this node, so they are recomputed if it changed)
+          uint8_t next_mode = k_queued_resolve;
+          if (states[n] == previous_state && output_hashes[n] == previous_hash)
+          {
+            if (structural_hashes[n] == previous_structural_hash)
+              continue;
+            next_mode = k_queued_rehash;
+          }
+          g.for_each_output_edge({n}, [&](edge_handle e) { enqueue(edges.dst_node[e.index], next_mode); });
+        }
+        compact_values();
+        return finish(r);
+      }
+
+      /// \brief Generate the IR of the live nodes (in topological order)
+      /// The operations emitted by each node are recorded relative to the node (see compile_cache::recorder). Only the
+      /// nodes that have been re-run by resolve() / update() since they were last generated (or whose operations could
+      /// not be recorded) are generated: the recorded operations of the other nodes are emitted again without calling
+      /// them (see compile_cache::replay). The nodes connected to a re-run node do not have to be generated again, as
+      /// their recorded operations use the values of their inputs: only the cone of the edits is generated.
+      /// \param gen an empty generator (the IR of every live node is emitted, for instance in a function that has been
+      ///        reset): begin_node() / end_node() are called for every node that is not constant
+      /// \return true if every call to generate() succeeded
+      bool generate(reporter& r, generator& gen)
+      {
+        generation_result = {};
+        segments.resize(segment_states.size());
+        bool success = true;
+        for (const uint32_t n : topo)
+        {
+          if (live[n] == 0)
+            continue;
+          base_node& node = g.get_node({n});
+          if (segment_states[n] == k_not_generated && node.is_constant())
+            segment_states[n] = k_constant;
+          if (segment_states[n] == k_constant)
+            continue;
+
+          set_input_values(n);
+          gen.begin_node(n, node);
+          if (segment_states[n] == k_recorded && compile_cache::replay(segments[n], node, g.get_values(), gen))
+          {
+            ++generation_result.replayed;
+          }
+          else
+          {
+            compile_cache::recorder rec(gen, g.get_values(), static_cast<const base_node&>(node).get_input_impls(), segments[n]);
+            const bool generated = node.generate(r, rec);
+            success = success && generated;
+            segment_states[n] = generated && rec.finish(static_cast<const base_node&>(node).get_output_impls()) ? k_recorded : k_not_generated;
+            ++generation_result.generated;
+          }
+          gen.end_node(n, node);
+        }
+        return success;
+      }
+
+      /// \brief Return the counters of the last call to generate()
+      const generation_stats& get_generation_stats() const { return generation_result; }
+
+      /// \brief Use a cache of the resolved nodes (nullptr to stop using it)
+      /// \note The cache must outlive the resolver (or the calls to resolve() / update())
+      void set_cache(compile_cache* _cache) { cache = _cache; }
+
+      /// \brief Return the counters of the last resolution
+      const stats& get_stats() const { return result; }
+
+      /// \brief Return the structural hash of a node (hash_t::zero if it has not been resolved)
+      hash_t get_structural_hash(node_handle n) const { return structural_hashes[n.index]; }
+
+      /// \brief Return the structural hashes of the nodes (indexed by node)
+      span<const hash_t> get_structural_hashes() const { return structural_hashes; }
+
+      /// \brief Return the state of a node after the last resolution
+      node_state get_state(node_handle n) const { return states[n.index]; }
+
+      /// \brief Return the topological order of the live nodes computed by the last resolution
+      /// (nodes that are part of a cycle are not in it). Nodes are sorted by level, then by kind (see pass_runner)
+      /// \note After an update() that patched the order, the batches are computed again on the first call
+      span<const uint32_t> get_order() const
+      {
+        if (order_stale)
+          build_order();
+        return order;
+      }
+
+      /// \brief Return the nodes that have been re-run by the last resolution / update, in topological order
+      /// (these are the nodes whose IR changed, and that the next call to generate() will generate)
+      span<const uint32_t> get_updated_nodes() const { return updated; }
+
+    private:
+      static constexpr uint32_t k_no_position = ~0u;
+      static constexpr size_t k_min_compaction_count = 4096;
+      static constexpr uint8_t k_not_queued = 0;
+      static constexpr uint8_t k_queued_rehash = 1; // only recompute the structural hash
+      static constexpr uint8_t k_queued_resolve = 2;
+      static constexpr uint8_t k_not_generated = 0; // (or the operations could not be recorded)
+      static constexpr uint8_t k_constant = 1;
+      static constexpr uint8_t k_recorded = 2;
+
+      void count_state(node_state s, int delta)
+      {
+        result.resolved += s == node_state::resolved ? delta : 0;
+        result.failed += s == node_state::failed ? delta : 0;
+        result.skipped += s == node_state::skipped ? delta : 0;
+        result.dead += s == node_state::dead ? delta : 0;
+      }
+
+      void report_dead(reporter& r) const
+      {
+        if (result.dead > 0)
+          r.log(reporter::severity_t::debug, "resolver: {} nodes do not contribute to any output node and have been pruned", result.dead);
+      }
+
+      void set_state(uint32_t n, node_state s)
+      {
+        count_state(states[n], -1);
+        states[n] = s;
+        count_state(s, 1);
+        if (s == node_state::dead) // (not resolved anymore)
+          structural_hashes[n] = hash_t::zero;
+      }
+
+      bool finish(reporter& r)
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        result.in_cycle = cycle_count;
+        if (result.in_cycle > 0)
+        {
+          r.log(reporter::severity_t::error, "resolver: {} nodes are part of (or depend on) a dependency cycle and cannot be resolved",
+                result.in_cycle);
+        }
+        return result.resolved + result.dead == node_count;
+      }
+
+      /// \brief Compute the liveness of the nodes and the topological order of the graph
+      void build()
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const graph::edge_table& edges = g.get_edges();
+
+        // live nodes: walk the connections backwards from the output nodes
+        const span<const uint32_t> output_nodes = g.get_output_nodes();
+        has_output_nodes = !output_nodes.empty();
+        live.assign(node_count, has_output_nodes ? 0 : 1);
+        std::vector<uint32_t> stack;
+        for (const uint32_t n : output_nodes)
+        {
+          if (live[n] == 0)
+            stack.push_back(n);
+          live[n] = 1;
+        }
+        while (!stack.empty())
+        {
+          const uint32_t n = stack.back();
+          stack.pop_back();
+          g.for_each_input_edge({n}, [&](edge_handle e)
+          {
+            const uint32_t src = edges.src_node[e.index];
+            if (live[src] == 0)
+            {
+              live[src] = 1;
+              stack.push_back(src);
+            }
+          });
+        }
+
+        // topological order (Kahn) of every node (the dead ones too, so that the order can be patched when they become live):
+        topo.clear();
+        topo.reserve(node_count);
+        std::vector<uint32_t> count(node_count);
+        for (uint32_t n = 0; n < node_count; ++n)
+        {
+          count[n] = get_input_edge_count(n);
+          if (count[n] == 0)
+            topo.push_back(n);
+        }
+        for (size_t i = 0; i < topo.size(); ++i)
+        {
+          g.for_each_output_edge({topo[i]}, [&](edge_handle e)
+          {
+            const uint32_t dst = edges.dst_node[e.index];
+            if (--count[dst] == 0)
+              topo.push_back(dst);
+          });
+        }
+
+        positions.assign(node_count, k_no_position);
+        for (uint32_t i = 0; i < topo.size(); ++i)
+          positions[topo[i]] = i;
+        cycle_count = 0;
+        for (uint32_t n = 0; n < node_count; ++n)
+          cycle_count += live[n] != 0 && positions[n] == k_no_position ? 1 : 0;
+
+        build_order();
+        built_version = g.get_topology_version();
+        g.clear_topology_edits();
+      }
+
+      /// \brief Split the live nodes of the topological order in batches (see pass_runner)
+      void build_order() const
+      {
+        order.clear();
+        for (const uint32_t n : topo)
+        {
+          if (live[n] != 0)
+            order.push_back(n);
+        }
+        runner.build(order);
+        order.assign(runner.get_nodes().begin(), runner.get_nodes().end());
+        order_stale = false;
+      }
+
+      /// \brief Patch the topological order and the liveness with the topology edits made since the last build()
+      /// The nodes whose liveness changed are put in liveness_changes (except the new ones).
+      /// \return false if the edits have not been recorded, or if they cannot be patched (the order has to be built again)
+      bool patch_topology()
+      {
+        const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+        const uint32_t previous_count = static_cast<uint32_t>(positions.size());
+        if (!g.has_topology_edits_since(built_version) || topo.size() != previous_count || has_output_nodes == g.get_output_nodes().empty())
+          return false;
+
+        const graph::edge_table& edges = g.get_edges();
+        const span<const graph::topology_edit> topology_edits = g.get_topology_edits();
+        using edit_kind = graph::topology_edit::kind_t;
+
+        // new nodes are put at the end of the order (they are moved by the connections that need it):
+        for (uint32_t n = previous_count; n < node_count; ++n)
+        {
+          positions.push_back(static_cast<uint32_t>(topo.size()));
+          topo.push_back(n);
+          live.push_back(has_output_nodes ? 0 : 1);
+        }
+        marks.resize(node_count, 0);
+        moved.clear();
+        for (const graph::topology_edit& it : topology_edits)
+        {
+          if (it.kind == edit_kind::connect && !reorder(it.node, it.dst))
+            return false;
+        }
+
+        // the connections whose ends have not been moved (nor added) are still in order:
+        for (const graph::topology_edit& it : topology_edits)
+        {
+          if (it.kind == edit_kind::connect && positions[it.node] >= positions[it.dst])
+            return false;
+        }
+        bool in_order = true;
+        for (const uint32_t n : moved)
+        {
+          g.for_each_input_edge({n}, [&](edge_handle e) { in_order = in_order && positions[edges.src_node[e.index]] < positions[n]; });
+          g.for_each_output_edge({n}, [&](edge_handle e) { in_order = in_order && positions[n] < positions[edges.dst_node[e.index]]; });
+        }
+        if (!in_order)
+          return false;
+
+        // liveness: from the last node of the order to the first, so that the liveness of the nodes connected to the
+        // outputs of a node is known when it is computed (only the nodes whose outputs changed are visited, then
+        // the nodes connected to the inputs of the nodes whose liveness changed)
+        liveness_changes.clear();
+        if (has_output_nodes)
+        {
+          using item = std::pair<uint32_t, uint32_t>; // (position, node)
+          std::priority_queue<item> queue;
+          const auto enqueue = [&](uint32_t n)
+          {
+            if (marks[n] != 0)
+              return;
+            marks[n] = 1;
+            queue.push({positions[n], n});
+          };
+          for (const graph::topology_edit& it : topology_edits)
+            enqueue(it.node);
+          while (!queue.empty())
+          {
+            const uint32_t n = queue.top().second;
+            queue.pop();
+            marks[n] = 0;
+            bool is_live = g.is_output_node({n});
+            g.for_each_output_edge({n}, [&](edge_handle e) { is_live = is_live || live[edges.dst_node[e.index]] != 0; });
+            if (is_live == (live[n] != 0))
+              continue;
+            live[n] = is_live ? 1 : 0;
+            if (n < previous_count)
+              liveness_changes.push_back(n);
+            g.for_each_input_edge({n}, [&](edge_handle e) { enqueue(edges.src_node[e.index]); });
+          }
+        }
+
+        order_stale = true;
+        built_version = g.get_topology_version();
+        g.clear_topology_edits();
+        return true;
+      }
+
+      /// \brief Restore the topological order after the connection src -> dst has been added (Pearce-Kelly)
+      /// Only the nodes placed between dst and src are moved: the ones reachable from dst go after the ones that reach src,
+      /// in the positions they occupied (and keep their relative order).
+      /// \return false if the connection makes a cycle
+      bool reorder(uint32_t src, uint32_t dst)
+      {
+        const uint32_t lower = positions[dst];
+        const uint32_t upper = positions[src];
+        if (src == dst)
+          return false;
+        if (upper < lower)
+          return true;
+
+        const graph::edge_table& edges = g.get_edges();
+        bool cycle = false;
+        forward.clear();
+        backward.clear();
+        reorder_stack.assign(1, dst);
+        marks[dst] = 1;
+        while (!reorder_stack.empty() && !cycle)
+        {
+          const uint32_t n = reorder_stack.back();
+          reorder_stack.pop_back();
+          forward.push_back(n);
+          g.for_each_output_edge({n}, [&](edge_handle e)
+          {
+            const uint32_t next = edges.dst_node[e.index];
+            cycle = cycle || next == src;
+            if (marks[next] == 0 && positions[next] < upper)
+            {
+              marks[next] = 1;
+              reorder_stack.push_back(next);
+            }
+          });
+        }
+        if (!cycle)
+        {
+          reorder_stack.assign(1, src);
+          marks[src] = 1;
+          while (!reorder_stack.empty())
+          {
+            const uint32_t n = reorder_stack.back();
+            reorder_stack.pop_back();
+            backward.push_back(n);
+            g.for_each_input_edge({n}, [&](edge_handle e)
+            {
+              const uint32_t next = edges.src_node[e.index];
+              if (marks[next] == 0 && positions[next] > lower)
+              {
+                marks[next] = 1;
+                reorder_stack.push_back(next);
+              }
+            });
+          }
+        }
+        for (const uint32_t n : forward)
+          marks[n] = 0;
+        for (const uint32_t n : backward)
+          marks[n] = 0;
+        for (const uint32_t n : reorder_stack)
+          marks[n] = 0;
+        if (cycle)
+          return false;
+
+        const auto by_position = [this](uint32_t a, uint32_t b) { return positions[a] < positions[b]; };
+        std::sort(forward.begin(), forward.end(), by_position);
+        std::sort(backward.begin(), backward.end(), by_position);
+        slots.clear();
+        for (const uint32_t n : backward)
+          slots.push_back(positions[n]);
+        for (const uint32_t n : forward)
+          slots.push_back(positions[n]);
+        std::sort(slots.begin(), slots.end());
+        size_t i = 0;
+        for (const std::vector<uint32_t>* nodes : {&backward, &forward})
+        {
+          for (const uint32_t n : *nodes)
+          {
+            positions[n] = slots[i++];
+            topo[positions[n]] = n;
+            moved.push_back(n);
+          }
+        }
+        return true;
+      }
+
+      /// \brief Return the number of connected input pins of a node
+      uint32_t get_input_edge_count(uint32_t n) const
+      {
+        uint32_t count = 0;
+        g.for_each_input_edge({n}, [&count](edge_handle) { ++count; });
+        return count;
+      }
+
+      void push_node(thread_pool& pool, uint32_t n)
+      {
+        pool.push([this, &pool, n]
+        {
+          reporter local;
+          local.set_buffering(true);
+          resolve_node(n, local);
+          logs[n] = local.take_buffer();
+
+          const graph::edge_table& edges = g.get_edges();
+          g.for_each_output_edge({n}, [&](edge_handle e)
+          {
+            const uint32_t dst = edges.dst_node[e.index];
+            if (remaining[dst].fetch_sub(1, std::memory_order_acq_rel) == 1 && live[dst] != 0)
+              push_node(pool, dst);
+          });
+        });
+      }
+
+      /// \brief Resolve a batch of nodes of the same kind, whose inputs have all been resolved
+      void resolve_batch(const pass_runner::batch& b, reporter& r)
+      {
+        const node_kind& kind = g.get_node_kinds()[b.kind];
+        batch_nodes.clear();
+        batch_ptrs.clear();
+        for (const uint32_t n : runner.get_batch_nodes(b))
+        {
+          if (!set_input_types(n))
+            continue;
+          set_structural_hash(n);
+          if (const std::shared_ptr<const compile_cache::entry> e = find_in_cache(n); e != nullptr && resolve_from_cache(n, *e))
+            continue;
+          batch_nodes.push_back(n);
+          batch_ptrs.push_back(&g.get_node({n}));
+        }
+
+        // each node logs in its own reporter, so that its logs are replayed together (as with a thread_pool)
+        const size_t resolved_count = batch_nodes.size();
+        if (batch_logs.size() < resolved_count)
+          batch_logs.resize(resolved_count);
+        batch_reporters.clear();
+        for (size_t i = 0; i < resolved_count; ++i)
+        {
+          batch_logs[i].set_buffering(true);
+          batch_reporters.push_back(&batch_logs[i]);
+        }
+
+        // only keep the nodes for which the step succeeded
+        const auto filter = [this]
+        {
+          size_t count = 0;
+          for (size_t i = 0; i < batch_nodes.size(); ++i)
+          {
+            if (batch_results[i] == 0)
+            {
+              states[batch_nodes[i]] = node_state::failed;
+              continue;
+            }
+            batch_nodes[count] = batch_nodes[i];
+            batch_ptrs[count] = batch_ptrs[i];
+            batch_reporters[count] = batch_reporters[i];
+            ++count;
+          }
+          batch_nodes.resize(count);
+          batch_ptrs.resize(count);
+          batch_reporters.resize(count);
+        };
+
+        batch_results.assign(batch_nodes.size(), 0);
+        kind.resolve_batch(batch_ptrs, batch_reporters, batch_results);
+        filter();
+        batch_results.assign(batch_nodes.size(), 0);
+        kind.validate_batch(batch_ptrs, batch_reporters, batch_results);
+        filter();
+        kind.const_generate_batch(batch_ptrs, batch_reporters, g.get_values());
+        for (size_t i = 0; i < resolved_count; ++i)
+          r.replay(batch_logs[i].take_buffer());
+
+        for (const uint32_t n : batch_nodes)
+        {
+          set_resolved(n);
+          compile_cache::entry e;
+          if (make_cache_entry(n, e))
+            cache->store(structural_hashes[n], std::move(e));
+        }
+      }
+
+      /// \brief Resolve a node whose inputs have all been resolved
+      /// The value table is shared by the tasks: it is only accessed under values_lock. The cache may read / write
+      /// its directory, so it is only accessed outside of the lock.
+      void resolve_node(uint32_t n, reporter& r)
+      {
+        if (!set_input_types(n))
+          return;
+        {
+          std::lock_guard<std::mutex> _l(values_lock);
+          set_structural_hash(n);
+        }
+        if (const std::shared_ptr<const compile_cache::entry> cached = find_in_cache(n); cached != nullptr)
+        {
+          std::lock_guard<std::mutex> _l(values_lock);
+          if (resolve_from_cache(n, *cached))
+            return;
+        }
+
+        base_node& node = g.get_node({n});
+        if (!node.resolve_output_types(r) || !node.validate(r))
+        {
+          states[n] = node_state::failed;
+          return;
+        }
+        compile_cache::entry e;
+        bool cacheable = false;
+        {
+          std::lock_guard<std::mutex> _l(values_lock);
+          node.const_generate(r, g.get_values());
+          set_resolved(n);
+          cacheable = make_cache_entry(n, e);
+        }
+        if (cacheable)
+          cache->store(structural_hashes[n], std::move(e));
+      }
+
+      /// \brief Return the entry of a node in the cache (nullptr if there is none, or no cache)
+      std::shared_ptr<const compile_cache::entry> find_in_cache(uint32_t n) const
+      {
+        return cache != nullptr && g.get_node({n}).is_cacheable() ? cache->find(structural_hashes[n]) : nullptr;
+      }
+
+      /// \brief Set the outputs of a node from its entry in the cache
+      /// \return true if the entry matches the node (which is now resolved)
+      bool resolve_from_cache(uint32_t n, const compile_cache::entry& e)
+      {
+        if (!compile_cache::apply_resolution(e, g.get_node({n}), g.get_values()))
+          return false;
+        set_resolved(n);
+        return true;
+      }
+
+      /// \brief Make the entry of a resolved node, to be stored in the cache
+      /// \return false if there is no cache or if the node cannot be cached
+      bool make_cache_entry(uint32_t n, compile_cache::entry& e) const
+      {
+        const base_node& node = g.get_node({n});
+        return cache != nullptr && node.is_cacheable() && compile_cache::make_resolution(node, g.get_values(), e);
+      }
+
+      /// \brief Set the types (and values) of the inputs of a node from its connections
+      /// \return false (and flag the node as skipped) if an input is connected to a node that is not resolved
+      bool set_input_types(uint32_t n)
+      {
+        const graph::edge_table& edges = g.get_edges();
+        base_node& node = g.get_node({n});
+
+        // unconnected inputs have no type, outputs have no value until const_generate() sets them:
+        span<pin_impl> inputs = node.get_input_impls();
+        for (pin_impl& it : inputs)
+        {
+          it.set_type(type::ref::zero);
+          it.set_value({});
+        }
+        for (pin_impl& it : node.get_output_impls())
+          it.set_value({});
+        for (uint32_t pin = 0; pin < inputs.size(); ++pin)
+        {
+          const uint32_t e = g.find_input_edge({n}, pin).index;
+          if (e == ~0u)
+            continue;
+          if (states[edges.src_node[e]] != node_state::resolved)
+          {
+            states[n] = node_state::skipped;
+            structural_hashes[n] = hash_t::zero;
+            return false;
+          }
+          // (the type of an edge connected after its source has been resolved is only set here)
+          const pin_impl& src_output = g.get_node({edges.src_node[e]}).get_output_impls()[edges.src_pin[e]];
+          g.set_edge_type({e}, src_output.get_type());
+          inputs[edges.dst_pin[e]].set_type(src_output.get_type());
+          inputs[edges.dst_pin[e]].set_value(src_output.get_value());
+        }
+        return true;
+      }
+
+      /// \brief Set the structural hash of a node whose input types are set (reads the value table)
+      void set_structural_hash(uint32_t n)
+      {
+        const graph::edge_table& edges = g.get_edges();
+        // the structural hashes of the inputs are combined with a sum, so that the order of the edges does not matter
+        uint64_t inputs_hash = 0;
+        g.for_each_input_edge({n}, [&](edge_handle it)
+        {
+          const uint32_t e = it.index;
+          const uint32_t link[] = {edges.src_pin[e], edges.dst_pin[e]};
+          const hash_t src_hash = structural_hashes[edges.src_node[e]];
+          inputs_hash += hash_bytes(hash_bytes(k_hash_seed, &src_hash, sizeof(src_hash)), link, sizeof(link));
+        });
+        const base_node& node = g.get_node({n});
+        hash_t h = compile_cache::hash_node(node, g.get_values(), inputs_hash, cache != nullptr ? cache->get_salt() : 0);
+        // the results of a node that is not cacheable may depend on a state it does not hash: once it is resolved,
+        // the hash of its outputs is part of its structural hash (so the nodes depending on it are keyed by what they see)
+        if (!node.is_cacheable() && states[n] == node_state::resolved)
+          h = static_cast<hash_t>(hash_bytes(static_cast<uint64_t>(h), &output_hashes[n], sizeof(output_hashes[n])));
+        structural_hashes[n] = h;
+      }
+
+      /// \brief Release the values that are not referenced by a pin anymore (the previous constants of the re-run nodes)
+      /// This is a scan of the whole graph, so it is only done when the table has doubled since the last time:
+      /// its cost is amortized over the values created by the updates.
+      void compact_values()
+      {
+        result.released_values = 0;
+        value_table& values = g.get_values();
+        const size_t count = values.get_count();
+        if (count < k_min_compaction_count || count < 2 * compacted_value_count)
+          return;
+
+        const auto for_each_pin = [this](auto&& fnc)
+        {
+          g.for_each_node([&fnc](node_handle, base_node& node)
+          {
+            for (pin_impl& it : node.get_input_impls())
+              fnc(it);
+            for (pin_impl& it : node.get_output_impls())
+              fnc(it);
+            for (param_impl& it : node.get_param_impls())
+              fnc(it);
+          });
+        };
+        keep_values.assign(count, 0);
+        for_each_pin([this, count](pin_impl& it)
+        {
+          if (it.get_value().is_valid() && it.get_value().get_index() < count)
+            keep_values[it.get_value().get_index()] = 1;
+        });
+        const std::vector<uint32_t> remap = values.compact(keep_values);
+        for_each_pin([&remap](pin_impl& it)
+        {
+          if (it.get_value().is_valid() && it.get_value().get_index() < remap.size())
+            it.set_value(value(remap[it.get_value().get_index()]));
+        });
+        compacted_value_count = values.get_count();
+        result.released_values = static_cast<uint32_t>(count - compacted_value_count);
+      }
+
+      /// \brief Flag a node as resolved and propagate its output types along its connections
+      void set_resolved(uint32_t n)
+      {
+        const graph::edge_table& edges = g.get_edges();
+        const base_node& node = g.get_node({n});
+        const value_table& values = g.get_values();
+        states[n] = node_state::resolved;
+
+        // the data of the output constants is part of the state seen by the nodes connected to the outputs:
+        span<const pin_impl> outputs = node.get_output_impls();
+        uint64_t h = node.get_output_state_hash();
+        for (const pin_impl& it : outputs)
+        {
+          if (!it.get_value().is_valid())
+            continue;
+          const span<const uint8_t> data = values.get_data(it.get_value());
+          h = hash_bytes(h, data.data(), data.size());
+        }
+        output_hashes[n] = h;
+        if (!node.is_cacheable())
+          set_structural_hash(n);
+
+        g.for_each_output_edge({n}, [&](edge_handle e) { g.set_edge_type(e, outputs[edges.src_pin[e.index]].get_type()); });
+      }
+
+      /// \brief Set the values of the inputs of a node from the outputs they are connected to (see generate)
+      void set_input_values(uint32_t n)
+      {
+        const graph::edge_table& edges = g.get_edges();
+        span<pin_impl> inputs = g.get_node({n}).get_input_impls();
+        g.for_each_input_edge({n}, [&](edge_handle e)
+        {
+          inputs[edges.dst_pin[e.index]].set_value(g.get_node({edges.src_node[e.index]}).get_output_impls()[edges.src_pin[e.index]].get_value());
+        });
+      }
+
+    private:
+      graph& g;
+
+      std::vector<uint32_t> topo; // every node that is not part of a cycle, in a topological order (patched by update())
+      std::vector<uint32_t> positions; // [node count] position in topo (k_no_position if part of a cycle)
+      mutable std::vector<uint32_t> order; // the live nodes of topo, in batch order (see get_order)
+      mutable pass_runner runner;
+      mutable bool order_stale = false; // topo has been patched since order has been built
+      std::vector<uint8_t> live; // [node count] 0 if the node does not contribute to any output node
+      bool has_output_nodes = false; // (when the order has been built)
+      uint32_t cycle_count = 0; // live nodes that are part of (or depend on) a cycle
+      uint64_t built_version = ~uint64_t(0); // topology version of the graph when the order was built / patched
+
+      // used by patch_topology():
+      std::vector<uint32_t> liveness_changes; // (also used by update())
+      std::vector<uint8_t> marks; // [node count]
+      std::vector<uint32_t> moved;
+      std::vector<uint32_t> forward;
+      std::vector<uint32_t> backward;
+      std::vector<uint32_t> slots;
+      std::vector<uint32_t> reorder_stack;
+
+      std::vector<node_state> states; // written by the task of the node, read by the tasks of the nodes depending on it
+      std::vector<uint64_t> output_hashes; // [node count] see base_node::get_output_state_hash
+      std::vector<hash_t> structural_hashes; // [node count] see compile_cache::hash_node
+      compile_cache* cache = nullptr;
+      std::vector<uint32_t> updated; // nodes that have been re-run by the last resolution
+      std::vector<uint8_t> queued; // [node count] used by update()
+      std::vector<uint8_t> keep_values; // used by compact_values()
+      size_t compacted_value_count = 0; // size of the value table after the last resolve() / compaction
+
+      // used by generate():
+      std::vector<compile_cache::entry> segments; // [node count] operations recorded by the last generation of the node
+      std::vector<uint8_t> segment_states; // [node count] k_not_generated, k_constant or k_recorded
+      generation_stats generation_result;
+
+      // used by resolve_batch():
+      std::vector<uint32_t> batch_nodes;
+      std::vector<base_node*> batch_ptrs;
+      std::vector<uint8_t> batch_results;
+      std::vector<reporter> batch_logs; // [biggest batch] buffering reporters, one per node of the batch
+      std::vector<reporter*> batch_reporters;
+
+      std::mutex values_lock; // see resolve_node()
+
+      std::unique_ptr<std::atomic<uint32_t>[]> remaining; // connections whose source has not been resolved yet
+      std::vector<std::vector<reporter::ser_log>> logs; // buffered logs of each node
+
+      stats result;
+  };
+} // namespace rukh
@@ -3,8 +3,25 @@
 
 #include "type.hpp"
 #include "type_db.hpp"
+#include "frozen_type_db.hpp"
+#include "concurrent_type_db.hpp"
+#include "value.hpp"
+#include "fold.hpp"
+#include "generator.hpp"
+#include "ir.hpp"
 #include "pin.hpp"
 #include "node.hpp"
+#include "node_kind.hpp"
+#include "graph.hpp"
+#include "pass_runner.hpp"
+#include "thread_pool.hpp"
+#include "compile_cache.hpp"
+#include "resolver.hpp"
+#include "range_analysis.hpp"
+#include "node_registry.hpp"
+#include "graph_image.hpp"
+#include "stream_loader.hpp"
+#include "permutation_compiler.hpp"
 
 namespace rukh
 {
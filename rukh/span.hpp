@@ -0,0 +1,80 @@
+//
+// file : span.hpp
+// in : file:///home/tim/projects/rukh/rukh/span.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:09:05 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace rukh
+{
+  /// \brief A non-owning view over contiguous objects (like C++20's std::span)
+  template<typename Type>
+  class span
+  {
+    public:
+      constexpr span() = default;
+      constexpr span(Type* _data, size_t _count) : ptr(_data), count(_count) {}
+
+      template<size_t Count>
+      constexpr span(Type (&array)[Count]) : ptr(array), count(Count) {}
+
+      template<typename Elem, size_t Count>
+      constexpr span(std::array<Elem, Count>& array) : ptr(array.data()), count(Count) {}
+
+      template<typename Elem, size_t Count>
+      constexpr span(const std::array<Elem, Count>& array) : ptr(array.data()), count(Count) {}
+
+      template<typename Elem>
+      span(std::vector<Elem>& vector) : ptr(vector.data()), count(vector.size()) {}
+
+      template<typename Elem>
+      span(const std::vector<Elem>& vector) : ptr(vector.data()), count(vector.size()) {}
+
+      constexpr Type* data() const { return ptr; }
+      constexpr size_t size() const { return count; }
+      constexpr bool empty() const { return count == 0; }
+
+      constexpr Type* begin() const { return ptr; }
+      constexpr Type* end() const { return ptr + count; }
+
+      constexpr Type& operator [] (size_t index) const { return ptr[index]; }
+
+      constexpr Type& front() const { return ptr[0]; }
+      constexpr Type& back() const { return ptr[count - 1]; }
+
+      /// \brief Return a part of the span
+      constexpr span subspan(size_t offset, size_t sub_count) const { return {ptr + offset, sub_count}; }
+
+    private:
+      Type* ptr = nullptr;
+      size_t count = 0;
+  };
+} // namespace rukh
@@ -0,0 +1,236 @@
+//
+// file : stream_loader.hpp
+// in : file:///home/tim/projects/rukh/rukh/stream_loader.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:33:33 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+#include "graph_image.hpp"
+#include "node_registry.hpp"
+#include "reporter.hpp"
+#include "resolver.hpp"
+
+namespace rukh
+{
+  /// \brief Load a graph_image chunk by chunk, resolving the nodes as soon as they are added
+  ///
+  /// graph_image::instantiate() creates the whole graph before the resolution can start. For big (generated) graphs,
+  /// the stream loader interleaves both: the node records of the image are in topological order, so once a chunk of
+  /// nodes has been created the inputs of each of its nodes are connected to nodes that have already been resolved.
+  /// Every node is then resolved right away (resolve_output_types(), validate() then const_generate()) and the pages
+  /// of the records of the chunk are handed back to the OS (when the image is mapped), so the memory used by the
+  /// image stays around the size of a chunk. (The graph itself still grows with the loaded nodes.)
+  ///
+  /// The resolution follows the same rules as the resolver: nodes with an input connected to a node that failed are
+  /// skipped, and the constants go in the value table of the graph. Dead nodes are not pruned (whether a node
+  /// contributes to an output node is only known once the nodes after it have been loaded). The nodes are left dirty, so a resolver
+  /// of the graph will resolve them again the next time it is used.
+  class stream_loader
+  {
+    public:
+      static constexpr uint32_t k_default_chunk_size = 16384;
+
+      using node_state = resolver::node_state;
+      using stats = resolver::stats;
+
+    public:
+      stream_loader(graph& _g, const node_registry& _registry, uint32_t _chunk_size = k_default_chunk_size)
+        : g(_g), registry(_registry), chunk_size(_chunk_size > 0 ? _chunk_size : 1)
+      {}
+
+      /// \brief Map an image file and load it
+      /// \return true if every node of the image has been added and resolved
+      bool load(const std::string& path, reporter& r)
+      {
+        std::optional<graph_image> image = graph_image::load_image(path, false);
+        if (!image)
+        {
+          r.log(reporter::severity_t::error, "stream_loader: cannot load '{}' (not a valid graph image)", path);
+          return false;
+        }
+        return load(*image, r);
+      }
+
+      /// \brief Add the nodes and connections of the image to the graph, resolving them chunk by chunk
+      /// The image must be in topological order (see graph_image::is_topological).
+      /// If a node kind is not in the registry, the loading stops there (the previous chunks stay in the graph).
+      /// \return true if every node of the image has been added and resolved
+      bool load(const graph_image& image, reporter& r);
+
+      /// \brief Return the counters of the last load
+      const stats& get_stats() const { return result; }
+
+      /// \brief Return the index of the first node added by the last load
+      uint32_t get_base() const { return base; }
+
+      /// \brief Return the number of chunks processed by the last load
+      uint32_t get_chunk_count() const { return chunk_count; }
+
+      /// \brief Return the state of a node added by the last load
+      node_state get_state(node_handle n) const { return states[n.index - base]; }
+
+    private:
+      /// \brief Connect the inputs of a node and resolve it
+      void resolve_node(const graph_image& image, uint32_t index, size_t& edge_cursor, reporter& r);
+
+    private:
+      graph& g;
+      const node_registry& registry;
+      const uint32_t chunk_size;
+
+      uint32_t base = 0;
+      uint32_t chunk_count = 0;
+      std::vector<node_state> states; // [node count of the image]
+      stats result;
+  };
+
+
+  // // // // //
+  // // // // //
+  // // // // //
+
+
+  inline bool stream_loader::load(const graph_image& image, reporter& r)
+  {
+    const span<const graph_image::node_record> nodes = image.get_nodes();
+    const span<const graph_image::edge_record> edges = image.get_edges();
+    const span<const graph_image::param_record> params = image.get_params();
+
+    base = static_cast<uint32_t>(g.get_node_count());
+    chunk_count = 0;
+    result = {};
+    states.assign(nodes.size(), node_state::pending);
+    if (!image.is_topological())
+    {
+      r.log(reporter::severity_t::error, "stream_loader: the graph image is not in topological order (the graph has a cycle)");
+      return false;
+    }
+
+    g.reserve(base + nodes.size(), g.get_edge_count() + edges.size());
+    bool success = true;
+    size_t edge_cursor = 0;
+    size_t param_end = 0;
+    const void* released_nodes = nodes.data();
+    const void* released_params = params.data();
+    const void* released_edges = edges.data();
+    for (uint32_t start = 0; start < nodes.size(); start += chunk_size)
+    {
+      const uint32_t end = static_cast<uint32_t>(std::min<size_t>(nodes.size(), size_t(start) + chunk_size));
+
+      // create the nodes of the chunk:
+      for (uint32_t i = start; i < end; ++i)
+      {
+        const node_registry::create_fnc create = registry.find(nodes[i].kind);
+        if (create == nullptr)
+        {
+          r.log(reporter::severity_t::error, "stream_loader: unknown node kind: '{}'", image.get_string(nodes[i].name));
+          return false;
+        }
+        image.add_node(g, create, nodes[i], r, success);
+        param_end = std::max<size_t>(param_end, std::min<size_t>(params.size(), size_t(nodes[i].first_param) + nodes[i].param_count));
+      }
+
+      // connect and resolve them (in order: their inputs are connected to previous nodes):
+      for (uint32_t i = start; i < end; ++i)
+      {
+        resolve_node(image, i, edge_cursor, r);
+        result.resolved += states[i] == node_state::resolved ? 1 : 0;
+        result.failed += states[i] == node_state::failed ? 1 : 0;
+        result.skipped += states[i] == node_state::skipped ? 1 : 0;
+      }
+
+      // the records of the chunk will not be read again:
+      released_nodes = image.release(released_nodes, nodes.data() + end);
+      released_params = image.release(released_params, params.data() + param_end);
+      released_edges = image.release(released_edges, edges.data() + edge_cursor);
+      ++chunk_count;
+    }
+    if (edge_cursor != edges.size())
+    {
+      r.log(reporter::severity_t::error, "stream_loader: {} connections of the graph image are not sorted by destination", edges.size() - edge_cursor);
+      success = false;
+    }
+    return success && result.resolved == nodes.size();
+  }
+
+  inline void stream_loader::resolve_node(const graph_image& image, uint32_t index, size_t& edge_cursor, reporter& r)
+  {
+    const span<const graph_image::edge_record> edges = image.get_edges();
+    const node_handle h = {base + index};
+    base_node& node = g.get_node(h);
+    span<pin_impl> inputs = node.get_input_impls();
+
+    bool skipped = false;
+    bool invalid = false;
+    for (; edge_cursor < edges.size() && edges[edge_cursor].dst_node == index; ++edge_cursor)
+    {
+      const graph_image::edge_record& rec = edges[edge_cursor];
+      if (rec.src_node >= index)
+      {
+        r.log(reporter::severity_t::error, "stream_loader: invalid connection (the graph image is not in topological order)");
+        invalid = true;
+        continue;
+      }
+      const edge_handle e = image.connect(g, base, rec, type::ref::zero, r);
+      if (!e.is_valid())
+      {
+        invalid = true;
+        continue;
+      }
+      if (states[rec.src_node] != node_state::resolved)
+      {
+        skipped = true;
+        continue;
+      }
+      const graph::edge_table& graph_edges = g.get_edges();
+      const pin_impl& output = g.get_node({base + rec.src_node}).get_output_impls()[graph_edges.src_pin[e.index]];
+      g.set_edge_type(e, output.get_type());
+      inputs[graph_edges.dst_pin[e.index]].set_type(output.get_type());
+      inputs[graph_edges.dst_pin[e.index]].set_value(output.get_value());
+    }
+
+    if (invalid || skipped)
+    {
+      states[index] = invalid ? node_state::failed : node_state::skipped;
+      return;
+    }
+    if (!node.resolve_output_types(r) || !node.validate(r))
+    {
+      states[index] = node_state::failed;
+      return;
+    }
+    node.const_generate(r, g.get_values());
+    states[index] = node_state::resolved;
+  }
+} // namespace rukh
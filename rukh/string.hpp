@@ -29,6 +29,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <tools/hash/fnv1a.hpp>
 #include <tools/ct_list.hpp>
 #include <tools/embed.hpp>
@@ -42,6 +45,18 @@ namespace rukh
 
   inline constexpr bool operator < (hash_t a, hash_t b) { return static_cast<uint64_t>(a) < static_cast<uint64_t>(b); }
 
+  /// \brief Initial value of a hash computed with hash_bytes
+  inline constexpr uint64_t k_hash_seed = 0xcbf29ce484222325ull;
+
+  /// \brief Combine bytes in a hash (FNV-1a)
+  inline uint64_t hash_bytes(uint64_t h, const void* data, size_t size)
+  {
+    const uint8_t* const bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+      h = (h ^ bytes[i]) * 0x100000001b3ull;
+    return h;
+  }
+
   /// \brief Compile-time string
   template<typename Type, Type... Chs>
   struct ct_string
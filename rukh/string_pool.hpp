@@ -0,0 +1,147 @@
+//
+// file : string_pool.hpp
+// in : file:///home/tim/projects/rukh/rukh/string_pool.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:00:21 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "string.hpp"
+#include "hash_table.hpp"
+
+namespace rukh
+{
+  /// \brief Hash a runtime string (same hash as rk_str(...)::hash)
+  inline hash_t hash_string(const std::string_view& sv)
+  {
+    return static_cast<hash_t>(neam::ct::hash::fnv1a<64>((const uint8_t*)sv.data(), sv.size()));
+  }
+
+  /// \brief Handle to a string interned in a string_pool
+  /// It carries the precomputed hash of the string (like ct_string::hash does for compile-time strings),
+  /// so it can be used in place of the string in hot paths without hashing it again.
+  struct interned_string
+  {
+    hash_t hash = hash_t::zero;
+    uint32_t index = ~0u; // index in the pool
+
+    bool is_valid() const { return index != ~0u; }
+
+    bool operator == (const interned_string& o) const { return hash == o.hash && index == o.index; }
+    bool operator != (const interned_string& o) const { return !(*this == o); }
+  };
+
+  /// \brief Intern runtime strings (member names, pin names, ... loaded from user graphs)
+  /// Each distinct string is hashed and copied once. Strings are stored in chunks and are never moved or freed
+  /// before the pool is destroyed: string_views returned by the pool can be kept around (in a pin_rt for instance).
+  /// \note Strings are null terminated
+  class string_pool
+  {
+    public:
+      string_pool() = default;
+      string_pool(string_pool&&) = default;
+      string_pool& operator = (string_pool&&) = default;
+
+      /// \brief Intern a string (or return the existing handle if the string has already been interned)
+      interned_string intern(const std::string_view& sv)
+      {
+        const hash_t hash = hash_string(sv);
+        if (const uint32_t* index = indices.find(hash); index != nullptr)
+        {
+          // NOTE: In case of a hash collision between two different strings, the second string is still stored
+          //       (but is not findable). Everything else in rukh uses the hash as the identity of names anyway.
+          if (strings[*index] == sv)
+            return {hash, *index};
+        }
+
+        const uint32_t index = static_cast<uint32_t>(strings.size());
+        strings.push_back(store(sv));
+        indices.insert(hash, index);
+        return {hash, index};
+      }
+
+      /// \brief Return the handle of an already-interned string (or an invalid handle, with the hash of the string)
+      interned_string find(const std::string_view& sv) const
+      {
+        const hash_t hash = hash_string(sv);
+        if (const uint32_t* index = indices.find(hash); index != nullptr && strings[*index] == sv)
+          return {hash, *index};
+        return {hash, ~0u};
+      }
+
+      /// \brief Return the string of a handle (an empty string for invalid handles)
+      std::string_view get(const interned_string& handle) const
+      {
+        if (handle.index >= strings.size())
+          return {};
+        return strings[handle.index];
+      }
+
+      /// \brief Return the number of strings in the pool
+      size_t size() const { return strings.size(); }
+
+    private:
+      static constexpr size_t k_chunk_size = 64 * 1024;
+
+      std::string_view store(const std::string_view& sv)
+      {
+        const size_t size = sv.size() + 1;
+        char* dest = nullptr;
+        if (size > k_chunk_size / 4)
+        {
+          // big strings get their own allocation
+          big_strings.push_back(std::make_unique<char[]>(size));
+          dest = big_strings.back().get();
+        }
+        else
+        {
+          if (chunks.empty() || chunk_offset + size > k_chunk_size)
+          {
+            chunks.push_back(std::make_unique<char[]>(k_chunk_size));
+            chunk_offset = 0;
+          }
+          dest = chunks.back().get() + chunk_offset;
+          chunk_offset += size;
+        }
+        memcpy(dest, sv.data(), sv.size());
+        dest[sv.size()] = 0;
+        return {dest, sv.size()};
+      }
+
+    private:
+      std::vector<std::unique_ptr<char[]>> chunks;
+      std::vector<std::unique_ptr<char[]>> big_strings;
+      size_t chunk_offset = 0;
+
+      std::vector<std::string_view> strings;
+      hash_table<uint32_t> indices;
+  };
+} // namespace rukh
@@ -0,0 +1,206 @@
+//
+// file : swizzle.hpp
+// in : file:///home/tim/projects/rukh/rukh/swizzle.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 22:59:00 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "string.hpp"
+
+namespace rukh
+{
+  /// \brief Built-in swizzling support (xyzw / rgba, 1 to 4 components)
+  ///
+  /// Every valid swizzle name is hashed at compile-time (with the same hash as rk_str) and stored in a
+  /// perfect hash table (hash and displace): resolving a swizzle from a member-name hash is a single probe.
+  namespace swizzle
+  {
+    /// \brief A swizzle
+    struct entry
+    {
+      hash_t key = hash_t::zero;
+      uint8_t length = 0; // number of components of the result
+      uint8_t required_dim = 0; // minimum dimension of the source vector
+      uint8_t components = 0; // source component index, 2 bits per component (first component in the low bits)
+
+      /// \brief Return the source component index of the nth component of the result
+      constexpr unsigned get_component(unsigned n) const { return (components >> (2 * n)) & 3; }
+    };
+
+    // table parameters:
+    constexpr size_t k_entry_count = 2 * (4 + 4 * 4 + 4 * 4 * 4 + 4 * 4 * 4 * 4);
+    constexpr unsigned k_bucket_bits = 8;
+    constexpr unsigned k_slot_bits = 10;
+
+    struct table_t
+    {
+      std::array<entry, size_t(1) << k_slot_bits> slots = {};
+      std::array<uint16_t, size_t(1) << k_bucket_bits> seeds = {};
+      size_t count = 0; // number of entries that have been inserted
+    };
+
+    // // // // //
+
+    /// \brief Generate the hash of a swizzle (using a rukh::ct_string so it is the same as rk_str)
+    template<bool Rgba, size_t Combination, size_t... Pos>
+    constexpr hash_t make_hash(std::index_sequence<Pos...>)
+    {
+      return ct_string<char, (Rgba ? "rgba" : "xyzw")[(Combination >> (2 * Pos)) & 3]...>::hash;
+    }
+
+    template<bool Rgba, size_t Length, size_t Combination>
+    constexpr entry make_entry()
+    {
+      entry e;
+      e.key = make_hash<Rgba, Combination>(std::make_index_sequence<Length>{});
+      e.length = static_cast<uint8_t>(Length);
+      e.components = static_cast<uint8_t>(Combination);
+      for (unsigned i = 0; i < Length; ++i)
+      {
+        if (e.get_component(i) + 1u > e.required_dim)
+          e.required_dim = static_cast<uint8_t>(e.get_component(i) + 1);
+      }
+      return e;
+    }
+
+    template<bool Rgba, size_t Length, size_t... Combinations>
+    constexpr void fill_entries(std::array<entry, k_entry_count>& entries, size_t& at, std::index_sequence<Combinations...>)
+    {
+      ((entries[at++] = make_entry<Rgba, Length, Combinations>()), ...);
+    }
+
+    constexpr std::array<entry, k_entry_count> make_entries()
+    {
+      std::array<entry, k_entry_count> entries = {};
+      size_t at = 0;
+      fill_entries<false, 1>(entries, at, std::make_index_sequence<4>{});
+      fill_entries<false, 2>(entries, at, std::make_index_sequence<4 * 4>{});
+      fill_entries<false, 3>(entries, at, std::make_index_sequence<4 * 4 * 4>{});
+      fill_entries<false, 4>(entries, at, std::make_index_sequence<4 * 4 * 4 * 4>{});
+      fill_entries<true, 1>(entries, at, std::make_index_sequence<4>{});
+      fill_entries<true, 2>(entries, at, std::make_index_sequence<4 * 4>{});
+      fill_entries<true, 3>(entries, at, std::make_index_sequence<4 * 4 * 4>{});
+      fill_entries<true, 4>(entries, at, std::make_index_sequence<4 * 4 * 4 * 4>{});
+      return entries;
+    }
+
+    constexpr size_t bucket_of(hash_t key)
+    {
+      return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> (64 - k_bucket_bits));
+    }
+
+    constexpr size_t slot_of(hash_t key, uint16_t seed)
+    {
+      const uint64_t h = (static_cast<uint64_t>(key) ^ (seed * 0xC2B2AE3D27D4EB4Full)) * 0x165667B19E3779F9ull;
+      return static_cast<size_t>(h >> (64 - k_slot_bits));
+    }
+
+    /// \brief Build the perfect hash table: buckets are placed from the biggest to the smallest,
+    /// each one with the first seed that makes all of its entries land in free slots.
+    constexpr table_t build_table()
+    {
+      constexpr size_t bucket_count = size_t(1) << k_bucket_bits;
+      const std::array<entry, k_entry_count> entries = make_entries();
+
+      // sort the entries by bucket:
+      std::array<uint16_t, bucket_count + 1> bucket_start = {};
+      for (const entry& e : entries)
+        ++bucket_start[bucket_of(e.key) + 1];
+      size_t max_bucket_size = 0;
+      for (size_t b = 0; b < bucket_count; ++b)
+      {
+        max_bucket_size = bucket_start[b + 1] > max_bucket_size ? bucket_start[b + 1] : max_bucket_size;
+        bucket_start[b + 1] += bucket_start[b];
+      }
+      std::array<uint16_t, k_entry_count> order = {};
+      std::array<uint16_t, bucket_count> fill = {};
+      for (size_t i = 0; i < k_entry_count; ++i)
+      {
+        const size_t b = bucket_of(entries[i].key);
+        order[bucket_start[b] + fill[b]++] = static_cast<uint16_t>(i);
+      }
+
+      table_t table = {};
+      for (size_t size = max_bucket_size; size > 0; --size)
+      {
+        for (size_t b = 0; b < bucket_count; ++b)
+        {
+          if (size_t(bucket_start[b + 1] - bucket_start[b]) != size)
+            continue;
+
+          for (uint32_t seed = 0; seed < 0xFFFF; ++seed)
+          {
+            bool ok = true;
+            for (size_t i = bucket_start[b]; ok && i < bucket_start[b + 1]; ++i)
+            {
+              const size_t slot = slot_of(entries[order[i]].key, static_cast<uint16_t>(seed));
+              ok = table.slots[slot].key == hash_t::zero;
+              // also check against the other entries of the same bucket
+              for (size_t j = bucket_start[b]; ok && j < i; ++j)
+                ok = slot_of(entries[order[j]].key, static_cast<uint16_t>(seed)) != slot;
+            }
+            if (!ok)
+              continue;
+
+            table.seeds[b] = static_cast<uint16_t>(seed);
+            for (size_t i = bucket_start[b]; i < bucket_start[b + 1]; ++i)
+            {
+              table.slots[slot_of(entries[order[i]].key, static_cast<uint16_t>(seed))] = entries[order[i]];
+              ++table.count;
+            }
+            break;
+          }
+        }
+      }
+      return table;
+    }
+
+    inline constexpr table_t table = build_table();
+    static_assert(table.count == k_entry_count, "rukh::swizzle: failed to build the perfect hash table (hash collision ?)");
+
+    // // // // //
+
+    /// \brief Return the swizzle of a given member-name hash, or nullptr if the name is not a swizzle
+    constexpr const entry* find(hash_t key)
+    {
+      const entry& e = table.slots[slot_of(key, table.seeds[bucket_of(key)])];
+      return (e.key == key && key != hash_t::zero) ? &e : nullptr;
+    }
+
+    /// \brief Return the swizzle of a given member-name hash if it is valid for a vector of dimension \p dim, or nullptr
+    constexpr const entry* find(hash_t key, size_t dim)
+    {
+      const entry* e = find(key);
+      return (e != nullptr && e->required_dim <= dim) ? e : nullptr;
+    }
+  } // namespace swizzle
+} // namespace rukh
@@ -0,0 +1,204 @@
+//
+// file : thread_pool.hpp
+// in : file:///home/tim/projects/rukh/rukh/thread_pool.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 23:11:39 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rukh
+{
+  /// \brief A work-stealing thread pool
+  ///
+  /// Each worker has its own task queue: tasks pushed from a worker go to its own queue (and are run LIFO, while
+  /// the data they use is still hot in the cache) and idle workers steal tasks from the other queues (FIFO).
+  /// Tasks pushed from outside the pool go to a shared queue.
+  ///
+  /// wait() makes the calling thread help running the tasks until every task pushed has been run.
+  /// A pool with 0 threads is valid: every task is then run by the thread calling wait().
+  class thread_pool
+  {
+    public:
+      using task = std::function<void()>;
+
+    public:
+      explicit thread_pool(unsigned thread_count = std::thread::hardware_concurrency())
+      {
+        // the last queue is for the tasks pushed from outside of the workers (and is used by the thread calling wait())
+        for (unsigned i = 0; i <= thread_count; ++i)
+          queues.push_back(std::make_unique<task_queue>());
+        threads.reserve(thread_count);
+        for (unsigned i = 0; i < thread_count; ++i)
+          threads.emplace_back([this, i] { worker_loop(i); });
+      }
+
+      ~thread_pool()
+      {
+        {
+          std::lock_guard<std::mutex> _l(sleep_lock);
+          stop = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads)
+          t.join();
+      }
+
+      thread_pool(const thread_pool&) = delete;
+      thread_pool& operator = (const thread_pool&) = delete;
+
+      /// \brief Return the number of worker threads
+      unsigned get_thread_count() const { return static_cast<unsigned>(threads.size()); }
+
+      /// \brief Push a task. Can be called from any thread (including from a task)
+      void push(task&& t)
+      {
+        pending.fetch_add(1, std::memory_order_acq_rel);
+        const unsigned q = current_pool == this ? current_queue : external_queue();
+        {
+          std::lock_guard<std::mutex> _l(queues[q]->lock);
+          queues[q]->tasks.push_back(std::move(t));
+        }
+        queued.fetch_add(1, std::memory_order_acq_rel);
+        {
+          std::lock_guard<std::mutex> _l(sleep_lock);
+        }
+        wake.notify_one();
+      }
+
+      /// \brief Run tasks until every task that has been pushed has been run
+      /// \warning Must not be called from a task
+      void wait()
+      {
+        thread_pool* const previous_pool = current_pool;
+        const unsigned previous_queue = current_queue;
+        current_pool = this;
+        current_queue = external_queue();
+
+        while (pending.load(std::memory_order_acquire) > 0)
+        {
+          if (run_one(external_queue()))
+            continue;
+          std::unique_lock<std::mutex> l(sleep_lock);
+          wake.wait(l, [this]
+          {
+            return pending.load(std::memory_order_acquire) == 0 || queued.load(std::memory_order_acquire) > 0;
+          });
+        }
+
+        current_pool = previous_pool;
+        current_queue = previous_queue;
+      }
+
+    private:
+      struct task_queue
+      {
+        std::mutex lock;
+        std::deque<task> tasks;
+      };
+
+      unsigned external_queue() const { return static_cast<unsigned>(queues.size() - 1); }
+
+      /// \brief Run a task from the queue \p self, or stolen from another queue
+      bool run_one(unsigned self)
+      {
+        task t;
+        bool found = false;
+        {
+          task_queue& q = *queues[self];
+          std::lock_guard<std::mutex> _l(q.lock);
+          if (!q.tasks.empty())
+          {
+            t = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            found = true;
+          }
+        }
+        for (size_t i = 1; !found && i < queues.size(); ++i)
+        {
+          task_queue& q = *queues[(self + i) % queues.size()];
+          std::lock_guard<std::mutex> _l(q.lock);
+          if (!q.tasks.empty())
+          {
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            found = true;
+          }
+        }
+        if (!found)
+          return false;
+
+        queued.fetch_sub(1, std::memory_order_acq_rel);
+        t();
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          // wake-up the threads waiting for the completion
+          {
+            std::lock_guard<std::mutex> _l(sleep_lock);
+          }
+          wake.notify_all();
+        }
+        return true;
+      }
+
+      void worker_loop(unsigned index)
+      {
+        current_pool = this;
+        current_queue = index;
+        for (;;)
+        {
+          if (run_one(index))
+            continue;
+          std::unique_lock<std::mutex> l(sleep_lock);
+          wake.wait(l, [this] { return stop || queued.load(std::memory_order_acquire) > 0; });
+          if (stop && queued.load(std::memory_order_acquire) == 0)
+            return;
+        }
+      }
+
+    private:
+      std::vector<std::unique_ptr<task_queue>> queues; // [thread_count + 1]
+      std::vector<std::thread> threads;
+
+      std::atomic<size_t> pending = {0}; // pushed but not yet run (or currently running)
+      std::atomic<size_t> queued = {0}; // in a queue
+
+      std::mutex sleep_lock;
+      std::condition_variable wake;
+      bool stop = false;
+
+      static inline thread_local thread_pool* current_pool = nullptr;
+      static inline thread_local unsigned current_queue = 0;
+  };
+} // namespace rukh
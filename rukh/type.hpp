@@ -38,6 +38,9 @@
 #include <vector>
 
 #include "string.hpp"
+#include "string_pool.hpp"
+#include "swizzle.hpp"
+#include "type_set.hpp"
 
 
 namespace rukh
@@ -52,6 +55,7 @@ namespace rukh
   /// member access, or swizzling.
   ///
   /// \note Some functions of the class are implemented in type_db.hpp (because of the dependency with type_db)
+  /// \note The member, cast and resolution queries are shared with frozen_type (see type_queries.hpp)
   class type
   {
     public:
@@ -102,7 +106,12 @@ namespace rukh
         // NOTE: you can have meta-types as members
 
         std::map<hash_t, type::ref> members = {}; // hash -> type::ref for "static" members
-        std::function<type::ref(hash_t)> members_getter = {}; // "dynamic" members (swizzling, ...). Return type::ref::zero when not existing.
+        std::function<type::ref(hash_t)> members_getter = {}; // "dynamic" members. Return type::ref::zero when not existing.
+
+        // swizzling: (for vector-like types, see swizzle.hpp)
+        // every xyzw / rgba swizzle using at most the first `dim` components is a member of the type,
+        // swizzle_types[n] being the type of the swizzles with n + 1 components (type::ref::zero to disable them)
+        std::array<type::ref, 4> swizzle_types = {};
 
         // sub-types: (for meta types)
         // NOTE: you should only use either subtypes or subtypes_getter
@@ -119,6 +128,10 @@ namespace rukh
         // destruct: (if not specified, will only destruct members. If there's not members, nothing will be done)
         // will be called to generate IR at the end of the lifecycle of the object
         std::function<bool(/*, TODO: IR-GEN + validate */)> destruct = {};
+
+        // name of the callable fields above when the type is saved into / loaded from a type image (see hook_registry)
+        // If zero, the type_id is used.
+        hash_t hooks_name = hash_t::zero;
       };
 
   public:
@@ -126,9 +139,13 @@ namespace rukh
       type::ref get_ref() const { return def.type_id; }
 
       /// \brief Return whether or not a type can be implicitly casted into another
+      /// (directly or through a chain of implicit casts)
+      /// \note This is a lookup in the cast matrix of the type_db (see type_db::get_cast)
       bool can_implicit_cast(const type& other) const;
 
-      /// \brief Return whether or not a type can be casted into another with precision loss
+      /// \brief Return whether or not a type can be casted into another without precision loss
+      /// (directly or through a chain of lossless casts)
+      /// \note This is a lookup in the cast matrix of the type_db (see type_db::get_cast)
       bool can_lossless_cast(const type& other) const;
 
       /// \brief Check that the members are all of known types.
@@ -137,6 +154,7 @@ namespace rukh
       ///
       /// Invalid types cannot be resolved nor instanciated.
       /// Most functions will not work when dealing with non valid types.
+      /// \note The result is cached by the type_db (see type_db::get_properties)
       bool is_valid() const;
 
       /// \brief Whether or not a type is a primitive number (integer or floating point)
@@ -154,20 +172,13 @@ namespace rukh
 
       /// \brief Whether or not a type is a concrete type ('explicit' type) and
       /// each one of its members is also a fully concrete type
-      bool is_fully_concrete() const
-      {
-        if (!is_concrete())
-          return false;
-        if (def.is_dim_valid_for)
-          return false;
-        // TODO: check members
-        return true;
-      }
+      bool is_fully_concrete() const;
 
       /// \brief Return the size (in bytes) of the type (including its members).
       /// Return 0 if the type does not have a size (like a meta type)
       /// \note This size will not contain meaningful information if the type is not
       /// a fully concrete type
+      /// \note The result is cached by the type_db (see type_db::get_properties)
       size_t size() const;
 
       /// \brief Return whether or not the type has the specified member
@@ -175,31 +186,48 @@ namespace rukh
       template<typename String>
       bool has_member() const
       {
-        if (const auto it = def.members.find(String::hash); it != def.members.end())
-          return true;
-        if (def.members_getter)
-          return def.members_getter(String::hash) != ref::zero;
-        return false;
+        return has_member(String::hash);
       }
 
       /// \brief Return whether or not the type has the specified member
       /// \warning must not be used for string literals. Only for runtime-strings.
+      /// \note This hashes the string. Prefer the interned_string version when the name is used more than once.
       bool has_member(const std::string_view& sv) const
       {
-        const hash_t hash = (hash_t)neam::ct::hash::fnv1a<64>((const uint8_t*)sv.data(), sv.size());
-        if (const auto it = def.members.find(hash); it != def.members.end())
-          return true;
-        if (def.members_getter)
-          return def.members_getter(hash) != ref::zero;
-        return false;
+        return has_member(hash_string(sv));
+      }
+
+      /// \brief Return whether or not the type has the specified member
+      /// \param name a string interned in a string_pool (its hash is precomputed)
+      bool has_member(const interned_string& name) const
+      {
+        return has_member(name.hash);
       }
 
+      /// \brief Return whether or not the type has the specified member
+      /// \param name the hash of the member name (as given by rk_str("my-member")::hash or interned_string::hash)
+      bool has_member(hash_t name) const;
+
+      /// \brief Return the swizzle for a member name hash, or nullptr if it is not a valid swizzle for the type
+      /// (see definition::swizzle_types)
+      const swizzle::entry* get_swizzle(hash_t name) const;
+
       /// \brief Return whether or not a given type is a valid resolution for the current type
       /// Non-meta-types only accept themselves as resolution
       /// Meta-types will accept matching types as resolution
       /// \note meta-types can also accept partial resolutions
+      /// \note The result is cached by the type_db (see type_db::get_resolution_cache_stats)
       bool is_valid_resolution(const type& t) const;
 
+      /// \brief Return the set of concrete types accepted by the type (see type_db::get_accepted_types)
+      /// Intersection / inclusion of meta-types can be done with the returned sets
+      /// \warning The reference is only valid until the next definition is added to the type_db
+      const type_set& get_accepted_types() const;
+
+      /// \brief Return whether or not a concrete type is accepted by the current type
+      /// (the type itself for concrete types, the matching types for meta-types)
+      bool accepts(const type& t) const;
+
       /// \brief Return the member type (or the special none type if none found)
       /// \tparam String must be a string as provided by rk_str("my-member")
       template<typename String>
@@ -207,8 +235,17 @@ namespace rukh
 
       /// \brief Return the member type (or the special none type if none found)
       /// \warning must not be used for string literals. Only for runtime-strings.
+      /// \note This hashes the string. Prefer the interned_string version when the name is used more than once.
       type get_member_type(const std::string_view& sv) const;
 
+      /// \brief Return the member type (or the special none type if none found)
+      /// \param name a string interned in a string_pool (its hash is precomputed)
+      type get_member_type(const interned_string& name) const;
+
+      /// \brief Return the member type (or the special none type if none found)
+      /// \param name the hash of the member name (as given by rk_str("my-member")::hash or interned_string::hash)
+      type get_member_type(hash_t name) const;
+
       const type_db &tdb;
       const definition &def;
   };
@@ -237,4 +274,9 @@ namespace rukh
     a = static_cast<type::cast_type>(static_cast<ut>(a) & static_cast<ut>(b));
     return a;
   }
+  inline constexpr type::cast_type operator ~ (type::cast_type a)
+  {
+    using ut = typename std::underlying_type_t<type::cast_type>;
+    return static_cast<type::cast_type>(~static_cast<ut>(a));
+  }
 } // namespace rukh
@@ -28,25 +28,107 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 
 #include "type.hpp"
+#include "cast_matrix.hpp"
 #include "type_identity.hpp"
+#include "type_queries.hpp"
+#include "hash_table.hpp"
 
 namespace rukh
 {
+  class frozen_type_db;
+
+  /// \brief An ordered pair of type::ref (used as key in hash tables)
+  struct type_ref_pair
+  {
+    type::ref first;
+    type::ref second;
+
+    constexpr bool operator == (const type_ref_pair& o) const { return first == o.first && second == o.second; }
+    constexpr bool operator != (const type_ref_pair& o) const { return !(*this == o); }
+  };
+
+  template<>
+  struct hash_table_key<type_ref_pair>
+  {
+    static constexpr uint64_t hash(const type_ref_pair& k)
+    {
+      const uint64_t a = static_cast<uint64_t>(k.first);
+      const uint64_t b = static_cast<uint64_t>(k.second);
+      // rotate one of the two so that (a, b) and (b, a) don't end-up in the same slot
+      return a ^ ((b << 31) | (b >> 33));
+    }
+  };
+
   /// \brief Hold types definitions
+  /// Definitions are stored in a deque (so references to them are stable and types stay valid)
+  /// and indexed by a flat hash table keyed on the type::ref (which is already a hash)
+  ///
+  /// The derived properties, accepted types, casts and resolutions are lazily computed for the queried types only,
+  /// and invalidated when a definition is added. For the compile hot path, freeze() creates a compact snapshot.
+  ///
+  /// \note Queries are thread-safe: the lazily filled caches are guarded by shared mutexes (the caches are only
+  ///       locked exclusively when they are filled). So once the DB stops changing it can be queried from
+  ///       multiple threads (for instance by the workers of a resolver, see thread_pool).
+  /// \warning Adding definitions is not thread-safe, and must not be done while the DB is queried.
+  ///          (see concurrent_type_db for a DB that can be modified while being used)
   class type_db
   {
     public:
+      /// \brief Properties of a type that are derived from its definition and the definitions of its members
+      /// They are computed once and cached until the next definition is added to the DB
+      struct properties
+      {
+        size_t size = 0;
+        bool valid = false;
+        bool fully_concrete = false;
+      };
+
+      /// \brief Returned by get_concrete_index for non-concrete types
+      static constexpr uint32_t k_not_concrete = ~uint32_t(0);
+
+      /// \brief Hit / miss counters of the type::is_valid_resolution cache
+      struct resolution_cache_stats
+      {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+      };
+
+    public:
+      type_db()
+      {
+        definitions.push_back(
+        {
+          type::ref::zero,
+          "none",
+          0, // size
+          0, // dim
+          {}, // dim getter
+          false, // concrete
+        });
+        indices.insert(rukh_str_hash("none"), 0);
+        concrete_indices.push_back(k_not_concrete);
+        cache.emplace_back();
+        type_sets.emplace_back();
+      }
+
       /// \brief Add a new definition to the type DB
       /// \return whether or not the type has been added or not
       /// Reason for not adding a type definition is: conflict
       bool add_definition(type::definition&& def)
       {
-        const auto [it, inserted] = definitions.emplace(def.type_id, std::move(def));
-        (void)it;
-        return inserted;
+        if (!can_add(def.type_id))
+          return false;
+        definitions.push_back(std::move(def));
+        register_last_definition();
+        return true;
       }
 
       /// \brief Add a new definition to the type DB
@@ -54,42 +136,422 @@ namespace rukh
       /// Reason for not adding a type definition is: conflict
       bool add_definition(const type::definition& def)
       {
-        const auto [it, inserted] = definitions.emplace(def.type_id, def);
-        (void)it;
-        return inserted;
+        if (!can_add(def.type_id))
+          return false;
+        definitions.push_back(def);
+        register_last_definition();
+        return true;
       }
 
       /// \brief Return the type for a given type::ref or a spacial none type
       type get_type(type::ref id) const
       {
-        if (const auto it = definitions.find(id); it != definitions.end())
-          return {*this, it->second};
-        return {*this, none};
+        if (const uint32_t* index = indices.find(id); index != nullptr)
+          return {*this, definitions[*index]};
+        return get_none();
       }
 
       /// \brief Return the special "none" type
       type get_none() const
       {
-        return {*this, none};
+        return {*this, definitions.front()};
+      }
+
+      /// \brief Return the number of definitions in the DB (including the none type)
+      size_t size() const { return definitions.size(); }
+
+      /// \brief Return the current epoch of the DB. The epoch changes every time a definition is added.
+      uint64_t get_epoch() const { return epoch; }
+
+      /// \brief Return the derived properties of a type (validity, size, ...)
+      /// The first call after a change in the DB will compute them (recursively for the members),
+      /// subsequent calls are O(1).
+      properties get_properties(const type::definition& def) const
+      {
+        const uint32_t index = index_of(def);
+        {
+          std::shared_lock<std::shared_mutex> _l(sync.cache_lock);
+          if (cache[index].epoch == epoch)
+            return cache[index].props;
+        }
+        std::lock_guard<std::shared_mutex> _l(sync.cache_lock);
+        return compute_properties(index);
+      }
+
+      /// \brief Return the number of concrete types in the DB
+      size_t get_concrete_count() const { return concrete_types.size(); }
+
+      /// \brief Return the dense index of a concrete type (in [0, get_concrete_count()[), or k_not_concrete
+      /// Concrete indices are stable and are the bit indices used in type_set
+      uint32_t get_concrete_index(type::ref id) const
+      {
+        return concrete_indices[index_of(id)];
+      }
+
+      /// \brief Return the concrete type of a given dense index (see get_concrete_index)
+      type get_concrete_type(uint32_t concrete_index) const
+      {
+        if (concrete_index >= concrete_types.size())
+          return get_none();
+        return {*this, definitions[concrete_types[concrete_index]]};
+      }
+
+      /// \brief Return the set of concrete types accepted by a type
+      /// For a concrete type this is only the type itself, for a meta-type this is every concrete type in its subtypes,
+      /// every concrete type accepted by the meta-types in its subtypes, and every concrete type for which subtypes_getter returns true.
+      /// The set is lazily built (and subtypes_getter is only called once for a given meta-type / concrete-type pair).
+      /// \warning The reference is only valid until the next definition is added to the DB
+      /// \warning subtypes_getter is called while the caches are locked: it must not query the derived properties,
+      ///          the accepted types or the casts of the DB (looking-up definitions with get_type is fine)
+      const type_set& get_accepted_types(const type::definition& def) const
+      {
+        const uint32_t index = index_of(def);
+        {
+          std::shared_lock<std::shared_mutex> _l(sync.cache_lock);
+          if (type_sets[index].epoch == epoch)
+            return type_sets[index].set;
+        }
+        std::lock_guard<std::shared_mutex> _l(sync.cache_lock);
+        return compute_accepted_types(index);
+      }
+
+      /// \brief Return whether or not a type is a meta-type that accepts a given concrete type (or the type itself)
+      bool accepts(const type::definition& def, type::ref concrete_type) const
+      {
+        const uint32_t concrete_index = get_concrete_index(concrete_type);
+        if (concrete_index == k_not_concrete)
+          return false;
+        return get_accepted_types(def).test(concrete_index);
+      }
+
+      /// \brief Return the best chain of casts from a type to another (see cast_matrix)
+      /// The transitive closure of the casts is computed (incrementally) on the first call after a change in the DB,
+      /// subsequent calls are O(1).
+      cast_info get_cast(type::ref from, type::ref to) const
+      {
+        if (from == to)
+          return cast_info::identity();
+        std::shared_lock<std::shared_mutex> _l(sync.cache_lock);
+        if (casts_epoch != epoch)
+        {
+          _l.unlock();
+          {
+            std::lock_guard<std::shared_mutex> _ul(sync.cache_lock);
+            update_casts();
+          }
+          _l.lock();
+        }
+        const uint32_t from_index = casts.get_cast_index(index_of(from));
+        const uint32_t to_index = casts.get_cast_index(index_of(to));
+        if (from_index == cast_matrix::k_no_index || to_index == cast_matrix::k_no_index)
+          return {};
+        return casts.get(from_index, to_index);
+      }
+
+      /// \brief Return the cheapest candidate parameter list for the given argument types
+      /// Exact matches cost nothing, arguments accepted by a meta-type parameter cost cast_cost::meta,
+      /// other arguments must be implicitly castable to the parameter (and cost the cost of the cast chain)
+      overload_match find_best_overload(const std::vector<type::ref>& args, const std::vector<std::vector<type::ref>>& candidates) const
+      {
+        return rukh::find_best_overload(args, candidates, [this](type::ref arg, type::ref param) -> uint16_t
+        {
+          if (arg == param)
+            return cast_cost::exact;
+          const uint32_t param_index = index_of(param);
+          if (param_index == 0)
+            return cast_cost::none;
+          if (concrete_indices[param_index] == k_not_concrete)
+            return accepts(definitions[param_index], arg) ? cast_cost::meta : cast_cost::none;
+          const cast_info info = get_cast(arg, param);
+          return info.is_implicit() ? info.cost : cast_cost::none;
+        });
+      }
+
+      /// \brief Create an immutable, compact snapshot of the DB, to be used once every types have been registered
+      /// This computes the properties, accepted types and casts of every type: it is O(n) and must be explicitly
+      /// called (the queries on the DB itself never build a snapshot).
+      /// \note Implemented in frozen_type_db.hpp
+      /// \see frozen_type_db
+      frozen_type_db freeze() const;
+
+      /// \brief Return the counters of the resolution cache (since the creation of the DB or the last reset)
+      resolution_cache_stats get_resolution_cache_stats() const { return {sync.hits.load(), sync.misses.load()}; }
+
+      /// \brief Reset the counters of the resolution cache
+      void reset_resolution_cache_stats() const
+      {
+        sync.hits = 0;
+        sync.misses = 0;
       }
 
       // TODO: Some more utilities here
 
     private:
-      const type::definition none
-      {
-        type::ref::zero,
-        "none",
-        0, // size
-        0, // dim
-        {}, // dim getter
-        false, // concrete
+      friend class type;
+      friend class frozen_type_db;
+      friend class cast_matrix;
+
+      /// \note Must be called with cache_lock held exclusively
+      void update_casts() const
+      {
+        if (casts_epoch == epoch)
+          return;
+        casts.update(*this);
+        casts_epoch = epoch;
+      }
+
+      /// \brief Compute the derived properties, the accepted types and the casts of every type (see freeze)
+      /// \note Must be called with cache_lock held exclusively
+      void update_caches() const
+      {
+        for (uint32_t i = 0; i < definitions.size(); ++i)
+        {
+          compute_properties(i);
+          compute_accepted_types(i);
+        }
+        update_casts();
+      }
+
+      /// \brief Get the cached result of a resolution test
+      /// \return false if not in the cache (or if the cache is from a previous epoch)
+      bool find_resolution(type::ref t, type::ref resolution, bool& result) const
+      {
+        std::shared_lock<std::shared_mutex> _l(sync.resolution_lock);
+        const bool* it = resolution_epoch == epoch ? resolution_cache.find({t, resolution}) : nullptr;
+        if (it == nullptr)
+        {
+          sync.misses.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        sync.hits.fetch_add(1, std::memory_order_relaxed);
+        result = *it;
+        return true;
+      }
+
+      void cache_resolution(type::ref t, type::ref resolution, bool result) const
+      {
+        std::lock_guard<std::shared_mutex> _l(sync.resolution_lock);
+        if (resolution_epoch != epoch)
+        {
+          resolution_cache.clear();
+          resolution_epoch = epoch;
+        }
+        resolution_cache.insert({t, resolution}, result);
+      }
+
+    private:
+      void register_last_definition()
+      {
+        const uint32_t index = static_cast<uint32_t>(definitions.size() - 1);
+        const type::definition& def = definitions.back();
+        indices.insert(def.type_id, index);
+        if (def.concrete)
+        {
+          concrete_indices.push_back(static_cast<uint32_t>(concrete_types.size()));
+          concrete_types.push_back(index);
+        }
+        else
+        {
+          concrete_indices.push_back(k_not_concrete);
+        }
+        cache.emplace_back();
+        type_sets.emplace_back();
+        ++epoch;
+      }
+
+      bool can_add(type::ref id) const
+      {
+        // type::ref::zero is the none type, and cannot be overridden
+        return id != type::ref::zero && indices.find(id) == nullptr;
+      }
+
+      /// \brief Return the index of a definition (0 / the none type if not in the DB)
+      uint32_t index_of(type::ref id) const
+      {
+        if (const uint32_t* index = indices.find(id); index != nullptr)
+          return *index;
+        return 0;
+      }
+
+      uint32_t index_of(const type::definition& def) const
+      {
+        return index_of(def.type_id);
+      }
+
+      properties compute_properties(uint32_t index) const
+      {
+        cached_properties& entry = cache[index];
+        if (entry.epoch == epoch)
+        {
+          // circular type: being computed while already being computed. Circular types are not valid.
+          if (entry.computing)
+            return {};
+          return entry.props;
+        }
+
+        entry.epoch = epoch;
+        entry.computing = true;
+
+        const type::definition& def = definitions[index];
+        properties props;
+        props.valid = def.dim != 0 && def.type_id != type::ref::zero;
+        props.fully_concrete = def.concrete && !def.is_dim_valid_for;
+        props.size = def.size;
+        for (auto&& it : def.members)
+        {
+          const properties member = compute_properties(index_of(it.second));
+          props.valid = props.valid && member.valid;
+          props.fully_concrete = props.fully_concrete && member.fully_concrete;
+          props.size += member.size;
+        }
+
+        if (!props.valid)
+          props.size = 0;
+        else if (!def.is_dim_valid_for)
+          props.size *= def.dim;
+
+        entry.computing = false;
+        entry.props = props;
+        return props;
+      }
+
+      /// \brief Compute the accepted types of a type (and of the meta-types it reaches through its subtypes)
+      /// Meta-types can reach each other through their subtypes: every meta-type of a cycle (of a strongly connected
+      /// component of the subtypes graph) accepts the same types. So the components are found with Tarjan's algorithm
+      /// (the stack being the meta-types whose set is being computed), and the sets of a component are only completed
+      /// (and so cached) once every meta-type of the component has been visited.
+      const type_set& compute_accepted_types(uint32_t index) const
+      {
+        accepted_types_stack.clear();
+        visit_accepted_types(index);
+        return type_sets[index].set;
+      }
+
+      /// \return the lowest stack position reachable from the type (k_visited if the type is not on the stack)
+      uint32_t visit_accepted_types(uint32_t index) const
+      {
+        constexpr uint32_t k_visited = ~0u;
+        cached_type_set& entry = type_sets[index];
+        if (entry.epoch == epoch)
+          return entry.computing ? entry.stack_position : k_visited;
+
+        entry.epoch = epoch;
+        entry.computing = true;
+        entry.stack_position = static_cast<uint32_t>(accepted_types_stack.size());
+        accepted_types_stack.push_back(index);
+        uint32_t lowest = entry.stack_position;
+
+        const type::definition& def = definitions[index];
+        entry.set = type_set(concrete_types.size());
+        if (def.concrete)
+        {
+          entry.set.set(concrete_indices[index]);
+        }
+        else
+        {
+          // subtypes_getter: only test the concrete types that have been added since the last time
+          if (def.subtypes_getter)
+          {
+            for (; entry.tested_count < concrete_types.size(); ++entry.tested_count)
+            {
+              if (def.subtypes_getter(definitions[concrete_types[entry.tested_count]].type_id))
+                entry.getter_set.set(entry.tested_count);
+            }
+            entry.set |= entry.getter_set;
+          }
+
+          for (const type::ref id : def.subtypes)
+          {
+            const uint32_t subtype_index = index_of(id);
+            if (subtype_index == 0)
+              continue;
+            if (concrete_indices[subtype_index] != k_not_concrete)
+            {
+              entry.set.set(concrete_indices[subtype_index]);
+              continue;
+            }
+            // (the set of a meta-type that is on the stack is partial: it is completed with its component)
+            lowest = std::min(lowest, visit_accepted_types(subtype_index));
+            entry.set |= type_sets[subtype_index].set;
+          }
+        }
+
+        // root of a component: every meta-type of the component accepts the union of their sets
+        if (lowest == entry.stack_position)
+        {
+          for (size_t i = entry.stack_position + 1; i < accepted_types_stack.size(); ++i)
+            entry.set |= type_sets[accepted_types_stack[i]].set;
+          for (size_t i = entry.stack_position + 1; i < accepted_types_stack.size(); ++i)
+          {
+            type_sets[accepted_types_stack[i]].set = entry.set;
+            type_sets[accepted_types_stack[i]].computing = false;
+          }
+          entry.computing = false;
+          accepted_types_stack.resize(entry.stack_position);
+        }
+        return lowest;
+      }
+
+    private:
+      struct cached_properties
+      {
+        uint64_t epoch = 0;
+        bool computing = false;
+        properties props = {};
+      };
+
+      struct cached_type_set
+      {
+        uint64_t epoch = 0;
+        bool computing = false; // on the stack of visit_accepted_types()
+        uint32_t stack_position = 0;
+        type_set set = {};
+
+        // materialized results of subtypes_getter (for the first tested_count concrete types)
+        uint32_t tested_count = 0;
+        type_set getter_set = {};
       };
-      std::map<type::ref, type::definition> definitions
+
+      /// \brief Synchronization of the queries (see get_properties, get_accepted_types, get_cast and find_resolution)
+      /// Copying a DB does not copy the locks.
+      struct query_sync
       {
-        {none.type_id, none},
-        {rukh_str_hash("none"), none},
+        query_sync() = default;
+        query_sync(const query_sync& o) : hits(o.hits.load()), misses(o.misses.load()) {}
+        query_sync& operator = (const query_sync& o)
+        {
+          hits = o.hits.load();
+          misses = o.misses.load();
+          return *this;
+        }
+
+        std::shared_mutex cache_lock; // properties, accepted types and casts
+
+        std::shared_mutex resolution_lock;
+        std::atomic<uint64_t> hits = {0};
+        std::atomic<uint64_t> misses = {0};
       };
+
+    private:
+      // index 0 is always the none type
+      std::deque<type::definition> definitions;
+      hash_table<uint32_t> indices;
+
+      uint64_t epoch = 1;
+      mutable std::vector<cached_properties> cache; // same indices as definitions
+
+      std::vector<uint32_t> concrete_indices; // same indices as definitions. k_not_concrete for meta-types
+      std::vector<uint32_t> concrete_types; // concrete index -> index in definitions
+      mutable std::vector<cached_type_set> type_sets; // same indices as definitions
+      mutable std::vector<uint32_t> accepted_types_stack; // used by compute_accepted_types()
+
+      mutable hash_table<bool, type_ref_pair> resolution_cache;
+      mutable uint64_t resolution_epoch = 0;
+
+      mutable cast_matrix casts;
+      mutable uint64_t casts_epoch = 0;
+
+      mutable query_sync sync;
   };
 
 
@@ -105,132 +567,208 @@ namespace rukh
 
 
 
-  bool type::can_implicit_cast(const type& other) const
+  inline void cast_matrix::update(const type_db& db)
   {
-    (void)other; // TODO
-    return true;
-  }
+    const uint32_t old_count = size();
+    type_set new_casts(old_count); // old types that gained new casts (to types that were not defined before)
 
-  bool type::can_lossless_cast(const type& other) const
-  {
-    (void)other; // TODO
-    return true;
-  }
+    const auto add_edge = [this](uint32_t source, uint32_t target_index, const auto& fnc)
+    {
+      const type::cast_type flags = fnc ? fnc() : type::cast_type::none;
+      if (flags == type::cast_type::none)
+        return;
+      const uint32_t target = ensure_index(target_index);
+      edges[source].push_back({target, flags});
+    };
+
+    // casts to types that have been defined since the last update:
+    for (size_t i = 0; i < pending.size();)
+    {
+      const uint32_t target_index = db.index_of(pending[i].target);
+      if (target_index == 0)
+      {
+        ++i;
+        continue;
+      }
+      if (db.definitions[target_index].concrete)
+      {
+        const uint32_t target = ensure_index(target_index);
+        edges[pending[i].source].push_back({target, pending[i].flags});
+        if (pending[i].source < old_count)
+          new_casts.set(pending[i].source);
+      }
+      pending[i] = pending.back();
+      pending.pop_back();
+    }
 
-  bool type::is_valid() const
-  {
-    if (def.dim == 0 || def.type_id == ref::zero)
-      return false;
-    for (auto&& it : def.members)
+    // new definitions:
+    for (; processed < db.definitions.size(); ++processed)
     {
-      type t = tdb.get_type(it.second);
-      if (!t.is_valid())
-        return false;
+      const type::definition& def = db.definitions[processed];
+      if (!def.concrete || def.cast_into.empty())
+        continue;
+      const uint32_t source = ensure_index(processed);
+      for (auto&& it : def.cast_into)
+      {
+        const uint32_t target_index = db.index_of(it.first);
+        if (target_index != 0)
+        {
+          if (db.definitions[target_index].concrete)
+            add_edge(source, target_index, it.second);
+        }
+        else if (it.second)
+        {
+          // the target is not yet defined, the cast is added when (and if) it is
+          const type::cast_type flags = it.second();
+          if (flags != type::cast_type::none)
+            pending.push_back({source, it.first, flags});
+        }
+      }
+    }
 
-      // TODO: make a contains() test for circular deps (with a bool flag as param)
+    const uint32_t count = size();
+    grow(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      // old types only have to be recomputed if they can reach a type that has new casts
+      if (i < old_count && !new_casts.test(i) && !reach[i].intersects(new_casts))
+        continue;
+      compute_row(i);
     }
-    return true;
   }
 
-  size_t type::size() const
+  /// \brief Read the type::definition (see definition_accessor)
+  template<>
+  struct definition_accessor<type>
   {
-    // can save us in case of a circular type
-    if (!is_valid())
-      return 0;
+    static bool has_dim_getter(const type& t) { return bool(t.def.is_dim_valid_for); }
+    static bool is_dim_valid_for(const type& t, size_t dim) { return t.def.is_dim_valid_for(dim); }
+    static size_t get_dim(const type& t) { return t.def.dim; }
+
+    static size_t get_member_count(const type& t) { return t.def.members.size(); }
+
+    static std::optional<type::ref> find_member(const type& t, hash_t name)
+    {
+      if (const auto it = t.def.members.find(name); it != t.def.members.end())
+        return it->second;
+      return {};
+    }
+
+    static type::ref get_dynamic_member(const type& t, hash_t name)
+    {
+      return t.def.members_getter ? t.def.members_getter(name) : type::ref::zero;
+    }
+
+    template<typename Fnc>
+    static bool all_members(const type& t, Fnc&& fnc)
+    {
+      for (auto&& it : t.def.members)
+      {
+        if (!fnc(it.first, it.second))
+          return false;
+      }
+      return true;
+    }
 
-    size_t base_size = def.size;
-    for (auto&& it : def.members)
-      base_size += tdb.get_type(it.second).size();
+    static type::ref get_swizzle_type(const type& t, size_t length) { return t.def.swizzle_types[length - 1]; }
+
+    static bool has_subtype(const type& t, type::ref subtype)
+    {
+      return t.def.subtypes.count(subtype) || (t.def.subtypes_getter && t.def.subtypes_getter(subtype));
+    }
 
-    if (def.is_dim_valid_for)
-      return base_size;
+    template<typename Fnc>
+    static bool all_subtypes(const type& t, Fnc&& fnc)
+    {
+      for (const type::ref it : t.def.subtypes)
+      {
+        if (!fnc(it))
+          return false;
+      }
+      return true;
+    }
 
-    return base_size * def.dim;
+    static cast_info get_cast(const type& from, const type& to) { return from.tdb.get_cast(from.def.type_id, to.def.type_id); }
+  };
+
+  inline bool type::can_implicit_cast(const type& other) const
+  {
+    return type_queries::can_implicit_cast(*this, other);
   }
 
-  template<typename String>
-  type type::get_member_type() const
+  inline bool type::can_lossless_cast(const type& other) const
   {
-    if (const auto it = def.members.find(String::hash); it != def.members.end())
-      return tdb.get_type(it->second);
-    return tdb.get_none();
+    return type_queries::can_lossless_cast(*this, other);
   }
 
-  type type::get_member_type(const std::string_view &sv) const
+  inline bool type::has_member(hash_t name) const
   {
-    const hash_t hash = (hash_t)neam::ct::hash::fnv1a<64>((const uint8_t*)sv.data(), sv.size());
-    if (const auto it = def.members.find(hash); it != def.members.end())
-      return tdb.get_type(it->second);
-    return tdb.get_none();
+    return type_queries::has_member(*this, name);
   }
 
-  bool type::is_valid_resolution(const type& t) const
+  inline const swizzle::entry* type::get_swizzle(hash_t name) const
   {
-    // Test for self
-    if (&t == this || &t.def == &def)
-      return true;
+    return type_queries::get_swizzle(*this, name);
+  }
+
+  inline const type_set& type::get_accepted_types() const
+  {
+    return tdb.get_accepted_types(def);
+  }
 
-#define return_false_if(x)  do{if (x) { return false; }}while(0)
+  inline bool type::accepts(const type& t) const
+  {
+    return t.is_concrete() && tdb.accepts(def, t.get_ref());
+  }
 
-    // fast exits:
-    return_false_if(t.def.concrete != def.concrete);
-    return_false_if(!is_valid() || !t.is_valid());
+  inline bool type::is_valid() const
+  {
+    return tdb.get_properties(def).valid;
+  }
 
-    // test the dim (ignore the test is t is a partial resolution)
-    if (!t.def.is_dim_valid_for)
-    {
-      if (def.is_dim_valid_for)
-        return_false_if(!def.is_dim_valid_for(t.def.dim));
-      else
-        return_false_if(def.dim != t.def.dim);
-    }
+  inline bool type::is_fully_concrete() const
+  {
+    return tdb.get_properties(def).fully_concrete;
+  }
 
-    // for members (ignore the test for meta-types)
-    if (t.def.concrete)
-    {
-      return_false_if(t.def.members.size() != def.members.size());
-      for (auto&& member_res : t.def.members)
-      {
-        const auto member_it = def.members.find(member_res.first);
+  inline size_t type::size() const
+  {
+    return tdb.get_properties(def).size;
+  }
 
-        // easy case: not found
-        return_false_if(member_it == def.members.end());
+  template<typename String>
+  type type::get_member_type() const
+  {
+    return get_member_type(String::hash);
+  }
 
-        // easy case: the same type
-        if (member_it->second == member_res.second)
-          continue;
+  inline type type::get_member_type(const std::string_view &sv) const
+  {
+    return get_member_type(hash_string(sv));
+  }
 
-        // slow case: test for resolution
-        const type member_type = tdb.get_type(member_it->second);
-        const type member_res_type = tdb.get_type(member_res.second);
-        return_false_if(!member_type.is_valid_resolution(member_res_type));
-      }
-    }
-    // For sub-types (ignore the test for concrete types)
-    else
-    {
-      // resolutions for meta types can only be more restrictives in the sense that
-      // accepted sub-types should only be either resolution of types or types that are in the list
-      for (auto&& subtype_id : t.def.subtypes)
-      {
-        // easy case: in the subtypes set or subtypes_getter returns true
-        if (def.subtypes.count(subtype_id))
-          continue;
-        if (def.subtypes_getter && def.subtypes_getter(subtype_id))
-          continue;
+  inline type type::get_member_type(const interned_string& name) const
+  {
+    return get_member_type(name.hash);
+  }
 
-        // slow case: test for resolution:
-        const type subtype = tdb.get_type(subtype_id);
-        bool found = false;
-        for (auto&& id : def.subtypes)
-          found |= tdb.get_type(id).is_valid_resolution(subtype);
+  inline type type::get_member_type(hash_t name) const
+  {
+    return type_queries::get_member_type(*this, name);
+  }
 
-        return_false_if(!found);
-      }
-    }
+  inline bool type::is_valid_resolution(const type& t) const
+  {
+    // Test for self
+    if (&t == this || &t.def == &def)
+      return true;
 
-#undef return_false_if
+    bool result;
+    if (tdb.find_resolution(def.type_id, t.def.type_id, result))
+      return result;
 
-    return true;
+    result = type_queries::compute_resolution(*this, t);
+    tdb.cache_resolution(def.type_id, t.def.type_id, result);
+    return result;
   }
 } // namespace rukh
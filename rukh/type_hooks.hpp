@@ -0,0 +1,108 @@
+//
+// file : type_hooks.hpp
+// in : file:///home/tim/projects/rukh/rukh/type_hooks.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 22:56:35 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <deque>
+
+#include "type.hpp"
+#include "hash_table.hpp"
+
+namespace rukh
+{
+  /// \brief The callable fields of a type definition
+  /// Those cannot be stored in a type image (see frozen_type_db::save_image), and are rebound
+  /// by name (definition::hooks_name) through a hook_registry when the image is loaded.
+  struct type_hooks
+  {
+    std::function<bool(size_t)> is_dim_valid_for = {};
+    std::function<type::ref(hash_t)> members_getter = {};
+    std::function<bool(type::ref)> subtypes_getter = {};
+    std::map<type::ref, std::function<type::cast_type(/*TODO: IR-GEN + validate*/)>> cast_into = {};
+    std::function<bool(const std::vector<hash_t>& /*, TODO: IR-GEN + validate */)> construct_from = {};
+    std::function<bool(/*, TODO: IR-GEN + validate */)> destruct = {};
+
+    /// \brief Return the hooks of a definition
+    static type_hooks from(const type::definition& def)
+    {
+      return {def.is_dim_valid_for, def.members_getter, def.subtypes_getter, def.cast_into, def.construct_from, def.destruct};
+    }
+
+    /// \brief Return whether or not a definition has any callable field set
+    static bool has_hooks(const type::definition& def)
+    {
+      return def.is_dim_valid_for || def.members_getter || def.subtypes_getter || !def.cast_into.empty()
+             || def.construct_from || def.destruct;
+    }
+
+    /// \brief Return the name under which the hooks of a definition are registered
+    static hash_t name_of(const type::definition& def)
+    {
+      return def.hooks_name != hash_t::zero ? def.hooks_name : def.type_id;
+    }
+  };
+
+  /// \brief Holds named type_hooks, to rebind the callable fields of the types of a loaded type image
+  /// \note Only the types that have callable fields have to be registered
+  class hook_registry
+  {
+    public:
+      /// \brief Register hooks under a name
+      /// \return false if the name is already registered
+      bool add(hash_t name, type_hooks&& hooks)
+      {
+        if (name == hash_t::zero || indices.find(name) != nullptr)
+          return false;
+        indices.insert(name, static_cast<uint32_t>(entries.size()));
+        entries.push_back(std::move(hooks));
+        return true;
+      }
+
+      /// \brief Register the callable fields of a definition (under definition::hooks_name, or the type_id)
+      /// \return false if the name is already registered
+      bool add(const type::definition& def)
+      {
+        return add(type_hooks::name_of(def), type_hooks::from(def));
+      }
+
+      /// \brief Return the hooks registered under a name, or nullptr
+      const type_hooks* find(hash_t name) const
+      {
+        if (const uint32_t* index = indices.find(name); index != nullptr)
+          return &entries[*index];
+        return nullptr;
+      }
+
+      size_t size() const { return entries.size(); }
+
+    private:
+      std::deque<type_hooks> entries;
+      hash_table<uint32_t> indices;
+  };
+} // namespace rukh
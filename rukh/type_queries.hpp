@@ -0,0 +1,180 @@
+//
+// file : type_queries.hpp
+// in : file:///home/tim/projects/rukh/rukh/type_queries.hpp
+//
+// created by : Timothée Feuillet
+// date: dim. oct. 18 10:12:00 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include "cast_matrix.hpp"
+#include "string.hpp"
+#include "swizzle.hpp"
+#include "type.hpp"
+
+namespace rukh
+{
+  /// \brief Give the type queries (see type_queries) access to the definition of a type
+  /// Specialized for type (in type_db.hpp, reads the type::definition) and for frozen_type (in frozen_type_db.hpp,
+  /// reads the arrays of the image). Member, subtype and swizzle types are given as type::ref.
+  ///
+  /// A specialization has the following static functions (Type being the specialized type):
+  ///   - bool has_dim_getter(const Type&), bool is_dim_valid_for(const Type&, size_t dim), size_t get_dim(const Type&)
+  ///   - size_t get_member_count(const Type&)
+  ///   - std::optional<type::ref> find_member(const Type&, hash_t name) (the type of a "static" member)
+  ///   - type::ref get_dynamic_member(const Type&, hash_t name) (the type returned by the members_getter)
+  ///   - bool all_members(const Type&, Fnc&& fnc) (calls fnc(hash_t name, type::ref member) until it returns false)
+  ///   - type::ref get_swizzle_type(const Type&, size_t length) (type::ref::zero if disabled)
+  ///   - bool has_subtype(const Type&, type::ref subtype) (in the subtypes set or accepted by the subtypes_getter)
+  ///   - bool all_subtypes(const Type&, Fnc&& fnc) (calls fnc(type::ref subtype) until it returns false)
+  ///   - cast_info get_cast(const Type& from, const Type& to)
+  template<typename Type>
+  struct definition_accessor;
+
+  /// \brief The queries shared by type and frozen_type, written once over a definition_accessor
+  /// Type must also provide tdb.get_type(type::ref), tdb.get_none(), is_valid(), is_concrete(), accepts(const Type&)
+  /// and is_valid_resolution(const Type&) (which is where the results of resolution are cached).
+  namespace type_queries
+  {
+    template<typename Type>
+    bool can_implicit_cast(const Type& from, const Type& to)
+    {
+      return definition_accessor<Type>::get_cast(from, to).is_implicit();
+    }
+
+    template<typename Type>
+    bool can_lossless_cast(const Type& from, const Type& to)
+    {
+      return definition_accessor<Type>::get_cast(from, to).is_lossless();
+    }
+
+    template<typename Type>
+    const swizzle::entry* get_swizzle(const Type& t, hash_t name)
+    {
+      using accessor = definition_accessor<Type>;
+      if (accessor::has_dim_getter(t))
+        return nullptr;
+      const swizzle::entry* e = swizzle::find(name, accessor::get_dim(t));
+      return (e != nullptr && accessor::get_swizzle_type(t, e->length) != type::ref::zero) ? e : nullptr;
+    }
+
+    template<typename Type>
+    bool has_member(const Type& t, hash_t name)
+    {
+      using accessor = definition_accessor<Type>;
+      if (accessor::find_member(t, name))
+        return true;
+      if (get_swizzle(t, name) != nullptr)
+        return true;
+      return accessor::get_dynamic_member(t, name) != type::ref::zero;
+    }
+
+    template<typename Type>
+    Type get_member_type(const Type& t, hash_t name)
+    {
+      using accessor = definition_accessor<Type>;
+      if (const std::optional<type::ref> member = accessor::find_member(t, name); member)
+        return t.tdb.get_type(*member);
+      if (const swizzle::entry* e = get_swizzle(t, name); e != nullptr)
+        return t.tdb.get_type(accessor::get_swizzle_type(t, e->length));
+      return t.tdb.get_none();
+    }
+
+    /// \brief The actual implementation of is_valid_resolution (without the cache)
+    template<typename Type>
+    bool compute_resolution(const Type& self, const Type& t)
+    {
+      using accessor = definition_accessor<Type>;
+#define return_false_if(x)  do{if (x) { return false; }}while(0)
+
+      // fast exits:
+      return_false_if(t.is_concrete() != self.is_concrete());
+      return_false_if(!self.is_valid() || !t.is_valid());
+
+      // test the dim (ignore the test is t is a partial resolution)
+      if (!accessor::has_dim_getter(t))
+      {
+        if (accessor::has_dim_getter(self))
+          return_false_if(!accessor::is_dim_valid_for(self, accessor::get_dim(t)));
+        else
+          return_false_if(accessor::get_dim(self) != accessor::get_dim(t));
+      }
+
+      // for members (ignore the test for meta-types)
+      if (t.is_concrete())
+      {
+        return_false_if(accessor::get_member_count(t) != accessor::get_member_count(self));
+        return accessor::all_members(t, [&self](hash_t name, type::ref member_res)
+        {
+          const std::optional<type::ref> member = accessor::find_member(self, name);
+
+          // easy case: not found
+          return_false_if(!member);
+
+          // easy case: the same type
+          if (*member == member_res)
+            return true;
+
+          // slow case: test for resolution (through the cache)
+          return self.tdb.get_type(*member).is_valid_resolution(self.tdb.get_type(member_res));
+        });
+      }
+
+      // For sub-types (ignore the test for concrete types)
+      // resolutions for meta types can only be more restrictives in the sense that
+      // accepted sub-types should only be either resolution of types or types that are in the list
+      return accessor::all_subtypes(t, [&self](type::ref subtype_id)
+      {
+        const Type subtype = self.tdb.get_type(subtype_id);
+
+        // easy case: in the subtypes set or subtypes_getter returns true
+        // (for concrete types, this is a single bit test in the materialized set of accepted types)
+        if (subtype.is_concrete())
+        {
+          if (self.accepts(subtype))
+            return true;
+        }
+        else if (accessor::has_subtype(self, subtype_id))
+        {
+          return true;
+        }
+
+        // slow case: test for resolution (through the cache):
+        bool found = false;
+        accessor::all_subtypes(self, [&self, &subtype, &found](type::ref it)
+        {
+          found = self.tdb.get_type(it).is_valid_resolution(subtype);
+          return !found;
+        });
+        return found;
+      });
+
+#undef return_false_if
+    }
+  } // namespace type_queries
+} // namespace rukh
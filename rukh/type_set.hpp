@@ -0,0 +1,177 @@
+//
+// file : type_set.hpp
+// in : file:///home/tim/projects/rukh/rukh/type_set.hpp
+//
+// created by : Timothée Feuillet
+// date: sam. oct. 17 22:52:26 2026 GMT+0000
+//
+//
+// Copyright (c) 2018 Timothée Feuillet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rukh
+{
+  /// \brief A set of concrete types, represented as a bitset over the dense concrete-type indices of a type_db
+  /// (see type_db::get_concrete_index)
+  ///
+  /// All the set operations are done word-wise, without branches in the loops, so that the compiler
+  /// can vectorize them (SSE2 / AVX2 / NEON, depending on the target).
+  /// Sets of different sizes can be mixed: missing bits are considered not set.
+  class type_set
+  {
+    public:
+      type_set() = default;
+      explicit type_set(size_t bit_count) : words((bit_count + 63) / 64, 0) {}
+
+      /// \brief Make the set able to hold at least \p bit_count bits (does not change the set)
+      void resize(size_t bit_count)
+      {
+        const size_t word_count = (bit_count + 63) / 64;
+        if (word_count > words.size())
+          words.resize(word_count, 0);
+      }
+
+      /// \brief Remove every types from the set
+      void clear()
+      {
+        for (auto& w : words)
+          w = 0;
+      }
+
+      void set(uint32_t index)
+      {
+        resize(size_t(index) + 1);
+        words[index / 64] |= uint64_t(1) << (index % 64);
+      }
+
+      void reset(uint32_t index)
+      {
+        if (index / 64 < words.size())
+          words[index / 64] &= ~(uint64_t(1) << (index % 64));
+      }
+
+      bool test(uint32_t index) const
+      {
+        if (index / 64 >= words.size())
+          return false;
+        return (words[index / 64] >> (index % 64)) & 1;
+      }
+
+      /// \brief Return the number of types in the set
+      size_t count() const
+      {
+        size_t ret = 0;
+        for (const uint64_t w : words)
+          ret += __builtin_popcountll(w);
+        return ret;
+      }
+
+      bool empty() const
+      {
+        uint64_t acc = 0;
+        for (const uint64_t w : words)
+          acc |= w;
+        return acc == 0;
+      }
+
+      /// \brief Whether or not the two sets have at least a type in common
+      bool intersects(const type_set& o) const
+      {
+        const size_t sz = common_size(o);
+        uint64_t acc = 0;
+        for (size_t i = 0; i < sz; ++i)
+          acc |= words[i] & o.words[i];
+        return acc != 0;
+      }
+
+      /// \brief Return the number of types in the intersection of the two sets
+      size_t intersection_count(const type_set& o) const
+      {
+        const size_t sz = common_size(o);
+        size_t ret = 0;
+        for (size_t i = 0; i < sz; ++i)
+          ret += __builtin_popcountll(words[i] & o.words[i]);
+        return ret;
+      }
+
+      /// \brief Whether or not every types of this set are in \p o
+      bool is_subset_of(const type_set& o) const
+      {
+        const size_t sz = common_size(o);
+        uint64_t acc = 0;
+        for (size_t i = 0; i < sz; ++i)
+          acc |= words[i] & ~o.words[i];
+        for (size_t i = sz; i < words.size(); ++i)
+          acc |= words[i];
+        return acc == 0;
+      }
+
+      type_set& operator &= (const type_set& o)
+      {
+        const size_t sz = common_size(o);
+        for (size_t i = 0; i < sz; ++i)
+          words[i] &= o.words[i];
+        for (size_t i = sz; i < words.size(); ++i)
+          words[i] = 0;
+        return *this;
+      }
+
+      type_set& operator |= (const type_set& o)
+      {
+        resize(o.words.size() * 64);
+        for (size_t i = 0; i < o.words.size(); ++i)
+          words[i] |= o.words[i];
+        return *this;
+      }
+
+      friend type_set operator & (type_set a, const type_set& b) { return a &= b; }
+      friend type_set operator | (type_set a, const type_set& b) { return a |= b; }
+
+      bool operator == (const type_set& o) const { return is_subset_of(o) && o.is_subset_of(*this); }
+      bool operator != (const type_set& o) const { return !(*this == o); }
+
+      /// \brief Call \p fnc(index) for every type in the set (in increasing index order)
+      template<typename Fnc>
+      void for_each(Fnc&& fnc) const
+      {
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+          for (uint64_t w = words[i]; w != 0; w &= w - 1)
+            fnc(static_cast<uint32_t>(i * 64 + __builtin_ctzll(w)));
+        }
+      }
+
+    private:
+      size_t common_size(const type_set& o) const
+      {
+        return words.size() < o.words.size() ? words.size() : o.words.size();
+      }
+
+    private:
+      std::vector<uint64_t> words;
+  };
+} // namespace rukh
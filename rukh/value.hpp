@@ -29,21 +29,262 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "arena.hpp"
+#include "span.hpp"
 #include "type.hpp"
-#include "reporter.hpp"
 
 namespace rukh
 {
+  /// \brief A value manipulated during a compilation: a constant or a value that will only be known at runtime
+  /// Values are compact 32-bit handles into a value_table, which holds their type and (for constants) their data
   class value
   {
     public:
-      value(const type& _type, reporter& r) noexcept : type(_type), report(r) {}
-      
-    public:
-      const type& type;
+      constexpr value() = default;
+      constexpr explicit value(uint32_t _index) : index(_index) {}
+
+      /// \brief Return whether or not the handle refers to a value
+      constexpr bool is_valid() const { return index != ~0u; }
+
+      /// \brief Return the index of the value in its value_table
+      constexpr uint32_t get_index() const { return index; }
+
+      constexpr bool operator == (const value& o) const { return index == o.index; }
+      constexpr bool operator != (const value& o) const { return index != o.index; }
+
     private:
-      reporter& report;
+      uint32_t index = ~0u;
   };
 
-  
+  /// \brief Holds the values of a compilation
+  ///
+  /// The data of constants is sized by type::size(). Constants of at most k_inline_size bytes (scalars and small vectors)
+  /// are stored inline in the table, bigger ones are allocated in an arena owned by the table.
+  /// The table is made to be reset between compilations (see reset()): its memory is then reused, so folding
+  /// constants does not allocate once the table has grown to the size of the graph.
+  ///
+  /// \note Constant data is zero-initialized and aligned on k_data_alignment bytes.
+  /// \warning The table is not thread-safe. Spans returned by get_data() / get_components() are invalidated
+  ///          when a value is added.
+  class value_table
+  {
+    public:
+      static constexpr size_t k_inline_size = 16;
+      static constexpr size_t k_data_alignment = 16;
+
+    public:
+      explicit value_table(size_t arena_chunk_size = arena::k_default_chunk_size) : allocator(arena_chunk_size) {}
+
+      /// \brief Add a non-constant value
+      value add(type::ref t)
+      {
+        types.push_back(t);
+        sizes.push_back(k_not_constant);
+        data.emplace_back();
+        return value(static_cast<uint32_t>(types.size() - 1));
+      }
+
+      /// \brief Add a (zero-initialized) constant, sized by the type
+      value add_constant(const type& t)
+      {
+        return add_constant(t.get_ref(), t.size());
+      }
+
+      /// \brief Add a (zero-initialized) constant of \p size bytes
+      value add_constant(type::ref t, size_t size)
+      {
+        types.push_back(t);
+        sizes.push_back(static_cast<uint32_t>(size));
+        storage& s = data.emplace_back();
+        if (size > k_inline_size)
+        {
+          s.ptr = static_cast<uint8_t*>(allocator.allocate(size, k_data_alignment));
+          memset(s.ptr, 0, size);
+        }
+        return value(static_cast<uint32_t>(types.size() - 1));
+      }
+
+      /// \brief Add a constant initialized from \p size bytes of \p src
+      value add_constant(type::ref t, const void* src, size_t size)
+      {
+        const value v = add_constant(t, size);
+        if (size > 0)
+          memcpy(get_data(v).data(), src, size);
+        return v;
+      }
+
+      /// \brief Add a constant initialized from an object (a primitive, or an array / struct of primitives)
+      template<typename Type>
+      value add_constant_of(type::ref t, const Type& src)
+      {
+        static_assert(std::is_trivially_copyable_v<Type>, "rukh::value_table: constants must be trivially copyable");
+        return add_constant(t, &src, sizeof(Type));
+      }
+
+      /// \brief Return whether or not a value is in the table (false for invalid handles)
+      bool contains(value v) const { return v.is_valid() && v.get_index() < sizes.size(); }
+
+      /// \brief Return whether or not a value is a constant (false for values that are not in the table)
+      bool is_constant(value v) const { return contains(v) && sizes[v.get_index()] != k_not_constant; }
+
+      /// \brief Return the type of a value (type::ref::zero for values that are not in the table)
+      type::ref get_type(value v) const { return contains(v) ? types[v.get_index()] : type::ref::zero; }
+
+      /// \brief Return the size of the data of a constant (0 for non-constant values)
+      size_t get_size(value v) const { return is_constant(v) ? sizes[v.get_index()] : 0; }
+
+      /// \brief Return the data of a constant (an empty span for non-constant values)
+      span<uint8_t> get_data(value v)
+      {
+        if (!is_constant(v))
+          return {};
+        const uint32_t size = sizes[v.get_index()];
+        storage& s = data[v.get_index()];
+        return {size > k_inline_size ? s.ptr : s.bytes, size};
+      }
+
+      /// \brief Return the data of a constant (an empty span for non-constant values)
+      span<const uint8_t> get_data(value v) const
+      {
+        const span<uint8_t> ret = const_cast<value_table*>(this)->get_data(v);
+        return {ret.data(), ret.size()};
+      }
+
+      /// \brief Return the data of a constant as an array of \p Type (for instance the components of a vector)
+      /// Return an empty span if the value is not a constant or if its size is not a multiple of sizeof(Type)
+      template<typename Type>
+      span<Type> get_components(value v)
+      {
+        static_assert(std::is_trivially_copyable_v<Type>, "rukh::value_table: constants must be trivially copyable");
+        static_assert(alignof(Type) <= k_data_alignment, "rukh::value_table: type is over-aligned");
+        const span<uint8_t> bytes = get_data(v);
+        if (bytes.empty() || bytes.size() % sizeof(Type) != 0)
+          return {};
+        return {reinterpret_cast<Type*>(bytes.data()), bytes.size() / sizeof(Type)};
+      }
+
+      /// \brief Return the data of a constant as an array of \p Type (for instance the components of a vector)
+      /// Return an empty span if the value is not a constant or if its size is not a multiple of sizeof(Type)
+      template<typename Type>
+      span<const Type> get_components(value v) const
+      {
+        const span<Type> ret = const_cast<value_table*>(this)->get_components<Type>(v);
+        return {ret.data(), ret.size()};
+      }
+
+      /// \brief Read a component of a constant (or the whole constant for scalars)
+      /// \return false if the value is not a constant or if the component is out of its data
+      template<typename Type>
+      bool get(value v, Type& dest, size_t component = 0) const
+      {
+        const span<const Type> components = get_components<Type>(v);
+        if (component >= components.size())
+          return false;
+        dest = components[component];
+        return true;
+      }
+
+      /// \brief Write a component of a constant (or the whole constant for scalars)
+      /// \return false if the value is not a constant or if the component is out of its data
+      template<typename Type>
+      bool set(value v, const Type& src, size_t component = 0)
+      {
+        const span<Type> components = get_components<Type>(v);
+        if (component >= components.size())
+          return false;
+        components[component] = src;
+        return true;
+      }
+
+      /// \brief Return the number of values in the table
+      size_t get_count() const { return types.size(); }
+
+      /// \brief Reserve memory for \p count values
+      void reserve(size_t count)
+      {
+        types.reserve(count);
+        sizes.reserve(count);
+        data.reserve(count);
+      }
+
+      /// \brief Remove every value (memory is kept for the next compilation)
+      /// \warning Invalidates every value handle
+      void reset()
+      {
+        types.clear();
+        sizes.clear();
+        data.clear();
+        allocator.reset();
+      }
+
+      /// \brief Make the table a copy of \p o, sharing (not copying) the data of the constants that are not stored inline
+      /// The values of \p o keep their handles, so a compilation can continue in this table from the state of \p o.
+      /// \warning \p o must not be reset (nor destroyed) while the table is in use, and the shared constants must not be written to
+      void share(const value_table& o)
+      {
+        reset();
+        types = o.types;
+        sizes = o.sizes;
+        data = o.data;
+      }
+
+      /// \brief Remove the values that are not used anymore
+      /// The kept values are renumbered (in the same order) and the data of their constants is copied to a new arena,
+      /// so the memory of the removed constants is released (this also ends any sharing done by share()).
+      /// \param keep [get_count()] non-zero for the values to keep
+      /// \return [get_count()] the new index of every value (~0u for the removed ones)
+      /// \warning Invalidates every value handle: they have to be remapped with the returned indices
+      std::vector<uint32_t> compact(span<const uint8_t> keep)
+      {
+        std::vector<uint32_t> remap(types.size(), ~0u);
+        arena new_allocator(allocator.get_chunk_size());
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < types.size(); ++i)
+        {
+          if (keep[i] == 0)
+            continue;
+          remap[i] = count;
+          const storage s = data[i];
+          types[count] = types[i];
+          sizes[count] = sizes[i];
+          data[count] = s;
+          if (sizes[i] != k_not_constant && sizes[i] > k_inline_size)
+          {
+            data[count].ptr = static_cast<uint8_t*>(new_allocator.allocate(sizes[i], k_data_alignment));
+            memcpy(data[count].ptr, s.ptr, sizes[i]);
+          }
+          ++count;
+        }
+        types.resize(count);
+        sizes.resize(count);
+        data.resize(count);
+        allocator = std::move(new_allocator);
+        return remap;
+      }
+
+      /// \brief Return the number of bytes used by the constants that are not stored inline
+      size_t get_out_of_line_size() const { return allocator.get_used_size(); }
+
+    private:
+      static constexpr uint32_t k_not_constant = ~0u;
+
+      union storage
+      {
+        alignas(k_data_alignment) uint8_t bytes[k_inline_size] = {};
+        uint8_t* ptr; // for constants bigger than k_inline_size
+      };
+
+    private:
+      arena allocator;
+
+      // per value:
+      std::vector<type::ref> types;
+      std::vector<uint32_t> sizes; // k_not_constant for non-constant values
+      std::vector<storage> data;
+  };
 } // namespace rukh
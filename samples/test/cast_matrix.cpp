@@ -0,0 +1,111 @@
+
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+#include "types.hpp"
+
+namespace
+{
+  using ct = rukh::type::cast_type;
+  constexpr ct k_widening = ct::implicit | ct::lossless;
+}
+
+/// Multi-hop casts take the cheapest chain, and casts to types defined after the matrix has been built are added to
+/// the existing rows (the rows of the types that can reach them included)
+RUKH_TEST(cast_matrix_chains)
+{
+  rukh::type_db db;
+  unsigned cast_calls = 0;
+  const auto add = [&](const char* name, std::vector<std::pair<const char*, ct>> casts)
+  {
+    rukh::type::definition def = rukh::test::make_concrete_type(name, 4);
+    for (const auto& it : casts)
+      def.cast_into[rukh::hash_string(it.first)] = [&cast_calls, flags = it.second] { ++cast_calls; return flags; };
+    db.add_definition(std::move(def));
+  };
+  add("int8", {{"int16", k_widening}});
+  add("int16", {{"int32", k_widening}});
+  add("int32", {{"float", ct::implicit}, {"double", k_widening}}); // (double is not defined yet)
+  add("float", {{"int32", ct::none}, {"int8", ct::lossless}}); // (none: not possible, lossless: explicit)
+  const auto cast = [&db](const char* from, const char* to) { return db.get_cast(rukh::hash_string(from), rukh::hash_string(to)); };
+
+  const rukh::cast_info lossless_chain = cast("int8", "int32");
+  RUKH_CHECK(lossless_chain.is_implicit() && lossless_chain.is_lossless() && lossless_chain.cost == 2 * rukh::cast_cost::lossless_hop);
+  const rukh::cast_info lossy_chain = cast("int8", "float");
+  RUKH_CHECK(lossy_chain.is_implicit() && !lossy_chain.is_lossless());
+  RUKH_CHECK(lossy_chain.cost == 2 * rukh::cast_cost::lossless_hop + rukh::cast_cost::lossy_hop);
+  const rukh::cast_info explicit_chain = cast("float", "int16");
+  RUKH_CHECK(explicit_chain.is_possible() && !explicit_chain.is_implicit() && explicit_chain.is_lossless());
+  RUKH_CHECK(explicit_chain.cost == rukh::cast_cost::explicit_hop + rukh::cast_cost::lossless_hop);
+  const rukh::cast_info back = cast("int32", "int8"); // (int32 -> float -> int8)
+  RUKH_CHECK(!back.is_implicit() && !back.is_lossless() && back.cost == rukh::cast_cost::lossy_hop + rukh::cast_cost::explicit_hop);
+  RUKH_CHECK(!cast("int8", "double").is_possible() && !cast("int8", "unknown").is_possible());
+  RUKH_CHECK(cast("int8", "int8").cost == rukh::cast_cost::exact && cast("int8", "int8").is_lossless());
+  const unsigned calls = cast_calls;
+
+  // defining double (after the matrix has been built) adds the pending int32 -> double cast, and a new type:
+  add("double", {});
+  add("int4", {{"int8", k_widening}});
+  const rukh::cast_info pending_chain = cast("int8", "double");
+  RUKH_CHECK(pending_chain.is_implicit() && pending_chain.is_lossless() && pending_chain.cost == 3 * rukh::cast_cost::lossless_hop);
+  RUKH_CHECK(cast("int4", "double").cost == 4 * rukh::cast_cost::lossless_hop && cast("int4", "float").is_implicit());
+  RUKH_CHECK(!cast("double", "int32").is_possible());
+  RUKH_CHECK(db.get_type(rukh::hash_string("int16")).can_lossless_cast(db.get_type(rukh::hash_string("double"))));
+  // the cast functions are only called once:
+  RUKH_CHECK(calls == 6 && cast_calls == calls + 1);
+
+  // the frozen DB has the same matrix:
+  const rukh::frozen_type_db frozen = db.freeze();
+  const auto frozen_cast = [&frozen](const char* from, const char* to)
+  {
+    return frozen.get_cast(frozen.index_of(rukh::hash_string(from)), frozen.index_of(rukh::hash_string(to)));
+  };
+  for (const char* from : {"int4", "int8", "float", "double"})
+  {
+    for (const char* to : {"int8", "int32", "double"})
+      RUKH_CHECK(frozen_cast(from, to).cost == cast(from, to).cost && frozen_cast(from, to).flags == cast(from, to).flags);
+  }
+}
+
+/// Overload resolution: exact matches, then meta-type parameters, then the cheapest implicit casts
+RUKH_TEST(cast_matrix_find_best_overload)
+{
+  rukh::type_db db;
+  rukh::type::definition i = rukh::test::make_concrete_type("int", 4);
+  i.cast_into[rukh::hash_string("float")] = [] { return ct::implicit; };
+  i.cast_into[rukh::hash_string("double")] = [] { return k_widening; };
+  db.add_definition(std::move(i));
+  db.add_definition(rukh::test::make_concrete_type("float", 4));
+  db.add_definition(rukh::test::make_concrete_type("double", 8));
+  db.add_definition(rukh::test::make_meta_type("number", {rukh::hash_string("int"), rukh::hash_string("float")}));
+
+  const auto refs = [](std::initializer_list<const char*> names)
+  {
+    std::vector<rukh::type::ref> ret;
+    for (const char* name : names)
+      ret.push_back(rukh::hash_string(name));
+    return ret;
+  };
+  const std::vector<std::vector<rukh::type::ref>> candidates =
+  {
+    refs({"float", "float"}),
+    refs({"double", "float"}),
+    refs({"number", "float"}),
+    refs({"int"}),
+  };
+
+  const rukh::overload_match meta = db.find_best_overload(refs({"int", "float"}), candidates);
+  RUKH_CHECK(meta.found() && meta.index == 2 && meta.cost == rukh::cast_cost::meta && !meta.ambiguous);
+  const rukh::overload_match exact = db.find_best_overload(refs({"int"}), candidates);
+  RUKH_CHECK(exact.found() && exact.index == 3 && exact.cost == rukh::cast_cost::exact);
+  RUKH_CHECK(!db.find_best_overload(refs({"double", "float"}), {refs({"int", "float"})}).found());
+
+  // int -> double (lossless) is cheaper than int -> float (lossy):
+  const rukh::overload_match cast = db.find_best_overload(refs({"int", "float"}), {candidates[0], candidates[1]});
+  RUKH_CHECK(cast.found() && cast.index == 1 && cast.cost == rukh::cast_cost::lossless_hop);
+  const rukh::overload_match ambiguous = db.find_best_overload(refs({"float", "float"}), {candidates[0], candidates[2]});
+  RUKH_CHECK(ambiguous.found() && ambiguous.index == 0 && !ambiguous.ambiguous); // exact (0) vs meta (1)
+  RUKH_CHECK(db.find_best_overload(refs({"float", "float"}), {candidates[0], candidates[0]}).ambiguous);
+}
@@ -0,0 +1,229 @@
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace rukh::test
+{
+  /// A float constant whose value is not part of its state hash: it must not be taken from the cache
+  struct hidden_constant_node : node<hidden_constant_node, rk_str("hidden-constant"), inputs<>, outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "a constant that is not cacheable";
+    inline static unsigned resolve_count = 0;
+    float data = 1.f;
+
+    bool resolve_output_types(reporter&) override { ++resolve_count; output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return true; }
+    void const_generate(reporter&, value_table& values) override
+    {
+      output<rk_str("value")>().set_value(values.add_constant_of(k_float, data));
+    }
+    bool generate(reporter&, generator&) override { return false; }
+  };
+} // namespace rukh::test
+
+namespace
+{
+  std::string make_temp_directory(const char* name)
+  {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path.string();
+  }
+
+  /// Resolve and generate a graph with a cache, return whether it succeeded
+  bool compile(rukh::graph& g, rukh::compile_cache& cache, rukh::ir::function& fnc, std::vector<rukh::hash_t>* hashes = nullptr)
+  {
+    rukh::reporter r;
+    rukh::resolver res(g);
+    res.set_cache(&cache);
+    if (!res.resolve(r))
+      return false;
+    if (hashes != nullptr)
+      hashes->assign(res.get_structural_hashes().begin(), res.get_structural_hashes().end());
+    rukh::pass_runner runner(g);
+    runner.build(res.get_order());
+    rukh::ir::builder b(fnc, g.get_values());
+    return runner.generate(r, b, cache, res.get_structural_hashes());
+  }
+
+  bool same_ir(const rukh::ir::function& a, const rukh::ir::function& b)
+  {
+    bool same = a.get_instruction_count() == b.get_instruction_count() && a.get_instruction_count() > 0;
+    for (rukh::ir::id i = 0; same && i < a.get_instruction_count(); ++i)
+    {
+      same = a.get_instruction(i).op == b.get_instruction(i).op && a.get_instruction(i).immediate == b.get_instruction(i).immediate;
+      same = same && a.get_type(i) == b.get_type(i);
+      const rukh::span<const rukh::ir::id> operands = a.get_operands(i);
+      same = same && std::equal(operands.begin(), operands.end(), b.get_operands(i).begin(), b.get_operands(i).end());
+    }
+    return same;
+  }
+} // namespace
+
+/// Compiling the same graph twice with the same cache takes every node from memory, and a new cache on the same
+/// directory takes them from the disk: the IR is the same every time
+RUKH_TEST(compile_cache_hits)
+{
+  const std::string directory = make_temp_directory("rukh-test-cache-hits");
+  rukh::ir::function first;
+  std::vector<rukh::hash_t> first_hashes;
+  {
+    rukh::compile_cache cache(directory);
+    rukh::graph g;
+    rukh::test::make_graph(g, 500, 3);
+    RUKH_CHECK(compile(g, cache, first, &first_hashes));
+    const rukh::compile_cache::stats stats = cache.get_stats();
+    RUKH_CHECK(stats.disk_hits == 0 && stats.misses > 0 && stats.stores > 0);
+
+    // memory hits:
+    rukh::graph again;
+    rukh::test::make_graph(again, 500, 3);
+    rukh::ir::function second;
+    std::vector<rukh::hash_t> second_hashes;
+    RUKH_CHECK(compile(again, cache, second, &second_hashes));
+    const rukh::compile_cache::stats again_stats = cache.get_stats();
+    RUKH_CHECK(again_stats.hits > 0 && again_stats.disk_hits == 0);
+    RUKH_CHECK(again_stats.misses == stats.misses && again_stats.stores == stats.stores);
+    RUKH_CHECK(second_hashes == first_hashes && same_ir(first, second));
+  }
+
+  // disk hits:
+  rukh::compile_cache cache(directory);
+  rukh::graph g;
+  rukh::test::make_graph(g, 500, 3);
+  rukh::ir::function third;
+  RUKH_CHECK(compile(g, cache, third));
+  const rukh::compile_cache::stats stats = cache.get_stats();
+  RUKH_CHECK(stats.disk_hits > 0 && stats.misses == 0 && stats.stores == 0);
+  RUKH_CHECK(same_ir(first, third));
+  std::filesystem::remove_all(directory);
+}
+
+/// The salt is part of the structural hashes: the entries of a cache with another salt are not used
+RUKH_TEST(compile_cache_salt)
+{
+  const std::string directory = make_temp_directory("rukh-test-cache-salt");
+  std::vector<rukh::hash_t> salted_hashes;
+  {
+    rukh::compile_cache cache(directory, 1);
+    rukh::graph g;
+    rukh::test::make_graph(g, 200, 5);
+    rukh::ir::function fnc;
+    RUKH_CHECK(compile(g, cache, fnc, &salted_hashes));
+  }
+
+  rukh::compile_cache cache(directory, 2);
+  rukh::graph g;
+  rukh::test::make_graph(g, 200, 5);
+  rukh::ir::function fnc;
+  std::vector<rukh::hash_t> hashes;
+  RUKH_CHECK(compile(g, cache, fnc, &hashes));
+  const rukh::compile_cache::stats stats = cache.get_stats();
+  RUKH_CHECK(stats.disk_hits == 0 && stats.misses > 0 && stats.stores > 0);
+  bool all_different = hashes.size() == salted_hashes.size();
+  for (size_t i = 0; all_different && i < hashes.size(); ++i)
+    all_different = hashes[i] == rukh::hash_t::zero || hashes[i] != salted_hashes[i]; // (zero: not resolved)
+  RUKH_CHECK(all_different);
+  std::filesystem::remove_all(directory);
+}
+
+/// Nodes that are not cacheable are always resolved, and the nodes depending on them are keyed by their results
+RUKH_TEST(compile_cache_not_cacheable)
+{
+  rukh::compile_cache cache;
+  std::vector<rukh::hash_t> hashes[2];
+  for (unsigned i = 0; i < 2; ++i)
+  {
+    rukh::graph g;
+    const rukh::node_handle c = g.add_node<rukh::test::hidden_constant_node>();
+    static_cast<rukh::test::hidden_constant_node&>(g.get_node(c)).data = float(i + 2);
+    const rukh::node_handle in = g.add_node<rukh::test::input_node>();
+    const rukh::node_handle add = g.add_node<rukh::test::add_node>();
+    const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+    g.connect(c, 0, add, 0);
+    g.connect(in, 0, add, 1);
+    g.connect(add, 0, out, 0);
+    g.set_output_node(out);
+
+    rukh::reporter r;
+    rukh::resolver res(g);
+    res.set_cache(&cache);
+    RUKH_CHECK(res.resolve(r));
+    RUKH_CHECK(rukh::test::hidden_constant_node::resolve_count == i + 1);
+    const rukh::value v = g.get_node(c).get_output_impls()[0].get_value();
+    RUKH_CHECK(v.is_valid() && g.get_values().get_components<float>(v)[0] == float(i + 2));
+    hashes[i].assign(res.get_structural_hashes().begin(), res.get_structural_hashes().end());
+  }
+  RUKH_CHECK(hashes[0][1] == hashes[1][1]); // (the input)
+  RUKH_CHECK(hashes[0][0] != hashes[1][0] && hashes[0][2] != hashes[1][2] && hashes[0][3] != hashes[1][3]);
+}
+
+/// Threads (and caches on the same directory, as other processes would do) storing the same keys at the same time:
+/// every entry written is complete, and no temporary file is left
+RUKH_TEST(compile_cache_concurrent_store)
+{
+  constexpr unsigned k_thread_count = 8;
+  constexpr unsigned k_key_count = 64;
+  constexpr unsigned k_iteration_count = 20;
+  const std::string directory = make_temp_directory("rukh-test-cache-concurrent");
+  const auto make_entry = [](unsigned key)
+  {
+    rukh::compile_cache::entry e;
+    e.has_resolution = true;
+    e.output_types.assign(key % 7 + 1, rukh::type::ref(key * 7919ull));
+    e.output_constants.assign(e.output_types.size(), rukh::compile_cache::k_no_ref);
+    return e;
+  };
+
+  rukh::compile_cache shared(directory);
+  rukh::compile_cache other(directory);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < k_thread_count; ++t)
+  {
+    threads.emplace_back([&, t]
+    {
+      rukh::compile_cache& cache = t % 2 == 0 ? shared : other;
+      for (unsigned i = 0; i < k_iteration_count; ++i)
+      {
+        for (unsigned k = 0; k < k_key_count; ++k)
+        {
+          const unsigned key = (k + t) % k_key_count;
+          cache.store(rukh::hash_t(key + 1), make_entry(key));
+          const std::shared_ptr<const rukh::compile_cache::entry> e = cache.find(rukh::hash_t(key + 1));
+          RUKH_CHECK(e != nullptr && e->output_types == make_entry(key).output_types);
+        }
+      }
+    });
+  }
+  for (std::thread& t : threads)
+    t.join();
+
+  rukh::compile_cache reader(directory);
+  bool complete = true;
+  for (unsigned key = 0; key < k_key_count; ++key)
+  {
+    const std::shared_ptr<const rukh::compile_cache::entry> e = reader.find(rukh::hash_t(key + 1));
+    complete = complete && e != nullptr && e->has_resolution && e->output_types == make_entry(key).output_types;
+  }
+  RUKH_CHECK(complete && reader.get_stats().disk_hits == k_key_count);
+
+  unsigned file_count = 0;
+  unsigned tmp_count = 0;
+  for (const std::filesystem::directory_entry& it : std::filesystem::directory_iterator(directory))
+  {
+    ++file_count;
+    tmp_count += it.path().extension() == ".tmp" ? 1 : 0;
+  }
+  RUKH_CHECK(file_count == k_key_count && tmp_count == 0);
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,160 @@
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+/// Stress test of concurrent_type_db: readers acquire / query / release snapshots while writers add definitions,
+/// publish them and collect the old snapshots. (To be run under TSan / ASan)
+RUKH_TEST(concurrent_type_db_stress)
+{
+  constexpr unsigned k_reader_count = 96;
+  constexpr unsigned k_type_count = 500;
+  constexpr unsigned k_iteration_count = 500;
+
+  rukh::concurrent_type_db db;
+  std::atomic<bool> done = {false};
+
+  std::vector<std::thread> threads;
+  threads.emplace_back([&]
+  {
+    for (unsigned i = 1; i <= k_type_count; ++i)
+    {
+      db.add_definition(rukh::type::definition{rukh::type::ref(i * 7919ull), "t", 4, 1, {}, true});
+      if (i % 5 == 0)
+        db.publish();
+    }
+    db.publish();
+    done = true;
+  });
+  threads.emplace_back([&]
+  {
+    while (!done)
+    {
+      db.publish();
+      db.collect();
+    }
+  });
+
+  for (unsigned r = 0; r < k_reader_count; ++r)
+  {
+    threads.emplace_back([&, r]
+    {
+      // half of the readers register again from time to time (reusing the slots of the others)
+      rukh::concurrent_type_db::reader reader = db.register_reader();
+      std::vector<rukh::concurrent_type_db::snapshot> held;
+      uint64_t last_version = 0;
+      size_t last_size = 0;
+      for (unsigned i = 0; i < k_iteration_count; ++i)
+      {
+        if (r % 2 == 0 && i % 50 == 0)
+          reader = db.register_reader();
+        rukh::concurrent_type_db::snapshot s = reader.acquire();
+        RUKH_CHECK(s && s.get_version() >= last_version);
+        RUKH_CHECK(s->size() >= last_size);
+        last_version = s.get_version();
+        last_size = s->size();
+
+        // every published type must be there, and queries must be consistent:
+        const uint32_t index = static_cast<uint32_t>(1 + (i * 31 + r) % (s->size()));
+        if (index < s->size())
+        {
+          const rukh::frozen_type t = s->get_type_at(index);
+          RUKH_CHECK(t.get_ref() == rukh::type::ref(index * 7919ull));
+          RUKH_CHECK(s->get_type(t.get_ref()).index == index);
+          RUKH_CHECK(t.is_valid() && t.size() == 4);
+        }
+        RUKH_CHECK(db.get_version() >= last_version);
+
+        // keep a few old snapshots alive
+        if (i % 7 == 0)
+          held.push_back(std::move(s));
+        if (held.size() > 4)
+          held.erase(held.begin());
+      }
+    });
+  }
+  for (std::thread& t : threads)
+    t.join();
+
+  RUKH_CHECK(db.register_reader().acquire()->size() == k_type_count + 1);
+  db.collect();
+  RUKH_CHECK(db.get_retired_count() == 0);
+}
+
+/// Read scaling: acquire / query / release throughput with 1 to N reader threads (N: the number of hardware threads,
+/// at least 4), first alone and then while a writer thread keeps publishing new snapshots.
+/// Readers do not take any lock and never retry: the throughput should grow with the number of cores,
+/// and acquire() should not slow down (other than by sharing the cores with the writer) while publish() is running.
+RUKH_TEST(concurrent_type_db_read_scaling)
+{
+  constexpr unsigned k_type_count = 256;
+  constexpr unsigned k_op_count = 200000; // per thread
+  rukh::concurrent_type_db db;
+  for (unsigned i = 1; i <= k_type_count; ++i)
+    db.add_definition(rukh::type::definition{rukh::type::ref(i * 7919ull), "t", 4, 1, {}, true});
+  db.publish();
+
+  const unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+  for (const bool concurrent_publish : {false, true})
+  {
+    double single_thread_rate = 0;
+    for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+    {
+      std::atomic<uint64_t> found = {0};
+      std::atomic<unsigned> running_readers = {0};
+      std::atomic<uint64_t> publish_count = {0};
+      const std::string name = "acquire + query, " + std::to_string(thread_count) + " thread(s)"
+                             + (concurrent_publish ? ", concurrent publish()" : "");
+      const double rate = rukh::test::bench(name.c_str(), size_t(k_op_count) * thread_count, "reads", [&]
+      {
+        std::vector<std::thread> threads;
+        running_readers = thread_count;
+        if (concurrent_publish)
+        {
+          threads.emplace_back([&db, &running_readers, &publish_count]
+          {
+            // every publish() replaces the current snapshot (new type) and retires the previous one
+            while (running_readers != 0)
+            {
+              db.add_definition(rukh::type::definition{rukh::type::ref((k_type_count + 1 + publish_count) * 7919ull), "t", 4, 1, {}, true});
+              db.publish();
+              ++publish_count;
+            }
+          });
+        }
+        for (unsigned t = 0; t < thread_count; ++t)
+        {
+          threads.emplace_back([&db, &found, &running_readers, t]
+          {
+            const rukh::concurrent_type_db::reader reader = db.register_reader();
+            uint64_t local_found = 0;
+            for (unsigned i = 0; i < k_op_count; ++i)
+            {
+              const rukh::concurrent_type_db::snapshot s = reader.acquire();
+              const uint32_t index = 1 + (i + t) % k_type_count;
+              local_found += s->get_type(rukh::type::ref(index * 7919ull)).index == index;
+            }
+            found += local_found;
+            --running_readers;
+          });
+        }
+        for (std::thread& t : threads)
+          t.join();
+      });
+      if (concurrent_publish)
+        printf("  %llu snapshots published during the reads\n", static_cast<unsigned long long>(publish_count.load()));
+      if (thread_count == 1)
+        single_thread_rate = rate;
+      else
+        printf("  %.2fx the single thread reads/s (%u hardware threads)\n", rate / single_thread_rate, std::thread::hardware_concurrency());
+      RUKH_CHECK(found == uint64_t(k_op_count) * thread_count);
+    }
+  }
+  db.collect();
+  RUKH_CHECK(db.get_retired_count() == 0);
+}
@@ -0,0 +1,200 @@
+
+#include <cstring>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+namespace
+{
+  using rukh::fold::isa;
+
+  const char* get_isa_name(isa i)
+  {
+    switch (i)
+    {
+      case isa::sse2: return "sse2";
+      case isa::avx2: return "avx2";
+      default: return "scalar";
+    }
+  }
+
+  /// Random floats, with the special values every implementation has to agree on (NaNs, infinities, signed zeros, denormals)
+  std::vector<float> make_inputs(size_t count, uint32_t seed)
+  {
+    static const float specials[] =
+    {
+      0.f, -0.f, 1.f, -1.f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+      std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+      std::numeric_limits<float>::max(), std::numeric_limits<float>::min(),
+    };
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    std::vector<float> ret(count);
+    for (float& it : ret)
+      it = (rng() % 8 == 0) ? specials[rng() % (sizeof(specials) / sizeof(specials[0]))] : dist(rng);
+    return ret;
+  }
+
+  /// Compare bit-exactly (the sign / payload of NaNs is not specified, see fold)
+  template<typename Type>
+  bool same_bits(std::vector<Type> a, std::vector<Type> b)
+  {
+    if constexpr (std::is_same_v<Type, float>)
+    {
+      rukh::fold::canonicalize_nans(a.data(), a.size());
+      rukh::fold::canonicalize_nans(b.data(), b.size());
+    }
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(Type)) == 0;
+  }
+
+  constexpr rukh::fold::binary_op k_binary_ops[] =
+  {
+    rukh::fold::binary_op::add, rukh::fold::binary_op::sub, rukh::fold::binary_op::mul,
+    rukh::fold::binary_op::div, rukh::fold::binary_op::min, rukh::fold::binary_op::max,
+  };
+  constexpr rukh::fold::compare_op k_compare_ops[] =
+  {
+    rukh::fold::compare_op::lt, rukh::fold::compare_op::le, rukh::fold::compare_op::gt,
+    rukh::fold::compare_op::ge, rukh::fold::compare_op::eq, rukh::fold::compare_op::ne,
+  };
+} // namespace
+
+/// Every SIMD implementation must give the same bits as the scalar one (for every size, so the tails are tested)
+RUKH_TEST(fold_simd_is_bit_exact)
+{
+  const rukh::fold::kernel_table& ref = rukh::fold::get_kernels(isa::scalar);
+  for (const isa i : {isa::sse2, isa::avx2})
+  {
+    if (i > rukh::fold::get_supported_isa())
+    {
+      printf("  %s is not supported, skipped\n", get_isa_name(i));
+      continue;
+    }
+    const rukh::fold::kernel_table& k = rukh::fold::get_kernels(i);
+    for (size_t count = 1; count <= 40; ++count)
+    {
+      const std::vector<float> a = make_inputs(count * 4, uint32_t(count));
+      const std::vector<float> b = make_inputs(count * 4, uint32_t(count + 1000));
+
+      for (const rukh::fold::binary_op op : k_binary_ops)
+      {
+        std::vector<float> expected(count), result(count);
+        ref.binary(op, a.data(), b.data(), expected.data(), count);
+        k.binary(op, a.data(), b.data(), result.data(), count);
+        RUKH_CHECK(same_bits(expected, result));
+
+        ref.binary_broadcast(op, a.data(), b[0], expected.data(), count);
+        k.binary_broadcast(op, a.data(), b[0], result.data(), count);
+        RUKH_CHECK(same_bits(expected, result));
+      }
+      for (const rukh::fold::compare_op op : k_compare_ops)
+      {
+        std::vector<uint32_t> expected(count), result(count);
+        ref.compare(op, a.data(), b.data(), expected.data(), count);
+        k.compare(op, a.data(), b.data(), result.data(), count);
+        RUKH_CHECK(same_bits(expected, result));
+      }
+      for (size_t dim = 2; dim <= 4; ++dim)
+      {
+        std::vector<float> expected(count), result(count);
+        ref.dot(a.data(), b.data(), dim, expected.data(), count);
+        k.dot(a.data(), b.data(), dim, result.data(), count);
+        RUKH_CHECK(same_bits(expected, result));
+      }
+    }
+    for (size_t n = 2; n <= 4; ++n)
+    {
+      for (uint32_t seed = 0; seed < 64; ++seed)
+      {
+        const std::vector<float> a = make_inputs(n * n, seed);
+        const std::vector<float> b = make_inputs(n * n, seed + 1000);
+        std::vector<float> expected(n * n), result(n * n);
+        ref.mat_mul(a.data(), b.data(), expected.data(), n);
+        k.mat_mul(a.data(), b.data(), result.data(), n);
+        RUKH_CHECK(same_bits(expected, result));
+
+        expected.resize(n);
+        result.resize(n);
+        ref.mat_vec(a.data(), b.data(), expected.data(), n);
+        k.mat_vec(a.data(), b.data(), result.data(), n);
+        RUKH_CHECK(same_bits(expected, result));
+      }
+    }
+  }
+}
+
+/// The value_table functions only fold constants: a runtime value or an invalid handle as an operand gives an invalid value
+/// (and nothing is added to the table)
+RUKH_TEST(fold_non_constant_operands)
+{
+  const rukh::hash_t k_float3 = rukh::hash_string("float3");
+  const rukh::hash_t k_float3x3 = rukh::hash_string("float3x3");
+  rukh::value_table values;
+  const float data[9] = {1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f};
+  const rukh::value vec = values.add_constant(k_float3, data, 3 * sizeof(float));
+  const rukh::value mat = values.add_constant(k_float3x3, data, sizeof(data));
+  const rukh::value runtime = values.add(k_float3);
+  const rukh::swizzle::entry* const zyx = rukh::swizzle::find(rukh::hash_string("zyx"));
+  if (!RUKH_CHECK(zyx != nullptr))
+    return;
+
+  RUKH_CHECK(rukh::fold::binary(values, rukh::fold::binary_op::add, vec, vec, k_float3).is_valid());
+  const size_t count = values.get_count();
+  for (const rukh::value v : {runtime, rukh::value{}})
+  {
+    for (const auto& [a, b] : {std::pair{vec, v}, std::pair{v, vec}})
+    {
+      RUKH_CHECK(!rukh::fold::binary(values, rukh::fold::binary_op::add, a, b, k_float3).is_valid());
+      RUKH_CHECK(!rukh::fold::compare(values, rukh::fold::compare_op::lt, a, b, k_float3).is_valid());
+      RUKH_CHECK(!rukh::fold::dot(values, a, b, k_float3).is_valid());
+      RUKH_CHECK(!rukh::fold::cross(values, a, b, k_float3).is_valid());
+    }
+    RUKH_CHECK(!rukh::fold::apply_swizzle(values, *zyx, v, k_float3).is_valid());
+    RUKH_CHECK(!rukh::fold::mat_mul(values, mat, v, 3, k_float3x3).is_valid());
+    RUKH_CHECK(!rukh::fold::mat_mul(values, v, mat, 3, k_float3x3).is_valid());
+    RUKH_CHECK(!rukh::fold::mat_vec(values, mat, v, 3, k_float3).is_valid());
+    RUKH_CHECK(!rukh::fold::mat_vec(values, v, vec, 3, k_float3).is_valid());
+    RUKH_CHECK(!rukh::fold::transpose(values, v, 3, k_float3x3).is_valid());
+  }
+  RUKH_CHECK(values.get_count() == count);
+}
+
+/// Throughput of the kernels of every supported implementation
+RUKH_TEST(fold_simd_benchmark)
+{
+  constexpr size_t k_count = 1 << 16;
+  constexpr size_t k_repeat = 64;
+  const std::vector<float> a = make_inputs(k_count * 4, 1);
+  const std::vector<float> b = make_inputs(k_count * 4, 2);
+  std::vector<float> r(k_count * 4);
+  volatile float sink = 0; // (keeps the results alive)
+
+  for (const isa i : {isa::scalar, isa::sse2, isa::avx2})
+  {
+    if (i > rukh::fold::get_supported_isa())
+      continue;
+    const rukh::fold::kernel_table& k = rukh::fold::get_kernels(i);
+    printf("  %s:\n", get_isa_name(i));
+    rukh::test::bench("add", k_count * k_repeat, "floats", [&]
+    {
+      for (size_t j = 0; j < k_repeat; ++j)
+        k.binary(rukh::fold::binary_op::add, a.data(), b.data(), r.data(), k_count);
+    });
+    rukh::test::bench("dot4", k_count * k_repeat, "vec4", [&]
+    {
+      for (size_t j = 0; j < k_repeat; ++j)
+        k.dot(a.data(), b.data(), 4, r.data(), k_count);
+    });
+    rukh::test::bench("mat4 * mat4", k_count * k_repeat / 16, "matrices", [&]
+    {
+      for (size_t j = 0; j < k_count * k_repeat / 16; ++j)
+        k.mat_mul(a.data() + (j % (k_count / 4)) * 16, b.data(), r.data(), 4);
+    });
+    sink = sink + r[0];
+  }
+}
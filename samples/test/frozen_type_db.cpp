@@ -0,0 +1,174 @@
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+#include "types.hpp"
+
+namespace
+{
+  std::string get_temp_path(const char* name)
+  {
+    return (std::filesystem::temp_directory_path() / name).string();
+  }
+} // namespace
+
+/// A frozen DB saved to a file and loaded back gives the same answers, the callable fields of the hooked types being
+/// rebound through a hook_registry
+RUKH_TEST(frozen_type_db_image_round_trip)
+{
+  const rukh::type::ref k_float = rukh::hash_string("float");
+  const rukh::type::ref k_int = rukh::hash_string("int");
+  rukh::hook_registry hooks;
+  const std::string path = get_temp_path("rukh-test-types.rkti");
+  {
+    rukh::type_db db;
+    rukh::type::definition f = rukh::test::make_concrete_type("float", 4);
+    f.swizzle_types = {k_float, rukh::type::ref::zero, rukh::type::ref::zero, rukh::type::ref::zero};
+    db.add_definition(std::move(f));
+    rukh::type::definition i = rukh::test::make_concrete_type("int", 4);
+    i.cast_into[k_float] = [] { return rukh::type::cast_type::implicit; };
+    db.add_definition(i);
+    hooks.add(i);
+
+    // dynamic members (the hooks are registered under a shared name):
+    rukh::type::definition s = rukh::test::make_concrete_type("s", 0);
+    s.members[rukh::hash_string("a")] = k_float;
+    s.members_getter = [k_int](rukh::hash_t name) { return name == rukh::hash_string("dyn") ? k_int : rukh::hash_t::zero; };
+    s.hooks_name = rukh::hash_string("dynamic-members");
+    db.add_definition(s);
+    hooks.add(s);
+
+    // meta array type:
+    rukh::type::definition arr = rukh::test::make_meta_type("small-array", {k_float});
+    arr.is_dim_valid_for = [](size_t dim) { return dim <= 4; };
+    db.add_definition(arr);
+    hooks.add(arr);
+    rukh::type::definition f3 = rukh::test::make_meta_type("float-x3", {k_float});
+    f3.dim = 3;
+    db.add_definition(std::move(f3));
+    db.add_definition(rukh::test::make_meta_type("number", {k_float, k_int}));
+
+    const rukh::frozen_type_db frozen = db.freeze();
+    RUKH_CHECK(frozen.save_image(path));
+  }
+
+  const std::optional<rukh::frozen_type_db> loaded = rukh::frozen_type_db::load_image(path, hooks);
+  if (!RUKH_CHECK(loaded.has_value()))
+    return;
+  const auto get = [&loaded](const char* name) { return loaded->get_type(rukh::hash_string(name)); };
+  RUKH_CHECK(loaded->size() == 7 && loaded->get_concrete_count() == 3);
+  RUKH_CHECK(get("s").get_debug_name() == "s" && get("s").size() == 4 && get("s").is_valid());
+  RUKH_CHECK(get("s").has_member("a") && get("s").has_member("dyn") && !get("s").has_member("nope"));
+  RUKH_CHECK(get("s").get_member_type("a").get_ref() == k_float);
+  RUKH_CHECK(get("float").get_swizzle(rukh::hash_string("x")) != nullptr && get("float").get_member_type("x").get_ref() == k_float);
+  RUKH_CHECK(get("int").can_implicit_cast(get("float")) && !get("float").can_implicit_cast(get("int")));
+  RUKH_CHECK(get("number").accepts(get("int")) && !get("number").accepts(get("s")));
+  RUKH_CHECK(get("small-array").is_valid_resolution(get("float-x3")));
+  RUKH_CHECK(get("unknown").get_ref() == rukh::type::ref::zero);
+
+  // missing hooks, truncated images:
+  rukh::hook_registry partial;
+  partial.add(rukh::hash_string("dynamic-members"), {});
+  RUKH_CHECK(!rukh::frozen_type_db::load_image(path, partial));
+  const std::string truncated_path = get_temp_path("rukh-test-types-truncated.rkti");
+  {
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream(truncated_path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+  }
+  RUKH_CHECK(!rukh::frozen_type_db::load_image(truncated_path, hooks));
+  RUKH_CHECK(!rukh::frozen_type_db::load_image(get_temp_path("rukh-test-does-not-exist.rkti"), hooks));
+
+  // corrupted entries: (the index of "s" in the lookup table, the last copy of its ref in the image)
+  // only the sections are checked by default, the entries are only checked when asked to
+  const std::string corrupted_path = get_temp_path("rukh-test-types-corrupted.rkti");
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const rukh::type::ref key = rukh::hash_string("s");
+    const size_t key_offset = data.rfind(std::string(reinterpret_cast<const char*>(&key), sizeof(key)));
+    if (!RUKH_CHECK(key_offset != std::string::npos && key_offset % 8 == 0))
+      return;
+    const uint64_t bad_index = ~uint64_t(0);
+    memcpy(&data[key_offset + sizeof(key)], &bad_index, sizeof(bad_index));
+    std::ofstream(corrupted_path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+  }
+  RUKH_CHECK(rukh::frozen_type_db::load_image(corrupted_path, hooks).has_value());
+  RUKH_CHECK(!rukh::frozen_type_db::load_image(corrupted_path, hooks, true));
+  RUKH_CHECK(rukh::frozen_type_db::load_image(path, hooks, true).has_value());
+  std::filesystem::remove(path);
+  std::filesystem::remove(truncated_path);
+  std::filesystem::remove(corrupted_path);
+}
+
+/// type and frozen_type run the same queries (see type_queries.hpp): every pair of types gives the same resolution,
+/// member, swizzle and cast answers
+RUKH_TEST(frozen_type_db_same_queries)
+{
+  const rukh::type::ref k_float = rukh::hash_string("float");
+  const rukh::type::ref k_int = rukh::hash_string("int");
+  rukh::type_db db;
+  rukh::type::definition f = rukh::test::make_concrete_type("float", 4);
+  f.swizzle_types = {k_float, k_float, rukh::type::ref::zero, rukh::type::ref::zero};
+  f.cast_into[k_int] = [] { return rukh::type::cast_type::none; };
+  db.add_definition(std::move(f));
+  rukh::type::definition i = rukh::test::make_concrete_type("int", 4);
+  i.cast_into[k_float] = [] { return rukh::type::cast_type::implicit; };
+  db.add_definition(std::move(i));
+  rukh::type::definition f2 = rukh::test::make_concrete_type("float2", 4, 2);
+  f2.swizzle_types = {k_float, rukh::hash_string("float2"), rukh::type::ref::zero, rukh::type::ref::zero};
+  db.add_definition(std::move(f2));
+  db.add_definition(rukh::test::make_meta_type("number", {k_float, k_int}));
+  db.add_definition(rukh::test::make_meta_type("any-number", {rukh::hash_string("number")}));
+  rukh::type::definition arr = rukh::test::make_meta_type("small-array", {k_float});
+  arr.is_dim_valid_for = [](size_t dim) { return dim <= 2; };
+  db.add_definition(std::move(arr));
+  rukh::type::definition getter = rukh::test::make_meta_type("ints", {});
+  getter.subtypes_getter = [k_int](rukh::type::ref t) { return t == k_int; };
+  db.add_definition(std::move(getter));
+  for (const char* member : {"float", "int", "number", "unknown"})
+  {
+    rukh::type::definition s = rukh::test::make_concrete_type(std::string("s-") + member, 0);
+    s.members[rukh::hash_string("m")] = rukh::hash_string(member);
+    s.members_getter = [k_int](rukh::hash_t name) { return name == rukh::hash_string("dyn") ? k_int : rukh::hash_t::zero; };
+    db.add_definition(std::move(s));
+  }
+  const rukh::frozen_type_db frozen = db.freeze();
+
+  const std::vector<const char*> names = {"none", "float", "int", "float2", "number", "any-number", "small-array", "ints",
+                                          "s-float", "s-int", "s-number", "s-unknown"};
+  bool same = true;
+  for (const char* a : names)
+  {
+    const rukh::type ta = db.get_type(rukh::hash_string(a));
+    const rukh::frozen_type fa = frozen.get_type(rukh::hash_string(a));
+    for (const char* member : {"m", "dyn", "x", "xy", "xyz", "nope"})
+    {
+      same = same && ta.has_member(member) == fa.has_member(member);
+      same = same && ta.get_member_type(member).get_ref() == fa.get_member_type(member).get_ref();
+      same = same && (ta.get_swizzle(rukh::hash_string(member)) == fa.get_swizzle(rukh::hash_string(member)));
+    }
+    for (const char* b : names)
+    {
+      const rukh::type tb = db.get_type(rukh::hash_string(b));
+      const rukh::frozen_type fb = frozen.get_type(rukh::hash_string(b));
+      same = same && ta.is_valid_resolution(tb) == fa.is_valid_resolution(fb);
+      same = same && ta.can_implicit_cast(tb) == fa.can_implicit_cast(fb) && ta.can_lossless_cast(tb) == fa.can_lossless_cast(fb);
+    }
+  }
+  RUKH_CHECK(same);
+
+  // (spot checks, so that the comparison is not between two wrong answers)
+  const auto get = [&frozen](const char* name) { return frozen.get_type(rukh::hash_string(name)); };
+  RUKH_CHECK(get("any-number").is_valid_resolution(get("number")) && !get("number").is_valid_resolution(get("any-number")));
+  RUKH_CHECK(get("int").can_implicit_cast(get("float")) && !get("float").can_implicit_cast(get("int")));
+  RUKH_CHECK(get("s-unknown").has_member("m") && !get("s-unknown").is_valid() && get("s-float").has_member("dyn"));
+  RUKH_CHECK(get("float2").get_member_type("xy").get_ref() == rukh::hash_string("float2") && !get("float2").has_member("xyz"));
+}
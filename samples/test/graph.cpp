@@ -0,0 +1,65 @@
+
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+/// The edge table: connections are rejected when a node / pin does not exist or when the input pin is already
+/// connected, and disconnect() moves the last connection in the place of the removed one (the input pins follow)
+RUKH_TEST(graph_edge_table)
+{
+  rukh::graph g;
+  const rukh::node_handle a = g.add_node<rukh::test::input_node>();
+  const rukh::node_handle b = g.add_node<rukh::test::input_node>();
+  const rukh::node_handle add = g.add_node<rukh::test::add_node>();
+  const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+
+  const rukh::edge_handle e0 = g.connect(a, 0, add, 0);
+  const rukh::edge_handle e1 = g.connect(b, 0, add, 1, rukh::test::k_float);
+  const rukh::edge_handle e2 = g.connect(add, 0, out, 0);
+  RUKH_CHECK(e0.index == 0 && e1.index == 1 && e2.index == 2 && g.get_edge_count() == 3);
+  const rukh::graph::edge_table& edges = g.get_edges();
+  RUKH_CHECK(edges.src_node[1] == b.index && edges.src_pin[1] == 0 && edges.dst_node[1] == add.index && edges.dst_pin[1] == 1);
+  RUKH_CHECK(edges.types[1] == rukh::test::k_float && edges.types[0] == rukh::type::ref::zero);
+  RUKH_CHECK(g.find_input_edge(add, 0) == e0 && g.find_input_edge(add, 1) == e1 && g.find_input_edge(out, 0) == e2);
+  RUKH_CHECK(!g.find_input_edge(a, 0).is_valid() && !g.find_input_edge(add, 2).is_valid());
+
+  // a second connection into an input pin, pins / nodes that do not exist:
+  const uint64_t version = g.get_topology_version();
+  RUKH_CHECK(!g.connect(b, 0, add, 0).is_valid() && g.find_input_edge(add, 0) == e0);
+  RUKH_CHECK(!g.connect(a, 1, out, 0).is_valid() && !g.connect(a, 0, add, 2).is_valid());
+  RUKH_CHECK(!g.connect(a, 0, rukh::node_handle{}, 0).is_valid() && !g.connect(out, 0, add, 0).is_valid());
+  RUKH_CHECK(g.get_edge_count() == 3 && g.get_topology_version() == version);
+
+  std::vector<rukh::edge_handle> add_inputs;
+  g.for_each_input_edge(add, [&add_inputs](rukh::edge_handle e) { add_inputs.push_back(e); });
+  RUKH_CHECK((add_inputs == std::vector<rukh::edge_handle>{e0, e1}));
+  std::vector<rukh::edge_handle> a_outputs;
+  g.for_each_output_edge(a, [&a_outputs](rukh::edge_handle e) { a_outputs.push_back(e); });
+  RUKH_CHECK((a_outputs == std::vector<rukh::edge_handle>{e0}));
+
+  // swap-remove: add -> out (the last connection) takes the place of a -> add
+  g.clear_dirty();
+  RUKH_CHECK(g.disconnect(e0) && g.get_edge_count() == 2 && g.get_topology_version() != version);
+  RUKH_CHECK(edges.src_node[0] == add.index && edges.dst_node[0] == out.index && edges.dst_pin[0] == 0);
+  RUKH_CHECK(g.find_input_edge(out, 0) == e0 && g.find_input_edge(add, 1) == e1 && !g.find_input_edge(add, 0).is_valid());
+  RUKH_CHECK(g.is_dirty(add) && !g.is_dirty(out) && !g.is_dirty(a));
+  RUKH_CHECK(!g.disconnect(rukh::edge_handle{2}) && !g.disconnect(rukh::edge_handle{}));
+
+  // the freed input pin can be connected again, removing the last connection does not move anything:
+  const rukh::edge_handle e3 = g.connect(b, 0, add, 0);
+  RUKH_CHECK(e3.index == 2 && g.find_input_edge(add, 0) == e3);
+  RUKH_CHECK(g.disconnect(e3) && g.get_edge_count() == 2 && g.find_input_edge(out, 0) == e0 && g.find_input_edge(add, 1) == e1);
+  RUKH_CHECK(g.disconnect(e1) && g.disconnect(e0) && g.get_edge_count() == 0);
+  RUKH_CHECK(!g.find_input_edge(out, 0).is_valid() && !g.find_input_edge(add, 1).is_valid());
+
+  // output nodes:
+  g.set_output_node(out);
+  g.set_output_node(out);
+  g.set_output_node(a);
+  RUKH_CHECK(g.is_output_node(out) && g.is_output_node(a) && !g.is_output_node(b) && g.get_output_nodes().size() == 2);
+  g.set_output_node(out, false);
+  RUKH_CHECK(!g.is_output_node(out) && g.get_output_nodes().size() == 1 && g.get_output_nodes()[0] == a.index);
+}
@@ -0,0 +1,121 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace
+{
+  using edge_key = std::tuple<rukh::hash_t, uint32_t, rukh::hash_t, uint32_t, rukh::hash_t>;
+
+  /// The connections of a graph (source kind / pin, destination kind / pin, type), independently of the order of the nodes
+  std::vector<edge_key> get_edge_keys(const rukh::graph& g)
+  {
+    const rukh::graph::edge_table& edges = g.get_edges();
+    std::vector<edge_key> ret;
+    for (uint32_t e = 0; e < edges.size(); ++e)
+    {
+      ret.emplace_back(g.get_node({edges.src_node[e]}).get_name_hash(), edges.src_pin[e],
+                       g.get_node({edges.dst_node[e]}).get_name_hash(), edges.dst_pin[e], edges.types[e]);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  /// The (kind, param types) of every node, independently of the order of the nodes
+  std::vector<std::vector<rukh::hash_t>> get_node_keys(const rukh::graph& g)
+  {
+    std::vector<std::vector<rukh::hash_t>> ret;
+    for (uint32_t n = 0; n < g.get_node_count(); ++n)
+    {
+      const rukh::base_node& node = g.get_node({n});
+      std::vector<rukh::hash_t>& key = ret.emplace_back(1, node.get_name_hash());
+      for (const rukh::param_impl& it : node.get_param_impls())
+        key.push_back(it.get_type());
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  bool same_bytes(const rukh::graph_image& a, const rukh::graph_image& b)
+  {
+    return a.get_image_size() == b.get_image_size() && memcmp(a.get_data(), b.get_data(), a.get_image_size()) == 0;
+  }
+
+  std::string get_temp_path(const char* name)
+  {
+    return (std::filesystem::temp_directory_path() / name).string();
+  }
+} // namespace
+
+/// A graph saved to a file and loaded back is the same graph, and dumping it again gives the same image
+RUKH_TEST(graph_image_round_trip)
+{
+  const rukh::node_registry registry = rukh::test::make_registry();
+  rukh::reporter r;
+  rukh::graph g;
+  rukh::test::make_graph(g, 1000, 42);
+
+  const rukh::graph_image image = rukh::graph_image::from_graph(g);
+  RUKH_CHECK(image.is_topological());
+  RUKH_CHECK(image.get_nodes().size() == g.get_node_count() && image.get_edges().size() == g.get_edge_count());
+
+  const std::string path = get_temp_path("rukh-test-round-trip.rkgi");
+  RUKH_CHECK(image.save_image(path));
+  const std::optional<rukh::graph_image> loaded = rukh::graph_image::load_image(path);
+  if (!RUKH_CHECK(loaded.has_value()))
+    return;
+  RUKH_CHECK(same_bytes(image, *loaded));
+
+  rukh::graph g2;
+  RUKH_CHECK(loaded->instantiate(g2, registry, r));
+  RUKH_CHECK(g2.get_node_count() == g.get_node_count() && g2.get_edge_count() == g.get_edge_count());
+  RUKH_CHECK(get_edge_keys(g2) == get_edge_keys(g));
+  RUKH_CHECK(get_node_keys(g2) == get_node_keys(g));
+  RUKH_CHECK(g2.get_output_nodes().size() == 1);
+
+  // the nodes of g2 are in the order of the image: dumping it again is stable
+  const rukh::graph_image image2 = rukh::graph_image::from_graph(g2);
+  rukh::graph g3;
+  RUKH_CHECK(image2.instantiate(g3, registry, r));
+  RUKH_CHECK(same_bytes(image2, rukh::graph_image::from_graph(g3)));
+
+  // truncated images are rejected
+  RUKH_CHECK(!rukh::graph_image::from_memory(loaded->get_data(), loaded->get_image_size() - 8));
+  std::filesystem::remove(path);
+}
+
+/// Throughput of saving, loading and instantiating a big graph
+RUKH_TEST(graph_image_load_benchmark)
+{
+  constexpr uint32_t k_add_count = 200000;
+  const rukh::node_registry registry = rukh::test::make_registry();
+  rukh::reporter r;
+  rukh::graph g;
+  rukh::test::make_graph(g, k_add_count, 1);
+  const size_t node_count = g.get_node_count();
+
+  std::optional<rukh::graph_image> image;
+  rukh::test::bench("from_graph", node_count, "nodes", [&] { image = rukh::graph_image::from_graph(g); });
+  const std::string path = get_temp_path("rukh-test-load.rkgi");
+  RUKH_CHECK(image->save_image(path));
+  printf("  image: %zu bytes (%.1f bytes / node)\n", size_t(image->get_image_size()), double(image->get_image_size()) / node_count);
+
+  std::optional<rukh::graph_image> loaded;
+  rukh::test::bench("load_image", node_count, "nodes", [&] { loaded = rukh::graph_image::load_image(path); });
+  if (!RUKH_CHECK(loaded.has_value()))
+    return;
+  rukh::graph g2;
+  rukh::test::bench("instantiate", node_count, "nodes", [&] { RUKH_CHECK(loaded->instantiate(g2, registry, r)); });
+  RUKH_CHECK(g2.get_node_count() == node_count && g2.get_edge_count() == g.get_edge_count());
+  std::filesystem::remove(path);
+}
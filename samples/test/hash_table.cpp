@@ -0,0 +1,125 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+namespace
+{
+  std::vector<rukh::hash_t> make_keys(size_t count, uint32_t seed)
+  {
+    std::mt19937_64 rng(seed);
+    std::vector<rukh::hash_t> ret(count);
+    for (rukh::hash_t& it : ret)
+      it = static_cast<rukh::hash_t>(rng() | 1); // (never the empty marker)
+    return ret;
+  }
+} // namespace
+
+/// Insert / find / erase, the growth of the table at 3/4 of its capacity and the reserved empty key
+RUKH_TEST(hash_table_operations)
+{
+  rukh::hash_table<uint32_t> table;
+  RUKH_CHECK(table.find(static_cast<rukh::hash_t>(42)) == nullptr && !table.erase(static_cast<rukh::hash_t>(42)));
+
+  // the empty marker cannot be inserted:
+  RUKH_CHECK(!table.insert(rukh::hash_t::zero, 1).second && table.empty());
+  RUKH_CHECK(table.find(rukh::hash_t::zero) == nullptr && !table.erase(rukh::hash_t::zero));
+
+  // growth: 12 entries fit in 16 slots, the 13th one triggers a rehash
+  const std::vector<rukh::hash_t> keys = make_keys(1000, 1);
+  table.reserve(12);
+  RUKH_CHECK(table.capacity() == 16);
+  for (uint32_t i = 0; i < 12; ++i)
+    RUKH_CHECK(table.insert(keys[i], i).second);
+  RUKH_CHECK(table.capacity() == 16);
+  RUKH_CHECK(table.insert(keys[12], 12).second);
+  RUKH_CHECK(table.capacity() == 32 && table.size() == 13);
+  for (uint32_t i = 13; i < keys.size(); ++i)
+    table.insert(keys[i], i);
+  RUKH_CHECK(table.size() == keys.size() && table.size() * 4 <= table.capacity() * 3);
+
+  // duplicates are not inserted:
+  const std::pair<uint32_t*, bool> dup = table.insert(keys[7], 1234);
+  RUKH_CHECK(!dup.second && dup.first != nullptr && *dup.first == 7);
+
+  bool found_all = true;
+  for (uint32_t i = 0; i < keys.size(); ++i)
+    found_all = found_all && table.find(keys[i]) != nullptr && *table.find(keys[i]) == i;
+  RUKH_CHECK(found_all);
+
+  // erase every other key: the others must still be found (the clusters are shifted back)
+  for (uint32_t i = 0; i < keys.size(); i += 2)
+    RUKH_CHECK(table.erase(keys[i]));
+  RUKH_CHECK(table.size() == keys.size() / 2 && !table.erase(keys[0]));
+  bool erased_valid = true;
+  for (uint32_t i = 0; i < keys.size(); ++i)
+    erased_valid = erased_valid && (i % 2 == 0 ? table.find(keys[i]) == nullptr : table.find(keys[i]) != nullptr && *table.find(keys[i]) == i);
+  RUKH_CHECK(erased_valid);
+
+  // keys whose home is the same slot (of a 16 slots table: the same top 4 bits once scrambled):
+  rukh::hash_table<uint32_t> small;
+  std::vector<rukh::hash_t> colliding;
+  for (uint64_t k = 1; colliding.size() < 3; ++k)
+  {
+    if (((k * 0x9E3779B97F4A7C15ull) >> 60) == 0)
+      colliding.push_back(static_cast<rukh::hash_t>(k));
+  }
+  for (uint32_t i = 0; i < 3; ++i)
+    small.insert(colliding[i], i);
+  RUKH_CHECK(small.capacity() == 16);
+  RUKH_CHECK(small.erase(colliding[0]) && *small.find(colliding[1]) == 1 && *small.find(colliding[2]) == 2);
+  RUKH_CHECK(small.erase(colliding[2]) && *small.find(colliding[1]) == 1 && small.size() == 1);
+
+  table.clear();
+  RUKH_CHECK(table.empty() && table.find(keys[1]) == nullptr);
+}
+
+/// Lookups in the flat hash table used by type_db vs a std::map (what type_db used before)
+RUKH_TEST(hash_table_benchmark)
+{
+  constexpr size_t k_count = 100000;
+  constexpr size_t k_lookup_rounds = 10;
+  const std::vector<rukh::hash_t> keys = make_keys(k_count, 2);
+  std::vector<rukh::hash_t> lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937(3));
+
+  rukh::hash_table<uint32_t> table;
+  std::map<rukh::hash_t, uint32_t> map;
+  rukh::test::bench("hash_table insert", k_count, "keys", [&]
+  {
+    for (uint32_t i = 0; i < k_count; ++i)
+      table.insert(keys[i], i);
+  });
+  rukh::test::bench("std::map insert", k_count, "keys", [&]
+  {
+    for (uint32_t i = 0; i < k_count; ++i)
+      map.emplace(keys[i], i);
+  });
+
+  uint64_t table_sum = 0;
+  uint64_t map_sum = 0;
+  const double table_rate = rukh::test::bench("hash_table find", k_count * k_lookup_rounds, "lookups", [&]
+  {
+    for (size_t r = 0; r < k_lookup_rounds; ++r)
+    {
+      for (const rukh::hash_t k : lookups)
+        table_sum += *table.find(k);
+    }
+  });
+  const double map_rate = rukh::test::bench("std::map find", k_count * k_lookup_rounds, "lookups", [&]
+  {
+    for (size_t r = 0; r < k_lookup_rounds; ++r)
+    {
+      for (const rukh::hash_t k : lookups)
+        map_sum += map.find(k)->second;
+    }
+  });
+  printf("  %.1fx the lookups/s of std::map\n", table_rate / map_rate);
+  RUKH_CHECK(table_sum == map_sum);
+}
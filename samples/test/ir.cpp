@@ -0,0 +1,92 @@
+
+#include <cstdio>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+/// Generating a graph gives a function whose operands are all defined before they are used
+RUKH_TEST(ir_builder_generate)
+{
+  rukh::reporter r;
+  rukh::graph g;
+  rukh::test::make_graph(g, 1000, 7);
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+
+  rukh::pass_runner runner(g);
+  runner.build(res.get_order());
+  rukh::ir::function fnc;
+  rukh::ir::builder b(fnc, g.get_values());
+  RUKH_CHECK(runner.generate(r, b));
+
+  RUKH_CHECK(fnc.get_instruction_count() == b.get_stats().emitted);
+  RUKH_CHECK(fnc.get_instruction_count() > 0 && fnc.get_instruction_count() <= g.get_node_count());
+  uint32_t output_count = 0;
+  for (rukh::ir::id i = 0; i < fnc.get_instruction_count(); ++i)
+  {
+    for (const rukh::ir::id it : fnc.get_operands(i))
+      RUKH_CHECK(it < i);
+    output_count += fnc.get_instruction(i).op == rukh::opcode::output ? 1 : 0;
+  }
+  RUKH_CHECK(output_count == 1);
+  RUKH_CHECK(fnc.get_instruction(rukh::ir::id(fnc.get_instruction_count() - 1)).op == rukh::opcode::output);
+}
+
+/// Constants are numbered by content: the same constant added twice to the value table is emitted once
+RUKH_TEST(ir_builder_deduplicates_constants)
+{
+  rukh::value_table values;
+  rukh::ir::function fnc;
+  rukh::ir::builder b(fnc, values);
+  const rukh::value k1 = values.add_constant_of(rukh::test::k_float, 2.f);
+  const rukh::value k2 = values.add_constant_of(rukh::test::k_float, 2.f);
+  const rukh::value sum1 = b.emit(rukh::opcode::add, rukh::test::k_float, {k1, k1});
+  const rukh::value sum2 = b.emit(rukh::opcode::add, rukh::test::k_float, {k2, k2});
+  RUKH_CHECK(sum1 == sum2);
+  RUKH_CHECK(fnc.get_instruction_count() == 2 && b.get_stats().deduplicated == 2);
+
+  // same data, but another type:
+  const rukh::value k3 = values.add_constant_of(rukh::hash_t(1), 2.f);
+  b.emit(rukh::opcode::neg, rukh::hash_t(1), {k3});
+  RUKH_CHECK(fnc.get_instruction_count() == 4);
+}
+
+/// Throughput of the IR builder: raw emission, and the generation of a whole graph
+RUKH_TEST(ir_builder_benchmark)
+{
+  constexpr uint32_t k_instruction_count = 1000000;
+  rukh::value_table values;
+  rukh::ir::function fnc;
+  rukh::ir::builder b(fnc, values);
+
+  for (const bool deduplicate : {false, true})
+  {
+    b.set_deduplication(deduplicate);
+    fnc.reset();
+    b.reset();
+    values.reset();
+    rukh::test::bench(deduplicate ? "emit (deduplicated)" : "emit", k_instruction_count, "instructions", [&]
+    {
+      rukh::value x = b.emit(rukh::opcode::input, rukh::test::k_float, {}, 0);
+      const rukh::value y = b.emit(rukh::opcode::input, rukh::test::k_float, {}, 1);
+      for (uint32_t i = 2; i < k_instruction_count; ++i)
+        x = b.emit(rukh::opcode::add, rukh::test::k_float, {x, y});
+    });
+    RUKH_CHECK(fnc.get_instruction_count() == k_instruction_count);
+  }
+
+  rukh::reporter r;
+  rukh::graph g;
+  rukh::test::make_graph(g, 200000, 3);
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  rukh::pass_runner runner(g);
+  runner.build(res.get_order());
+  rukh::ir::function graph_fnc;
+  rukh::ir::builder graph_builder(graph_fnc, g.get_values());
+  const double rate = rukh::test::bench("generate", runner.get_nodes().size(), "nodes", [&] { RUKH_CHECK(runner.generate(r, graph_builder)); });
+  printf("  %zu instructions (%.3g instructions/s)\n", graph_fnc.get_instruction_count(),
+         rate * double(graph_fnc.get_instruction_count()) / double(runner.get_nodes().size()));
+}
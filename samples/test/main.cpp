@@ -1,8 +1,29 @@
 
+#include <cstring>
+
 #include <rukh/rukh.hpp>
 #include <logger/logger.hpp>
 
-int main()
+#include "test.hpp"
+
+/// Run every test (or only the ones whose name contains argv[1])
+int main(int argc, char** argv)
 {
-  return 0;
+  const char* filter = argc > 1 ? argv[1] : nullptr;
+  unsigned failed_tests = 0;
+  for (const rukh::test::test_case& test : rukh::test::get_tests())
+  {
+    if (filter != nullptr && strstr(test.name, filter) == nullptr)
+      continue;
+    printf("[test] %s\n", test.name);
+    const unsigned failures = rukh::test::get_failure_count();
+    test.fnc();
+    if (rukh::test::get_failure_count() != failures)
+    {
+      printf("[test] %s: FAILED\n", test.name);
+      ++failed_tests;
+    }
+  }
+  printf("%u test(s) failed\n", failed_tests);
+  return failed_tests != 0 ? 1 : 0;
 }
@@ -0,0 +1,74 @@
+
+#include <initializer_list>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+namespace rukh::test
+{
+  /// A node with several pins of each kind, exposing its pin accessors
+  struct pins_node : node<pins_node, rk_str("pins"),
+                          inputs<pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("int")>, pin<rk_str("c"), rk_str("float")>>,
+                          outputs<pin<rk_str("x"), rk_str("float")>, pin<rk_str("y"), rk_str("int")>>,
+                          params<pin<rk_str("mode"), rk_str("any")>>>
+  {
+    static constexpr const char* description = "pins";
+
+    static constexpr size_t index_of_c = pin_index<input_list, rk_str("c")>();
+    static constexpr size_t index_of_y = pin_index<output_list, rk_str("y")>();
+    static constexpr size_t index_of_mode = pin_index<param_list, rk_str("mode")>();
+    static constexpr size_t lookup_missing = input_list::index_of(rukh_str_hash("x"));
+    static constexpr size_t input_count = input_list::array.size();
+
+    const pin_impl* get_b() const { return &input<rk_str("b")>(); }
+    pin_impl* get_y() { return &output<rk_str("y")>(); }
+    const param_impl* get_mode() const { return &param<rk_str("mode")>(); }
+
+    bool resolve_output_types(reporter&) override { return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator&) override { return false; }
+  };
+
+  // the pin indices are resolved at compile-time:
+  static_assert(pins_node::index_of_c == 2 && pins_node::index_of_y == 1 && pins_node::index_of_mode == 0);
+  static_assert(pins_node::lookup_missing == ~size_t(0) && pins_node::input_count == 3);
+  static_assert(pins_node::name_hash == rukh_str_hash("pins"));
+} // namespace rukh::test
+
+/// The pin accessors give the state of the pin with that name, and the pin descriptions have the hash of their name
+RUKH_TEST(node_pin_lookup)
+{
+  rukh::graph g;
+  const rukh::node_handle h = g.add_node<rukh::test::pins_node>();
+  rukh::test::pins_node& n = static_cast<rukh::test::pins_node&>(g.get_node(h));
+  RUKH_CHECK(n.get_b() == &n.get_input_impls()[1]);
+  RUKH_CHECK(n.get_y() == &n.get_output_impls()[1]);
+  RUKH_CHECK(n.get_mode() == &n.get_param_impls()[0]);
+  RUKH_CHECK(n.get_name() == "pins" && n.get_name_hash() == rukh::hash_string("pins"));
+
+  const auto check_pins = [](rukh::span<const rukh::pin_rt> pins, std::initializer_list<const char*> names, std::initializer_list<const char*> types)
+  {
+    bool valid = pins.size() == names.size();
+    for (size_t i = 0; valid && i < pins.size(); ++i)
+    {
+      valid = pins[i].name == names.begin()[i] && pins[i].name_hash == rukh::hash_string(names.begin()[i]);
+      valid = valid && pins[i].type_id == rukh::hash_string(types.begin()[i]);
+    }
+    return valid;
+  };
+  RUKH_CHECK(check_pins(n.get_input_pins(), {"a", "b", "c"}, {"float", "int", "float"}));
+  RUKH_CHECK(check_pins(n.get_output_pins(), {"x", "y"}, {"float", "int"}));
+  RUKH_CHECK(check_pins(n.get_params(), {"mode"}, {"any"}));
+  // the pin arrays are static (shared by the nodes of the same type):
+  const rukh::node_handle other = g.add_node<rukh::test::pins_node>();
+  RUKH_CHECK(g.get_node(other).get_input_pins().data() == n.get_input_pins().data());
+  RUKH_CHECK(g.get_node(other).get_input_impls().data() != n.get_input_impls().data());
+
+  // dynamic pins (with an interned name):
+  rukh::string_pool pool;
+  const rukh::pin_rt dynamic = rukh::pin_rt::from_interned(rukh::hash_string("float"), pool.intern("dynamic"), pool);
+  RUKH_CHECK(dynamic.name == "dynamic" && dynamic.name_hash == rukh::hash_string("dynamic"));
+}
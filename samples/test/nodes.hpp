@@ -0,0 +1,156 @@
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+namespace rukh::test
+{
+  inline const hash_t k_float = rukh_str_hash("float");
+
+  /// A float constant (its params are not used, they are only there to be saved / loaded)
+  struct constant_node : node<constant_node, rk_str("constant"), inputs<>, outputs<pin<rk_str("value"), rk_str("float")>>,
+                              params<pin<rk_str("min"), rk_str("float")>, pin<rk_str("max"), rk_str("float")>>>
+  {
+    static constexpr const char* description = "a float constant";
+    float data = 1.f;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return true; }
+    bool is_cacheable() const override { return true; }
+    void const_generate(reporter&, value_table& values) override
+    {
+      output<rk_str("value")>().set_value(values.add_constant_of(k_float, data));
+    }
+    uint64_t get_state_hash() const override { return hash_bytes(k_hash_seed, &data, sizeof(data)); }
+    bool generate(reporter&, generator&) override { return false; }
+  };
+
+  /// An input of the generated function
+  struct input_node : node<input_node, rk_str("input"), inputs<>, outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "an input of the function";
+    uint32_t index = 0;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    bool is_cacheable() const override { return true; }
+    void const_generate(reporter&, value_table&) override {}
+    uint64_t get_state_hash() const override { return index; }
+    bool generate(reporter&, generator& g) override
+    {
+      const value v = g.emit(opcode::input, k_float, {}, index);
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+
+  /// a + b
+  struct add_node : node<add_node, rk_str("add"), inputs<pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("float")>>,
+                         outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "a + b";
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    bool is_cacheable() const override { return true; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator& g) override
+    {
+      const value v = g.emit(opcode::add, k_float, {input<rk_str("a")>().get_value(), input<rk_str("b")>().get_value()});
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+
+  inline const hash_t k_add_op = rukh_str_hash("add-op");
+  inline const hash_t k_mul_op = rukh_str_hash("mul-op");
+
+  /// a + b or a * b, depending on the type of its "op" param (k_add_op by default)
+  struct op_node : node<op_node, rk_str("op"), inputs<pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("float")>>,
+                        outputs<pin<rk_str("value"), rk_str("float")>>, params<pin<rk_str("op"), rk_str("any")>>>
+  {
+    static constexpr const char* description = "a + b or a * b";
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override
+    {
+      const hash_t op = param<rk_str("op")>().get_type();
+      return op == type::ref::zero || op == k_add_op || op == k_mul_op;
+    }
+    bool is_constant() const override { return false; }
+    bool is_cacheable() const override { return true; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator& g) override
+    {
+      const opcode op = param<rk_str("op")>().get_type() == k_mul_op ? opcode::mul : opcode::add;
+      const value v = g.emit(op, k_float, {input<rk_str("a")>().get_value(), input<rk_str("b")>().get_value()});
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+
+  /// An output of the generated function
+  struct output_node : node<output_node, rk_str("output"), inputs<pin<rk_str("value"), rk_str("float")>>, outputs<>, params<>>
+  {
+    static constexpr const char* description = "an output of the function";
+
+    bool resolve_output_types(reporter&) override { return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    bool is_cacheable() const override { return true; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator& g) override
+    {
+      g.emit(opcode::output, type::ref::zero, {input<rk_str("value")>().get_value()});
+      return true;
+    }
+  };
+
+  /// \brief Register the test nodes
+  inline node_registry make_registry()
+  {
+    node_registry ret;
+    ret.add<constant_node>();
+    ret.add<input_node>();
+    ret.add<add_node>();
+    ret.add<op_node>();
+    ret.add<output_node>();
+    return ret;
+  }
+
+  /// \brief Fill a graph with some constants and inputs, \p add_count additions of random previous values and an output
+  inline void make_graph(graph& g, uint32_t add_count, uint32_t seed)
+  {
+    std::mt19937 rng(seed);
+    std::vector<node_handle> values;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      const node_handle n = g.add_node<constant_node>();
+      static_cast<constant_node&>(g.get_node(n)).data = float(i);
+      if (i % 3 == 0)
+        g.edit_param(n, 1).set_type(k_float);
+      values.push_back(n);
+
+      const node_handle in = g.add_node<input_node>();
+      static_cast<input_node&>(g.get_node(in)).index = i;
+      values.push_back(in);
+    }
+    for (uint32_t i = 0; i < add_count; ++i)
+    {
+      const node_handle n = g.add_node<add_node>();
+      g.connect(values[rng() % values.size()], 0, n, 0);
+      g.connect(values[values.size() - 1 - rng() % 8], 0, n, 1);
+      values.push_back(n);
+    }
+    const node_handle out = g.add_node<output_node>();
+    g.connect(values.back(), 0, out, 0);
+    g.set_output_node(out);
+  }
+} // namespace rukh::test
@@ -0,0 +1,121 @@
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace rukh::test
+{
+  /// a * b, generating its batches itself (reading every input first, then emitting every operation)
+  struct batched_mul_node : node<batched_mul_node, rk_str("batched-mul"), inputs<pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("float")>>,
+                                 outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "a * b";
+    static inline uint32_t batch_count = 0;
+    static inline size_t max_batch_size = 0;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator& g) override
+    {
+      const value v = g.emit(opcode::mul, k_float, {input<rk_str("a")>().get_value(), input<rk_str("b")>().get_value()});
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+
+    static void generate_batch(span<batched_mul_node* const> nodes, reporter&, generator& g, span<uint8_t> results)
+    {
+      ++batch_count;
+      max_batch_size = std::max(max_batch_size, nodes.size());
+      std::vector<value> operands;
+      for (const batched_mul_node* n : nodes)
+      {
+        operands.push_back(n->input<rk_str("a")>().get_value());
+        operands.push_back(n->input<rk_str("b")>().get_value());
+      }
+      for (size_t i = 0; i < nodes.size(); ++i)
+      {
+        const value v = g.emit(opcode::mul, k_float, {operands[i * 2], operands[i * 2 + 1]});
+        nodes[i]->output<rk_str("value")>().set_value(v);
+        results[i] = v.is_valid();
+      }
+    }
+  };
+} // namespace rukh::test
+
+/// Generating a graph by batches of nodes of the same kind (with the default batch functions and with a node
+/// generating its batches itself) emits the same IR as generating each node alone, in the same order
+RUKH_TEST(pass_runner_batch_dispatch)
+{
+  rukh::graph g;
+  std::mt19937 rng(17);
+  std::vector<rukh::node_handle> values;
+  for (uint32_t i = 0; i < 8; ++i)
+  {
+    values.push_back(g.add_node<rukh::test::constant_node>());
+    static_cast<rukh::test::constant_node&>(g.get_node(values.back())).data = float(i);
+    values.push_back(g.add_node<rukh::test::input_node>());
+    static_cast<rukh::test::input_node&>(g.get_node(values.back())).index = i;
+  }
+  for (uint32_t i = 0; i < 3000; ++i)
+  {
+    const rukh::node_handle n = rng() % 2 == 0 ? g.add_node<rukh::test::add_node>() : g.add_node<rukh::test::batched_mul_node>();
+    g.connect(values[rng() % values.size()], 0, n, 0);
+    g.connect(values[rng() % values.size()], 0, n, 1);
+    values.push_back(n);
+  }
+  const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+  g.connect(values.back(), 0, out, 0);
+
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  rukh::pass_runner runner(g);
+  runner.build(res.get_order());
+
+  rukh::ir::function batched;
+  rukh::ir::builder batched_builder(batched, g.get_values());
+  rukh::test::batched_mul_node::batch_count = 0;
+  RUKH_CHECK(runner.generate(r, batched_builder));
+  uint32_t mul_batches = 0;
+  for (const rukh::pass_runner::batch& b : runner.get_batches())
+    mul_batches += g.get_node({runner.get_batch_nodes(b)[0]}).get_name_hash() == rukh::test::batched_mul_node::name_hash ? 1 : 0;
+  RUKH_CHECK(rukh::test::batched_mul_node::batch_count == mul_batches && rukh::test::batched_mul_node::max_batch_size > 1);
+  RUKH_CHECK(runner.get_batches().size() < g.get_node_count() / 4);
+
+  // the same nodes, in the same order, one virtual call at a time:
+  rukh::ir::function single;
+  rukh::ir::builder single_builder(single, g.get_values());
+  bool success = true;
+  for (const uint32_t n : runner.get_nodes())
+  {
+    rukh::base_node& node = g.get_node({n});
+    if (node.is_constant())
+      continue;
+    g.for_each_input_edge({n}, [&g, &node](rukh::edge_handle e)
+    {
+      const rukh::graph::edge_table& edges = g.get_edges();
+      const rukh::value v = g.get_node({edges.src_node[e.index]}).get_output_impls()[edges.src_pin[e.index]].get_value();
+      node.get_input_impls()[edges.dst_pin[e.index]].set_value(v);
+    });
+    success = node.generate(r, single_builder) && success;
+  }
+  RUKH_CHECK(success);
+
+  bool same = batched.get_instruction_count() == single.get_instruction_count() && batched.get_instruction_count() > 0;
+  for (rukh::ir::id i = 0; same && i < batched.get_instruction_count(); ++i)
+  {
+    const rukh::ir::instruction& a = batched.get_instruction(i);
+    const rukh::ir::instruction& b = single.get_instruction(i);
+    same = a.op == b.op && a.immediate == b.immediate && batched.get_type(i) == single.get_type(i);
+    const rukh::span<const rukh::ir::id> operands = batched.get_operands(i);
+    same = same && std::equal(operands.begin(), operands.end(), single.get_operands(i).begin(), single.get_operands(i).end());
+  }
+  RUKH_CHECK(same);
+}
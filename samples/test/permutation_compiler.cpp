@@ -0,0 +1,128 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace
+{
+  constexpr size_t k_permutation_count = 64;
+  constexpr uint32_t k_op_count = 3;
+
+  /// Return the structural hashes of the instructions of a function, sorted: each hash covers the opcode, the type,
+  /// the immediate (the data of the constant for constants) and the hashes of the operands, so two functions computing
+  /// the same operations have the same list whatever the order of their instructions and the indices of their constants
+  std::vector<uint64_t> hash_instructions(const rukh::ir::function& fnc, const rukh::value_table& values)
+  {
+    std::vector<uint64_t> hashes(fnc.get_instruction_count());
+    for (rukh::ir::id i = 0; i < hashes.size(); ++i)
+    {
+      const rukh::ir::instruction& ins = fnc.get_instruction(i);
+      const rukh::type::ref t = fnc.get_type(i);
+      uint64_t h = rukh::hash_bytes(rukh::k_hash_seed, &ins.op, sizeof(ins.op));
+      h = rukh::hash_bytes(h, &t, sizeof(t));
+      if (ins.op == rukh::opcode::constant)
+      {
+        const rukh::span<const uint8_t> data = values.get_data(rukh::value(ins.immediate));
+        h = rukh::hash_bytes(h, data.data(), data.size());
+      }
+      else
+      {
+        h = rukh::hash_bytes(h, &ins.immediate, sizeof(ins.immediate));
+      }
+      for (const rukh::ir::id it : fnc.get_operands(i))
+        h = rukh::hash_bytes(h, &hashes[it], sizeof(hashes[it]));
+      hashes[i] = h;
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+  }
+
+  /// A big graph (the shared part) with a few op nodes after it (the cone), and the permutations of their ops
+  struct permuted_graph
+  {
+    rukh::graph g;
+    rukh::node_handle ops[k_op_count];
+    std::vector<rukh::permutation_compiler::permutation> permutations;
+
+    explicit permuted_graph(uint32_t add_count)
+    {
+      rukh::test::make_graph(g, add_count, 5);
+      const rukh::node_handle last = {static_cast<uint32_t>(g.get_node_count() - 2)}; // (before the output node)
+      rukh::node_handle prev = last;
+      for (rukh::node_handle& it : ops)
+      {
+        it = g.add_node<rukh::test::op_node>();
+        g.connect(prev, 0, it, 0);
+        g.connect(last, 0, it, 1);
+        prev = it;
+      }
+      const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+      g.connect(prev, 0, out, 0);
+      g.set_output_node(out);
+
+      for (size_t i = 0; i < k_permutation_count; ++i)
+      {
+        rukh::permutation_compiler::permutation& p = permutations.emplace_back();
+        for (uint32_t j = 0; j < k_op_count; ++j)
+          p.push_back({ops[j], 0, ((i >> j) & 1) != 0 ? rukh::test::k_mul_op : rukh::test::k_add_op});
+      }
+    }
+
+    /// Compile a permutation without sharing anything: set its params, then resolve and generate the whole graph
+    /// \return the hashes of the instructions of the function (see hash_instructions), empty on failure
+    std::vector<uint64_t> compile_alone(size_t i, rukh::reporter& r)
+    {
+      for (const rukh::permutation_compiler::param_assignment& a : permutations[i])
+        g.edit_param(a.node, a.param).set_type(a.param_type);
+      rukh::resolver res(g);
+      if (!res.resolve(r))
+        return {};
+      rukh::pass_runner runner(g);
+      runner.build(res.get_order());
+      rukh::ir::function fnc;
+      rukh::ir::builder b(fnc, g.get_values());
+      return runner.generate(r, b) ? hash_instructions(fnc, g.get_values()) : std::vector<uint64_t>{};
+    }
+  };
+} // namespace
+
+/// Compiling 64 permutations shares the work done on the nodes they do not change: it gives the same functions as
+/// compiling each permutation alone (the same operations, see hash_instructions), and the speedup is printed
+RUKH_TEST(permutation_compiler_throughput)
+{
+  rukh::reporter r;
+  permuted_graph pg(20000);
+
+  std::vector<std::vector<uint64_t>> expected(k_permutation_count);
+  const double alone_rate = rukh::test::bench("compiled alone", k_permutation_count, "permutations", [&]
+  {
+    for (size_t i = 0; i < k_permutation_count; ++i)
+      expected[i] = pg.compile_alone(i, r);
+  });
+  // (restore the default params: the permutation compiler resolves the graph with them)
+  for (const rukh::node_handle it : pg.ops)
+    pg.g.edit_param(it, 0).set_type(rukh::type::ref::zero);
+
+  rukh::thread_pool pool;
+  for (rukh::thread_pool* p : {static_cast<rukh::thread_pool*>(nullptr), &pool})
+  {
+    rukh::permutation_compiler pc(pg.g);
+    bool success = false;
+    const double rate = rukh::test::bench(p == nullptr ? "permutation_compiler" : "permutation_compiler (thread pool)",
+                                          k_permutation_count, "permutations", [&] { success = pc.compile(pg.permutations, r, p); });
+    if (!RUKH_CHECK(success))
+      continue;
+    RUKH_CHECK(pc.get_stats().compiled == k_permutation_count && pc.get_stats().cone_nodes == k_op_count + 1);
+    bool same = true;
+    for (size_t i = 0; i < k_permutation_count; ++i)
+      same = same && !expected[i].empty() && hash_instructions(pc.get_function(i), pc.get_values(i)) == expected[i];
+    RUKH_CHECK(same);
+    RUKH_CHECK(expected[0] != expected[k_permutation_count - 1]);
+    printf("  %.1fx the throughput of compiling each permutation alone\n", rate / alone_rate);
+  }
+}
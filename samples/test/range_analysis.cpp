@@ -0,0 +1,218 @@
+
+#include <cstdint>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace rukh::test
+{
+  inline const hash_t k_half = rukh_str_hash("half");
+  inline const hash_t k_bool = rukh_str_hash("bool");
+
+  /// An input of the function whose values are known to be in [lo, hi]
+  struct ranged_input_node : node<ranged_input_node, rk_str("ranged-input"), inputs<>, outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "an input in [lo, hi]";
+    uint32_t index = 0;
+    float lo = 0.f;
+    float hi = 1.f;
+    type::ref value_type = k_float;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(value_type); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table&) override {}
+    bool propagate_ranges(span<const value_range>, span<value_range> outputs, const value_table&) const override
+    {
+      outputs[0] = value_range::uniform(interval::make(lo, hi), 1);
+      return true;
+    }
+    bool generate(reporter&, generator& g) override
+    {
+      const value v = g.emit(opcode::input, value_type, {}, index);
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+
+  /// max(min(x, hi), lo), as a float
+  struct clamp_node : node<clamp_node, rk_str("clamp"), inputs<pin<rk_str("x"), rk_str("float")>>, outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "clamp(x, lo, hi)";
+    float lo = 0.f;
+    float hi = 1.f;
+    value lo_value;
+    value hi_value;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table& values) override
+    {
+      lo_value = values.add_constant_of(k_float, lo);
+      hi_value = values.add_constant_of(k_float, hi);
+    }
+    bool propagate_ranges(span<const value_range> inputs, span<value_range> outputs, const value_table&) const override
+    {
+      const interval bounds = interval::make(lo, hi);
+      outputs[0] = value_range::uniform(inputs[0].is_unknown() ? bounds : inputs[0].hull().intersect(bounds), 1);
+      return true;
+    }
+    bool generate(reporter&, generator& g) override
+    {
+      const value m = g.emit(opcode::min, k_float, {input<rk_str("x")>().get_value(), hi_value});
+      const value v = g.emit(opcode::max, k_float, {m, lo_value});
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+
+  /// A boolean constant (a uint32_t 0 / 1, as fold makes them)
+  struct bool_node : node<bool_node, rk_str("bool"), inputs<>, outputs<pin<rk_str("value"), rk_str("bool")>>, params<>>
+  {
+    static constexpr const char* description = "a boolean constant";
+    bool data = false;
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_bool); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return true; }
+    void const_generate(reporter&, value_table& values) override
+    {
+      output<rk_str("value")>().set_value(values.add_constant_of(k_bool, uint32_t(data ? 1 : 0)));
+    }
+    uint64_t get_state_hash() const override { return data ? 1 : 0; }
+    bool generate(reporter&, generator&) override { return false; }
+  };
+
+  /// condition ? a : b, as a float
+  struct select_node : node<select_node, rk_str("select"),
+                            inputs<pin<rk_str("condition"), rk_str("bool")>, pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("float")>>,
+                            outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "condition ? a : b";
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator& g) override
+    {
+      const value v = g.emit(opcode::select, k_float,
+                             {input<rk_str("condition")>().get_value(), input<rk_str("a")>().get_value(), input<rk_str("b")>().get_value()});
+      output<rk_str("value")>().set_value(v);
+      return v.is_valid();
+    }
+  };
+} // namespace rukh::test
+
+/// range_pruner: a clamp of a value already in range emits nothing, a select with a constant condition is replaced by
+/// the selected operand, and operations are never replaced by an operand of another type
+RUKH_TEST(range_pruner_prunes)
+{
+  rukh::graph g;
+  const auto add_input = [&g](uint32_t index, float lo, float hi, rukh::type::ref t)
+  {
+    const rukh::node_handle n = g.add_node<rukh::test::ranged_input_node>();
+    rukh::test::ranged_input_node& in = static_cast<rukh::test::ranged_input_node&>(g.get_node(n));
+    in.index = index;
+    in.lo = lo;
+    in.hi = hi;
+    in.value_type = t;
+    return n;
+  };
+  const auto add_clamp = [&g](rukh::node_handle x)
+  {
+    const rukh::node_handle n = g.add_node<rukh::test::clamp_node>();
+    g.connect(x, 0, n, 0);
+    return n;
+  };
+  const auto add_select = [&g](rukh::node_handle condition, rukh::node_handle a, rukh::node_handle b)
+  {
+    const rukh::node_handle n = g.add_node<rukh::test::select_node>();
+    g.connect(condition, 0, n, 0);
+    g.connect(a, 0, n, 1);
+    g.connect(b, 0, n, 2);
+    const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+    g.connect(n, 0, out, 0);
+    return n;
+  };
+  const auto add_bool = [&g](bool data)
+  {
+    const rukh::node_handle n = g.add_node<rukh::test::bool_node>();
+    static_cast<rukh::test::bool_node&>(g.get_node(n)).data = data;
+    return n;
+  };
+
+  const rukh::node_handle in_range = add_input(0, 0.f, 1.f, rukh::test::k_float);
+  const rukh::node_handle out_of_range = add_input(1, -5.f, 5.f, rukh::test::k_float);
+  const rukh::node_handle half = add_input(2, 0.f, 1.f, rukh::test::k_half);
+  const rukh::node_handle pruned_clamp = add_clamp(in_range); // min and max pruned
+  const rukh::node_handle kept_clamp = add_clamp(out_of_range); // nothing pruned
+  const rukh::node_handle mixed_clamp = add_clamp(half); // min kept (the operand is a half), max pruned
+  const rukh::node_handle true_select = add_select(add_bool(true), pruned_clamp, kept_clamp); // pruned
+  const rukh::node_handle false_select = add_select(add_bool(false), pruned_clamp, kept_clamp); // pruned
+  const rukh::node_handle unknown_select = add_select(out_of_range, pruned_clamp, kept_clamp); // kept (the condition can be 0)
+  const rukh::node_handle mixed_select = add_select(add_bool(true), half, mixed_clamp); // kept (the operand is a half)
+  add_select(in_range, mixed_clamp, kept_clamp); // kept ([0, 1] contains 0)
+
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  rukh::range_analysis ranges(g);
+  ranges.set_float_types({rukh::test::k_float});
+  ranges.run(res);
+  RUKH_CHECK(ranges.get_output_range(pruned_clamp, 0).is_within(rukh::interval::make(0.f, 1.f)));
+  RUKH_CHECK(ranges.get_output_range(kept_clamp, 0).is_within(rukh::interval::make(0.f, 1.f)));
+  RUKH_CHECK(ranges.get_input_range(kept_clamp, 0).hull().min == -5.f && ranges.get_output_range(true_select, 0).is_unknown());
+
+  rukh::pass_runner runner(g);
+  runner.build(res.get_order());
+  rukh::ir::function fnc;
+  rukh::ir::builder b(fnc, g.get_values());
+  rukh::range_pruner pruner(b, ranges);
+  RUKH_CHECK(runner.generate(r, pruner));
+  RUKH_CHECK(pruner.get_pruned_count() == 5);
+
+  uint32_t min_max_count = 0;
+  uint32_t select_count = 0;
+  for (const rukh::ir::instruction& it : fnc.get_instructions())
+  {
+    min_max_count += it.op == rukh::opcode::min || it.op == rukh::opcode::max ? 1 : 0;
+    select_count += it.op == rukh::opcode::select ? 1 : 0;
+  }
+  RUKH_CHECK(min_max_count == 3 && select_count == 3);
+
+  const auto get_output = [&g](rukh::node_handle n) { return g.get_node(n).get_output_impls()[0].get_value(); };
+  RUKH_CHECK(get_output(pruned_clamp) == get_output(in_range));
+  RUKH_CHECK(get_output(true_select) == get_output(pruned_clamp) && get_output(false_select) == get_output(kept_clamp));
+  RUKH_CHECK(get_output(unknown_select) != get_output(pruned_clamp) && get_output(mixed_select) != get_output(half));
+  RUKH_CHECK(g.get_values().get_type(get_output(mixed_select)) == rukh::test::k_float);
+}
+
+/// range_pruner: constant conditions of a float type are read as floats (-0.f is false), and a select whose condition
+/// is not a valid value is kept
+RUKH_TEST(range_pruner_conditions)
+{
+  rukh::graph g;
+  rukh::value_table& values = g.get_values();
+  const rukh::value a = values.add(rukh::test::k_float);
+  const rukh::value b = values.add(rukh::test::k_float);
+  const rukh::value negative_zero = values.add_constant_of(rukh::test::k_float, -0.f);
+  const rukh::value half_one = values.add_constant_of(rukh::test::k_float, 0.5f);
+  const rukh::value true_bool = values.add_constant_of(rukh::test::k_bool, uint32_t(1));
+
+  rukh::range_analysis ranges(g);
+  ranges.set_float_types({rukh::test::k_float});
+  rukh::ir::function fnc;
+  rukh::ir::builder builder(fnc, values);
+  rukh::range_pruner pruner(builder, ranges);
+  RUKH_CHECK(pruner.emit(rukh::opcode::select, rukh::test::k_float, {negative_zero, a, b}) == b);
+  RUKH_CHECK(pruner.emit(rukh::opcode::select, rukh::test::k_float, {half_one, a, b}) == a);
+  RUKH_CHECK(pruner.emit(rukh::opcode::select, rukh::test::k_float, {true_bool, a, b}) == a);
+  RUKH_CHECK(pruner.get_pruned_count() == 3 && fnc.get_instructions().empty());
+
+  // (not replaced by an operand: the builder then rejects the invalid condition)
+  RUKH_CHECK(!pruner.emit(rukh::opcode::select, rukh::test::k_float, {rukh::value{}, a, b}).is_valid() && pruner.get_pruned_count() == 3);
+}
@@ -0,0 +1,587 @@
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace rukh::test
+{
+  /// a + b, logging its tag when resolved (and failing validation when asked to)
+  struct tag_node : node<tag_node, rk_str("tag"), inputs<pin<rk_str("a"), rk_str("float")>, pin<rk_str("b"), rk_str("float")>>,
+                         outputs<pin<rk_str("value"), rk_str("float")>>, params<>>
+  {
+    static constexpr const char* description = "a tagged a + b";
+    uint32_t tag = 0;
+    bool fail = false;
+    uint32_t resolve_count = 0;
+
+    bool resolve_output_types(reporter& r) override
+    {
+      ++resolve_count;
+      r.log(reporter::severity_t::message, "resolved {}", tag);
+      output<rk_str("value")>().set_type(k_float);
+      return true;
+    }
+    bool validate(reporter& r) const override
+    {
+      if (fail)
+        r.log(reporter::severity_t::error, "{} failed", tag);
+      return !fail;
+    }
+    bool is_constant() const override { return false; }
+    void const_generate(reporter&, value_table&) override {}
+    bool generate(reporter&, generator&) override { return false; }
+  };
+
+  /// \brief Fill a graph with some inputs and \p count tag nodes connected to random previous nodes
+  inline std::vector<node_handle> make_tag_graph(graph& g, uint32_t count, uint32_t seed)
+  {
+    std::mt19937 rng(seed);
+    std::vector<node_handle> values;
+    for (uint32_t i = 0; i < 16; ++i)
+      values.push_back(g.add_node<input_node>());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      const node_handle n = g.add_node<tag_node>();
+      static_cast<tag_node&>(g.get_node(n)).tag = i;
+      g.connect(values[rng() % values.size()], 0, n, 0);
+      g.connect(values[values.size() - 1 - rng() % std::min<size_t>(values.size(), 8)], 0, n, 1);
+      values.push_back(n);
+    }
+    return values;
+  }
+
+  /// \brief Return the messages logged by a resolution of the graph
+  inline std::vector<std::string> resolve_logs(graph& g, thread_pool* pool, bool& success)
+  {
+    reporter r;
+    r.set_buffering(true);
+    resolver res(g);
+    success = res.resolve(r, pool);
+    std::vector<std::string> ret;
+    for (const reporter::ser_log& it : r.take_buffer())
+      ret.push_back(it.format());
+    return ret;
+  }
+
+  /// \brief Make \p dst a copy of \p src: the same nodes (with the same indices), connections and output nodes
+  inline void copy_graph(const graph& src, graph& dst)
+  {
+    dst.clear();
+    src.for_each_node([&](node_handle n, const base_node&) { dst.add_copy(src, n); });
+    const graph::edge_table& edges = src.get_edges();
+    for (uint32_t e = 0; e < edges.size(); ++e)
+      dst.connect({edges.src_node[e]}, edges.src_pin[e], {edges.dst_node[e]}, edges.dst_pin[e]);
+    for (const uint32_t n : src.get_output_nodes())
+      dst.set_output_node({n});
+  }
+
+  /// \brief Return the (sorted) hashes of the instructions of a function, each hash covering the instructions it
+  /// depends on: two functions computing the same things give the same hashes, whatever the order of their instructions
+  inline std::vector<uint64_t> hash_instructions(const ir::function& fnc, const value_table& values)
+  {
+    std::vector<uint64_t> hashes(fnc.get_instruction_count());
+    for (ir::id i = 0; i < hashes.size(); ++i)
+    {
+      const ir::instruction& ins = fnc.get_instruction(i);
+      const type::ref t = fnc.get_type(i);
+      uint64_t h = hash_bytes(k_hash_seed, &ins.op, sizeof(ins.op));
+      h = hash_bytes(h, &t, sizeof(t));
+      if (ins.op == opcode::constant)
+      {
+        const span<const uint8_t> data = values.get_data(value(ins.immediate));
+        h = hash_bytes(h, data.data(), data.size());
+      }
+      else
+      {
+        h = hash_bytes(h, &ins.immediate, sizeof(ins.immediate));
+      }
+      for (const ir::id it : fnc.get_operands(i))
+        h = hash_bytes(h, &hashes[it], sizeof(hashes[it]));
+      hashes[i] = h;
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+  }
+
+  /// \brief Return the hashes of the IR generated by a resolver (see hash_instructions), empty on failure
+  inline std::vector<uint64_t> generate_hashes(graph& g, resolver& res, reporter& r)
+  {
+    ir::function fnc;
+    ir::builder b(fnc, g.get_values());
+    return res.generate(r, b) ? hash_instructions(fnc, g.get_values()) : std::vector<uint64_t>{};
+  }
+} // namespace rukh::test
+
+/// With a thread pool, the logs are replayed in the topological order whatever the number of threads, and are the
+/// same as the ones of a serial resolution
+RUKH_TEST(resolver_deterministic_logs)
+{
+  rukh::graph g;
+  rukh::test::make_tag_graph(g, 2000, 11);
+  bool success = false;
+  const std::vector<std::string> serial = rukh::test::resolve_logs(g, nullptr, success);
+  RUKH_CHECK(success && serial.size() == 2000);
+
+  for (const unsigned thread_count : {0u, 1u, 2u, 4u, 8u})
+  {
+    rukh::thread_pool pool(thread_count);
+    for (unsigned i = 0; i < 3; ++i)
+    {
+      const std::vector<std::string> parallel = rukh::test::resolve_logs(g, &pool, success);
+      RUKH_CHECK(success && parallel == serial);
+    }
+  }
+}
+
+/// Nodes logging in several steps (resolve_output_types() then validate()): a serial resolution, which runs each step
+/// on a whole batch, keeps the logs of each node together and gives the same sequence as with a thread pool
+RUKH_TEST(resolver_serial_logs_by_node)
+{
+  rukh::graph g;
+  const std::vector<rukh::node_handle> nodes = rukh::test::make_tag_graph(g, 500, 3);
+  for (size_t i = 16; i < nodes.size(); i += 7)
+    static_cast<rukh::test::tag_node&>(g.get_node(nodes[i])).fail = true;
+
+  bool success = true;
+  const std::vector<std::string> serial = rukh::test::resolve_logs(g, nullptr, success);
+  RUKH_CHECK(!success);
+  bool grouped = true;
+  for (size_t i = 0; i < serial.size(); ++i)
+  {
+    const size_t pos = serial[i].find(" failed");
+    if (pos != std::string::npos)
+      grouped = grouped && i > 0 && serial[i - 1] == "resolved " + serial[i].substr(0, pos);
+  }
+  RUKH_CHECK(grouped);
+
+  rukh::thread_pool pool(4);
+  const std::vector<std::string> parallel = rukh::test::resolve_logs(g, &pool, success);
+  RUKH_CHECK(!success && parallel == serial);
+}
+
+/// The nodes of a cycle (and the nodes that depend on them) are not resolved and are reported, the others are
+RUKH_TEST(resolver_cycle)
+{
+  rukh::graph g;
+  const rukh::node_handle in = g.add_node<rukh::test::input_node>();
+  rukh::node_handle cycle[3];
+  for (rukh::node_handle& it : cycle)
+  {
+    it = g.add_node<rukh::test::tag_node>();
+    g.connect(in, 0, it, 1);
+  }
+  g.connect(cycle[0], 0, cycle[1], 0);
+  g.connect(cycle[1], 0, cycle[2], 0);
+  g.connect(cycle[2], 0, cycle[0], 0);
+  const rukh::node_handle dependent = g.add_node<rukh::test::add_node>();
+  g.connect(cycle[2], 0, dependent, 0);
+  g.connect(in, 0, dependent, 1);
+  const rukh::node_handle independent = g.add_node<rukh::test::add_node>();
+  g.connect(in, 0, independent, 0);
+  g.connect(in, 0, independent, 1);
+
+  rukh::thread_pool pool(2);
+  for (rukh::thread_pool* p : {static_cast<rukh::thread_pool*>(nullptr), &pool})
+  {
+    rukh::reporter r;
+    r.set_buffering(true);
+    rukh::resolver res(g);
+    RUKH_CHECK(!res.resolve(r, p));
+    RUKH_CHECK(res.get_stats().in_cycle == 4 && res.get_stats().resolved == 2 && res.get_stats().failed == 0);
+    RUKH_CHECK(res.get_order().size() == 2 && r.get_count(rukh::reporter::severity_t::error) == 1);
+    RUKH_CHECK(res.get_state(cycle[1]) == rukh::resolver::node_state::pending);
+    RUKH_CHECK(res.get_state(dependent) == rukh::resolver::node_state::pending);
+    RUKH_CHECK(res.get_state(independent) == rukh::resolver::node_state::resolved);
+  }
+}
+
+/// Under the work-stealing pool, a node that fails makes the nodes depending on it skipped (and silent),
+/// every other node is resolved
+RUKH_TEST(resolver_failing_node)
+{
+  rukh::graph g;
+  const std::vector<rukh::node_handle> nodes = rukh::test::make_tag_graph(g, 3000, 5);
+  const rukh::node_handle failing = nodes[16 + 100];
+  static_cast<rukh::test::tag_node&>(g.get_node(failing)).fail = true;
+
+  // the nodes that (directly or not) depend on the failing node:
+  std::vector<bool> depends(g.get_node_count(), false);
+  depends[failing.index] = true;
+  uint32_t dependent_count = 0;
+  for (const rukh::node_handle n : nodes) // (nodes are created after their inputs)
+  {
+    bool found = false;
+    g.for_each_input_edge(n, [&](rukh::edge_handle e) { found = found || depends[g.get_edges().src_node[e.index]]; });
+    if (found && n != failing)
+    {
+      depends[n.index] = true;
+      ++dependent_count;
+    }
+  }
+  RUKH_CHECK(dependent_count > 0);
+
+  rukh::thread_pool pool(4);
+  rukh::reporter r;
+  r.set_buffering(true);
+  rukh::resolver res(g);
+  RUKH_CHECK(!res.resolve(r, &pool));
+  RUKH_CHECK(res.get_stats().failed == 1 && res.get_stats().skipped == dependent_count && res.get_stats().in_cycle == 0);
+  RUKH_CHECK(res.get_stats().resolved == g.get_node_count() - 1 - dependent_count);
+  bool states_valid = true;
+  for (const rukh::node_handle n : nodes)
+  {
+    const rukh::resolver::node_state expected = n == failing ? rukh::resolver::node_state::failed
+                                              : depends[n.index] ? rukh::resolver::node_state::skipped
+                                              : rukh::resolver::node_state::resolved;
+    states_valid = states_valid && res.get_state(n) == expected;
+  }
+  RUKH_CHECK(states_valid);
+
+  // the skipped nodes do not log anything, the failing node logs its error:
+  const std::vector<rukh::reporter::ser_log> logs = r.take_buffer();
+  RUKH_CHECK(r.get_count(rukh::reporter::severity_t::error) == 1);
+  RUKH_CHECK(r.get_count(rukh::reporter::severity_t::message) == 3000 - dependent_count);
+  RUKH_CHECK(std::any_of(logs.begin(), logs.end(), [](const rukh::reporter::ser_log& l) { return l.format() == "100 failed"; }));
+}
+
+/// update() after editing a param that does not change the output type of its node: only that node is re-resolved,
+/// the nodes connected to it only get their structural hash recomputed
+RUKH_TEST(resolver_update_early_cutoff)
+{
+  rukh::graph g;
+  const rukh::node_handle a = g.add_node<rukh::test::input_node>();
+  const rukh::node_handle b = g.add_node<rukh::test::input_node>();
+  static_cast<rukh::test::input_node&>(g.get_node(b)).index = 1;
+  const rukh::node_handle op = g.add_node<rukh::test::op_node>();
+  g.connect(a, 0, op, 0);
+  g.connect(b, 0, op, 1);
+  std::vector<rukh::node_handle> chain;
+  rukh::node_handle previous = op;
+  for (uint32_t i = 0; i < 8; ++i)
+  {
+    chain.push_back(g.add_node<rukh::test::tag_node>());
+    g.connect(previous, 0, chain.back(), 0);
+    g.connect(b, 0, chain.back(), 1);
+    previous = chain.back();
+  }
+  const auto resolve_counts = [&g, &chain]
+  {
+    std::vector<uint32_t> ret;
+    for (const rukh::node_handle n : chain)
+      ret.push_back(static_cast<const rukh::test::tag_node&>(g.get_node(n)).resolve_count);
+    return ret;
+  };
+
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  const std::vector<uint32_t> counts = resolve_counts();
+  RUKH_CHECK(counts == std::vector<uint32_t>(8, 1));
+  const rukh::hash_t op_hash = res.get_structural_hash(op);
+  const rukh::hash_t last_hash = res.get_structural_hash(chain.back());
+
+  // add -> mul: the output of op is still a float
+  g.edit_param(op, 0).set_type(rukh::test::k_mul_op);
+  RUKH_CHECK(res.update(r));
+  RUKH_CHECK(res.get_updated_nodes().size() == 1 && res.get_updated_nodes()[0] == op.index);
+  RUKH_CHECK(resolve_counts() == counts);
+  RUKH_CHECK(res.get_stats().resolved == g.get_node_count());
+  // (the structural hashes depend on the param, and are propagated)
+  RUKH_CHECK(res.get_structural_hash(op) != op_hash && res.get_structural_hash(chain.back()) != last_hash);
+
+  // an invalid op: op fails, and the whole chain is re-run (skipped)
+  g.edit_param(op, 0).set_type(rukh::test::k_float);
+  RUKH_CHECK(!res.update(r));
+  RUKH_CHECK(res.get_updated_nodes().size() == 9 && res.get_state(op) == rukh::resolver::node_state::failed);
+  RUKH_CHECK(res.get_stats().skipped == 8 && resolve_counts() == counts);
+
+  // back to add: the chain is resolved again, and has the structural hashes of the first resolution
+  g.edit_param(op, 0).set_type(rukh::type::ref::zero);
+  RUKH_CHECK(res.update(r));
+  RUKH_CHECK(res.get_updated_nodes().size() == 9 && resolve_counts() == std::vector<uint32_t>(8, 2));
+  RUKH_CHECK(res.get_structural_hash(op) == op_hash && res.get_structural_hash(chain.back()) == last_hash);
+
+  // nothing to do:
+  RUKH_CHECK(res.update(r) && res.get_updated_nodes().empty());
+}
+
+/// Liveness: with output nodes, a subgraph that does not contribute to them is neither resolved nor generated,
+/// and the nodes of the output cone are
+RUKH_TEST(resolver_dead_nodes)
+{
+  rukh::graph g;
+  const rukh::node_handle a = g.add_node<rukh::test::input_node>();
+  const rukh::node_handle b = g.add_node<rukh::test::input_node>();
+  static_cast<rukh::test::input_node&>(g.get_node(b)).index = 1;
+  const rukh::node_handle sum = g.add_node<rukh::test::add_node>();
+  g.connect(a, 0, sum, 0);
+  g.connect(b, 0, sum, 1);
+  const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+  g.connect(sum, 0, out, 0);
+  g.set_output_node(out);
+
+  // a disconnected subgraph, and a branch of the output cone that does not go to the output:
+  std::vector<rukh::node_handle> dead;
+  dead.push_back(g.add_node<rukh::test::input_node>());
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    dead.push_back(g.add_node<rukh::test::tag_node>());
+    g.connect(dead[dead.size() - 2], 0, dead.back(), 0);
+    g.connect(dead[0], 0, dead.back(), 1);
+  }
+  const rukh::node_handle dead_out = g.add_node<rukh::test::output_node>();
+  g.connect(dead.back(), 0, dead_out, 0);
+  dead.push_back(dead_out);
+  dead.push_back(g.add_node<rukh::test::op_node>());
+  g.connect(sum, 0, dead.back(), 0);
+  g.connect(a, 0, dead.back(), 1);
+  g.edit_param(dead.back(), 0).set_type(rukh::test::k_mul_op);
+
+  rukh::thread_pool pool(2);
+  for (rukh::thread_pool* p : {static_cast<rukh::thread_pool*>(nullptr), &pool})
+  {
+    rukh::reporter r;
+    r.set_buffering(true);
+    rukh::resolver res(g);
+    RUKH_CHECK(res.resolve(r, p));
+    RUKH_CHECK(res.get_stats().dead == dead.size() && res.get_stats().resolved == 4 && res.get_order().size() == 4);
+    RUKH_CHECK(r.get_count(rukh::reporter::severity_t::debug) == 1 && !r.has_errors());
+    bool all_dead = true;
+    for (const rukh::node_handle n : dead)
+      all_dead = all_dead && res.get_state(n) == rukh::resolver::node_state::dead;
+    RUKH_CHECK(all_dead && res.get_state(out) == rukh::resolver::node_state::resolved);
+    RUKH_CHECK(static_cast<const rukh::test::tag_node&>(g.get_node(dead[1])).resolve_count == 0);
+
+    // only the output cone is generated (the dead output is not):
+    rukh::pass_runner runner(g);
+    runner.build(res.get_order());
+    rukh::ir::function fnc;
+    rukh::ir::builder builder(fnc, g.get_values());
+    RUKH_CHECK(runner.generate(r, builder));
+    uint32_t counts[3] = {0, 0, 0}; // inputs, add, output
+    for (const rukh::ir::instruction& it : fnc.get_instructions())
+    {
+      counts[0] += it.op == rukh::opcode::input ? 1 : 0;
+      counts[1] += it.op == rukh::opcode::add ? 1 : 0;
+      counts[2] += it.op == rukh::opcode::output ? 1 : 0;
+    }
+    RUKH_CHECK(fnc.get_instruction_count() == 4 && counts[0] == 2 && counts[1] == 1 && counts[2] == 1);
+  }
+
+  // flagging the dead output as an output of the graph: update() resolves its cone
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  g.set_output_node(dead_out);
+  RUKH_CHECK(res.update(r));
+  RUKH_CHECK(res.get_stats().dead == 1 && res.get_stats().resolved == g.get_node_count() - 1);
+  RUKH_CHECK(res.get_updated_nodes().size() == dead.size() - 1 && res.get_state(dead.back()) == rukh::resolver::node_state::dead);
+  RUKH_CHECK(static_cast<const rukh::test::tag_node&>(g.get_node(dead[1])).resolve_count == 1);
+}
+
+/// Editing connections: the order is patched (not computed again), and only the cone of the edit is resolved and
+/// generated again (the other nodes get their recorded IR replayed). A connection that makes a cycle falls back to
+/// computing the order again.
+RUKH_TEST(resolver_update_connection_edit)
+{
+  rukh::graph g;
+  std::vector<rukh::node_handle> inputs;
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    inputs.push_back(g.add_node<rukh::test::input_node>());
+    static_cast<rukh::test::input_node&>(g.get_node(inputs.back())).index = i;
+  }
+  std::vector<rukh::node_handle> chain;
+  for (uint32_t i = 0; i < 8; ++i)
+  {
+    chain.push_back(g.add_node<rukh::test::op_node>());
+    g.connect(i == 0 ? inputs[0] : chain[i - 1], 0, chain.back(), 0);
+    g.connect(inputs[1], 0, chain.back(), 1);
+  }
+  const rukh::node_handle out = g.add_node<rukh::test::output_node>();
+  g.connect(chain.back(), 0, out, 0);
+  g.set_output_node(out);
+
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r) && res.get_stats().dead == 1);
+  const std::vector<uint64_t> first_ir = rukh::test::generate_hashes(g, res, r);
+  RUKH_CHECK(!first_ir.empty() && res.get_generation_stats().generated == 11 && res.get_generation_stats().replayed == 0);
+  // nothing changed: every node is replayed
+  RUKH_CHECK(rukh::test::generate_hashes(g, res, r) == first_ir && res.get_generation_stats().generated == 0);
+  RUKH_CHECK(res.get_generation_stats().replayed == 11);
+
+  // compare the state, the structural hashes and the IR to the ones of a graph built with the edits
+  const auto check_same_as_new_graph = [&](const char* what)
+  {
+    rukh::graph copy;
+    rukh::test::copy_graph(g, copy);
+    rukh::reporter copy_r;
+    rukh::resolver copy_res(copy);
+    copy_res.resolve(copy_r);
+    bool same_nodes = true;
+    for (uint32_t n = 0; n < g.get_node_count(); ++n)
+    {
+      same_nodes = same_nodes && res.get_state({n}) == copy_res.get_state({n});
+      same_nodes = same_nodes && res.get_structural_hash({n}) == copy_res.get_structural_hash({n});
+    }
+    RUKH_CHECK(same_nodes);
+    const std::vector<uint64_t> copy_ir = rukh::test::generate_hashes(copy, copy_res, copy_r);
+    if (!RUKH_CHECK(rukh::test::generate_hashes(g, res, r) == copy_ir))
+      printf("  IR mismatch after %s\n", what);
+  };
+
+  // chain[3].b: inputs[1] -> inputs[2] (a dead node, that is now live)
+  RUKH_CHECK(g.disconnect(g.find_input_edge(chain[3], 1)));
+  g.connect(inputs[2], 0, chain[3], 1);
+  RUKH_CHECK(res.update(r) && !res.get_stats().rebuilt_topology && res.get_stats().dead == 0);
+  RUKH_CHECK(res.get_updated_nodes().size() == 2 && res.get_updated_nodes()[1] == chain[3].index);
+  const std::vector<uint64_t> second_ir = rukh::test::generate_hashes(g, res, r);
+  RUKH_CHECK(second_ir != first_ir && second_ir.size() == first_ir.size() + 1);
+  RUKH_CHECK(res.get_generation_stats().generated == 2 && res.get_generation_stats().replayed == 10);
+  check_same_as_new_graph("rewiring");
+
+  // a new node, connected to a node that is before it in the order (it is moved before it)
+  const rukh::node_handle side = g.add_node<rukh::test::op_node>();
+  g.edit_param(side, 0).set_type(rukh::test::k_mul_op);
+  g.connect(inputs[0], 0, side, 0);
+  g.connect(inputs[2], 0, side, 1);
+  RUKH_CHECK(g.disconnect(g.find_input_edge(chain[1], 1)));
+  g.connect(side, 0, chain[1], 1);
+  RUKH_CHECK(res.update(r) && !res.get_stats().rebuilt_topology);
+  RUKH_CHECK(res.get_updated_nodes().size() == 2 && res.get_updated_nodes()[0] == side.index);
+  const rukh::span<const uint32_t> order = res.get_order();
+  RUKH_CHECK(std::find(order.begin(), order.end(), side.index) < std::find(order.begin(), order.end(), chain[1].index));
+  rukh::test::generate_hashes(g, res, r);
+  RUKH_CHECK(res.get_generation_stats().generated == 2 && res.get_generation_stats().replayed == 11);
+  check_same_as_new_graph("adding a node");
+
+  // disconnecting the output: everything is dead (and nothing is resolved)
+  const rukh::edge_handle out_edge = g.find_input_edge(out, 0);
+  RUKH_CHECK(g.disconnect(out_edge));
+  RUKH_CHECK(res.update(r) && !res.get_stats().rebuilt_topology && res.get_stats().dead == g.get_node_count() - 1);
+  RUKH_CHECK(res.get_updated_nodes().size() == 1 && res.get_updated_nodes()[0] == out.index);
+  g.connect(chain.back(), 0, out, 0);
+  RUKH_CHECK(res.update(r) && !res.get_stats().rebuilt_topology && res.get_stats().dead == 0);
+  RUKH_CHECK(res.get_updated_nodes().size() == g.get_node_count());
+  check_same_as_new_graph("reconnecting the output");
+
+  // a cycle: the order is computed again
+  RUKH_CHECK(g.disconnect(g.find_input_edge(chain[2], 1)));
+  g.connect(chain[5], 0, chain[2], 1);
+  RUKH_CHECK(!res.update(r) && res.get_stats().rebuilt_topology && res.get_stats().in_cycle == 7);
+  RUKH_CHECK(g.disconnect(g.find_input_edge(chain[2], 1)));
+  g.connect(inputs[1], 0, chain[2], 1);
+  RUKH_CHECK(res.update(r) && res.get_stats().rebuilt_topology && res.get_stats().in_cycle == 0);
+  check_same_as_new_graph("breaking the cycle");
+}
+
+/// Random connection edits, new nodes and output nodes: the patched order, liveness, states, structural hashes and IR
+/// match the ones of a graph built with the edits
+RUKH_TEST(resolver_update_random_edits)
+{
+  constexpr uint32_t k_add_count = 400;
+  rukh::graph g;
+  rukh::test::make_graph(g, k_add_count, 7);
+  const uint32_t original_count = static_cast<uint32_t>(g.get_node_count());
+  const uint32_t first_add = 32; // (see make_graph)
+  std::mt19937 rng(11);
+
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r));
+  rukh::test::generate_hashes(g, res, r);
+
+  uint32_t patched = 0;
+  uint32_t generated = 0;
+  uint32_t replayed = 0;
+  bool all_same = true;
+  for (uint32_t round = 0; round < 40; ++round)
+  {
+    for (uint32_t edit = 0; edit < 3; ++edit)
+    {
+      // (every connection goes to an original node from an original node before it, or to a new node
+      // that is connected to an original node after its inputs: the graph stays acyclic)
+      const rukh::node_handle dst{first_add + static_cast<uint32_t>(rng() % k_add_count)};
+      const uint32_t pin = rng() % 2;
+      switch (rng() % 4)
+      {
+        case 0: case 1: // rewire an input
+        {
+          g.disconnect(g.find_input_edge(dst, pin));
+          g.connect({static_cast<uint32_t>(rng() % dst.index)}, 0, dst, pin);
+          break;
+        }
+        case 2: // insert a new node
+        {
+          const rukh::node_handle n = g.add_node<rukh::test::add_node>();
+          g.connect({static_cast<uint32_t>(rng() % dst.index)}, 0, n, 0);
+          g.connect({static_cast<uint32_t>(rng() % dst.index)}, 0, n, 1);
+          g.disconnect(g.find_input_edge(dst, pin));
+          g.connect(n, 0, dst, pin);
+          break;
+        }
+        case 3: // flag / unflag an output node (the original one is kept)
+        {
+          g.set_output_node(dst, !g.is_output_node(dst));
+          break;
+        }
+      }
+    }
+
+    RUKH_CHECK(res.update(r));
+    patched += res.get_stats().rebuilt_topology ? 0 : 1;
+    const std::vector<uint64_t> ir = rukh::test::generate_hashes(g, res, r);
+    generated += res.get_generation_stats().generated;
+    replayed += res.get_generation_stats().replayed;
+
+    rukh::graph copy;
+    rukh::test::copy_graph(g, copy);
+    rukh::reporter copy_r;
+    rukh::resolver copy_res(copy);
+    RUKH_CHECK(copy_res.resolve(copy_r));
+    for (uint32_t n = 0; n < g.get_node_count(); ++n)
+    {
+      all_same = all_same && res.get_state({n}) == copy_res.get_state({n});
+      all_same = all_same && res.get_structural_hash({n}) == copy_res.get_structural_hash({n});
+    }
+    std::vector<uint32_t> order(res.get_order().begin(), res.get_order().end());
+    std::vector<uint32_t> copy_order(copy_res.get_order().begin(), copy_res.get_order().end());
+    std::sort(order.begin(), order.end());
+    std::sort(copy_order.begin(), copy_order.end());
+    all_same = all_same && order == copy_order && ir == rukh::test::generate_hashes(copy, copy_res, copy_r);
+  }
+  RUKH_CHECK(all_same);
+  RUKH_CHECK(patched == 40);
+  RUKH_CHECK(g.get_node_count() > original_count);
+  printf("  %u nodes generated, %u replayed\n", generated, replayed);
+  RUKH_CHECK(generated < replayed / 10);
+}
+
+/// Scaling of the resolution of a graph with the number of threads of the pool (1 to N: the number of hardware
+/// threads, at least 4), compared to a serial resolution
+RUKH_TEST(resolver_scaling_benchmark)
+{
+  constexpr uint32_t k_node_count = 200000;
+  rukh::graph g;
+  rukh::test::make_graph(g, k_node_count, 3);
+  rukh::reporter r;
+  rukh::resolver res(g);
+  const double serial_rate = rukh::test::bench("resolve (serial)", g.get_node_count(), "nodes", [&] { RUKH_CHECK(res.resolve(r)); });
+
+  const unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+  for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+  {
+    rukh::thread_pool pool(thread_count);
+    const std::string name = "resolve (" + std::to_string(thread_count) + " thread(s))";
+    const double rate = rukh::test::bench(name.c_str(), g.get_node_count(), "nodes", [&] { RUKH_CHECK(res.resolve(r, &pool)); });
+    printf("  %.2fx the serial nodes/s (%u hardware threads)\n", rate / serial_rate, std::thread::hardware_concurrency());
+  }
+}
@@ -0,0 +1,118 @@
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace
+{
+  std::string get_temp_path(const char* name)
+  {
+    return (std::filesystem::temp_directory_path() / name).string();
+  }
+} // namespace
+
+/// Loading an image chunk by chunk gives the same resolved graph as instantiating it and resolving it, whatever the
+/// size of the chunks
+RUKH_TEST(stream_loader_round_trip)
+{
+  const rukh::node_registry registry = rukh::test::make_registry();
+  rukh::graph source;
+  rukh::test::make_graph(source, 5000, 9);
+  const std::string path = get_temp_path("rukh-test-stream.rkgi");
+  RUKH_CHECK(rukh::graph_image::from_graph(source).save_image(path));
+
+  rukh::reporter r;
+  rukh::graph reference;
+  const std::optional<rukh::graph_image> image = rukh::graph_image::load_image(path);
+  if (!RUKH_CHECK(image.has_value()))
+    return;
+  RUKH_CHECK(image->instantiate(reference, registry, r));
+  rukh::resolver res(reference);
+  RUKH_CHECK(res.resolve(r) && res.get_stats().resolved > 1000);
+
+  for (const uint32_t chunk_size : {1u, 7u, 1000u, rukh::stream_loader::k_default_chunk_size})
+  {
+    rukh::graph g;
+    rukh::stream_loader loader(g, registry, chunk_size);
+    RUKH_CHECK(loader.load(path, r));
+    const uint32_t node_count = static_cast<uint32_t>(g.get_node_count());
+    RUKH_CHECK(node_count == reference.get_node_count() && g.get_edge_count() == reference.get_edge_count());
+    RUKH_CHECK(loader.get_stats().resolved == node_count && loader.get_base() == 0);
+    RUKH_CHECK(loader.get_chunk_count() == (node_count + chunk_size - 1) / chunk_size);
+
+    // same nodes (in the same order), same types, same constants as the live nodes of the reference:
+    bool same = true;
+    for (uint32_t n = 0; same && n < node_count; ++n)
+    {
+      const rukh::base_node& a = g.get_node({n});
+      const rukh::base_node& b = reference.get_node({n});
+      same = a.get_name_hash() == b.get_name_hash() && loader.get_state({n}) == rukh::stream_loader::node_state::resolved;
+      if (res.get_state({n}) == rukh::resolver::node_state::dead) // (the stream loader does not prune dead nodes)
+        continue;
+      for (uint32_t i = 0; same && i < a.get_output_impls().size(); ++i)
+      {
+        const rukh::value va = a.get_output_impls()[i].get_value();
+        const rukh::value vb = b.get_output_impls()[i].get_value();
+        float fa = 0;
+        float fb = 0;
+        same = a.get_output_impls()[i].get_type() == b.get_output_impls()[i].get_type();
+        same = same && va.is_valid() == vb.is_valid();
+        if (same && va.is_valid())
+          same = g.get_values().get(va, fa) && reference.get_values().get(vb, fb) && fa == fb;
+      }
+      for (uint32_t i = 0; same && i < a.get_param_impls().size(); ++i)
+        same = a.get_param_impls()[i].get_type() == b.get_param_impls()[i].get_type();
+    }
+    RUKH_CHECK(same);
+    RUKH_CHECK(g.get_output_nodes().size() == 1);
+  }
+  std::filesystem::remove(path);
+}
+
+/// Truncated images, images with unknown node kinds and graphs that are not in topological order are rejected
+RUKH_TEST(stream_loader_rejects)
+{
+  const rukh::node_registry registry = rukh::test::make_registry();
+  rukh::graph source;
+  rukh::test::make_graph(source, 2000, 4);
+  const std::string path = get_temp_path("rukh-test-stream-truncated.rkgi");
+  const rukh::graph_image image = rukh::graph_image::from_graph(source);
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(static_cast<const char*>(image.get_data()), static_cast<std::streamsize>(image.get_image_size() / 2));
+  }
+  rukh::reporter r;
+  r.set_buffering(true);
+  rukh::graph g;
+  rukh::stream_loader loader(g, registry, 100);
+  RUKH_CHECK(!loader.load(path, r) && g.get_node_count() == 0 && r.has_errors());
+  RUKH_CHECK(!loader.load(get_temp_path("rukh-test-does-not-exist.rkgi"), r) && g.get_node_count() == 0);
+  std::filesystem::remove(path);
+
+  // an unknown node kind: the loading stops at its chunk
+  rukh::node_registry partial;
+  partial.add<rukh::test::constant_node>();
+  partial.add<rukh::test::input_node>();
+  partial.add<rukh::test::add_node>();
+  rukh::stream_loader partial_loader(g, partial, 100);
+  RUKH_CHECK(!partial_loader.load(image, r));
+  RUKH_CHECK(g.get_node_count() > 0 && g.get_node_count() < source.get_node_count() && g.get_node_count() % 100 != 0);
+
+  // a cycle:
+  rukh::graph cycle;
+  const rukh::node_handle a = cycle.add_node<rukh::test::add_node>();
+  const rukh::node_handle b = cycle.add_node<rukh::test::add_node>();
+  cycle.connect(a, 0, b, 0);
+  cycle.connect(b, 0, a, 0);
+  const rukh::graph_image cycle_image = rukh::graph_image::from_graph(cycle);
+  rukh::graph g2;
+  rukh::stream_loader cycle_loader(g2, registry);
+  RUKH_CHECK(!cycle_image.is_topological() && !cycle_loader.load(cycle_image, r) && g2.get_node_count() == 0);
+}
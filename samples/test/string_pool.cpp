@@ -0,0 +1,43 @@
+
+#include <string>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+/// Interning the same string twice gives the same handle, and the returned views stay valid (and at the same address)
+/// as the pool grows, and when it is moved
+RUKH_TEST(string_pool_interning)
+{
+  rukh::string_pool pool;
+  const rukh::interned_string a = pool.intern("position");
+  const std::string copy = "position"; // (another buffer, same content)
+  RUKH_CHECK(pool.intern(copy) == a && pool.size() == 1);
+  RUKH_CHECK(a.is_valid() && a.hash == rukh::hash_string("position"));
+  RUKH_CHECK(pool.find("position") == a && !pool.find("normal").is_valid());
+  RUKH_CHECK(pool.find("normal").hash == rukh::hash_string("normal"));
+  RUKH_CHECK(pool.get(rukh::interned_string{}).empty());
+
+  // enough strings to use several chunks, and a few big ones:
+  std::vector<rukh::interned_string> handles;
+  std::vector<std::string_view> views;
+  for (unsigned i = 0; i < 20000; ++i)
+  {
+    const std::string str = (i % 1000 == 0 ? std::string(40000, 'x') : "member-") + std::to_string(i);
+    handles.push_back(pool.intern(str));
+    views.push_back(pool.get(handles.back()));
+  }
+  const std::string_view position = pool.get(a);
+  RUKH_CHECK(pool.size() == 20001);
+
+  rukh::string_pool moved = std::move(pool);
+  bool stable = moved.get(a).data() == position.data() && position == "position";
+  for (unsigned i = 0; i < handles.size(); ++i)
+  {
+    const std::string str = (i % 1000 == 0 ? std::string(40000, 'x') : "member-") + std::to_string(i);
+    stable = stable && moved.get(handles[i]).data() == views[i].data() && views[i] == str && views[i].data()[str.size()] == 0;
+    stable = stable && moved.intern(str) == handles[i];
+  }
+  RUKH_CHECK(stable && moved.size() == 20001);
+}
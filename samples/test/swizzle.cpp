@@ -0,0 +1,52 @@
+
+#include <string>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+
+namespace rukh::test
+{
+  // the table is usable at compile-time:
+  static_assert(swizzle::find(rukh_str_hash("wzyx"))->length == 4 && swizzle::find(rukh_str_hash("wzyx"))->get_component(0) == 3);
+  static_assert(swizzle::find(rukh_str_hash("rg"), 2)->required_dim == 2 && swizzle::find(rukh_str_hash("rgb"), 2) == nullptr);
+  static_assert(swizzle::find(rukh_str_hash("xr")) == nullptr && swizzle::find(hash_t::zero) == nullptr);
+} // namespace rukh::test
+
+/// Every xyzw / rgba swizzle of 1 to 4 components is found (with its components), and other names are not
+RUKH_TEST(swizzle_lookup)
+{
+  unsigned found_count = 0;
+  for (const char* set : {"xyzw", "rgba"})
+  {
+    for (unsigned length = 1; length <= 4; ++length)
+    {
+      for (unsigned combination = 0; combination < (1u << (2 * length)); ++combination)
+      {
+        std::string name;
+        unsigned required_dim = 0;
+        for (unsigned i = 0; i < length; ++i)
+        {
+          const unsigned component = (combination >> (2 * i)) & 3;
+          name += set[component];
+          required_dim = component + 1 > required_dim ? component + 1 : required_dim;
+        }
+
+        const rukh::swizzle::entry* e = rukh::swizzle::find(rukh::hash_string(name));
+        if (!RUKH_CHECK(e != nullptr))
+          continue;
+        ++found_count;
+        bool components_valid = e->length == length && e->required_dim == required_dim;
+        for (unsigned i = 0; i < length; ++i)
+          components_valid = components_valid && set[e->get_component(i)] == name[i];
+        RUKH_CHECK(components_valid);
+        RUKH_CHECK(rukh::swizzle::find(rukh::hash_string(name), required_dim) == e);
+        RUKH_CHECK(rukh::swizzle::find(rukh::hash_string(name), required_dim - 1) == nullptr);
+      }
+    }
+  }
+  RUKH_CHECK(found_count == rukh::swizzle::k_entry_count);
+
+  for (const char* name : {"", "q", "X", "xr", "gx", "xyzwx", "rgbar", "xx ", "xyzq", "position", "w0"})
+    RUKH_CHECK(rukh::swizzle::find(rukh::hash_string(name)) == nullptr);
+}
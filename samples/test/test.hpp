@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace rukh::test
+{
+  /// \brief A test, registered by RUKH_TEST and run by main()
+  struct test_case
+  {
+    const char* name;
+    void (*fnc)();
+  };
+
+  inline std::vector<test_case>& get_tests()
+  {
+    static std::vector<test_case> tests;
+    return tests;
+  }
+
+  /// \brief Number of failed checks (checks can be done from any thread)
+  inline std::atomic<unsigned>& get_failure_count()
+  {
+    static std::atomic<unsigned> count = {0};
+    return count;
+  }
+
+  struct registrar
+  {
+    registrar(const char* name, void (*fnc)()) { get_tests().push_back({name, fnc}); }
+  };
+
+  inline bool check(bool cond, const char* expr, const char* file, int line)
+  {
+    if (!cond)
+    {
+      ++get_failure_count();
+      fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    }
+    return cond;
+  }
+
+  /// \brief Time a function doing \p count operations, and print the throughput
+  /// \return the number of operations per second
+  template<typename Fnc>
+  double bench(const char* name, size_t count, const char* unit, Fnc&& fnc)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    fnc();
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    const double rate = duration.count() > 0 ? count / duration.count() : 0;
+    printf("  [bench] %s: %zu %s in %.3fms (%.3g %s/s)\n", name, count, unit, duration.count() * 1000, rate, unit);
+    return rate;
+  }
+} // namespace rukh::test
+
+/// \brief Define and register a test
+#define RUKH_TEST(name) \
+  static void rukh_test_##name(); \
+  static const rukh::test::registrar rukh_test_registrar_##name(#name, &rukh_test_##name); \
+  static void rukh_test_##name()
+
+/// \brief Check a condition (the test continues if it fails)
+#define RUKH_CHECK(x) rukh::test::check((x), #x, __FILE__, __LINE__)
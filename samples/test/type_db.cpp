@@ -0,0 +1,135 @@
+
+#include <string>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+#include "types.hpp"
+
+/// Queries made between registrations only compute what they need: the accepted types of a meta-type are not
+/// materialized by queries on other types, and a frozen snapshot (only made by freeze()) gives the same answers
+RUKH_TEST(type_db_queries_between_registrations)
+{
+  constexpr uint32_t k_type_count = 20000;
+  rukh::type_db db;
+  db.add_definition(rukh::test::make_concrete_type("float", 4));
+
+  unsigned getter_calls = 0;
+  rukh::type::definition any = rukh::test::make_meta_type("any", {});
+  any.subtypes_getter = [&getter_calls](rukh::type::ref) { ++getter_calls; return true; };
+  db.add_definition(std::move(any));
+
+  bool sizes_valid = true;
+  rukh::test::bench("add_definition + query", k_type_count, "types", [&]
+  {
+    for (uint32_t i = 0; i < k_type_count; ++i)
+    {
+      rukh::type::definition def = rukh::test::make_concrete_type("t" + std::to_string(i), 4);
+      def.members[rukh::hash_string("x")] = rukh::hash_string("float");
+      const rukh::type::ref id = def.type_id;
+      db.add_definition(std::move(def));
+      sizes_valid = sizes_valid && db.get_type(id).size() == 8 && db.get_type(id).is_valid();
+    }
+  });
+  RUKH_CHECK(sizes_valid);
+  RUKH_CHECK(getter_calls == 0);
+
+  const rukh::type any_type = db.get_type(rukh::hash_string("any"));
+  RUKH_CHECK(any_type.accepts(db.get_type(rukh::hash_string("t42"))));
+  RUKH_CHECK(getter_calls == k_type_count + 1);
+
+  const rukh::frozen_type_db frozen = db.freeze();
+  RUKH_CHECK(frozen.size() == db.size());
+  for (const char* name : {"float", "any", "t0", "t19999", "none"})
+  {
+    const rukh::type t = db.get_type(rukh::hash_string(name));
+    const rukh::frozen_type ft = frozen.get_type(rukh::hash_string(name));
+    RUKH_CHECK(t.get_ref() == ft.get_ref() && t.size() == ft.size() && t.is_valid() == ft.is_valid());
+    RUKH_CHECK(t.is_concrete() == ft.is_concrete() && t.has_member("x") == ft.has_member("x"));
+    RUKH_CHECK(any_type.accepts(t) == frozen.get_type(rukh::hash_string("any")).accepts(ft));
+  }
+}
+
+namespace
+{
+  /// Concrete types, meta-types accepting meta-types (so resolutions take the slow, recursive, path)
+  /// and structures whose members are meta-types
+  void add_nested_types(rukh::type_db& db)
+  {
+    for (const char* name : {"float", "int", "double"})
+      db.add_definition(rukh::test::make_concrete_type(name, 4));
+    db.add_definition(rukh::test::make_meta_type("a", {rukh::hash_string("float"), rukh::hash_string("int")}));
+    db.add_definition(rukh::test::make_meta_type("b", {rukh::hash_string("float")}));
+    db.add_definition(rukh::test::make_meta_type("big", {rukh::hash_string("a"), rukh::hash_string("double")}));
+    db.add_definition(rukh::test::make_meta_type("small", {rukh::hash_string("b")}));
+    for (const char* name : {"a", "b"})
+    {
+      rukh::type::definition def = rukh::test::make_concrete_type(std::string("s-") + name, 0);
+      def.members[rukh::hash_string("m")] = rukh::hash_string(name);
+      db.add_definition(std::move(def));
+    }
+  }
+} // namespace
+
+/// The recursive resolutions (of the members and of the subtypes) go through the resolution cache
+RUKH_TEST(type_db_resolution_cache)
+{
+  rukh::type_db db;
+  add_nested_types(db);
+  const auto get = [&db](const char* name) { return db.get_type(rukh::hash_string(name)); };
+
+  db.reset_resolution_cache_stats();
+  RUKH_CHECK(get("s-a").is_valid_resolution(get("s-b")));
+  RUKH_CHECK(db.get_resolution_cache_stats().hits == 0 && db.get_resolution_cache_stats().misses == 2);
+  // (computed by the member recursion)
+  RUKH_CHECK(get("a").is_valid_resolution(get("b")));
+  RUKH_CHECK(db.get_resolution_cache_stats().hits == 1 && db.get_resolution_cache_stats().misses == 2);
+
+  // the subtype recursion tests (a, b) again:
+  RUKH_CHECK(get("big").is_valid_resolution(get("small")));
+  const rukh::type_db::resolution_cache_stats stats = db.get_resolution_cache_stats();
+  RUKH_CHECK(stats.hits == 2 && stats.misses >= 3);
+  RUKH_CHECK(get("big").is_valid_resolution(get("small")));
+  RUKH_CHECK(db.get_resolution_cache_stats().hits == stats.hits + 1 && db.get_resolution_cache_stats().misses == stats.misses);
+  RUKH_CHECK(!get("small").is_valid_resolution(get("big")));
+
+  // adding a definition invalidates the cache:
+  const uint64_t misses = db.get_resolution_cache_stats().misses;
+  db.add_definition(rukh::test::make_concrete_type("half", 2));
+  RUKH_CHECK(get("a").is_valid_resolution(get("b")));
+  RUKH_CHECK(db.get_resolution_cache_stats().misses == misses + 1);
+
+  // same thing on a frozen snapshot:
+  const rukh::frozen_type_db frozen = db.freeze();
+  const auto get_frozen = [&frozen](const char* name) { return frozen.get_type(rukh::hash_string(name)); };
+  RUKH_CHECK(get_frozen("s-a").is_valid_resolution(get_frozen("s-b")));
+  RUKH_CHECK(frozen.get_resolution_cache_stats().hits == 0 && frozen.get_resolution_cache_stats().misses == 2);
+  RUKH_CHECK(get_frozen("big").is_valid_resolution(get_frozen("small")));
+  RUKH_CHECK(frozen.get_resolution_cache_stats().hits == 1);
+  RUKH_CHECK(!get_frozen("small").is_valid_resolution(get_frozen("big")));
+}
+
+/// The cached properties of a type are recomputed once a definition is added (here: the type of one of its members)
+RUKH_TEST(type_db_properties_invalidation)
+{
+  rukh::type_db db;
+  db.add_definition(rukh::test::make_concrete_type("float", 4));
+  rukh::type::definition s = rukh::test::make_concrete_type("s", 0);
+  s.members[rukh::hash_string("a")] = rukh::hash_string("float");
+  s.members[rukh::hash_string("b")] = rukh::hash_string("float3");
+  db.add_definition(std::move(s));
+
+  const rukh::type t = db.get_type(rukh::hash_string("s"));
+  RUKH_CHECK(!t.is_valid() && t.size() == 0 && !t.is_fully_concrete());
+  RUKH_CHECK(db.get_properties(t.def).size == 0); // (cached)
+
+  const uint64_t epoch = db.get_epoch();
+  db.add_definition(rukh::test::make_concrete_type("float3", 4, 3));
+  RUKH_CHECK(db.get_epoch() != epoch);
+  RUKH_CHECK(t.is_valid() && t.size() == 16 && t.is_fully_concrete());
+
+  // a rejected definition does not change anything:
+  const uint64_t epoch2 = db.get_epoch();
+  RUKH_CHECK(!db.add_definition(rukh::test::make_concrete_type("float", 8)));
+  RUKH_CHECK(db.get_epoch() == epoch2 && t.size() == 16);
+}
@@ -0,0 +1,124 @@
+
+#include <string>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "test.hpp"
+#include "types.hpp"
+
+/// Set operations, including sets of different sizes (the missing bits are not set)
+RUKH_TEST(type_set_operations)
+{
+  rukh::type_set a(10);
+  rukh::type_set b(200);
+  RUKH_CHECK(a.empty() && b.empty() && a == b);
+
+  a.set(1);
+  a.set(5);
+  a.set(130); // (grows the set)
+  b.set(5);
+  b.set(130);
+  b.set(199);
+  RUKH_CHECK(a.test(1) && a.test(130) && !a.test(2) && !a.test(100000));
+  RUKH_CHECK(a.count() == 3 && b.count() == 3);
+
+  RUKH_CHECK(a.intersects(b) && a.intersection_count(b) == 2);
+  const rukh::type_set i = a & b;
+  const rukh::type_set u = a | b;
+  RUKH_CHECK(i.count() == 2 && i.test(5) && i.test(130));
+  RUKH_CHECK(u.count() == 4 && u.test(1) && u.test(199));
+  RUKH_CHECK(i.is_subset_of(a) && i.is_subset_of(b) && a.is_subset_of(u) && !a.is_subset_of(b) && !u.is_subset_of(a));
+
+  std::vector<uint32_t> indices;
+  u.for_each([&indices](uint32_t index) { indices.push_back(index); });
+  RUKH_CHECK((indices == std::vector<uint32_t>{1, 5, 130, 199}));
+
+  // same content, different sizes:
+  rukh::type_set small(1);
+  small.set(5);
+  rukh::type_set big(1000);
+  big.set(5);
+  RUKH_CHECK(small == big && big.is_subset_of(small));
+  big.set(999);
+  RUKH_CHECK(small != big && small.is_subset_of(big) && (big & small) == small);
+
+  a.reset(1);
+  a.reset(100000); // (out of the set: nothing to do)
+  RUKH_CHECK(a == i && !a.intersects(rukh::type_set(1)));
+  a.clear();
+  RUKH_CHECK(a.empty() && a.count() == 0);
+}
+
+/// The accepted types of meta-types: unions of the accepted sets of their meta subtypes, and subtypes_getter only
+/// called for the concrete types that have been added since the last time
+RUKH_TEST(type_set_accepted_types)
+{
+  rukh::type_db db;
+  for (const char* name : {"float", "double", "int"})
+    db.add_definition(rukh::test::make_concrete_type(name, 4));
+  db.add_definition(rukh::test::make_meta_type("floating", {rukh::hash_string("float"), rukh::hash_string("double")}));
+  db.add_definition(rukh::test::make_meta_type("number", {rukh::hash_string("floating"), rukh::hash_string("int")}));
+
+  unsigned getter_calls = 0;
+  rukh::type::definition sized = rukh::test::make_meta_type("sized", {});
+  sized.subtypes_getter = [&getter_calls, &db](rukh::type::ref id)
+  {
+    ++getter_calls;
+    return db.get_type(id).def.size == 8;
+  };
+  db.add_definition(std::move(sized));
+
+  const auto get = [&db](const char* name) { return db.get_type(rukh::hash_string(name)); };
+  const rukh::type_set& floating = get("floating").get_accepted_types();
+  RUKH_CHECK(floating.count() == 2 && floating.test(db.get_concrete_index(rukh::hash_string("double"))));
+  const rukh::type_set& number = get("number").get_accepted_types();
+  RUKH_CHECK(number.count() == 3 && get("floating").get_accepted_types().is_subset_of(number));
+  RUKH_CHECK(get("number").accepts(get("int")) && !get("floating").accepts(get("int")) && !get("number").accepts(get("floating")));
+
+  RUKH_CHECK(get("sized").get_accepted_types().empty() && getter_calls == 3);
+  for (int i = 0; i < 3; ++i)
+    db.add_definition(rukh::test::make_concrete_type("wide" + std::to_string(i), 8));
+  RUKH_CHECK(get("sized").get_accepted_types().count() == 3 && getter_calls == 6);
+  RUKH_CHECK(get("sized").accepts(get("wide1")) && !get("sized").accepts(get("float")));
+  RUKH_CHECK(get("number").get_accepted_types().count() == 3 && !get("number").accepts(get("wide0")));
+}
+
+/// Meta-types reaching each other through their subtypes (A = {B, x}, B = {C, y}, C = {A, z}) all accept every type
+/// of the cycle, whatever the order of the queries, and so does a frozen snapshot
+RUKH_TEST(type_set_cyclic_meta_types)
+{
+  const auto make_db = []
+  {
+    rukh::type_db db;
+    for (const char* name : {"x", "y", "z", "w"})
+      db.add_definition(rukh::test::make_concrete_type(name, 4));
+    db.add_definition(rukh::test::make_meta_type("A", {rukh::hash_string("B"), rukh::hash_string("x")}));
+    db.add_definition(rukh::test::make_meta_type("B", {rukh::hash_string("C"), rukh::hash_string("y")}));
+    db.add_definition(rukh::test::make_meta_type("C", {rukh::hash_string("A"), rukh::hash_string("z")}));
+    db.add_definition(rukh::test::make_meta_type("D", {rukh::hash_string("B"), rukh::hash_string("w")})); // (not in the cycle)
+    return db;
+  };
+  const std::vector<std::vector<const char*>> orders = {{"A", "B", "C", "D"}, {"C", "B", "A", "D"}, {"D", "B", "A", "C"}};
+  for (const std::vector<const char*>& order : orders)
+  {
+    const rukh::type_db db = make_db();
+    bool complete = true;
+    for (const char* name : order)
+    {
+      const size_t expected = name[0] == 'D' ? 4 : 3;
+      complete = complete && db.get_type(rukh::hash_string(name)).get_accepted_types().count() == expected;
+    }
+    RUKH_CHECK(complete);
+    RUKH_CHECK(!db.get_type(rukh::hash_string("A")).accepts(db.get_type(rukh::hash_string("w"))));
+  }
+
+  const rukh::frozen_type_db frozen = make_db().freeze();
+  bool complete = true;
+  for (const char* name : {"A", "B", "C"})
+  {
+    for (const char* concrete : {"x", "y", "z"})
+      complete = complete && frozen.get_type(rukh::hash_string(name)).accepts(frozen.get_type(rukh::hash_string(concrete)));
+  }
+  RUKH_CHECK(complete && frozen.get_type(rukh::hash_string("D")).accepts(frozen.get_type(rukh::hash_string("z"))));
+}
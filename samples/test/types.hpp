@@ -0,0 +1,24 @@
+
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <rukh/rukh.hpp>
+
+namespace rukh::test
+{
+  /// \brief A concrete type without members
+  inline type::definition make_concrete_type(const std::string& name, size_t size, size_t dim = 1)
+  {
+    return {hash_string(name), name, size, dim, {}, true};
+  }
+
+  /// \brief A meta-type accepting the given subtypes
+  inline type::definition make_meta_type(const std::string& name, std::set<type::ref> subtypes)
+  {
+    type::definition ret = {hash_string(name), name, 0, 1, {}, false};
+    ret.subtypes = std::move(subtypes);
+    return ret;
+  }
+} // namespace rukh::test
@@ -0,0 +1,177 @@
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <rukh/rukh.hpp>
+
+#include "nodes.hpp"
+#include "test.hpp"
+
+namespace rukh::test
+{
+  inline const hash_t k_float4x4 = rukh_str_hash("float4x4");
+  using float4x4 = std::array<float, 16>;
+
+  /// A 4x4 matrix constant (64 bytes: stored out of line in the value table)
+  struct matrix_node : node<matrix_node, rk_str("matrix"), inputs<>, outputs<pin<rk_str("value"), rk_str("float4x4")>>, params<>>
+  {
+    static constexpr const char* description = "a float4x4 constant";
+    float4x4 data = {};
+
+    bool resolve_output_types(reporter&) override { output<rk_str("value")>().set_type(k_float4x4); return true; }
+    bool validate(reporter&) const override { return true; }
+    bool is_constant() const override { return true; }
+    void const_generate(reporter&, value_table& values) override
+    {
+      output<rk_str("value")>().set_value(values.add_constant_of(k_float4x4, data));
+    }
+    uint64_t get_state_hash() const override { return hash_bytes(k_hash_seed, data.data(), sizeof(data)); }
+    bool generate(reporter&, generator&) override { return false; }
+  };
+
+  inline float4x4 make_matrix(float base)
+  {
+    float4x4 ret;
+    for (size_t i = 0; i < ret.size(); ++i)
+      ret[i] = base + float(i);
+    return ret;
+  }
+} // namespace rukh::test
+
+/// Inline (at most k_inline_size bytes) and out of line constants, and compact(): the remapped handles read the same
+/// data, and the memory of the removed constants is released
+RUKH_TEST(value_table_compact)
+{
+  const rukh::hash_t k_bytes = rukh::hash_string("bytes");
+  rukh::value_table values;
+  std::vector<rukh::value> handles;
+  std::vector<uint8_t> keep;
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    handles.push_back(values.add_constant_of(rukh::test::k_float4x4, rukh::test::make_matrix(float(i)))); // 64 bytes
+    handles.push_back(values.add_constant_of(rukh::test::k_float, float(i)));
+    handles.push_back(values.add(rukh::test::k_float));
+    const std::array<uint8_t, 16> inline_bytes = {uint8_t(i), 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, uint8_t(i >> 8)};
+    handles.push_back(values.add_constant_of(k_bytes, inline_bytes)); // (exactly k_inline_size bytes)
+    const std::array<uint8_t, 17> big_bytes = {uint8_t(i), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, uint8_t(i >> 8)};
+    handles.push_back(values.add_constant_of(k_bytes, big_bytes));
+    for (uint32_t j = 0; j < 5; ++j)
+      keep.push_back(i % 3 == 0 ? 1 : 0);
+  }
+  RUKH_CHECK(values.get_count() == 5000 && values.get_out_of_line_size() >= 1000 * (64 + 17));
+  const size_t out_of_line_size = values.get_out_of_line_size();
+  RUKH_CHECK(reinterpret_cast<uintptr_t>(values.get_data(handles[0]).data()) % rukh::value_table::k_data_alignment == 0);
+  RUKH_CHECK(reinterpret_cast<uintptr_t>(values.get_data(handles[3]).data()) % rukh::value_table::k_data_alignment == 0);
+  RUKH_CHECK(!values.is_constant(handles[2]) && values.get_data(handles[2]).empty() && values.get_size(handles[2]) == 0);
+
+  // invalid handles and handles that are not in the table:
+  for (const rukh::value v : {rukh::value{}, rukh::value(5000)})
+  {
+    RUKH_CHECK(!values.contains(v) && !values.is_constant(v) && values.get_type(v) == rukh::type::ref::zero);
+    RUKH_CHECK(values.get_size(v) == 0 && values.get_data(v).empty() && values.get_components<float>(v).empty());
+  }
+
+  const std::vector<uint32_t> remap = values.compact(keep);
+  RUKH_CHECK(values.get_count() == 334 * 5 && remap.size() == 5000);
+  RUKH_CHECK(values.get_out_of_line_size() < out_of_line_size / 2);
+  bool same = true;
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    if (i % 3 != 0)
+    {
+      for (uint32_t j = 0; j < 5; ++j)
+        same = same && remap[handles[i * 5 + j].get_index()] == ~0u;
+      continue;
+    }
+    const rukh::value matrix(remap[handles[i * 5].get_index()]);
+    const rukh::value scalar(remap[handles[i * 5 + 1].get_index()]);
+    const rukh::value runtime(remap[handles[i * 5 + 2].get_index()]);
+    const rukh::value inline_bytes(remap[handles[i * 5 + 3].get_index()]);
+    const rukh::value big_bytes(remap[handles[i * 5 + 4].get_index()]);
+    same = same && matrix.get_index() == i / 3 * 5; // (kept values keep their order)
+    const rukh::span<float> components = values.get_components<float>(matrix);
+    const rukh::test::float4x4 expected = rukh::test::make_matrix(float(i));
+    same = same && values.get_type(matrix) == rukh::test::k_float4x4 && std::equal(components.begin(), components.end(), expected.begin(), expected.end());
+    float f = 0;
+    same = same && values.get(scalar, f) && f == float(i);
+    same = same && !values.is_constant(runtime) && values.get_type(runtime) == rukh::test::k_float;
+    same = same && values.get_size(inline_bytes) == 16 && values.get_data(inline_bytes)[0] == uint8_t(i) && values.get_data(inline_bytes)[15] == uint8_t(i >> 8);
+    same = same && values.get_size(big_bytes) == 17 && values.get_data(big_bytes)[0] == uint8_t(i) && values.get_data(big_bytes)[16] == uint8_t(i >> 8);
+  }
+  RUKH_CHECK(same);
+}
+
+/// share(): the out of line constants are shared (not copied), the table can be added to without changing the other
+/// one, and compact() ends the sharing
+RUKH_TEST(value_table_share)
+{
+  rukh::value_table base;
+  const rukh::value matrix = base.add_constant_of(rukh::test::k_float4x4, rukh::test::make_matrix(1.f));
+  const rukh::value scalar = base.add_constant_of(rukh::test::k_float, 2.f);
+
+  rukh::value_table shared;
+  shared.share(base);
+  RUKH_CHECK(shared.get_count() == 2 && shared.get_out_of_line_size() == 0);
+  RUKH_CHECK(shared.get_data(matrix).data() == base.get_data(matrix).data());
+  RUKH_CHECK(shared.get_data(scalar).data() != base.get_data(scalar).data());
+  float f = 0;
+  RUKH_CHECK(shared.set(scalar, 3.f) && base.get(scalar, f) && f == 2.f);
+
+  const rukh::value added = shared.add_constant_of(rukh::test::k_float4x4, rukh::test::make_matrix(5.f));
+  RUKH_CHECK(added.get_index() == 2 && base.get_count() == 2 && shared.get_out_of_line_size() >= 64);
+
+  const std::vector<uint8_t> keep = {1, 0, 1};
+  const std::vector<uint32_t> remap = shared.compact(keep);
+  const rukh::value new_matrix(remap[matrix.get_index()]);
+  RUKH_CHECK(remap[scalar.get_index()] == ~0u && new_matrix.get_index() == 0 && remap[added.get_index()] == 1);
+  RUKH_CHECK(shared.get_data(new_matrix).data() != base.get_data(matrix).data());
+  RUKH_CHECK(shared.get_components<float>(new_matrix)[15] == 16.f && shared.get_components<float>(rukh::value(1))[0] == 5.f);
+  RUKH_CHECK(base.get_components<float>(matrix)[15] == 16.f && base.get(scalar, f) && f == 2.f);
+}
+
+/// The resolver compacts the value table of the graph once update() has doubled it: the constants of the re-run nodes
+/// are released, and the pins read the same constants through their remapped handles
+RUKH_TEST(value_table_resolver_compaction)
+{
+  constexpr uint32_t k_node_count = 3000;
+  rukh::graph g;
+  std::vector<rukh::node_handle> matrices;
+  std::vector<rukh::node_handle> scalars;
+  for (uint32_t i = 0; i < k_node_count; ++i)
+  {
+    matrices.push_back(g.add_node<rukh::test::matrix_node>());
+    static_cast<rukh::test::matrix_node&>(g.get_node(matrices.back())).data = rukh::test::make_matrix(float(i));
+    scalars.push_back(g.add_node<rukh::test::constant_node>());
+    static_cast<rukh::test::constant_node&>(g.get_node(scalars.back())).data = float(i);
+  }
+  rukh::reporter r;
+  rukh::resolver res(g);
+  RUKH_CHECK(res.resolve(r) && g.get_values().get_count() == 2 * k_node_count);
+
+  // re-run the matrix nodes (with new data) until the table is compacted:
+  uint32_t round = 0;
+  for (; round < 4 && res.get_stats().released_values == 0; ++round)
+  {
+    for (uint32_t i = 0; i < k_node_count; ++i)
+    {
+      static_cast<rukh::test::matrix_node&>(g.get_node(matrices[i])).data = rukh::test::make_matrix(float(i + 1000 * (round + 1)));
+      g.mark_dirty(matrices[i]);
+    }
+    RUKH_CHECK(res.update(r));
+  }
+  RUKH_CHECK(res.get_stats().released_values == round * k_node_count && g.get_values().get_count() == 2 * k_node_count);
+
+  const rukh::value_table& values = g.get_values();
+  bool same = true;
+  for (uint32_t i = 0; i < k_node_count; ++i)
+  {
+    const rukh::value m = g.get_node(matrices[i]).get_output_impls()[0].get_value();
+    const rukh::span<const float> components = values.get_components<float>(m);
+    const rukh::test::float4x4 expected = rukh::test::make_matrix(float(i + 1000 * round));
+    same = same && std::equal(components.begin(), components.end(), expected.begin(), expected.end());
+    float f = 0;
+    same = same && values.get(g.get_node(scalars[i]).get_output_impls()[0].get_value(), f) && f == float(i);
+  }
+  RUKH_CHECK(same);
+}